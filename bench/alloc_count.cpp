@@ -0,0 +1,384 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// Heap allocations per call of the code every node evaluation goes through:
+// the solver kernels of mgear_math.h, the Maya typed helpers of utils.cpp,
+// then the compute() and deform() of the nodes themselves. Global new and
+// malloc are counted while each one runs.
+//
+// The nodes run on the Maya API stand-in of tools/mayashim. Build from the
+// repository root:
+//     g++ -O2 -std=c++11 -pthread -Itools/mayashim -Isrc src/*.cpp
+//         tools/mayashim/mayashim.cpp bench/alloc_count.cpp -o alloc_count
+//     ./alloc_count
+//
+// A kernel or helper that allocates fails the run. The node counts are a
+// report: they include the allocations of the stand-in's data block (an
+// array builder copies its elements, an MPlug holds its parent) and of the
+// spring caches, which store each new frame. The mesh nodes,
+// mgear_rayCastPosition and mgear_vertexPosition, aren't run.
+/////////////////////////////////////////////////
+
+#include "mgear_solvers.h"
+
+#include <maya/MFnPlugin.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static long g_allocations = 0;
+
+// replaced operators, kept out of line so the compiler doesn't pair the
+// malloc below with the delete of the caller
+#if defined(__GNUC__)
+#define MGEAR_NOINLINE __attribute__((noinline))
+#else
+#define MGEAR_NOINLINE
+#endif
+
+MGEAR_NOINLINE void* operator new(std::size_t size)
+{
+	g_allocations++;
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+MGEAR_NOINLINE void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+MGEAR_NOINLINE void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+MGEAR_NOINLINE void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+static int g_failures = 0;
+
+// runs f calls times and prints the allocations per call, strict ones fail
+// the run when they allocate
+template <typename F>
+static void count(const char* name, int calls, F f, bool strict = true)
+{
+	long before = g_allocations;
+	for (int i = 0; i < calls; i++)
+		f();
+	double perCall = (double)(g_allocations - before) / calls;
+	printf("%-40s %8.2f\n", name, perCall);
+	if (strict && perCall > 0.0)
+		g_failures++;
+}
+
+/////////////////////////////////////////////////
+// NODES
+/////////////////////////////////////////////////
+
+PLUGIN_EXPORT MStatus initializePlugin(MObject obj);
+
+// A node and the inputs set before it runs, "plug=value" items. The plug
+// can go down compounds and elements, "driverList[0].driverListWeight", and
+// a range "blends[0..7]" sets each element. Numbers go to numeric
+// attributes, matrices get a translation of value along x, double and
+// vector arrays 16 items of value, curves a six point cubic.
+struct s_NodeCase
+{
+	const char* type;
+	const char* inputs;
+};
+
+static const s_NodeCase g_nodeCases[] = {
+	{ "mgear_ikfk2Bone", "blend=0.5 lengthA=3 lengthB=3 ikref=4 upv=1" },
+	{ "mgear_rollSplineKine", "ctlParent[0..3]=1 inputs[0..3]=2 u=0.4" },
+	{ "mgear_squashStretch2", "driver=4 count=8" },
+	{ "mgear_inverseRotOrder", "" },
+	{ "mgear_mulMatrix", "matrixA=1 matrixB=2" },
+	{ "mgear_matrixChain", "matrix=1 matrixIn[0..7]=2" },
+	{ "mgear_intMatrix", "matrixA=1 matrixB=3 blend=0.3 count=8" },
+	{ "mgear_percentageToU", "curve=1 percentage=40" },
+	{ "mgear_spinePointAt", "rotAX=30 rotBY=120 blend=0.3 blends[0..7]=0.6" },
+	{ "mgear_uToPercentage", "curve=1 u=0.6" },
+	{ "mgear_springNode", "goalX=1 stiffness=0.5 damping=0.3" },
+	{ "mgear_rotationalSpringNode", "goal=1 stiffness=0.5 damping=0.3" },
+	{ "mgear_springChainNode", "goal[0..7]=1 stiffness=0.5 damping=0.3" },
+	{ "mgear_linearInterpolate3DvectorNode", "vectorA=1 vectorB=2 blend=0.5" },
+	{ "mgear_linearInterpolateVectorArrayNode", "vectorArrayA=1 vectorArrayB=2 blend=0.5" },
+	{ "mgear_add10scalarNode", "" },
+	{ "mgear_weightedSumNode", "inValue[0..7]=2 inWeight[0..7]=0.5" },
+	{ "mgear_trigonometryAngle", "angle=0.5 angleArray=0.5" },
+	{ "mgear_matrixConstraint", "driverMatrix=2 driverList[0..1].driverListMatrix=1 driverList[0..1].driverListWeight=0.5" },
+	{ "mgear_curveCns", "inputs[0..3]=1" },
+	{ "mgear_slideCurve2", "master_crv=1 position=0.3" },
+};
+
+static const mshim::Attribute* findAttribute(const MObject& node, const std::string& name, MObject& attribute)
+{
+	std::vector<MObject> all = mshim::attributes(node);
+	for (size_t i = 0; i < all.size(); i++) {
+		const mshim::Attribute* attr = mshim::attribute(all[i]);
+		if (attr->name == name || attr->shortName == name) {
+			attribute = all[i];
+			return attr;
+		}
+	}
+	return 0;
+}
+
+// "a[0..3].b" -> "a[0].b" .. "a[3].b"
+static void expandRanges(const std::string& path, std::vector<std::string>& out)
+{
+	size_t dots = path.find("..");
+	if (dots == std::string::npos) {
+		out.push_back(path);
+		return;
+	}
+	size_t open = path.rfind('[', dots);
+	size_t close = path.find(']', dots);
+	int first = std::atoi(path.c_str() + open + 1);
+	int last = std::atoi(path.c_str() + dots + 2);
+	for (int i = first; i <= last; i++) {
+		std::ostringstream ss;
+		ss << path.substr(0, open + 1) << i << path.substr(close);
+		expandRanges(ss.str(), out);
+	}
+}
+
+static bool setInput(const MObject& node, const std::string& path, double value)
+{
+	MPlug plug;
+	const mshim::Attribute* attr = 0;
+	std::istringstream parts(path);
+	std::string part;
+	while (std::getline(parts, part, '.')) {
+		size_t bracket = part.find('[');
+		MObject attribute;
+		attr = findAttribute(node, part.substr(0, bracket), attribute);
+		if (!attr)
+			return false;
+		plug = plug.isNull() ? MPlug(node, attribute) : plug.child(attribute);
+		if (bracket != std::string::npos)
+			plug = plug.elementByLogicalIndex((unsigned)std::atoi(part.c_str() + bracket + 1));
+	}
+
+	MDataHandle h = mshim::dataBlock(node).inputValue(plug);
+	if (attr->kind == mshim::kMatrix) {
+		MMatrix m;
+		m.matrix[3][0] = value;
+		h.setMMatrix(m);
+	}
+	else if (attr->kind == mshim::kTyped && attr->type == MFnData::kNurbsCurve) {
+		MPointArray cvs;
+		MDoubleArray knots;
+		for (int i = 0; i < 6; i++)
+			cvs.append(MPoint(i * value, (i % 2) * value, 0.0));
+		const double k[] = { 0, 0, 0, 1, 2, 3, 3, 3 };
+		for (int i = 0; i < 8; i++)
+			knots.append(k[i]);
+		MObject owner = MFnNurbsCurveData().create();
+		MFnNurbsCurve().create(cvs, knots, 3, MFnNurbsCurve::kOpen, false, false, owner);
+		h.set(owner);
+	}
+	else if (attr->kind == mshim::kTyped && attr->type == MFnData::kDoubleArray)
+		h.set(MFnDoubleArrayData().create(MDoubleArray(16, value)));
+	else if (attr->kind == mshim::kTyped && attr->type == MFnData::kVectorArray)
+		h.set(MFnVectorArrayData().create(MVectorArray(16, MVector(value, 0.0, value))));
+	else if (attr->kind == mshim::kUnit && attr->type == MFnUnitAttribute::kTime)
+		h.setMTime(MTime(value, MTime::uiUnit()));
+	else if (!attr->children.empty())
+		h.set3Double(value, value, value);
+	else
+		h.setDouble(value);
+	mshim::dirty(plug);
+	return true;
+}
+
+// Evaluates the node once: every computed output, or deform() on points
+static void evaluateNode(const MObject& node, const std::vector<MObject>& outputs, const MObject& time, double frame, MPointArray& points)
+{
+	if (!time.isNull()) {
+		mshim::dataBlock(node).inputValue(time).setMTime(MTime(frame, MTime::uiUnit()));
+		mshim::dirty(MPlug(node, time));
+	}
+	if (mshim::isDeformer(node)) {
+		for (unsigned i = 0; i < points.length(); i++)
+			points[i] = MPoint(i * 0.1, 0.0, 0.0);
+		mshim::deform(node, points, MMatrix());
+		return;
+	}
+	for (size_t o = 0; o < outputs.size(); o++)
+		mshim::compute(MPlug(node, outputs[o]));
+}
+
+static void countNodes(int calls)
+{
+	if (!mshim::loadPlugin(initializePlugin)) {
+		printf("initializePlugin() failed\n");
+		g_failures++;
+		return;
+	}
+
+	for (size_t c = 0; c < sizeof(g_nodeCases) / sizeof(g_nodeCases[0]); c++) {
+		const s_NodeCase& nodeCase = g_nodeCases[c];
+		MObject node = mshim::createNode(nodeCase.type);
+		if (node.isNull()) {
+			printf("%-40s %8s\n", nodeCase.type, "missing");
+			g_failures++;
+			continue;
+		}
+
+		std::istringstream items(nodeCase.inputs);
+		std::string item;
+		while (items >> item) {
+			size_t equal = item.find('=');
+			std::vector<std::string> paths;
+			expandRanges(item.substr(0, equal), paths);
+			for (size_t i = 0; i < paths.size(); i++) {
+				if (!setInput(node, paths[i], std::atof(item.c_str() + equal + 1))) {
+					printf("%s: no plug %s\n", nodeCase.type, paths[i].c_str());
+					g_failures++;
+				}
+			}
+		}
+
+		// the outputs, as top level attributes, and the time that drives the springs
+		std::vector<MObject> outputs;
+		std::vector<MObject> affected = mshim::affectedAttributes(node);
+		for (size_t i = 0; i < affected.size(); i++) {
+			if (!mshim::attribute(affected[i])->parent)
+				outputs.push_back(affected[i]);
+		}
+		MObject time;
+		findAttribute(node, "time", time);
+		MPointArray points(16);
+
+		// the first evaluations fill the outputs and the caches
+		double frame = 1.0;
+		for (int i = 0; i < 3; i++)
+			evaluateNode(node, outputs, time, frame++, points);
+		count(nodeCase.type, calls, [&]() { evaluateNode(node, outputs, time, frame++, points); }, false);
+	}
+}
+
+/////////////////////////////////////////////////
+// MAIN
+/////////////////////////////////////////////////
+
+int main()
+{
+	const int calls = 1000;
+	const int n = 64;
+
+	// inputs are allocated up front, outside of the counted calls
+	double m[4][4] = { { 0.8, 0.2, 0.1, 0.0 }, { -0.3, 1.1, 0.4, 0.0 }, { 0.0, -0.2, 0.9, 0.0 }, { 1.0, 2.0, 3.0, 1.0 } };
+	double m2[4][4], m3[4][4];
+	s_TRS a, b, c;
+	decomposeTRS(m, a);
+	b = a;
+	b.q[0] = 0.3;
+	b.t[1] = -4.0;
+	s_TRS trs[2] = { a, b };
+	double weights[2] = { 0.25, 0.75 };
+	double qa[4] = { 0.0, 0.0, 0.0, 1.0 }, qb[4] = { 0.2, 0.4, 0.1, 0.89 }, q[4];
+	std::vector<double> blends(n), amounts(n), angles(n), s(n), cs(n), vo(n * 3), qs(n * 4);
+	std::vector<float> values(n), fweights(n);
+	for (int i = 0; i < n; i++) {
+		blends[i] = i / (n - 1.0);
+		amounts[i] = blends[i] - 0.5;
+		angles[i] = blends[i] * 7.0;
+		values[i] = (float)i;
+		fweights[i] = 0.5f;
+		qs[i * 4 + 3] = 1.0;
+	}
+	std::vector<s_TRS> trsOut(n);
+	double gscale[3] = { 1.0, 1.0, 1.0 };
+
+	printf("%-40s %8s\n", "kernel", "allocs");
+	count("multiplyMatrix4", calls, [&]() { multiplyMatrix4(m, m, m2); });
+	count("invertMatrix4", calls, [&]() { invertMatrix4(m, m2); });
+	count("decomposeTRS", calls, [&]() { decomposeTRS(m, c); });
+	count("composeTRS", calls, [&]() { composeTRS(a, m3); });
+	for (int mode = MGEAR_INTERPOLATE_SLERP; mode <= MGEAR_INTERPOLATE_LOG; mode++)
+		count(mode == 0 ? "interpolateTRSMode slerp" : mode == 1 ? "interpolateTRSMode dq" : "interpolateTRSMode log", calls, [&]() { interpolateTRSMode(a, b, 0.3, mode, c); });
+	count("interpolateTRSArray", calls, [&]() { interpolateTRSArray(a, b, &blends[0], n, &trsOut[0]); });
+	count("blendTRS", calls, [&]() { blendTRS(trs, weights, 2, c); });
+	count("eulerToQuaternion", calls, [&]() { eulerToQuaternion(10.0, 20.0, 30.0, q); });
+	count("slerpQuaternionFast", calls, [&]() { slerpQuaternionFast(qa, qb, 0.3, q); });
+	count("slerpQuaternionLong", calls, [&]() { slerpQuaternionLong(qa, qb, 0.3, q); });
+	count("quaternionAxisArray", calls, [&]() { quaternionAxisArray(4, (const double(*)[4])&qs[0], n, (double(*)[3])&vo[0]); });
+	count("squashStretchArray", calls, [&]() { squashStretchArray(1, gscale, &amounts[0], n, 0.8, (double(*)[3])&vo[0]); });
+	count("sinCosArray", calls, [&]() { sinCosArray(&angles[0], n, &s[0], &cs[0]); });
+	count("weightedSum", calls, [&]() { weightedSum(&values[0], &fweights[0], n); });
+
+
+	// the Maya typed helpers of utils.cpp
+	MQuaternion mqa(0.0, 0.0, 0.0, 1.0), mqb(0.2, 0.4, 0.1, 0.89), mq;
+	MVector va(1.0, 2.0, 3.0), vb(-1.0, 0.5, 2.0), vc;
+	MDoubleArray sorted(n);
+	for (int i = 0; i < n; i++)
+		sorted[i] = i / (n - 1.0);
+	MMatrix mm(m), mm2(m2);
+	MTransformationMatrix xa(mm), xb(mm.inverse()), xc;
+	s_SpringCoefficients coef = springCoefficients(0.5, 0.3);
+	double d = 0.0;
+
+	printf("\n%-40s %8s\n", "utils.cpp", "allocs");
+	count("e2q", calls, [&]() { mq = e2q(10.0, 20.0, 30.0); });
+	count("slerp2", calls, [&]() { mq = slerp2(mqa, mqb, 0.3); });
+	count("getDot", calls, [&]() { d += getDot(mqa, mqb); });
+	count("findClosestInArray", calls, [&]() { d += findClosestInArray(0.3, sorted); });
+	count("linearInterpolate MVector", calls, [&]() { vc = linearInterpolate(va, vb, 0.3); });
+	count("bezier4point", calls, [&]() { s_BezierPoint p = bezier4point(va, vb, vb, va, 0.3); d += p.position.x; });
+	count("rotateVectorAlongAxis", calls, [&]() { vc = rotateVectorAlongAxis(va, vb.normal(), 0.3); });
+	count("getQuaternionFromAxes", calls, [&]() { mq = getQuaternionFromAxes(MVector(1, 0, 0), MVector(0, 1, 0), MVector(0, 0, 1)); });
+	count("mapWorldPoseToObjectSpace", calls, [&]() { xc = mapWorldPoseToObjectSpace(xa, xb); });
+	count("mapObjectPoseToWorldSpace", calls, [&]() { xc = mapObjectPoseToWorldSpace(xa, xb); });
+	count("transformFromTRS", calls, [&]() { xc = transformFromTRS(a); });
+	for (int mode = MGEAR_INTERPOLATE_SLERP; mode <= MGEAR_INTERPOLATE_LOG; mode++)
+		count(mode == 0 ? "interpolateTransform slerp" : mode == 1 ? "interpolateTransform dq" : "interpolateTransform log", calls, [&]() { xc = interpolateTransform(xa, xb, 0.3, mode); });
+	count("springVelocity", calls, [&]() { vc = springVelocity(va, vb, coef, 0.25); });
+
+	printf("\n%-40s %8s\n", "node, per evaluation", "allocs");
+	countNodes(calls);
+
+	if (g_failures)
+		printf("\n%d kernel(s) or helper(s) allocate, or a node failed\n", g_failures);
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// Cost of the axis specialized kernels of mgear_squashStretch2 and
+// mgear_spinePointAt against the branch per call code they replace.
+//
+// Maya free, build and run from the repository root:
+//     g++ -O2 -std=c++11 -Isrc bench/axis_bench.cpp -o axis_bench
+//     ./axis_bench
+/////////////////////////////////////////////////
+
+#include "mgear_math.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double random(double low, double high)
+{
+	return low + (high - low) * (std::rand() / (double)RAND_MAX);
+}
+
+// former mgear_squashStretch2 compute, axis tested per call
+static void legacySquashStretch(const double gscale[3], int axis, double amount, double blend, double out[3])
+{
+	double sx = gscale[0], sy = gscale[1], sz = gscale[2];
+	if (axis != 0)
+		sx *= std::max(0.0, 1.0 + amount);
+	if (axis != 1)
+		sy *= std::max(0.0, 1.0 + amount);
+	if (axis != 2)
+		sz *= std::max(0.0, 1.0 + amount);
+	out[0] = std::max(gscale[0] * (1.0 - blend) + sx * blend, 0.0001);
+	out[1] = std::max(gscale[1] * (1.0 - blend) + sy * blend, 0.0001);
+	out[2] = std::max(gscale[2] * (1.0 - blend) + sz * blend, 0.0001);
+}
+
+// former mgear_spinePointAt, unit vector from a switch then a full rotation
+static void legacyPointAt(const double q[4], int axe, double out[3])
+{
+	double v[3] = { 0.0, 0.0, 0.0 };
+	switch (axe) {
+		case 0: v[0] = 1.0; break;
+		case 1: v[1] = 1.0; break;
+		case 2: v[2] = 1.0; break;
+		case 3: v[0] = -1.0; break;
+		case 4: v[1] = -1.0; break;
+		case 5: v[2] = -1.0; break;
+	}
+	quatRotate(q, v, out);
+}
+
+template <typename F>
+static double bestNs(int count, int runs, F f)
+{
+	double best = 1.0e30;
+	for (int r = 0; r < runs; r++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / count);
+	}
+	return best;
+}
+
+int main()
+{
+	const int count = 100000;
+	const int runs = 7;
+	std::srand(1);
+
+	// squash and stretch, a chain of count joints
+	double gscale[3] = { 1.0, 1.0, 1.0 };
+	std::vector<double> amounts(count), out(count * 3);
+	for (int i = 0; i < count; i++)
+		amounts[i] = random(-1.5, 1.5);
+	for (int axis = 0; axis < 3; axis++) {
+		double diff = 0.0;
+		squashStretchArray(axis, gscale, &amounts[0], count, 0.8, (double(*)[3])&out[0]);
+		for (int i = 0; i < count; i++) {
+			double ref[3];
+			legacySquashStretch(gscale, axis, amounts[i], 0.8, ref);
+			for (int j = 0; j < 3; j++)
+				diff = std::max(diff, std::fabs(ref[j] - out[i * 3 + j]));
+		}
+		double legacyNs = bestNs(count, runs, [&]() {
+			for (int i = 0; i < count; i++)
+				legacySquashStretch(gscale, axis, amounts[i], 0.8, &out[i * 3]);
+		});
+		double kernelNs = bestNs(count, runs, [&]() {
+			squashStretchArray(axis, gscale, &amounts[0], count, 0.8, (double(*)[3])&out[0]);
+		});
+		printf("squashStretch axis %d   per call %5.2f ns   array %5.2f ns   max diff %.1e\n", axis, legacyNs, kernelNs, diff);
+	}
+	printf("\n");
+
+	// spinePointAt axis, from unit quaternions
+	std::vector<double> q(count * 4);
+	for (int i = 0; i < count; i++) {
+		double n = 0.0;
+		for (int j = 0; j < 4; j++) {
+			q[i * 4 + j] = random(-1.0, 1.0);
+			n += q[i * 4 + j] * q[i * 4 + j];
+		}
+		for (int j = 0; j < 4; j++)
+			q[i * 4 + j] /= std::sqrt(n);
+	}
+	for (int axe = 0; axe < 6; axe++) {
+		double diff = 0.0;
+		quaternionAxisArray(axe, (const double(*)[4])&q[0], count, (double(*)[3])&out[0]);
+		for (int i = 0; i < count; i++) {
+			double ref[3];
+			legacyPointAt(&q[i * 4], axe, ref);
+			for (int j = 0; j < 3; j++)
+				diff = std::max(diff, std::fabs(ref[j] - out[i * 3 + j]));
+		}
+		double legacyNs = bestNs(count, runs, [&]() {
+			for (int i = 0; i < count; i++)
+				legacyPointAt(&q[i * 4], axe, &out[i * 3]);
+		});
+		double kernelNs = bestNs(count, runs, [&]() {
+			quaternionAxisArray(axe, (const double(*)[4])&q[0], count, (double(*)[3])&out[0]);
+		});
+		printf("pointAt axe %d   rotate %5.2f ns   basis row %5.2f ns   max diff %.1e\n", axe, legacyNs, kernelNs, diff);
+	}
+
+	return 0;
+}
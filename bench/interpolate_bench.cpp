@@ -0,0 +1,273 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// Cost and accuracy of the interpolation modes of mgear_math.h
+// (interpolateTRSMode), the ones exposed on mgear_intMatrix and mgear_ikfk2Bone.
+//
+// Maya free, build and run from the repository root:
+//     g++ -O2 -std=c++11 -Isrc bench/interpolate_bench.cpp -o interpolate_bench
+//     ./interpolate_bench [pairs]
+//
+// The accuracy is measured against the screw motion between the two
+// transforms, rebuilt here in long double from the rotation matrix of the
+// relative motion and the point of its axis, without the quaternion log and
+// exp of the log mode. Rotation error is in degrees, position error is
+// relative to the distance between the two transforms. The last line checks
+// the log mode on blends outside [0, 1].
+/////////////////////////////////////////////////
+
+#include "mgear_math.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double random(double low, double high)
+{
+	return low + (high - low) * (std::rand() / (double)RAND_MAX);
+}
+
+// random rigid transform, the rotation of b is up to maxAngle away from a
+static void randomPair(double maxAngle, s_TRS& a, s_TRS& b)
+{
+	for (int j = 0; j < 3; j++) {
+		a.t[j] = random(-10.0, 10.0);
+		b.t[j] = random(-10.0, 10.0);
+		a.s[j] = b.s[j] = 1.0;
+		a.sh[j] = b.sh[j] = 0.0;
+	}
+
+	double n = 0.0;
+	for (int j = 0; j < 4; j++) {
+		a.q[j] = random(-1.0, 1.0);
+		n += a.q[j] * a.q[j];
+	}
+	for (int j = 0; j < 4; j++)
+		a.q[j] /= std::sqrt(n);
+
+	double axis[3] = { random(-1.0, 1.0), random(-1.0, 1.0), random(-1.0, 1.0) };
+	normalize3(axis);
+	double angle = random(0.0, maxAngle);
+	double d[4] = { axis[0] * std::sin(angle / 2.0), axis[1] * std::sin(angle / 2.0), axis[2] * std::sin(angle / 2.0), std::cos(angle / 2.0) };
+	quatMultiply(a.q, d, b.q);
+}
+
+typedef long double real;
+
+// A transform of the reference, rotation matrix (column vectors) and translation
+struct s_Rigid
+{
+	real r[3][3];
+	real t[3];
+};
+
+static void quaternionMatrix(const double q[4], real r[3][3])
+{
+	real x = q[0], y = q[1], z = q[2], w = q[3];
+	r[0][0] = 1 - 2 * (y * y + z * z); r[0][1] = 2 * (x * y - z * w);     r[0][2] = 2 * (x * z + y * w);
+	r[1][0] = 2 * (x * y + z * w);     r[1][1] = 1 - 2 * (x * x + z * z); r[1][2] = 2 * (y * z - x * w);
+	r[2][0] = 2 * (x * z - y * w);     r[2][1] = 2 * (y * z + x * w);     r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+// Rodrigues, rotation of angle about the unit axis u
+static void axisAngleMatrix(const real u[3], real angle, real r[3][3])
+{
+	real c = std::cos(angle), s = std::sin(angle), k = 1 - c;
+	r[0][0] = c + u[0] * u[0] * k;        r[0][1] = u[0] * u[1] * k - u[2] * s; r[0][2] = u[0] * u[2] * k + u[1] * s;
+	r[1][0] = u[1] * u[0] * k + u[2] * s; r[1][1] = c + u[1] * u[1] * k;        r[1][2] = u[1] * u[2] * k - u[0] * s;
+	r[2][0] = u[2] * u[0] * k - u[1] * s; r[2][1] = u[2] * u[1] * k + u[0] * s; r[2][2] = c + u[2] * u[2] * k;
+}
+
+// Angle and unit axis of a rotation matrix, for angles below 180 degrees
+static real matrixAxisAngle(const real r[3][3], real u[3])
+{
+	u[0] = (r[2][1] - r[1][2]) / 2;
+	u[1] = (r[0][2] - r[2][0]) / 2;
+	u[2] = (r[1][0] - r[0][1]) / 2;
+	real s = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+	real angle = std::atan2(s, (r[0][0] + r[1][1] + r[2][2] - 1) / 2);
+	for (int j = 0; j < 3; j++)
+		u[j] = s > 0 ? u[j] / s : 0;
+	return angle;
+}
+
+// a followed by the part blend of the screw motion from a to b: the relative
+// motion turns by angle about the axis through c and slides by d along it,
+// c = (p + cot(angle / 2) u x p) / 2 for the part p of the translation
+// across the axis
+static void screwReference(const s_TRS& a, const s_TRS& b, double blend, s_Rigid& out)
+{
+	real ra[3][3], rb[3][3], rel[3][3], p[3] = { 0, 0, 0 };
+	quaternionMatrix(a.q, ra);
+	quaternionMatrix(b.q, rb);
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			rel[i][j] = 0;
+			for (int k = 0; k < 3; k++)
+				rel[i][j] += ra[k][i] * rb[k][j];
+		}
+		for (int k = 0; k < 3; k++)
+			p[i] += ra[k][i] * ((real)b.t[k] - (real)a.t[k]);
+	}
+
+	real u[3];
+	real angle = matrixAxisAngle(rel, u);
+	real d = u[0] * p[0] + u[1] * p[1] + u[2] * p[2];
+	real across[3] = { p[0] - d * u[0], p[1] - d * u[1], p[2] - d * u[2] };
+	real c[3] = { 0, 0, 0 };
+	if (angle > 1e-12L) {
+		real cotHalf = 1 / std::tan(angle / 2);
+		real ux[3] = { u[1] * across[2] - u[2] * across[1], u[2] * across[0] - u[0] * across[2], u[0] * across[1] - u[1] * across[0] };
+		for (int j = 0; j < 3; j++)
+			c[j] = (across[j] + cotHalf * ux[j]) / 2;
+	}
+
+	// partial motion: x -> R(x - c) + c + blend d u, no rotation is a slide
+	real rt[3][3], pt[3];
+	axisAngleMatrix(u, angle * blend, rt);
+	for (int i = 0; i < 3; i++) {
+		pt[i] = c[i] + blend * d * u[i];
+		for (int k = 0; k < 3; k++)
+			pt[i] -= rt[i][k] * c[k];
+		if (angle <= 1e-12L)
+			pt[i] = blend * p[i];
+	}
+
+	for (int i = 0; i < 3; i++) {
+		out.t[i] = a.t[i];
+		for (int j = 0; j < 3; j++) {
+			out.r[i][j] = 0;
+			for (int k = 0; k < 3; k++)
+				out.r[i][j] += ra[i][k] * rt[k][j];
+			out.t[i] += ra[i][j] * pt[j];
+		}
+	}
+}
+
+static double rotationError(const s_TRS& x, const s_Rigid& ref)
+{
+	// angle of the difference rotation
+	real rx[3][3], d[3][3], u[3];
+	quaternionMatrix(x.q, rx);
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			d[i][j] = 0;
+			for (int k = 0; k < 3; k++)
+				d[i][j] += rx[k][i] * ref.r[k][j];
+		}
+	}
+	return (double)(matrixAxisAngle(d, u) * 180 / 3.14159265358979323846L);
+}
+
+static double positionError(const s_TRS& x, const s_Rigid& ref)
+{
+	real pos = 0;
+	for (int j = 0; j < 3; j++)
+		pos += ((real)x.t[j] - ref.t[j]) * ((real)x.t[j] - ref.t[j]);
+	return (double)std::sqrt(pos);
+}
+
+int main(int argc, char* argv[])
+{
+	int pairs = (argc > 1) ? std::atoi(argv[1]) : 20000;
+	const int blendCount = 9;
+	const int runs = 7;
+	const char* names[3] = { "slerp", "dualQuaternion", "log" };
+	const double maxAngles[3] = { 30.0, 90.0, 179.0 };
+
+	std::srand(1);
+	printf("%d pairs x %d blends, best of %d runs\n\n", pairs, blendCount, runs);
+	printf("%-16s %10s | %28s | %28s | %28s\n", "mode", "ns/call", "max err <30deg (rot, pos)", "max err <90deg (rot, pos)", "max err <179deg (rot, pos)");
+
+	std::vector<s_TRS> a(pairs), b(pairs), out(pairs * blendCount);
+	double errors[3][3][2] = {};
+
+	for (int range = 0; range < 3; range++) {
+		for (int i = 0; i < pairs; i++)
+			randomPair(maxAngles[range] * 3.14159265358979 / 180.0, a[i], b[i]);
+
+		for (int mode = 0; mode < 3; mode++) {
+			for (int i = 0; i < pairs; i++) {
+				double dist = std::sqrt((b[i].t[0] - a[i].t[0]) * (b[i].t[0] - a[i].t[0]) + (b[i].t[1] - a[i].t[1]) * (b[i].t[1] - a[i].t[1]) + (b[i].t[2] - a[i].t[2]) * (b[i].t[2] - a[i].t[2]));
+				for (int k = 0; k < blendCount; k++) {
+					double blend = (k + 1) / (blendCount + 1.0);
+					s_TRS x;
+					s_Rigid ref;
+					interpolateTRSMode(a[i], b[i], blend, mode, x);
+					screwReference(a[i], b[i], blend, ref);
+					errors[mode][range][0] = std::max(errors[mode][range][0], rotationError(x, ref));
+					errors[mode][range][1] = std::max(errors[mode][range][1], positionError(x, ref) / std::max(dist, 1.0e-9));
+				}
+			}
+		}
+	}
+
+	for (int mode = 0; mode < 3; mode++) {
+		double best = 1.0e30;
+		double sink = 0.0;
+		for (int r = 0; r < runs; r++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int i = 0; i < pairs; i++) {
+				for (int k = 0; k < blendCount; k++)
+					interpolateTRSMode(a[i], b[i], (k + 1) / (blendCount + 1.0), mode, out[i * blendCount + k]);
+			}
+			std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			double ns = std::chrono::duration<double, std::nano>(end - start).count() / (pairs * blendCount);
+			best = std::min(best, ns);
+			sink += out[r % out.size()].t[0];
+		}
+
+		printf("%-16s %10.1f |", names[mode], best + sink * 0.0);
+		for (int range = 0; range < 3; range++)
+			printf("      %9.2e, %9.2e    |", errors[mode][range][0], errors[mode][range][1]);
+		printf("\n");
+	}
+
+	// log mode on blends outside [0, 1], on the pairs of the last range
+	const double outside[4] = { -1.0, -0.5, 1.5, 2.0 };
+	double rot = 0.0, pos = 0.0, norm = 0.0;
+	for (int i = 0; i < pairs; i++) {
+		double dist = std::sqrt((b[i].t[0] - a[i].t[0]) * (b[i].t[0] - a[i].t[0]) + (b[i].t[1] - a[i].t[1]) * (b[i].t[1] - a[i].t[1]) + (b[i].t[2] - a[i].t[2]) * (b[i].t[2] - a[i].t[2]));
+		for (int k = 0; k < 4; k++) {
+			s_TRS x;
+			s_Rigid ref;
+			interpolateTRSLog(a[i], b[i], outside[k], x);
+			screwReference(a[i], b[i], outside[k], ref);
+			rot = std::max(rot, rotationError(x, ref));
+			pos = std::max(pos, positionError(x, ref) / std::max(dist, 1.0e-9));
+			norm = std::max(norm, std::fabs(std::sqrt(x.q[0] * x.q[0] + x.q[1] * x.q[1] + x.q[2] * x.q[2] + x.q[3] * x.q[3]) - 1.0));
+		}
+	}
+	printf("\nlog, blends -1 .. 2 <179deg: max err %.2e deg, %.2e pos, quaternion norm off by %.2e\n", rot, pos, norm);
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// Error and cost of the quaternion paths used by mgear_spinePointAt:
+// e2q against eulerToQuaternion, and the exact slerp (slerpQuaternionLong)
+// against the fast one (slerpQuaternionFast), over the whole 0-360 range.
+//
+// Maya free, build and run from the repository root:
+//     g++ -O2 -std=c++11 -Isrc bench/slerp_bench.cpp -o slerp_bench
+//     ./slerp_bench
+//
+// Errors are the angle, in degrees, between the result and a long double
+// slerp.
+/////////////////////////////////////////////////
+
+#include "mgear_math.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double random(double low, double high)
+{
+	return low + (high - low) * (std::rand() / (double)RAND_MAX);
+}
+
+// e2q from utils.cpp, six trig calls
+static void legacyE2q(double x, double y, double z, double q[4])
+{
+	x = x * 3.14159265358979323846 / 180.0;
+	y = y * 3.14159265358979323846 / 180.0;
+	z = z * 3.14159265358979323846 / 180.0;
+	double c1 = std::cos(y / 2.0);
+	double s1 = std::sin(y / 2.0);
+	double c2 = std::cos(z / 2.0);
+	double s2 = std::sin(z / 2.0);
+	double c3 = std::cos(x / 2.0);
+	double s3 = std::sin(x / 2.0);
+	double c1c2 = c1 * c2;
+	double s1s2 = s1 * s2;
+	q[3] = c1c2 * c3 - s1s2 * s3;
+	q[0] = c1c2 * s3 + s1s2 * c3;
+	q[1] = s1 * c2 * c3 + c1 * s2 * s3;
+	q[2] = c1 * s2 * c3 - s1 * c2 * s3;
+}
+
+static void referenceSlerp(const double a[4], const double b[4], double blend, double out[4])
+{
+	long double d = 0.0L;
+	for (int j = 0; j < 4; j++)
+		d += (long double)a[j] * b[j];
+	long double s = std::sqrt(std::max(0.0L, 1.0L - d * d));
+	long double angle = std::atan2(s, d);
+	for (int j = 0; j < 4; j++) {
+		long double v = (std::sin((1.0L - blend) * angle) * a[j] + std::sin(blend * angle) * b[j]) / s;
+		out[j] = (double)v;
+	}
+}
+
+static double angleBetween(const double a[4], const double b[4])
+{
+	// both are rotations, compare up to the sign
+	double inv[4] = { -a[0], -a[1], -a[2], a[3] };
+	double d[4];
+	quatMultiply(inv, b, d);
+	double n = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2] + a[3] * a[3]) * std::sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2] + b[3] * b[3]);
+	double v = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) / n;
+	return 2.0 * std::atan2(v, std::fabs(d[3]) / n) * 180.0 / 3.14159265358979323846;
+}
+
+// random unit quaternion b at exactly angle degrees (rotation angle) from a
+static void pairAtAngle(double angle, double a[4], double b[4])
+{
+	double n = 0.0;
+	for (int j = 0; j < 4; j++) {
+		a[j] = random(-1.0, 1.0);
+		n += a[j] * a[j];
+	}
+	for (int j = 0; j < 4; j++)
+		a[j] /= std::sqrt(n);
+
+	double axis[3] = { random(-1.0, 1.0), random(-1.0, 1.0), random(-1.0, 1.0) };
+	normalize3(axis);
+	double half = angle * 3.14159265358979323846 / 360.0;
+	double d[4] = { axis[0] * std::sin(half), axis[1] * std::sin(half), axis[2] * std::sin(half), std::cos(half) };
+	quatMultiply(a, d, b);
+}
+
+template <typename F>
+static double bestNs(int count, int runs, F f)
+{
+	double best = 1.0e30;
+	for (int r = 0; r < runs; r++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / count);
+	}
+	return best;
+}
+
+int main()
+{
+	const int count = 200000;
+	const int runs = 7;
+	std::srand(1);
+
+	// euler to quaternion
+	std::vector<double> euler(count * 3);
+	for (int i = 0; i < count * 3; i++)
+		euler[i] = random(-720.0, 720.0);
+	std::vector<double> q(count * 4);
+
+	double e2qError = 0.0;
+	for (int i = 0; i < count; i++) {
+		double q1[4], q2[4];
+		legacyE2q(euler[i * 3], euler[i * 3 + 1], euler[i * 3 + 2], q1);
+		eulerToQuaternion(euler[i * 3], euler[i * 3 + 1], euler[i * 3 + 2], q2);
+		for (int j = 0; j < 4; j++)
+			e2qError = std::max(e2qError, std::fabs(q1[j] - q2[j]));
+	}
+	double e2qNs = bestNs(count, runs, [&]() {
+		for (int i = 0; i < count; i++)
+			legacyE2q(euler[i * 3], euler[i * 3 + 1], euler[i * 3 + 2], &q[i * 4]);
+	});
+	double sincosNs = bestNs(count, runs, [&]() {
+		for (int i = 0; i < count; i++)
+			eulerToQuaternion(euler[i * 3], euler[i * 3 + 1], euler[i * 3 + 2], &q[i * 4]);
+	});
+	printf("euler to quaternion   e2q %6.1f ns   eulerToQuaternion %6.1f ns   max component diff %.2e\n\n", e2qNs, sincosNs, e2qError);
+
+	// slerp, per 20 degrees bucket of the angle between A and B
+	printf("%-12s %14s %14s\n", "angle", "exact err", "fast err");
+	const int pairs = 2000;
+	const int blends = 21;
+	double worstFast = 0.0;
+	for (int bucket = 0; bucket < 18; bucket++) {
+		double errExact = 0.0, errFast = 0.0;
+		for (int i = 0; i < pairs; i++) {
+			double a[4], b[4];
+			pairAtAngle(random(bucket * 20.0, (bucket + 1) * 20.0), a, b);
+			for (int k = 0; k < blends; k++) {
+				double blend = k / (blends - 1.0);
+				double ref[4], exact[4], fast[4];
+				referenceSlerp(a, b, blend, ref);
+				slerpQuaternionLong(a, b, blend, exact);
+				slerpQuaternionFast(a, b, blend, fast);
+				errExact = std::max(errExact, angleBetween(ref, exact));
+				errFast = std::max(errFast, angleBetween(ref, fast));
+			}
+		}
+		worstFast = std::max(worstFast, errFast);
+		printf("%3d-%3d deg   %14.2e %14.2e\n", bucket * 20, (bucket + 1) * 20, errExact, errFast);
+	}
+	printf("fast worst    %14s %14.2e\n\n", "", worstFast);
+
+	// cost, in the spine range (< 180) and over the whole range
+	const char* ranges[2] = { "0-180 deg", "0-360 deg" };
+	for (int r = 0; r < 2; r++) {
+		std::vector<double> a(count * 4), b(count * 4), out(count * 4);
+		for (int i = 0; i < count; i++)
+			pairAtAngle(random(0.0, r == 0 ? 179.0 : 359.0), &a[i * 4], &b[i * 4]);
+		double exactNs = bestNs(count, runs, [&]() {
+			for (int i = 0; i < count; i++)
+				slerpQuaternionLong(&a[i * 4], &b[i * 4], 0.37, &out[i * 4]);
+		});
+		double fastNs = bestNs(count, runs, [&]() {
+			for (int i = 0; i < count; i++)
+				slerpQuaternionFast(&a[i * 4], &b[i * 4], 0.37, &out[i * 4]);
+		});
+		printf("slerp %s   exact %6.1f ns   fast %6.1f ns\n", ranges[r], exactNs, fastNs);
+	}
+
+	return 0;
+}
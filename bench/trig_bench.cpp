@@ -0,0 +1,112 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// Error and cost of sinCosArray, the kernel behind the array mode of
+// mgear_trigonometryAngle, against libm sin and cos.
+//
+// Maya free, build and run from the repository root:
+//     g++ -O2 -std=c++11 -Isrc bench/trig_bench.cpp -o trig_bench
+//     ./trig_bench
+// add -mavx2 for the four lane path.
+//
+// Errors are absolute, and in ulp of the libm result.
+/////////////////////////////////////////////////
+
+#include "mgear_math.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double random(double low, double high)
+{
+	return low + (high - low) * (std::rand() / (double)RAND_MAX);
+}
+
+static double ulpError(double value, double reference)
+{
+	double ulp = std::nextafter(std::fabs(reference), 1.0e300) - std::fabs(reference);
+	return std::fabs(value - reference) / ulp;
+}
+
+template <typename F>
+static double bestNs(int count, int runs, F f)
+{
+	double best = 1.0e30;
+	for (int r = 0; r < runs; r++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / count);
+	}
+	return best;
+}
+
+int main()
+{
+	const int count = 100000;
+	const int runs = 7;
+	std::srand(1);
+
+	printf("%-12s %12s %10s %12s %10s %10s %10s\n", "range", "sin abs", "sin ulp", "cos abs", "cos ulp", "libm ns", "kernel ns");
+	const double ranges[4] = { 3.14159265358979323846, 100.0, 1.0e4, 1.0e5 };
+	for (int r = 0; r < 4; r++) {
+		std::vector<double> x(count), s(count), c(count), ls(count), lc(count);
+		for (int i = 0; i < count; i++)
+			x[i] = random(-ranges[r], ranges[r]);
+
+		sinCosArray(&x[0], count, &s[0], &c[0]);
+		double sinAbs = 0.0, sinUlp = 0.0, cosAbs = 0.0, cosUlp = 0.0;
+		for (int i = 0; i < count; i++) {
+			double rs = std::sin(x[i]);
+			double rc = std::cos(x[i]);
+			sinAbs = std::max(sinAbs, std::fabs(s[i] - rs));
+			cosAbs = std::max(cosAbs, std::fabs(c[i] - rc));
+			sinUlp = std::max(sinUlp, ulpError(s[i], rs));
+			cosUlp = std::max(cosUlp, ulpError(c[i], rc));
+		}
+
+		// per angle, one sin and one cos
+		double libmNs = bestNs(count, runs, [&]() {
+			for (int i = 0; i < count; i++) {
+				ls[i] = std::sin(x[i]);
+				lc[i] = std::cos(x[i]);
+			}
+		});
+		double kernelNs = bestNs(count, runs, [&]() {
+			sinCosArray(&x[0], count, &s[0], &c[0]);
+		});
+		printf("+-%-10g %12.2e %10.1f %12.2e %10.1f %10.2f %10.2f\n", ranges[r], sinAbs, sinUlp, cosAbs, cosUlp, libmNs, kernelNs);
+	}
+
+	return 0;
+}
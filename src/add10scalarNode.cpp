@@ -149,6 +149,8 @@ MStatus mgear_add10scalarNode::compute(const MPlug& plug, MDataBlock& data)
 		return MS::kUnknownParameter;
 	}
 
+	mgear_ProfileScope profileScope(this, "mgear_add10scalarNode", plug);
+
 	// preparing the values from the attributes
 	float inputValue0 = data.inputValue(aInValue0, &status).asFloat();
 	float inputValue1 = data.inputValue(aInValue1, &status).asFloat();
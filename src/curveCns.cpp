@@ -75,6 +75,8 @@ MStatus mgear_curveCns::initialize()
 // COMPUTE ======================================
 MStatus mgear_curveCns::deform( MDataBlock& data, MItGeometry& iter, const MMatrix &mat, unsigned int /* mIndex */ )
 {
+	mgear_ProfileScope profileScope(this, "mgear_curveCns", "outputGeometry");
+
     MStatus returnStatus;
 
 	MArrayDataHandle adh = data.inputArrayValue( inputs );
@@ -32,6 +32,8 @@ Date:       2016 / 10 / 10
 /////////////////////////////////////////////////
 #include "mgear_solvers.h"
 
+#include <maya/MArrayDataBuilder.h>
+
 /////////////////////////////////////////////////
 // GLOBAL
 /////////////////////////////////////////////////
@@ -39,10 +41,14 @@ MTypeId mgear_intMatrix::id(0x0011FEC4);
 
 // Define the Node's attribute specifiers
 MObject mgear_intMatrix::blend;
+MObject mgear_intMatrix::blends;
+MObject mgear_intMatrix::interpolation;
+MObject mgear_intMatrix::count;
 
 MObject mgear_intMatrix::matrixA; 
 MObject mgear_intMatrix::matrixB; 
 MObject mgear_intMatrix::output; 
+MObject mgear_intMatrix::outputs;
 
 mgear_intMatrix::mgear_intMatrix() {} // constructor
 mgear_intMatrix::~mgear_intMatrix() {} // destructor
@@ -65,6 +71,7 @@ MStatus mgear_intMatrix::initialize()
 {
   MFnNumericAttribute nAttr;		
   MFnMatrixAttribute mAttr;
+  MFnEnumAttribute eAttr;
 	MStatus stat;
 
 	// ATTRIBUTES
@@ -76,6 +83,34 @@ MStatus mgear_intMatrix::initialize()
 	stat = addAttribute( blend );
 		if (!stat) {stat.perror("addAttribute"); return stat;}
 
+   // how the transforms are blended, see interpolateTRSMode
+   interpolation = eAttr.create( "interpolation", "interp", MGEAR_INTERPOLATE_SLERP );
+   eAttr.addField("slerp", MGEAR_INTERPOLATE_SLERP);
+   eAttr.addField("dualQuaternion", MGEAR_INTERPOLATE_DUAL_QUATERNION);
+   eAttr.addField("log", MGEAR_INTERPOLATE_LOG);
+   eAttr.setStorable(true);
+   eAttr.setKeyable(true);
+	stat = addAttribute( interpolation );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+   // array mode, one output matrix per blend value
+   blends = nAttr.create( "blends", "bs", MFnNumericData::kFloat, 0.0 );
+   nAttr.setArray(true);
+   nAttr.setStorable(true);
+   nAttr.setKeyable(true);
+   nAttr.setMin(0);
+   nAttr.setMax(1);
+	stat = addAttribute( blends );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+   // when above 0, outputs count matrices evenly spaced from A to B and the blends are ignored
+   count = nAttr.create( "count", "c", MFnNumericData::kInt, 0 );
+   nAttr.setStorable(true);
+   nAttr.setKeyable(true);
+   nAttr.setMin(0);
+	stat = addAttribute( count );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
 	// INPUTS
 	matrixA = mAttr.create( "matrixA", "mA" );
 	mAttr.setStorable(true);
@@ -99,6 +134,15 @@ MStatus mgear_intMatrix::initialize()
 	stat = addAttribute( output );
 		if (!stat) {stat.perror("addAttribute"); return stat;}
 
+	outputs = mAttr.create( "outputs", "outs" );
+	mAttr.setArray(true);
+	mAttr.setUsesArrayDataBuilder(true);
+	mAttr.setStorable(false);
+	mAttr.setKeyable(false);
+	mAttr.setConnectable(true);
+	stat = addAttribute( outputs );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
 	// CONNECTIONS
 	stat = attributeAffects( matrixA, output );
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
@@ -106,6 +150,18 @@ MStatus mgear_intMatrix::initialize()
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
 	stat = attributeAffects( blend, output );
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
+	stat = attributeAffects( interpolation, output );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+	stat = attributeAffects( interpolation, outputs );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+	stat = attributeAffects( matrixA, outputs );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+	stat = attributeAffects( matrixB, outputs );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+	stat = attributeAffects( blends, outputs );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+	stat = attributeAffects( count, outputs );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
 
    return MS::kSuccess;
 }
@@ -114,27 +170,25 @@ MStatus mgear_intMatrix::compute(const MPlug& plug, MDataBlock& data)
 {
 	MStatus returnStatus;
 
-	if( plug != output )
+	bool arrayOutput = plug == outputs || (plug.isElement() && plug.array() == outputs);
+	if( plug != output && !arrayOutput )
 		return MS::kUnknownParameter;
 
+	mgear_ProfileScope profileScope(this, "mgear_intMatrix", plug);
+	if( arrayOutput )
+		return computeArray(data);
+
 	// Input
 	MMatrix mA = data.inputValue( matrixA ).asMatrix();
 	MMatrix mB = data.inputValue( matrixB ).asMatrix();
 
-	MTransformationMatrix mAm= MTransformationMatrix(mA);
-	MTransformationMatrix mBm = MTransformationMatrix(mB);
-
 	// SLIDERS
 	double in_blend = (double)data.inputValue( blend ).asFloat();
+	int in_interpolation = data.inputValue( interpolation ).asShort();
 
-	MTransformationMatrix mCm = interpolateTransform(mAm, mBm, in_blend);
-
-	MMatrix mC = mCm.asMatrix();
-	//MMatrix mC = (mA * in_blend) +( (1 - in_blend) * mB);
-	// double i = mC.matrix[0][0];
-	
-
-	
+	// same blend as interpolateTransform, on the decomposed matrices
+	MMatrix mC;
+	interpolateMatrix(mA.matrix, mB.matrix, in_blend, in_interpolation, mC.matrix);
 
 	// Output
 	MDataHandle h;
@@ -145,3 +199,49 @@ MStatus mgear_intMatrix::compute(const MPlug& plug, MDataBlock& data)
 	return MS::kSuccess;
 }
 
+
+// Array mode: A and B are decomposed once for all the blends
+MStatus mgear_intMatrix::computeArray(MDataBlock& data)
+{
+	MStatus stat;
+
+	// Input
+	MMatrix mA = data.inputValue( matrixA ).asMatrix();
+	MMatrix mB = data.inputValue( matrixB ).asMatrix();
+
+	// SLIDERS
+	int in_count = data.inputValue( count ).asInt();
+	int in_interpolation = data.inputValue( interpolation ).asShort();
+	std::vector<double> in_blends;
+	if (in_count > 0){
+		in_blends.resize(in_count);
+		for (int i = 0; i < in_count; i++)
+			in_blends[i] = (in_count > 1) ? double(i) / double(in_count - 1) : 0.5;
+	}
+	else{
+		MArrayDataHandle adh = data.inputArrayValue( blends );
+		in_blends.resize(adh.elementCount());
+		for (unsigned i = 0; i < adh.elementCount(); i++){
+			adh.jumpToArrayElement(i);
+			in_blends[i] = (double)adh.inputValue().asFloat();
+		}
+	}
+	unsigned n = (unsigned)in_blends.size();
+
+	std::vector<double> mC(n * 16);
+	if (n > 0)
+		interpolateMatrixArray(mA.matrix, mB.matrix, &in_blends[0], (int)n, in_interpolation, (double(*)[4][4])&mC[0]);
+
+	// Output
+	MArrayDataHandle outHandle = data.outputArrayValue( outputs );
+	MArrayDataBuilder builder = outHandle.builder();
+	for (unsigned i = 0; i < n; i++){
+		MDataHandle h = builder.addElement(i);
+		h.setMMatrix( MMatrix((const double(*)[4])&mC[i * 16]) );
+	}
+	removeElementsFrom(outHandle, builder, n);
+	outHandle.set(builder);
+	outHandle.setAllClean();
+
+	return MS::kSuccess;
+}
@@ -105,6 +105,8 @@ MStatus mgear_inverseRotOrder::compute(const MPlug& plug, MDataBlock& data)
 	if( plug != output )
 		return MS::kUnknownParameter;
 
+	mgear_ProfileScope profileScope(this, "mgear_inverseRotOrder", plug);
+
 	// Input
 	int ro  = data.inputValue( rotOrder ).asShort();
 	int inv_ro [6] = {5, 3, 4, 1, 2, 0};
@@ -135,6 +135,8 @@ MStatus mgear_linearInterpolate3DvectorNode::compute(const MPlug& plug, MDataBlo
 		return MS::kUnknownParameter;
 	}
 
+	mgear_ProfileScope profileScope(this, "mgear_linearInterpolate3DvectorNode", plug);
+
 
 	// inputs
 
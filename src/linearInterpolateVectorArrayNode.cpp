@@ -0,0 +1,149 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+#include "mgear_solvers.h"
+
+MTypeId		mgear_linearInterpolateVectorArrayNode::id(0x0011FED4);
+
+//Static variables
+
+MObject		mgear_linearInterpolateVectorArrayNode::vecArrayA;
+MObject		mgear_linearInterpolateVectorArrayNode::vecArrayB;
+MObject		mgear_linearInterpolateVectorArrayNode::blend;
+MObject		mgear_linearInterpolateVectorArrayNode::blendArray;
+
+MObject		mgear_linearInterpolateVectorArrayNode::outVecArray;
+
+
+mgear_linearInterpolateVectorArrayNode::mgear_linearInterpolateVectorArrayNode(){}
+
+mgear_linearInterpolateVectorArrayNode::~mgear_linearInterpolateVectorArrayNode(){}
+
+mgear_linearInterpolateVectorArrayNode::SchedulingType mgear_linearInterpolateVectorArrayNode::schedulingType() const
+{
+	return kParallel;
+}
+
+void* mgear_linearInterpolateVectorArrayNode::creator()
+{
+	return new mgear_linearInterpolateVectorArrayNode();
+}
+
+
+/// INIT
+MStatus mgear_linearInterpolateVectorArrayNode::initialize()
+{
+	MStatus status;
+	MFnNumericAttribute nAttr;
+	MFnTypedAttribute tAttr;
+	MFnVectorArrayData vectorArrayFn;
+	MFnDoubleArrayData doubleArrayFn;
+
+	//Inputs
+	vecArrayA = tAttr.create("vectorArrayA", "vectorArrayA", MFnData::kVectorArray, vectorArrayFn.create(MVectorArray()));
+	tAttr.setStorable(true);
+	addAttribute(vecArrayA);
+
+	vecArrayB = tAttr.create("vectorArrayB", "vectorArrayB", MFnData::kVectorArray, vectorArrayFn.create(MVectorArray()));
+	tAttr.setStorable(true);
+	addAttribute(vecArrayB);
+
+	blend = nAttr.create("blend", "blend", MFnNumericData::kFloat, 0.0);
+	nAttr.setStorable(true);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0);
+	nAttr.setMax(1);
+	addAttribute(blend);
+
+	// optional blend per vector, the vectors past its end use blend
+	blendArray = tAttr.create("blendArray", "blendArray", MFnData::kDoubleArray, doubleArrayFn.create(MDoubleArray()));
+	tAttr.setStorable(true);
+	addAttribute(blendArray);
+
+	// ouput
+	outVecArray = tAttr.create("outVectorArray", "outVectorArray", MFnData::kVectorArray, vectorArrayFn.create(MVectorArray()));
+	tAttr.setWritable(false);
+	tAttr.setStorable(false);
+	tAttr.setReadable(true);
+	addAttribute(outVecArray);
+
+	// connections
+	attributeAffects(vecArrayA, outVecArray);
+	attributeAffects(vecArrayB, outVecArray);
+	attributeAffects(blend, outVecArray);
+	attributeAffects(blendArray, outVecArray);
+
+	return MS::kSuccess;
+}
+
+// COMPUTE
+
+MStatus mgear_linearInterpolateVectorArrayNode::compute(const MPlug& plug, MDataBlock& data)
+{
+	MStatus status;
+
+	if (plug != outVecArray)
+	{
+		return MS::kUnknownParameter;
+	}
+
+	mgear_ProfileScope profileScope(this, "mgear_linearInterpolateVectorArrayNode", plug);
+
+	// inputs, array() reads the data in place
+	MVectorArray vecA = MFnVectorArrayData(data.inputValue(vecArrayA).data()).array();
+	MVectorArray vecB = MFnVectorArrayData(data.inputValue(vecArrayB).data()).array();
+	MDoubleArray in_blends = MFnDoubleArrayData(data.inputValue(blendArray).data()).array();
+	double in_blend = (double)data.inputValue(blend, &status).asFloat();
+
+	// the output has as many vectors as the shortest input, the blends
+	// past the end of blendArray take blend
+	unsigned count = std::min(vecA.length(), vecB.length());
+	unsigned blendCount = std::min(count, in_blends.length());
+
+	// Output, computed in the array of the new data
+	MFnVectorArrayData outFn;
+	MObject outData = outFn.create(&status);
+	McheckStatusAndReturnIt(status);
+	MVectorArray vecC = outFn.array();
+	vecC.setLength(count);
+	for (unsigned i = 0; i < count; i++)
+	{
+		double t = i < blendCount ? in_blends[i] : in_blend;
+		const MVector& a = vecA[i];
+		const MVector& b = vecB[i];
+		vecC[i] = MVector(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+	}
+
+	MDataHandle hOut = data.outputValue(outVecArray, &status);
+	hOut.set(outData);
+	data.setClean(plug);
+
+	return MS::kSuccess;
+}
@@ -0,0 +1,155 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// INCLUDE
+/////////////////////////////////////////////////
+#include "mgear_solvers.h"
+
+#include <cstring>
+
+/////////////////////////////////////////////////
+// GLOBAL
+/////////////////////////////////////////////////
+MTypeId mgear_matrixChain::id(0x0011FED2);
+
+// Define the Node's attribute specifiers
+
+MObject mgear_matrixChain::matrixIn;
+MObject mgear_matrixChain::matrix;
+MObject mgear_matrixChain::invert;
+MObject mgear_matrixChain::output;
+
+mgear_matrixChain::mgear_matrixChain() {} // constructor
+mgear_matrixChain::~mgear_matrixChain() {} // destructor
+
+/////////////////////////////////////////////////
+// METHODS
+/////////////////////////////////////////////////
+
+mgear_matrixChain::SchedulingType mgear_matrixChain::schedulingType() const
+{
+	return kParallel;
+}
+
+// CREATOR ======================================
+void* mgear_matrixChain::creator()
+{
+   return new mgear_matrixChain();
+}
+
+// INIT =========================================
+MStatus mgear_matrixChain::initialize()
+{
+  MFnMatrixAttribute mAttr;
+  MFnNumericAttribute nAttr;
+  MFnCompoundAttribute cAttr;
+	MStatus stat;
+
+	// INPUTS
+	matrix = mAttr.create( "matrix", "m" );
+	mAttr.setStorable(true);
+	mAttr.setKeyable(true);
+	mAttr.setConnectable(true);
+
+	invert = nAttr.create( "invert", "inv", MFnNumericData::kBoolean, false );
+	nAttr.setStorable(true);
+	nAttr.setKeyable(true);
+
+	// multiplied in order, element 0 first: matrixIn[0] * matrixIn[1] * ...
+	matrixIn = cAttr.create( "matrixIn", "mi" );
+	cAttr.addChild( matrix );
+	cAttr.addChild( invert );
+	cAttr.setArray(true);
+	cAttr.setStorable(true);
+	stat = addAttribute( matrixIn );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	// OUTPUTS
+	output = mAttr.create( "output", "out" );
+	mAttr.setStorable(false);
+	mAttr.setKeyable(false);
+	mAttr.setConnectable(true);
+	stat = addAttribute( output );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	// CONNECTIONS
+	stat = attributeAffects( matrixIn, output );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+
+   return MS::kSuccess;
+}
+// COMPUTE ======================================
+MStatus mgear_matrixChain::compute(const MPlug& plug, MDataBlock& data)
+{
+	MStatus returnStatus;
+
+	if( plug != output )
+		return MS::kUnknownParameter;
+
+	mgear_ProfileScope profileScope(this, "mgear_matrixChain", plug);
+
+	// Input
+	MArrayDataHandle adh = data.inputArrayValue( matrixIn );
+	unsigned count = adh.elementCount();
+	if (_cacheInput.size() != count){
+		_cacheInput.resize(count);
+		_cacheInverse.resize(count);
+		_cacheValid.assign(count, false);
+	}
+
+	MMatrix mC;
+	for (unsigned i = 0; i < count; i++){
+		adh.jumpToArrayElement(i);
+		MDataHandle h = adh.inputValue();
+		MMatrix m = h.child( matrix ).asMatrix();
+
+		if (h.child( invert ).asBool()){
+			// only invert again when the input changed
+			if (!_cacheValid[i] || std::memcmp(m.matrix, _cacheInput[i].matrix, sizeof(m.matrix)) != 0){
+				_cacheInput[i] = m;
+				if (!invertMatrix4(m.matrix, _cacheInverse[i].matrix))
+					_cacheInverse[i] = MMatrix::identity;
+				_cacheValid[i] = true;
+			}
+			multiplyMatrix4(mC.matrix, _cacheInverse[i].matrix, mC.matrix);
+		}
+		else
+			multiplyMatrix4(mC.matrix, m.matrix, mC.matrix);
+	}
+
+	// Output
+	MDataHandle h;
+	h = data.outputValue( output );
+	h.setMMatrix( mC );
+	data.setClean(plug);
+
+	return MS::kSuccess;
+}
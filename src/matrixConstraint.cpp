@@ -38,6 +38,10 @@ MTypeId mgear_matrixConstraint::id(0x0011FEF0);
 // ---------------------------------------------------
 MObject mgear_matrixConstraint::aDriverMatrix;
 
+MObject mgear_matrixConstraint::aDriverList;
+MObject mgear_matrixConstraint::aDriverListMatrix;
+MObject mgear_matrixConstraint::aDriverListWeight;
+
 MObject mgear_matrixConstraint::aDriverRotationOffset;
 MObject mgear_matrixConstraint::aDriverRotationOffsetX;
 MObject mgear_matrixConstraint::aDriverRotationOffsetY;
@@ -101,115 +105,147 @@ void* mgear_matrixConstraint::creator()
 	return (new mgear_matrixConstraint());
 }
 
+// -- true when the output is the plug being computed or feeds a connection,
+// so the compute only fills the outputs that are actually read
+static bool outputRequested(const MPlug& plug, const MObject& node, const MObject& attr)
+{
+	if (plug == attr || (plug.isChild() && plug.parent() == attr))
+		return true;
+
+	MPlug out_plug(node, attr);
+	if (out_plug.isConnected())
+		return true;
+	for (unsigned int i = 0; i < out_plug.numChildren(); i++)
+	{
+		if (out_plug.child(i).isConnected())
+			return true;
+	}
+	return false;
+}
+
 MStatus mgear_matrixConstraint::compute(const MPlug& plug, MDataBlock& data)
 {
 	MStatus status;
 
-	// -- our needed variables
-	MTransformationMatrix result;
-	double scale[3];
-	double shear[3];
+	// -- which outputs do we need to fill
+	MObject node = thisMObject();
+	bool need_matrix = outputRequested(plug, node, aOutputMatrix);
+	bool need_driver_off = outputRequested(plug, node, aDriverOffsetOutputMatrix);
+	bool need_translate = outputRequested(plug, node, aTranslate);
+	bool need_rotate = outputRequested(plug, node, aRotate);
+	bool need_scale = outputRequested(plug, node, aScale);
+	bool need_shear = outputRequested(plug, node, aShear);
 
-	// -- our final output variables
-	double scale_result[3] = { 1.0, 1.0, 1.0 };
-	double shear_result[3];
+	if (!(need_matrix || need_driver_off || need_translate || need_rotate || need_scale || need_shear))
+		return MS::kUnknownParameter;
+
+	mgear_ProfileScope profileScope(this, "mgear_matrixConstraint", plug);
 
 	// -----------------------------------------
 	// input attributes
 	// -----------------------------------------
-	MMatrix driver_matrix = data.inputValue(aDriverMatrix, &status).asMatrix();
+	s_MatrixConstraintInputs in;
+	copyMatrix4(data.inputValue(aDriverMatrix, &status).asMatrix().matrix, in.driverMatrix);
+
+	// -- the weighted drivers are blended into a single driver matrix.
+	// Without drivers or weights, driverMatrix is used as is.
+	MArrayDataHandle driver_list_handle = data.inputArrayValue(aDriverList, &status);
+	unsigned int driver_count = driver_list_handle.elementCount();
+	std::vector<double> driver_list(driver_count * 17);
+	if (driver_count > 0)
+	{
+		double (*driver_matrices)[4][4] = (double(*)[4][4])&driver_list[0];
+		double* driver_weights = &driver_list[driver_count * 16];
+		for (unsigned int i = 0; i < driver_count; i++)
+		{
+			driver_list_handle.jumpToArrayElement(i);
+			MDataHandle driver_handle = driver_list_handle.inputValue(&status);
+			copyMatrix4(driver_handle.child(aDriverListMatrix).asMatrix().matrix, driver_matrices[i]);
+			driver_weights[i] = driver_handle.child(aDriverListWeight).asDouble();
+		}
+		in.driverList = driver_matrices;
+		in.driverWeights = driver_weights;
+		in.driverCount = (int)driver_count;
+	}
 
 	// -- driver rotation offset
-	double in_driver_rotation_offset_x = data.inputValue(aDriverRotationOffsetX, &status).asDouble();
-	double in_driver_rotation_offset_y = data.inputValue(aDriverRotationOffsetY, &status).asDouble();
-	double in_driver_rotation_offset_z = data.inputValue(aDriverRotationOffsetZ, &status).asDouble();
-
-	MMatrix driven_inverse_matrix = data.inputValue(aDrivenParentInverseMatrix, &status).asMatrix();
-	MMatrix rest_matrix = data.inputValue(aDrivenRestMatrix, &status).asMatrix();
-
-	// -- rotation multiplier
-	double in_rotation_multiplier_x = data.inputValue(aRotationMultiplierX, &status).asDouble();
-	double in_rotation_multiplier_y = data.inputValue(aRotationMultiplierY, &status).asDouble();
-	double in_rotation_multiplier_z = data.inputValue(aRotationMultiplierZ, &status).asDouble();
-
-
-	// -- scale multiplier
-	double in_scale_multiplier_x = data.inputValue(aScaleMultiplierX, &status).asDouble();
-	double in_scale_multiplier_y = data.inputValue(aScaleMultiplierY, &status).asDouble();
-	double in_scale_multiplier_z = data.inputValue(aScaleMultiplierZ, &status).asDouble();
-
+	in.driverRotationOffset[0] = data.inputValue(aDriverRotationOffsetX, &status).asDouble();
+	in.driverRotationOffset[1] = data.inputValue(aDriverRotationOffsetY, &status).asDouble();
+	in.driverRotationOffset[2] = data.inputValue(aDriverRotationOffsetZ, &status).asDouble();
 
 	// -- add the rotation offset.
 	// We need to add the offset on top of the driver matrix, to calculate the outputDriverOffsetMatrix and the
 	// the rest matrix correctly
-	MEulerRotation  euler_off(
-		degrees2radians(in_driver_rotation_offset_x),
-		degrees2radians(in_driver_rotation_offset_y),
-		degrees2radians(in_driver_rotation_offset_z) );
-	MTransformationMatrix driver_matrix_tfm(driver_matrix);
-	MTransformationMatrix driver_matrix_off = driver_matrix_tfm.rotateBy(euler_off,  MSpace::kPreTransform);
-
-
-	// MMatrix mult_matrix = driver_matrix * driven_inverse_matrix;
-	MMatrix mult_matrix = driver_matrix_off.asMatrix() * driven_inverse_matrix;
-
-	// -- multiply the result of the mult matrix by the rest
-	// -- need to have the rotation calculated seperaltely - (joint orientation)
-	MMatrix rotate_matrix = mult_matrix * rest_matrix.inverse();
+	MMatrix driver_matrix_off_result;
+	matrixConstraintDriver(in, driver_matrix_off_result.matrix);
 
-	MTransformationMatrix matrix(mult_matrix);
-	MTransformationMatrix rotate_tfm(rotate_matrix);
+	if (need_driver_off)
+	{
+		MDataHandle matrix_driver_off_handle = data.outputValue(aDriverOffsetOutputMatrix, &status);
+		matrix_driver_off_handle.setMMatrix(driver_matrix_off_result);
+		data.setClean(aDriverOffsetOutputMatrix);
+	}
 
+	// -- the driver offset matrix does not need the constraint solve
+	if (!(need_matrix || need_translate || need_rotate || need_scale || need_shear))
+		return MS::kSuccess;
 
-	// -- the quaternion rotation of the rotate matrix
-	// MQuaternion rotation = rotate_tfm_off.rotation();
-	MQuaternion rotation = rotate_tfm.rotation();
+	copyMatrix4(data.inputValue(aDrivenParentInverseMatrix, &status).asMatrix().matrix, in.drivenParentInverseMatrix);
+	copyMatrix4(data.inputValue(aDrivenRestMatrix, &status).asMatrix().matrix, in.drivenRestMatrix);
 
-	// -- apply the rotation multiplier
-	rotation.x *= in_rotation_multiplier_x;
-	rotation.y *= in_rotation_multiplier_y;
-	rotation.z *= in_rotation_multiplier_z;
+	// -- rotation multiplier
+	in.rotationMultiplier[0] = data.inputValue(aRotationMultiplierX, &status).asDouble();
+	in.rotationMultiplier[1] = data.inputValue(aRotationMultiplierY, &status).asDouble();
+	in.rotationMultiplier[2] = data.inputValue(aRotationMultiplierZ, &status).asDouble();
 
-	// -- decompose the matrix values to construct into the final matrix
-	MVector translation = matrix.getTranslation(MSpace::kWorld);
-	matrix.getScale(scale, MSpace::kWorld);
-	matrix.getShear(shear, MSpace::kWorld);
 
-	// -- add in the scale multiplication
-	scale[0] *= in_scale_multiplier_x;
-	scale[1] *= in_scale_multiplier_y;
-	scale[2] *= in_scale_multiplier_z;
+	// -- scale multiplier
+	in.scaleMultiplier[0] = data.inputValue(aScaleMultiplierX, &status).asDouble();
+	in.scaleMultiplier[1] = data.inputValue(aScaleMultiplierY, &status).asDouble();
+	in.scaleMultiplier[2] = data.inputValue(aScaleMultiplierZ, &status).asDouble();
 
-	// -- compose our matrix
-	result.setTranslation(translation, MSpace::kWorld);
-	result.setRotationQuaternion(rotation.x, rotation.y, rotation.z, rotation.w);
-	result.setScale(scale, MSpace::kWorld);
-	result.setShear(shear, MSpace::kWorld);
+	// -- the rotation is calculated relative to the rest (joint orientation),
+	// the multipliers applied on the decomposed values (see mgear_kernels.h)
+	s_MatrixConstraintOutputs result;
+	matrixConstraintSolve(in, driver_matrix_off_result.matrix, result);
 
 	// -----------------------------------------
 	// output
 	// -----------------------------------------
-	MDataHandle matrix_handle = data.outputValue(aOutputMatrix, &status);
-	matrix_handle.setMMatrix(result.asMatrix());
-	data.setClean(aOutputMatrix);
-	MDataHandle matrix_driver_off_handle = data.outputValue(aDriverOffsetOutputMatrix, &status);
-	matrix_driver_off_handle.setMMatrix(driver_matrix_off.asMatrix());
-	data.setClean(aDriverOffsetOutputMatrix);
-
-	MDataHandle translate_handle = data.outputValue(aTranslate, &status);
-	translate_handle.setMVector(result.getTranslation(MSpace::kWorld));
-
-	MEulerRotation rotation_result = result.eulerRotation();
-	MDataHandle rotate_handle = data.outputValue(aRotate, &status);
-	rotate_handle.set3Double(rotation_result.x, rotation_result.y, rotation_result.z);
-
-	result.getScale(scale_result, MSpace::kWorld);
-	MDataHandle scale_handle = data.outputValue(aScale, &status);
-	scale_handle.set3Double(scale_result[0], scale_result[1], scale_result[2]);
-
-	result.getShear(shear_result, MSpace::kWorld);
-	MDataHandle shear_handle = data.outputValue(aShear, &status);
-	shear_handle.set3Double(shear_result[0], shear_result[1], shear_result[2]);
+	if (need_matrix)
+	{
+		MDataHandle matrix_handle = data.outputValue(aOutputMatrix, &status);
+		matrix_handle.setMMatrix(MMatrix(result.outputMatrix));
+		data.setClean(aOutputMatrix);
+	}
+
+	if (need_translate)
+	{
+		MDataHandle translate_handle = data.outputValue(aTranslate, &status);
+		translate_handle.set3Double(result.translate[0], result.translate[1], result.translate[2]);
+		data.setClean(aTranslate);
+	}
+
+	if (need_rotate)
+	{
+		MDataHandle rotate_handle = data.outputValue(aRotate, &status);
+		rotate_handle.set3Double(result.rotate[0], result.rotate[1], result.rotate[2]);
+		data.setClean(aRotate);
+	}
+
+	if (need_scale)
+	{
+		MDataHandle scale_handle = data.outputValue(aScale, &status);
+		scale_handle.set3Double(result.scale[0], result.scale[1], result.scale[2]);
+		data.setClean(aScale);
+	}
+
+	if (need_shear)
+	{
+		MDataHandle shear_handle = data.outputValue(aShear, &status);
+		shear_handle.set3Double(result.shear[0], result.shear[1], result.shear[2]);
+		data.setClean(aShear);
+	}
 
 	data.setClean(plug);
 
@@ -223,6 +259,7 @@ MStatus mgear_matrixConstraint::initialize()
 	MFnMatrixAttribute mAttr;
 	MFnNumericAttribute nAttr;
 	MFnUnitAttribute uAttr;
+	MFnCompoundAttribute cAttr;
 
 	// -----------------------------------------
 	// input attributes
@@ -233,6 +270,24 @@ MStatus mgear_matrixConstraint::initialize()
 	mAttr.setWritable(true);
 	mAttr.setStorable(true);
 
+	aDriverListMatrix = mAttr.create("driverListMatrix", "driverListMatrix", MFnMatrixAttribute::kDouble);
+	mAttr.setKeyable(true);
+	mAttr.setReadable(false);
+	mAttr.setWritable(true);
+	mAttr.setStorable(true);
+
+	aDriverListWeight = nAttr.create("driverListWeight", "driverListWeight", MFnNumericData::kDouble, 1.0);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0);
+	nAttr.setSoftMax(1.0);
+
+	aDriverList = cAttr.create("driverList", "driverList");
+	cAttr.addChild(aDriverListMatrix);
+	cAttr.addChild(aDriverListWeight);
+	cAttr.setArray(true);
+	cAttr.setReadable(false);
+	cAttr.setStorable(true);
+
 	aDriverRotationOffsetX = nAttr.create("driverRotationOffsetX", "driverRotationOffsetX", MFnNumericData::kDouble);
 	nAttr.setKeyable(true);
 	nAttr.setMin(-360.0);
@@ -384,6 +439,7 @@ MStatus mgear_matrixConstraint::initialize()
 	// add attributes
 	// -----------------------------------------
 	addAttribute(aDriverMatrix);
+	addAttribute(aDriverList);
 
 	addAttribute(aDriverRotationOffset);
 	addAttribute(aDriverRotationOffsetX);
@@ -431,6 +487,7 @@ MStatus mgear_matrixConstraint::initialize()
 	// attribute affects
 	// -----------------------------------------
 	attributeAffects(aDriverMatrix, aOutputMatrix);
+	attributeAffects(aDriverList, aOutputMatrix);
 	attributeAffects(aDrivenParentInverseMatrix, aOutputMatrix);
 	attributeAffects(aDrivenRestMatrix, aOutputMatrix);
 
@@ -439,6 +496,7 @@ MStatus mgear_matrixConstraint::initialize()
 	attributeAffects(aScaleMultiplier, aOutputMatrix);
 
 	attributeAffects(aDriverMatrix, aDriverOffsetOutputMatrix);
+	attributeAffects(aDriverList, aDriverOffsetOutputMatrix);
 	// attributeAffects(aDrivenParentInverseMatrix, aDriverOffsetOutputMatrix);
 	// attributeAffects(aDrivenRestMatrix, aDriverOffsetOutputMatrix);
 	attributeAffects(aDriverRotationOffset, aDriverOffsetOutputMatrix);
@@ -464,6 +522,11 @@ MStatus mgear_matrixConstraint::initialize()
 	attributeAffects(aDriverMatrix, aScale);
 	attributeAffects(aDriverMatrix, aShear);
 
+	attributeAffects(aDriverList, aTranslate);
+	attributeAffects(aDriverList, aRotate);
+	attributeAffects(aDriverList, aScale);
+	attributeAffects(aDriverList, aShear);
+
 	attributeAffects(aDrivenParentInverseMatrix, aTranslate);
 	attributeAffects(aDrivenParentInverseMatrix, aRotate);
 	attributeAffects(aDrivenParentInverseMatrix, aScale);
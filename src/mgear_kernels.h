@@ -0,0 +1,1680 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+#ifndef _mgearKernels
+#define _mgearKernels
+
+/////////////////////////////////////////////////
+// The math of the node computes, free of Maya. The nodes read their
+// attributes and call these kernels, tools/mgear_bake.cpp and
+// tools/mgear_python.cpp call them to evaluate rigs without Maya.
+// Everything is on plain doubles: an MTransformationMatrix is an s_TRS, an
+// MMatrix a double[4][4] and an MVector a double[3]. The curve kernels take
+// any curve with the members of s_NurbsEvaluator, the nodes pass an
+// s_CurveFn around their MFnNurbsCurve.
+/////////////////////////////////////////////////
+
+#include "mgear_math.h"
+
+#include <algorithm>
+#include <vector>
+
+// PI and degrees2radians() of the nodes, with their precision
+#define MGEAR_KERNEL_PI 3.14159265
+#define MGEAR_KERNEL_DEG2RAD 0.0174532925
+
+/////////////////////////////////////////////////
+// HELPERS
+/////////////////////////////////////////////////
+
+// Default MTransformationMatrix
+inline void identityTRS(s_TRS& trs)
+{
+	for (int i = 0; i < 3; i++) {
+		trs.t[i] = 0.0;
+		trs.q[i] = 0.0;
+		trs.s[i] = 1.0;
+		trs.sh[i] = 0.0;
+	}
+	trs.q[3] = 1.0;
+}
+
+inline void identityMatrix4(double m[4][4])
+{
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			m[i][j] = (i == j) ? 1.0 : 0.0;
+	}
+}
+
+inline void copyMatrix4(const double m[4][4], double out[4][4])
+{
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			out[i][j] = m[i][j];
+	}
+}
+
+// out = m * parent.inverse(), a singular parent is left out like MMatrix
+// does (its inverse is the identity)
+inline void localMatrix(const double m[4][4], const double parent[4][4], double out[4][4])
+{
+	double inv[4][4];
+	if (!invertMatrix4(parent, inv))
+		identityMatrix4(inv);
+	multiplyMatrix4(m, inv, out);
+}
+
+// linearInterpolate(MVector, MVector, blend)
+inline void lerp3(const double a[3], const double b[3], double blend, double out[3])
+{
+	for (int i = 0; i < 3; i++)
+		out[i] = a[i] * (1 - blend) + b[i] * blend;
+}
+
+// rotateVectorAlongAxis(): the same quaternion products, with Maya's
+// MQuaternion a * b being quatMultiply(b, a)
+inline void rotateAlongAxis3(const double v[3], const double axis[3], double a, double out[3])
+{
+	double sa = std::sin(a / 2.0);
+	double ca = std::cos(a / 2.0);
+
+	double q1[4] = { v[0], v[1], v[2], 0.0 };
+	double q2[4] = { axis[0] * sa, axis[1] * sa, axis[2] * sa, ca };
+	double q2n[4] = { -axis[0] * sa, -axis[1] * sa, -axis[2] * sa, ca };
+	double q[4];
+	quatMultiply(q1, q2, q);
+	quatMultiply(q2n, q, q);
+
+	out[0] = q[0];
+	out[1] = q[1];
+	out[2] = q[2];
+}
+
+// MVector::rotateBy(MQuaternion), v times the rotation matrix of q
+inline void rotateByQuaternion(const double v[3], const double q[4], double out[3])
+{
+	double r[3][3];
+	rotationFromQuaternion(q, r);
+	double x = v[0] * r[0][0] + v[1] * r[1][0] + v[2] * r[2][0];
+	double y = v[0] * r[0][1] + v[1] * r[1][1] + v[2] * r[2][1];
+	double z = v[0] * r[0][2] + v[1] * r[1][2] + v[2] * r[2][2];
+	out[0] = x;
+	out[1] = y;
+	out[2] = z;
+}
+
+// getQuaternionFromAxes()
+inline void quaternionFromAxes(const double x[3], const double y[3], const double z[3], double q[4])
+{
+	double m[4][4];
+	identityMatrix4(m);
+	for (int i = 0; i < 3; i++) {
+		m[0][i] = x[i];
+		m[1][i] = y[i];
+		m[2][i] = z[i];
+	}
+	s_TRS trs;
+	decomposeTRS(m, trs);
+	for (int i = 0; i < 4; i++)
+		q[i] = trs.q[i];
+}
+
+// MEulerRotation::asQuaternion() in the default XYZ order, radians
+inline void eulerXYZToQuaternion(const double e[3], double q[4])
+{
+	double sx, cx, sy, cy, sz, cz;
+	sinCos(e[0] * 0.5, sx, cx);
+	sinCos(e[1] * 0.5, sy, cy);
+	sinCos(e[2] * 0.5, sz, cz);
+	double qx[4] = { sx, 0.0, 0.0, cx };
+	double qy[4] = { 0.0, sy, 0.0, cy };
+	double qz[4] = { 0.0, 0.0, sz, cz };
+	// X first, then Y, then Z
+	quatMultiply(qy, qx, q);
+	quatMultiply(qz, q, q);
+}
+
+// MQuaternion::asEulerRotation() in the XYZ order, radians, y in [-PI/2, PI/2]
+inline void quaternionToEulerXYZ(const double q[4], double e[3])
+{
+	// rows of Rx * Ry * Rz:
+	//     | cy.cz               cy.sz               -sy   |
+	//     | sx.sy.cz - cx.sz    sx.sy.sz + cx.cz    sx.cy |
+	//     | cx.sy.cz + sx.sz    cx.sy.sz - sx.cz    cx.cy |
+	double r[3][3];
+	rotationFromQuaternion(q, r);
+	e[1] = std::asin(std::min(std::max(-r[0][2], -1.0), 1.0));
+	if (std::fabs(r[0][2]) < 1.0 - 1.0e-12) {
+		e[0] = std::atan2(r[1][2], r[2][2]);
+		e[2] = std::atan2(r[0][1], r[0][0]);
+	}
+	else {
+		// gimbal lock, the whole twist goes to X
+		e[0] = std::atan2(-r[2][1], r[1][1]);
+		e[2] = 0.0;
+	}
+}
+
+/////////////////////////////////////////////////
+// IKFK2BONE
+/////////////////////////////////////////////////
+
+// Outputs of mgear_ikfk2Bone
+enum
+{
+	MGEAR_IKFK_OUT_A = 0,
+	MGEAR_IKFK_OUT_B = 1,
+	MGEAR_IKFK_OUT_CENTER = 2,
+	MGEAR_IKFK_OUT_EFF = 3
+};
+
+// The attributes of mgear_ikfk2Bone, with their defaults.
+// parent holds inAparent, inBparent, inCenterparent and inEffparent, in the
+// order of the outputs.
+struct s_IkFk2BoneInputs
+{
+	double root[4][4];
+	double ikref[4][4];
+	double upv[4][4];
+	double fk0[4][4];
+	double fk1[4][4];
+	double fk2[4][4];
+	double parent[4][4][4];
+
+	double blend;
+	int interpolation;
+	double lengthA;
+	double lengthB;
+	bool negate;
+	double roll;	// degrees
+	double scaleA;
+	double scaleB;
+	double maxstretch;
+	double softness;
+	double slide;
+	double reverse;
+
+	s_IkFk2BoneInputs() : blend(0.0), interpolation(MGEAR_INTERPOLATE_SLERP), lengthA(0.0), lengthB(0.0), negate(false), roll(0.0),
+		scaleA(1.0), scaleB(1.0), maxstretch(1.5), softness(0.0), slide(0.5), reverse(0.0)
+	{
+		identityMatrix4(root);
+		identityMatrix4(ikref);
+		identityMatrix4(upv);
+		identityMatrix4(fk0);
+		identityMatrix4(fk1);
+		identityMatrix4(fk2);
+		for (int i = 0; i < 4; i++)
+			identityMatrix4(parent[i]);
+	}
+};
+
+// The IK solve of mgear_ikfk2Bone for one output, roll in radians
+inline void ikfk2BoneIK(const s_TRS& root, const s_TRS& eff, const s_TRS& upv, const s_IkFk2BoneInputs& data, double roll, int output, s_TRS& result)
+{
+	identityTRS(result);
+	double lengthA = data.lengthA;
+	double lengthB = data.lengthB;
+	double softness = data.softness;
+	double bonePos[3], effPos[3], rootEff[3], xAxis[3], yAxis[3], zAxis[3], rollAxis[3];
+
+	const double* rootPos = root.t;
+	const double* upvPos = upv.t;
+	for (int i = 0; i < 3; i++) {
+		effPos[i] = eff.t[i];
+		rootEff[i] = effPos[i] - rootPos[i];
+		rollAxis[i] = rootEff[i];
+	}
+	double rootEffDistance = normalize3(rollAxis);
+
+	// init the scaling
+	double global_scale = root.s[0];
+	for (int i = 0; i < 3; i++)
+		result.s[i] = root.s[i];
+
+	// Distance with MaxStretch ---------------------
+	double restLength = (lengthA * data.scaleA + lengthB * data.scaleB) * global_scale;
+	double distance = rootEffDistance;
+	double distance2 = distance;
+	if (distance > (restLength * data.maxstretch))
+		distance = restLength * data.maxstretch;
+
+	// Adapt Softness value to chain length --------
+	softness = softness * restLength * .1;
+
+	// Stretch and softness ------------------------
+	// We use the real distance from root to controler to calculate the softness
+	// This way we have softness working even when there is no stretch
+	double stretch = std::max(1.0, distance / restLength);
+	double da = restLength - softness;
+	if ((softness > 0) && (distance2 > da)) {
+		double newlen = softness * (1.0 - std::exp(-(distance2 - da) / softness)) + da;
+		stretch = distance / newlen;
+	}
+
+	lengthA = lengthA * stretch * data.scaleA * global_scale;
+	lengthB = lengthB * stretch * data.scaleB * global_scale;
+
+	// Reverse -------------------------------------
+	double d = distance / (lengthA + lengthB);
+
+	double reverse_scale;
+	if (data.reverse < 0.5)
+		reverse_scale = 1 - (data.reverse * 2 * (1 - d));
+	else
+		reverse_scale = 1 - ((1 - data.reverse) * 2 * (1 - d));
+
+	lengthA *= reverse_scale;
+	lengthB *= reverse_scale;
+
+	bool invert = data.reverse > 0.5;
+
+	// Slide ---------------------------------------
+	double slide_add;
+	if (data.slide < .5)
+		slide_add = (lengthA * (data.slide * 2)) - (lengthA);
+	else
+		slide_add = (lengthB * (data.slide * 2)) - (lengthB);
+
+	lengthA += slide_add;
+	lengthB -= slide_add;
+
+	// calculate the angle inside the triangle!
+	double angleA = 0;
+	double angleB = 0;
+
+	// check if the divider is not null otherwise the result is nan
+	// and the output disapear from xsi, that breaks constraints
+	if ((rootEffDistance < lengthA + lengthB) && (rootEffDistance > std::fabs(lengthA - lengthB) + 1E-6)) {
+
+		// use the law of cosine for lengthA
+		double a = lengthA;
+		double b = rootEffDistance;
+		double c = lengthB;
+
+		angleA = std::acos(std::min(1.0, (a * a + b * b - c * c) / (2 * a * b)));
+
+		// use the law of cosine for lengthB
+		a = lengthB;
+		b = lengthA;
+		c = rootEffDistance;
+		angleB = std::acos(std::min(1.0, (a * a + b * b - c * c) / (2 * a * b)));
+
+		// invert the angles if need be
+		if (invert) {
+			angleA = -angleA;
+			angleB = -angleB;
+		}
+	}
+
+	// start with the X and Z axis
+	for (int i = 0; i < 3; i++)
+		xAxis[i] = rootEff[i];
+	normalize3(xAxis);
+	lerp3(rootPos, effPos, .5, yAxis);
+	for (int i = 0; i < 3; i++)
+		yAxis[i] = upvPos[i] - yAxis[i];
+	normalize3(yAxis);
+	rotateAlongAxis3(yAxis, rollAxis, roll, yAxis);
+	cross3(xAxis, yAxis, zAxis);
+	normalize3(zAxis);
+	cross3(zAxis, xAxis, yAxis);
+	normalize3(yAxis);
+
+	if (output == MGEAR_IKFK_OUT_A) {
+
+		if (angleA != 0.0)
+			rotateAlongAxis3(xAxis, zAxis, -angleA, xAxis);
+
+		if (data.negate) {
+			for (int i = 0; i < 3; i++)
+				xAxis[i] *= -1;
+		}
+		cross3(zAxis, xAxis, yAxis);
+		normalize3(yAxis);
+
+		quaternionFromAxes(xAxis, yAxis, zAxis, result.q);
+
+		result.s[0] = lengthA;
+		result.s[1] = global_scale;
+		result.s[2] = global_scale;
+		for (int i = 0; i < 3; i++)
+			result.t[i] = rootPos[i];
+	}
+	else if (output == MGEAR_IKFK_OUT_B) {
+
+		if (angleA != 0.0)
+			rotateAlongAxis3(xAxis, zAxis, -angleA, xAxis);
+
+		// the elbow
+		for (int i = 0; i < 3; i++)
+			bonePos[i] = xAxis[i] * lengthA + rootPos[i];
+
+		if (angleB != 0.0)
+			rotateAlongAxis3(xAxis, zAxis, -(angleB - MGEAR_KERNEL_PI), xAxis);
+
+		if (data.negate) {
+			for (int i = 0; i < 3; i++)
+				xAxis[i] *= -1;
+		}
+		cross3(zAxis, xAxis, yAxis);
+		normalize3(yAxis);
+
+		quaternionFromAxes(xAxis, yAxis, zAxis, result.q);
+
+		result.s[0] = lengthB;
+		result.s[1] = global_scale;
+		result.s[2] = global_scale;
+		for (int i = 0; i < 3; i++)
+			result.t[i] = bonePos[i];
+	}
+	else if (output == MGEAR_IKFK_OUT_CENTER) {
+
+		if (angleA != 0.0)
+			rotateAlongAxis3(xAxis, zAxis, -angleA, xAxis);
+
+		// the elbow
+		for (int i = 0; i < 3; i++)
+			bonePos[i] = xAxis[i] * lengthA + rootPos[i];
+
+		if (angleB != 0.0) {
+			if (invert)
+				angleB += MGEAR_KERNEL_PI * 2;
+			rotateAlongAxis3(xAxis, zAxis, -(angleB * .5 - MGEAR_KERNEL_PI * .5), xAxis);
+		}
+
+		// yAxis.Sub(upvPos,bonePos); // this was flipping the centerN when the elbow/upv was aligned to root/eff
+		cross3(xAxis, yAxis, zAxis);
+		normalize3(zAxis);
+
+		if (data.negate) {
+			for (int i = 0; i < 3; i++)
+				xAxis[i] *= -1;
+		}
+		cross3(zAxis, xAxis, yAxis);
+		normalize3(yAxis);
+
+		// keeps the root scaling
+		quaternionFromAxes(xAxis, yAxis, zAxis, result.q);
+		for (int i = 0; i < 3; i++)
+			result.t[i] = bonePos[i];
+	}
+	else if (output == MGEAR_IKFK_OUT_EFF) {
+
+		for (int i = 0; i < 3; i++)
+			effPos[i] = rootPos[i];
+		if (angleA != 0.0)
+			rotateAlongAxis3(xAxis, zAxis, -angleA, xAxis);
+
+		// the elbow
+		for (int i = 0; i < 3; i++)
+			effPos[i] += xAxis[i] * lengthA;
+
+		if (angleB != 0.0)
+			rotateAlongAxis3(xAxis, zAxis, -(angleB - MGEAR_KERNEL_PI), xAxis);
+
+		// the effector
+		for (int i = 0; i < 3; i++)
+			effPos[i] += xAxis[i] * lengthB;
+
+		result = eff;
+		for (int i = 0; i < 3; i++)
+			result.t[i] = effPos[i];
+	}
+}
+
+// The FK solve of mgear_ikfk2Bone for one output
+inline void ikfk2BoneFK(const s_TRS& bone1, const s_TRS& bone2, const s_TRS& eff, bool negate, int output, s_TRS& result)
+{
+	double xAxis[3], yAxis[3], zAxis[3];
+
+	if (output == MGEAR_IKFK_OUT_A) {
+		result = bone1;
+		for (int i = 0; i < 3; i++)
+			xAxis[i] = bone2.t[i] - bone1.t[i];
+
+		result.s[0] = std::sqrt(dot3(xAxis, xAxis));
+		result.s[1] = 1.0;
+		result.s[2] = 1.0;
+
+		if (negate) {
+			for (int i = 0; i < 3; i++)
+				xAxis[i] *= -1;
+		}
+		normalize3(xAxis);
+
+		const double z[3] = { 0.0, 0.0, 1.0 };
+		rotateByQuaternion(z, bone1.q, zAxis);
+		cross3(zAxis, xAxis, yAxis);
+
+		quaternionFromAxes(xAxis, yAxis, zAxis, result.q);
+	}
+	else if (output == MGEAR_IKFK_OUT_B) {
+		result = bone2;
+		for (int i = 0; i < 3; i++)
+			xAxis[i] = eff.t[i] - bone2.t[i];
+
+		result.s[0] = std::sqrt(dot3(xAxis, xAxis));
+		result.s[1] = 1.0;
+		result.s[2] = 1.0;
+
+		if (negate) {
+			for (int i = 0; i < 3; i++)
+				xAxis[i] *= -1;
+		}
+		normalize3(xAxis);
+
+		const double y[3] = { 0.0, 1.0, 0.0 };
+		rotateByQuaternion(y, bone2.q, yAxis);
+		cross3(xAxis, yAxis, zAxis);
+		normalize3(zAxis);
+		cross3(zAxis, xAxis, yAxis);
+		normalize3(yAxis);
+
+		quaternionFromAxes(xAxis, yAxis, zAxis, result.q);
+	}
+	else if (output == MGEAR_IKFK_OUT_CENTER) {
+		// half the euler rotation of bone2 in bone1 space
+		// Only +/-180 degree with this one but we don't get the shear issue anymore
+		double m1[4][4], m2[4][4], inv1[4][4], m[4][4];
+		composeTRS(bone1, m1);
+		composeTRS(bone2, m2);
+		if (!invertMatrix4(m1, inv1))
+			identityMatrix4(inv1);
+		multiplyMatrix4(m2, inv1, m);
+
+		s_TRS t;
+		decomposeTRS(m, t);
+		double e[3];
+		quaternionToEulerXYZ(t.q, e);
+		for (int i = 0; i < 3; i++)
+			e[i] *= .5;
+		eulerXYZToQuaternion(e, t.q);
+		composeTRS(t, m);
+		multiplyMatrix4(m, m1, m);
+		decomposeTRS(m, t);
+
+		identityTRS(result);
+		for (int i = 0; i < 4; i++)
+			result.q[i] = t.q[i];
+		for (int i = 0; i < 3; i++)
+			result.t[i] = bone2.t[i];
+	}
+	else if (output == MGEAR_IKFK_OUT_EFF)
+		result = eff;
+}
+
+// Matrix of the transform with its scale set to 1, shear is kept
+inline void ikfk2BoneUnscaled(const s_TRS& trs, double m[4][4])
+{
+	s_TRS unscaled = trs;
+	unscaled.s[0] = unscaled.s[1] = unscaled.s[2] = 1.0;
+	composeTRS(unscaled, m);
+}
+
+// Without shear the unscaled bones are rigid transforms, and mapping them
+// between global and local space doesn't need any matrix.
+inline bool ikfk2BoneRigid(const s_TRS& trs)
+{
+	return std::fabs(trs.sh[0]) < MGEAR_TRS_EPSILON && std::fabs(trs.sh[1]) < MGEAR_TRS_EPSILON && std::fabs(trs.sh[2]) < MGEAR_TRS_EPSILON;
+}
+
+// decomposeTRS() of ikfk2BoneUnscaled() for a rigid transform: unit scale,
+// no shear, the quaternion normalized with w >= 0
+inline void ikfk2BoneRigidPart(const s_TRS& trs, s_TRS& out)
+{
+	double len = std::sqrt(trs.q[0] * trs.q[0] + trs.q[1] * trs.q[1] + trs.q[2] * trs.q[2] + trs.q[3] * trs.q[3]);
+	if (trs.q[3] < 0.0)
+		len = -len;
+	for (int i = 0; i < 3; i++) {
+		out.t[i] = trs.t[i];
+		out.s[i] = 1.0;
+		out.sh[i] = 0.0;
+	}
+	for (int i = 0; i < 4; i++)
+		out.q[i] = trs.q[i] / len;
+}
+
+// localMatrix() on rigid transforms: out = m * parent.inverse()
+inline void rigidLocal(const s_TRS& m, const s_TRS& parent, s_TRS& out)
+{
+	const double inv[4] = { -parent.q[0], -parent.q[1], -parent.q[2], parent.q[3] };
+	double d[3] = { m.t[0] - parent.t[0], m.t[1] - parent.t[1], m.t[2] - parent.t[2] };
+	quatRotate(inv, d, out.t);
+	quatMultiply(inv, m.q, out.q);
+	if (out.q[3] < 0.0) {
+		for (int i = 0; i < 4; i++)
+			out.q[i] = -out.q[i];
+	}
+	for (int i = 0; i < 3; i++) {
+		out.s[i] = 1.0;
+		out.sh[i] = 0.0;
+	}
+}
+
+// multiplyMatrix4() on rigid transforms: out = m * parent
+inline void rigidMultiply(const s_TRS& m, const s_TRS& parent, s_TRS& out)
+{
+	double t[3];
+	quatRotate(parent.q, m.t, t);
+	quatMultiply(parent.q, m.q, out.q);
+	if (out.q[3] < 0.0) {
+		for (int i = 0; i < 4; i++)
+			out.q[i] = -out.q[i];
+	}
+	for (int i = 0; i < 3; i++) {
+		out.t[i] = t[i] + parent.t[i];
+		out.s[i] = 1.0;
+		out.sh[i] = 0.0;
+	}
+}
+
+// The transforms the outputs of mgear_ikfk2Bone are built from: the IK
+// solve at blend 1, the FK bones otherwise, blended with the IK ones in
+// between.
+struct s_IkFk2BoneBones
+{
+	bool ik;
+	double roll;	// radians
+	s_TRS root;
+	s_TRS ikref;
+	s_TRS upv;
+	s_TRS bone1;
+	s_TRS bone2;
+	s_TRS eff;
+};
+
+// The part of mgear_ikfk2Bone::compute() all the outputs share
+inline void ikfk2BoneBones(const s_IkFk2BoneInputs& in, s_IkFk2BoneBones& bones)
+{
+	bones.ik = in.blend == 1.0;
+	bones.roll = in.roll * MGEAR_KERNEL_DEG2RAD;
+	if (in.blend != 0.0) {
+		decomposeTRS(in.root, bones.root);
+		decomposeTRS(in.ikref, bones.ikref);
+		decomposeTRS(in.upv, bones.upv);
+	}
+	if (bones.ik)
+		return;
+
+	decomposeTRS(in.fk0, bones.bone1);
+	decomposeTRS(in.fk1, bones.bone2);
+	decomposeTRS(in.fk2, bones.eff);
+	if (in.blend == 0.0)
+		return;
+
+	s_TRS ikbone1, ikbone2, ikeff, fkbone1, fkbone2, fkeff;
+	ikfk2BoneIK(bones.root, bones.ikref, bones.upv, in, bones.roll, MGEAR_IKFK_OUT_A, ikbone1);
+	ikfk2BoneIK(bones.root, bones.ikref, bones.upv, in, bones.roll, MGEAR_IKFK_OUT_B, ikbone2);
+	ikfk2BoneIK(bones.root, bones.ikref, bones.upv, in, bones.roll, MGEAR_IKFK_OUT_EFF, ikeff);
+	ikfk2BoneFK(bones.bone1, bones.bone2, bones.eff, in.negate, MGEAR_IKFK_OUT_A, fkbone1);
+	ikfk2BoneFK(bones.bone1, bones.bone2, bones.eff, in.negate, MGEAR_IKFK_OUT_B, fkbone2);
+	ikfk2BoneFK(bones.bone1, bones.bone2, bones.eff, in.negate, MGEAR_IKFK_OUT_EFF, fkeff);
+
+	// remove scale to avoid shearing issue
+	// This is not necessary in Softimage because the scaling hierarchy is not computed the same way.
+	// map the secondary transforms from global to local
+	s_TRS ikB1, ikB2, ikE, fkB1, fkB2, fkE;
+	bool rigid = ikfk2BoneRigid(ikbone1) && ikfk2BoneRigid(ikbone2) && ikfk2BoneRigid(ikeff)
+		&& ikfk2BoneRigid(fkbone1) && ikfk2BoneRigid(fkbone2) && ikfk2BoneRigid(fkeff);
+	if (rigid) {
+		s_TRS ikB2g, fkB2g;
+		ikfk2BoneRigidPart(ikbone1, ikB1);
+		ikfk2BoneRigidPart(fkbone1, fkB1);
+		ikfk2BoneRigidPart(ikbone2, ikB2g);
+		ikfk2BoneRigidPart(fkbone2, fkB2g);
+		ikfk2BoneRigidPart(ikeff, ikE);
+		ikfk2BoneRigidPart(fkeff, fkE);
+		rigidLocal(ikE, ikB2g, ikE);
+		rigidLocal(fkE, fkB2g, fkE);
+		rigidLocal(ikB2g, ikB1, ikB2);
+		rigidLocal(fkB2g, fkB1, fkB2);
+	}
+	else {
+		double mIkBone1[4][4], mIkBone2[4][4], mFkBone1[4][4], mFkBone2[4][4], m[4][4];
+		ikfk2BoneUnscaled(ikbone1, mIkBone1);
+		ikfk2BoneUnscaled(ikbone2, mIkBone2);
+		ikfk2BoneUnscaled(fkbone1, mFkBone1);
+		ikfk2BoneUnscaled(fkbone2, mFkBone2);
+
+		decomposeTRS(mIkBone1, ikB1);
+		decomposeTRS(mFkBone1, fkB1);
+		ikfk2BoneUnscaled(ikeff, m);
+		localMatrix(m, mIkBone2, m);
+		decomposeTRS(m, ikE);
+		ikfk2BoneUnscaled(fkeff, m);
+		localMatrix(m, mFkBone2, m);
+		decomposeTRS(m, fkE);
+		localMatrix(mIkBone2, mIkBone1, m);
+		decomposeTRS(m, ikB2);
+		localMatrix(mFkBone2, mFkBone1, m);
+		decomposeTRS(m, fkB2);
+	}
+
+	s_TRS blendB1, blendB2, blendE;
+	interpolateTRSMode(fkB1, ikB1, in.blend, in.interpolation, blendB1);
+	interpolateTRSMode(fkB2, ikB2, in.blend, in.interpolation, blendB2);
+	interpolateTRSMode(fkE, ikE, in.blend, in.interpolation, blendE);
+
+	// map the local transforms back to global
+	bones.bone1 = blendB1;
+	if (rigid) {
+		rigidMultiply(blendB2, blendB1, bones.bone2);
+		rigidMultiply(blendE, bones.bone2, bones.eff);
+	}
+	else {
+		// a sheared bone leaves some scale in the local transforms
+		double mBone1[4][4], mBone2[4][4], mEff[4][4];
+		composeTRS(blendB1, mBone1);
+		composeTRS(blendB2, mBone2);
+		composeTRS(blendE, mEff);
+		multiplyMatrix4(mBone2, mBone1, mBone2);
+		multiplyMatrix4(mEff, mBone2, mEff);
+		decomposeTRS(mBone2, bones.bone2);
+		decomposeTRS(mEff, bones.eff);
+	}
+}
+
+// One output of mgear_ikfk2Bone::compute(), local to its parent matrix
+inline void ikfk2BoneOutput(const s_IkFk2BoneInputs& in, const s_IkFk2BoneBones& bones, int output, double out[4][4])
+{
+	s_TRS result;
+	if (bones.ik)
+		ikfk2BoneIK(bones.root, bones.ikref, bones.upv, in, bones.roll, output, result);
+	else
+		ikfk2BoneFK(bones.bone1, bones.bone2, bones.eff, in.negate, output, result);
+
+	double m[4][4];
+	composeTRS(result, m);
+	localMatrix(m, in.parent[output], out);
+}
+
+// The four outputs at once
+inline void ikfk2Bone(const s_IkFk2BoneInputs& in, double out[4][4][4])
+{
+	s_IkFk2BoneBones bones;
+	ikfk2BoneBones(in, bones);
+	for (int o = 0; o < 4; o++)
+		ikfk2BoneOutput(in, bones, o, out[o]);
+}
+
+/////////////////////////////////////////////////
+// ROLLSPLINEKINE
+/////////////////////////////////////////////////
+
+// bezier4point()
+inline void bezier4point3(const double a[3], const double tan_a[3], const double d[3], const double tan_d[3], double u, double position[3], double tangent[3])
+{
+	double b[3], c[3], ab[3], bc[3], cd[3], abbc[3], bccd[3];
+	for (int i = 0; i < 3; i++) {
+		b[i] = a[i] + tan_a[i];
+		c[i] = -tan_d[i] + d[i];
+	}
+	lerp3(a, b, u, ab);
+	lerp3(b, c, u, bc);
+	lerp3(c, d, u, cd);
+	lerp3(ab, bc, u, abbc);
+	lerp3(bc, cd, u, bccd);
+	lerp3(abbc, bccd, u, position);
+	for (int i = 0; i < 3; i++)
+		tangent[i] = bccd[i] - abbc[i];
+	normalize3(tangent);
+}
+
+// The attributes of mgear_rollSplineKine. The arrays hold count elements,
+// roll in degrees.
+struct s_RollSplineKineInputs
+{
+	const double (*ctlParent)[4][4];
+	const double (*inputs)[4][4];
+	const double* inputsRoll;
+	int count;
+	double outputParent[4][4];
+
+	double u;
+	bool resample;
+	int subdiv;
+	bool absolute;
+
+	s_RollSplineKineInputs() : ctlParent(NULL), inputs(NULL), inputsRoll(NULL), count(0), u(0.0), resample(false), subdiv(10), absolute(false)
+	{
+		identityMatrix4(outputParent);
+	}
+};
+
+// Resampled position and tangent at the arc length ratio u of the samples,
+// the node leaves them at zero when u is out of the curve.
+inline void rollSplineKineResampled(const std::vector<double>& samples, const std::vector<double>& lengths, double u, double position[3], double tangent[3])
+{
+	int subdiv = (int)lengths.size();
+	double overalllen = lengths[subdiv - 1];
+	double previous = 0.0;
+	for (int i = 0; i < subdiv - 1; i++) {
+		double next = lengths[i + 1] / overalllen;
+		if (u >= previous && u <= next) {
+			double v = (u - previous) / (next - previous);
+			lerp3(&samples[i * 6], &samples[(i + 1) * 6], v, position);
+			lerp3(&samples[i * 6 + 3], &samples[(i + 1) * 6 + 3], v, tangent);
+			return;
+		}
+		previous = next;
+	}
+}
+
+// mgear_rollSplineKine::compute(), false when the node fails (less than two
+// controlers)
+inline bool rollSplineKine(const s_RollSplineKineInputs& in, double out[4][4])
+{
+	int count = in.count;
+	if (count < 2)
+		return false;
+
+	// Get roll, pos, tan, rot, scl, in one buffer
+	std::vector<double> buffer(count * 14);
+	double* pos = &buffer[0];
+	double* tan = pos + count * 3;
+	double* rot = tan + count * 3;
+	double* scl = rot + count * 4;
+	double* roll = scl + count * 3;
+	s_TRS tp, t;
+	for (int i = 0; i < count; i++) {
+		decomposeTRS(in.ctlParent[i], tp);
+		decomposeTRS(in.inputs[i], t);
+		for (int j = 0; j < 3; j++) {
+			pos[i * 3 + j] = t.t[j];
+			scl[i * 3 + j] = t.s[j];
+		}
+		for (int j = 0; j < 4; j++)
+			rot[i * 4 + j] = tp.q[j];
+		double x[3] = { t.s[0] * 2.5, 0.0, 0.0 };
+		rotateByQuaternion(x, t.q, &tan[i * 3]);
+		roll[i] = in.inputsRoll[i] * MGEAR_KERNEL_DEG2RAD;
+	}
+
+	// Get step and indexes
+	double in_u = in.u;
+	double step = 1.0 / std::max(1, count - 1);
+	int index1 = std::min(count - 2, int(std::floor(in_u / step)));
+	int index2 = index1 + 1;
+	double v = (in_u - step * double(index1)) / step;
+
+	// calculate the bezier
+	double bezierPos[3] = { 0.0, 0.0, 0.0 };
+	double xAxis[3] = { 0.0, 0.0, 0.0 };
+	double yAxis[3], zAxis[3];
+	if (!in.resample) {
+		bezier4point3(&pos[index1 * 3], &tan[index1 * 3], &pos[index2 * 3], &tan[index2 * 3], v, bezierPos, xAxis);
+	}
+	else {
+		// position and tangent of each sample, with the length along the curve
+		int subdiv = std::max(in.subdiv, 2);
+		std::vector<double> samples(subdiv * 6);
+		std::vector<double> lengths(subdiv);
+		double samplestep = 1.0 / double(subdiv - 1);
+		double sampleu = samplestep;
+		int first = in.absolute ? 0 : index1;
+		for (int j = 0; j < 3; j++) {
+			samples[j] = pos[first * 3 + j];
+			samples[3 + j] = tan[first * 3 + j];
+		}
+		lengths[0] = 0;
+		double overalllen = 0;
+		for (int i = 1; i < subdiv; i++, sampleu += samplestep) {
+			int i1 = index1;
+			double sv = sampleu;
+			if (in.absolute) {
+				i1 = std::min(count - 2, int(std::floor(sampleu / step)));
+				sv = (sampleu - step * double(i1)) / step;
+			}
+			int i2 = i1 + 1;
+			double* sample = &samples[i * 6];
+			bezier4point3(&pos[i1 * 3], &tan[i1 * 3], &pos[i2 * 3], &tan[i2 * 3], sv, sample, sample + 3);
+			double diff[3] = { sample[0] - sample[-6], sample[1] - sample[-5], sample[2] - sample[-4] };
+			overalllen += std::sqrt(dot3(diff, diff));
+			lengths[i] = overalllen;
+		}
+		rollSplineKineResampled(samples, lengths, in.absolute ? in_u : v, bezierPos, xAxis);
+	}
+
+	// compute the scaling (straight interpolation!)
+	double scl1[3];
+	lerp3(&scl[index1 * 3], &scl[index2 * 3], v, scl1);
+
+	// compute the rotation!
+	double q[4];
+	slerpQuaternion(&rot[index1 * 4], &rot[index2 * 4], v, q);
+	const double y[3] = { 0.0, 1.0, 0.0 };
+	rotateByQuaternion(y, q, yAxis);
+
+	double a = roll[index1] * (1 - v) + roll[index2] * v;
+	double sa = std::sin(a / 2.0);
+	double rollq[4] = { xAxis[0] * sa, xAxis[1] * sa, xAxis[2] * sa, std::cos(a / 2.0) };
+	rotateByQuaternion(yAxis, rollq, yAxis);
+
+	cross3(xAxis, yAxis, zAxis);
+	normalize3(zAxis);
+	cross3(zAxis, xAxis, yAxis);
+	normalize3(yAxis);
+
+	// Output
+	s_TRS result;
+	for (int i = 0; i < 3; i++) {
+		result.t[i] = bezierPos[i];
+		result.sh[i] = 0.0;
+	}
+	quaternionFromAxes(xAxis, yAxis, zAxis, result.q);
+	// the node only sets the first scale component (to scl1.z), the others
+	// are left from the last decomposed input
+	result.s[0] = scl1[2];
+	result.s[1] = t.s[1];
+	result.s[2] = t.s[2];
+
+	double m[4][4];
+	composeTRS(result, m);
+	localMatrix(m, in.outputParent, out);
+	return true;
+}
+
+/////////////////////////////////////////////////
+// MATRIXCONSTRAINT
+/////////////////////////////////////////////////
+
+// The attributes of mgear_matrixConstraint, with their defaults.
+// driverList and driverWeights hold driverCount elements.
+struct s_MatrixConstraintInputs
+{
+	double driverMatrix[4][4];
+	const double (*driverList)[4][4];
+	const double* driverWeights;
+	int driverCount;
+	double driverRotationOffset[3];	// degrees
+	double drivenParentInverseMatrix[4][4];
+	double drivenRestMatrix[4][4];
+	double rotationMultiplier[3];
+	double scaleMultiplier[3];
+
+	s_MatrixConstraintInputs() : driverList(NULL), driverWeights(NULL), driverCount(0)
+	{
+		identityMatrix4(driverMatrix);
+		identityMatrix4(drivenParentInverseMatrix);
+		identityMatrix4(drivenRestMatrix);
+		for (int i = 0; i < 3; i++) {
+			driverRotationOffset[i] = 0.0;
+			rotationMultiplier[i] = 1.0;
+			scaleMultiplier[i] = 1.0;
+		}
+	}
+};
+
+// The outputs of mgear_matrixConstraint, rotate in radians
+struct s_MatrixConstraintOutputs
+{
+	double outputMatrix[4][4];
+	double driverOffsetOutputMatrix[4][4];
+	double translate[3];
+	double rotate[3];
+	double scale[3];
+	double shear[3];
+};
+
+// outputDriverOffsetMatrix of mgear_matrixConstraint, the driver with its
+// rotation offset
+inline void matrixConstraintDriver(const s_MatrixConstraintInputs& in, double out[4][4])
+{
+	s_TRS driver_trs;
+
+	// blend the weighted drivers into a single driver matrix
+	double driver_matrix[4][4];
+	copyMatrix4(in.driverMatrix, driver_matrix);
+	if (in.driverCount > 0) {
+		std::vector<s_TRS> driver_list(in.driverCount);
+		for (int i = 0; i < in.driverCount; i++)
+			decomposeTRS(in.driverList[i], driver_list[i]);
+
+		s_TRS driver_blend;
+		if (blendTRS(&driver_list[0], in.driverWeights, in.driverCount, driver_blend))
+			composeTRS(driver_blend, driver_matrix);
+	}
+
+	// pre transform rotation: the offset is applied before the driver rotation
+	double euler_off[3];
+	for (int i = 0; i < 3; i++)
+		euler_off[i] = in.driverRotationOffset[i] * MGEAR_KERNEL_DEG2RAD;
+	double offset[4];
+	eulerXYZToQuaternion(euler_off, offset);
+	decomposeTRS(driver_matrix, driver_trs);
+	quatMultiply(driver_trs.q, offset, driver_trs.q);
+	composeTRS(driver_trs, out);
+}
+
+// The other outputs of mgear_matrixConstraint, from the driver offset matrix
+inline void matrixConstraintSolve(const s_MatrixConstraintInputs& in, const double driverOffset[4][4], s_MatrixConstraintOutputs& out)
+{
+	s_TRS result;
+	double mult_matrix[4][4], rotate_matrix[4][4];
+	multiplyMatrix4(driverOffset, in.drivenParentInverseMatrix, mult_matrix);
+
+	// the rotation is calculated separately, relative to the rest (joint orientation)
+	localMatrix(mult_matrix, in.drivenRestMatrix, rotate_matrix);
+
+	decomposeTRS(mult_matrix, result);
+
+	s_TRS rotate_trs;
+	decomposeTRS(rotate_matrix, rotate_trs);
+	double rotation[4] = { rotate_trs.q[0], rotate_trs.q[1], rotate_trs.q[2], rotate_trs.q[3] };
+
+	for (int i = 0; i < 3; i++) {
+		rotation[i] *= in.rotationMultiplier[i];
+		result.s[i] *= in.scaleMultiplier[i];
+	}
+
+	for (int i = 0; i < 4; i++)
+		result.q[i] = rotation[i];
+	composeTRS(result, out.outputMatrix);
+
+	// the multiplier leaves the quaternion unnormalized
+	double n = std::sqrt(rotation[0] * rotation[0] + rotation[1] * rotation[1] + rotation[2] * rotation[2] + rotation[3] * rotation[3]);
+	if (n > MGEAR_TRS_EPSILON) {
+		for (int i = 0; i < 4; i++)
+			rotation[i] /= n;
+	}
+	quaternionToEulerXYZ(rotation, out.rotate);
+
+	for (int i = 0; i < 3; i++) {
+		out.translate[i] = result.t[i];
+		out.scale[i] = result.s[i];
+		out.shear[i] = result.sh[i];
+	}
+}
+
+// mgear_matrixConstraint::compute(), all the outputs
+inline void matrixConstraint(const s_MatrixConstraintInputs& in, s_MatrixConstraintOutputs& out)
+{
+	matrixConstraintDriver(in, out.driverOffsetOutputMatrix);
+	matrixConstraintSolve(in, out.driverOffsetOutputMatrix, out);
+}
+
+/////////////////////////////////////////////////
+// INTERPOLATEMATRIX
+/////////////////////////////////////////////////
+
+// mgear_intMatrix::compute(), the single output
+inline void interpolateMatrix(const double a[4][4], const double b[4][4], double blend, int mode, double out[4][4])
+{
+	if (blend == 1.0)
+		copyMatrix4(b, out);
+	else if (blend == 0.0)
+		copyMatrix4(a, out);
+	else {
+		s_TRS tA, tB, tC;
+		decomposeTRS(a, tA);
+		decomposeTRS(b, tB);
+		interpolateTRSMode(tA, tB, blend, mode, tC);
+		composeTRS(tC, out);
+	}
+}
+
+// The outputs array of mgear_intMatrix: A and B are decomposed once for all
+// the blends, with the same end points as the single output
+inline void interpolateMatrixArray(const double a[4][4], const double b[4][4], const double* blends, int count, int mode, double (*out)[4][4])
+{
+	if (count <= 0)
+		return;
+
+	s_TRS tA, tB;
+	decomposeTRS(a, tA);
+	decomposeTRS(b, tB);
+
+	const int chunk = 64;
+	s_TRS tC[chunk];
+	for (int first = 0; first < count; first += chunk) {
+		int n = std::min(chunk, count - first);
+		if (mode == MGEAR_INTERPOLATE_SLERP)
+			interpolateTRSArray(tA, tB, blends + first, n, tC);
+		else {
+			for (int i = 0; i < n; i++)
+				interpolateTRSMode(tA, tB, blends[first + i], mode, tC[i]);
+		}
+
+		for (int i = 0; i < n; i++) {
+			if (blends[first + i] == 1.0)
+				copyMatrix4(b, out[first + i]);
+			else if (blends[first + i] == 0.0)
+				copyMatrix4(a, out[first + i]);
+			else
+				composeTRS(tC[i], out[first + i]);
+		}
+	}
+}
+
+/////////////////////////////////////////////////
+// SPRINGNODE
+/////////////////////////////////////////////////
+
+// A point of the spring kernels, unlike double[3] it can be copied
+struct s_Point3
+{
+	double v[3];
+};
+
+// The integration of mgear_springNode for mgear_springSimulation
+struct s_SpringPoint3Traits
+{
+	typedef s_Point3 Goal;
+	typedef s_Point3 Velocity;
+
+	static bool equivalent(const s_Point3& a, const s_Point3& b)
+	{
+		for (int i = 0; i < 3; i++) {
+			if (std::fabs(a.v[i] - b.v[i]) > 1.0e-9)
+				return false;
+		}
+		return true;
+	}
+
+	static s_Point3 rest(const s_Point3&)
+	{
+		s_Point3 velocity = { { 0.0, 0.0, 0.0 } };
+		return velocity;
+	}
+
+	static s_Point3 rigidVelocity(const s_Point3& from, const s_Point3& to, double frames)
+	{
+		s_Point3 velocity;
+		for (int i = 0; i < 3; i++)
+			velocity.v[i] = (to.v[i] - from.v[i]) / frames;
+		return velocity;
+	}
+
+	static void interpolate(const s_Point3& a, const s_Point3& b, double blend, s_Point3& out)
+	{
+		lerp3(a.v, b.v, blend, out.v);
+	}
+
+	void step(const s_Point3& goal, s_Point3& position, s_Point3& velocity, const s_SpringCoefficients& coef, double h) const
+	{
+		double offset[3];
+		for (int i = 0; i < 3; i++)
+			offset[i] = goal.v[i] - position.v[i];
+		springVelocity3(velocity.v, offset, coef, h, velocity.v);
+		for (int i = 0; i < 3; i++)
+			position.v[i] += velocity.v[i] * h;
+	}
+};
+
+typedef mgear_springSimulation<s_SpringPoint3Traits> mgear_springPointSimulation;
+
+// mgear_springNode::compute(), simulation is what the node keeps from one
+// evaluation to the next. The bake tool evaluates the rows in order, with
+// the cacheSize channel (0 when missing).
+inline void springNode(mgear_springPointSimulation& simulation, const double goal[3], double currentFrame, double stiffness, double damping,
+	double intensity, int substeps, unsigned cacheSize, double out[3])
+{
+	s_SpringSettings settings = { stiffness, damping, std::max(1, substeps), 0 };
+	s_Point3 g = { { goal[0], goal[1], goal[2] } };
+	const s_Point3& newPosition = simulation.evaluate(s_SpringPoint3Traits(), g, currentFrame, settings, cacheSize);
+
+	// multiply the position by the spring intensity, after the states are
+	// stored so they aren't affected
+	for (int i = 0; i < 3; i++)
+		out[i] = goal[i] + ((newPosition.v[i] - goal[i]) * intensity);
+}
+
+/////////////////////////////////////////////////
+// ROTATIONALSPRINGNODE
+/////////////////////////////////////////////////
+
+// A rotation of the spring kernels (x, y, z, w)
+struct s_Quaternion
+{
+	double q[4];
+};
+
+// Rotation vector (axis * angle) of the shortest rotation q
+inline void rotationVector(const double q[4], double out[3])
+{
+	double s = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+	if (s < 1.0e-12) {
+		out[0] = out[1] = out[2] = 0.0;
+		return;
+	}
+	double sign = (q[3] < 0.0) ? -1.0 : 1.0;
+	double a = 2.0 * sign * std::atan2(s, sign * q[3]) / s;
+	for (int i = 0; i < 3; i++)
+		out[i] = q[i] * a;
+}
+
+// The rotation taking a to b: b * a^-1 in quatMultiply order
+inline void quatDifference(const double a[4], const double b[4], double out[4])
+{
+	double n = a[0] * a[0] + a[1] * a[1] + a[2] * a[2] + a[3] * a[3];
+	if (n == 0.0)
+		n = 1.0;
+	double inverse[4] = { -a[0] / n, -a[1] / n, -a[2] / n, a[3] / n };
+	quatMultiply(b, inverse, out);
+}
+
+// The integration of mgear_rotationalSpringNode for mgear_springSimulation.
+// The angular velocity is integrated like the position of mgear_springNode,
+// the offset to the goal being the rotation vector from the current
+// rotation.
+struct s_SpringRotationTraits
+{
+	typedef s_Quaternion Goal;
+	typedef s_Point3 Velocity;
+
+	static bool equivalent(const s_Quaternion& a, const s_Quaternion& b)
+	{
+		for (int i = 0; i < 4; i++) {
+			if (std::fabs(a.q[i] - b.q[i]) > 1.0e-9)
+				return false;
+		}
+		return true;
+	}
+
+	static s_Point3 rest(const s_Quaternion&)
+	{
+		s_Point3 velocity = { { 0.0, 0.0, 0.0 } };
+		return velocity;
+	}
+
+	static s_Point3 rigidVelocity(const s_Quaternion& from, const s_Quaternion& to, double frames)
+	{
+		double d[4];
+		s_Point3 velocity;
+		quatDifference(from.q, to.q, d);
+		rotationVector(d, velocity.v);
+		for (int i = 0; i < 3; i++)
+			velocity.v[i] /= frames;
+		return velocity;
+	}
+
+	static void interpolate(const s_Quaternion& a, const s_Quaternion& b, double blend, s_Quaternion& out)
+	{
+		slerpQuaternion(a.q, b.q, blend, out.q);
+	}
+
+	void step(const s_Quaternion& goal, s_Quaternion& rotation, s_Point3& velocity, const s_SpringCoefficients& coef, double h) const
+	{
+		double d[4], offset[3];
+		quatDifference(rotation.q, goal.q, d);
+		rotationVector(d, offset);
+		springVelocity3(velocity.v, offset, coef, h, velocity.v);
+
+		// rotate by the exponential of half the angular step
+		double half[3] = { velocity.v[0] * 0.5 * h, velocity.v[1] * 0.5 * h, velocity.v[2] * 0.5 * h };
+		double a = std::sqrt(half[0] * half[0] + half[1] * half[1] + half[2] * half[2]);
+		double e[4] = { 0.0, 0.0, 0.0, 1.0 };
+		if (a >= 1.0e-12) {
+			double sa = std::sin(a) / a;
+			e[0] = half[0] * sa;
+			e[1] = half[1] * sa;
+			e[2] = half[2] * sa;
+			e[3] = std::cos(a);
+		}
+		quatMultiply(e, rotation.q, rotation.q);
+
+		double n = std::sqrt(rotation.q[0] * rotation.q[0] + rotation.q[1] * rotation.q[1] + rotation.q[2] * rotation.q[2] + rotation.q[3] * rotation.q[3]);
+		if (n > 0.0) {
+			for (int i = 0; i < 4; i++)
+				rotation.q[i] /= n;
+		}
+	}
+};
+
+typedef mgear_springSimulation<s_SpringRotationTraits> mgear_springRotationSimulation;
+
+// mgear_rotationalSpringNode::compute(), the rotation of goal springs, its
+// translation, scale and shear are kept. Same use of simulation and
+// cacheSize as springNode().
+inline void rotationalSpringNode(mgear_springRotationSimulation& simulation, const double goal[4][4], double currentFrame, double stiffness,
+	double damping, double intensity, int substeps, unsigned cacheSize, double out[4][4])
+{
+	s_TRS trs;
+	decomposeTRS(goal, trs);
+	s_SpringSettings settings = { stiffness, damping, std::max(1, substeps), 0 };
+	s_Quaternion g = { { trs.q[0], trs.q[1], trs.q[2], trs.q[3] } };
+	const s_Quaternion& rotation = simulation.evaluate(s_SpringRotationTraits(), g, currentFrame, settings, cacheSize);
+
+	// blend with the goal by the spring intensity, after the states are
+	// stored so they aren't affected
+	slerpQuaternion(g.q, rotation.q, intensity, trs.q);
+	composeTRS(trs, out);
+}
+
+/////////////////////////////////////////////////
+// NURBS CURVE
+/////////////////////////////////////////////////
+
+// The degree of the curves the kernels evaluate, as high as Maya allows
+#define MGEAR_KERNEL_MAX_DEGREE 7
+
+// Non rational NURBS curve with Maya's knots: cvCount + degree - 1 values,
+// without the two extra end knots of the textbook definition. Empty knots
+// mean the uniform open curve Maya builds by default
+// (0, 0, 0, 1, 2 .. cvCount - 3, cvCount - 3, cvCount - 3 for a cubic).
+struct s_NurbsCurve
+{
+	int degree;
+	std::vector<double> cvs;	// x, y, z per cv
+	std::vector<double> knots;
+
+	s_NurbsCurve() : degree(3) {}
+
+	int cvCount() const { return (int)cvs.size() / 3; }
+};
+
+// What MFnNurbsCurve keeps between calls: the full knot vector and the arc
+// length table. Built by nurbsPrepare().
+// The members are what the curve kernels need from a curve, s_CurveFn of
+// mgear_solvers.h has the same ones on an MFnNurbsCurve.
+struct s_NurbsEvaluator
+{
+	const s_NurbsCurve* curve;
+	std::vector<double> knots;		// cvCount + degree + 1
+	std::vector<double> params;		// arc length table samples
+	std::vector<double> lengths;	// curve length at each sample
+	double start;
+	double end;
+	bool valid;
+
+	int cvCount() const { return curve->cvCount(); }
+	void point(double u, double out[3]) const;
+	void tangent(double u, double out[3]) const;	// not normalized
+	double length() const;
+	double paramFromLength(double length) const;
+};
+
+// Gauss-Legendre nodes and weights on [-1, 1], 8 points
+static const double MGEAR_KERNEL_GAUSS_X[8] = { -0.9602898564975363, -0.7966664774136267, -0.5255324099163290, -0.1834346424956498,
+	0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+static const double MGEAR_KERNEL_GAUSS_W[8] = { 0.1012285362903763, 0.2223810344533745, 0.3137066458778873, 0.3626837833783620,
+	0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+
+// de Boor on degree + 1 points, the first being cv span - degree
+inline void nurbsDeBoor(const double (*points)[3], const double* knots, int degree, int span, double u, double out[3])
+{
+	double d[MGEAR_KERNEL_MAX_DEGREE + 1][3];
+	for (int j = 0; j <= degree; j++) {
+		for (int i = 0; i < 3; i++)
+			d[j][i] = points[j][i];
+	}
+	for (int r = 1; r <= degree; r++) {
+		for (int j = degree; j >= r; j--) {
+			double left = knots[span - degree + j];
+			double right = knots[span + 1 + j - r];
+			double alpha = (right > left) ? (u - left) / (right - left) : 0.0;
+			for (int i = 0; i < 3; i++)
+				d[j][i] = (1.0 - alpha) * d[j - 1][i] + alpha * d[j][i];
+		}
+	}
+	for (int i = 0; i < 3; i++)
+		out[i] = d[degree][i];
+}
+
+// the knot span of u, clamped to the domain
+inline int nurbsSpan(const s_NurbsEvaluator& e, double& u)
+{
+	int degree = e.curve->degree;
+	int n = e.curve->cvCount();
+	u = std::min(std::max(u, e.start), e.end);
+	int span = (int)(std::upper_bound(e.knots.begin() + degree, e.knots.begin() + n, u) - e.knots.begin()) - 1;
+	return std::min(std::max(span, degree), n - 1);
+}
+
+// MFnNurbsCurve::getPointAtParam(), u clamped to the domain
+inline void nurbsPoint(const s_NurbsEvaluator& e, double u, double out[3])
+{
+	int span = nurbsSpan(e, u);
+	int degree = e.curve->degree;
+	nurbsDeBoor((const double(*)[3])&e.curve->cvs[(span - degree) * 3], &e.knots[0], degree, span, u, out);
+}
+
+// First derivative at u, MFnNurbsCurve::tangent() once normalized
+inline void nurbsDerivative(const s_NurbsEvaluator& e, double u, double out[3])
+{
+	int span = nurbsSpan(e, u);
+	int degree = e.curve->degree;
+	const double* cvs = &e.curve->cvs[0];
+	const double* U = &e.knots[0];
+
+	// the cvs of the derivative curve, degree - 1 on the knots without the
+	// first and last ones
+	double q[MGEAR_KERNEL_MAX_DEGREE][3];
+	for (int j = 0; j < degree; j++) {
+		int i = span - degree + j;
+		double dk = U[i + degree + 1] - U[i + 1];
+		double f = (dk > 0.0) ? degree / dk : 0.0;
+		for (int c = 0; c < 3; c++)
+			q[j][c] = (cvs[(i + 1) * 3 + c] - cvs[i * 3 + c]) * f;
+	}
+	nurbsDeBoor(q, U + 1, degree - 1, span - 1, u, out);
+}
+
+// speed integrated over [a, b]
+inline double nurbsArcLength(const s_NurbsEvaluator& e, double a, double b)
+{
+	double half = (b - a) * 0.5;
+	double mid = (a + b) * 0.5;
+	double length = 0.0;
+	for (int i = 0; i < 8; i++) {
+		double d[3];
+		nurbsDerivative(e, mid + half * MGEAR_KERNEL_GAUSS_X[i], d);
+		length += MGEAR_KERNEL_GAUSS_W[i] * std::sqrt(dot3(d, d));
+	}
+	return length * half;
+}
+
+// Full knots and arc length table of the curve, valid is false when the
+// curve can't be evaluated. The curve has to outlive the evaluator. Skip the
+// table when only points and derivatives are needed.
+inline void nurbsPrepare(const s_NurbsCurve& curve, s_NurbsEvaluator& e, bool arcLength = true)
+{
+	const int subdivisions = 8;	// per span, for the arc length
+	e.curve = &curve;
+	int degree = curve.degree;
+	int n = curve.cvCount();
+	e.valid = degree >= 1 && degree <= MGEAR_KERNEL_MAX_DEGREE && n > degree
+		&& (curve.knots.empty() || (int)curve.knots.size() == n + degree - 1);
+	e.knots.clear();
+	e.params.clear();
+	e.lengths.clear();
+	e.start = e.end = 0.0;
+	if (!e.valid)
+		return;
+
+	if (curve.knots.empty()) {
+		// uniform, open
+		for (int i = 0; i < n + degree + 1; i++)
+			e.knots.push_back((double)std::min(std::max(i - degree, 0), n - degree));
+	}
+	else {
+		e.knots.push_back(curve.knots[0]);
+		e.knots.insert(e.knots.end(), curve.knots.begin(), curve.knots.end());
+		e.knots.push_back(curve.knots.back());
+	}
+	e.start = e.knots[degree];
+	e.end = e.knots[n];
+	if (!arcLength)
+		return;
+
+	e.params.push_back(e.start);
+	e.lengths.push_back(0.0);
+	for (int span = degree; span < n; span++) {
+		double a = e.knots[span];
+		double b = e.knots[span + 1];
+		if (b <= a)
+			continue;
+		for (int i = 1; i <= subdivisions; i++) {
+			double u = a + (b - a) * i / subdivisions;
+			e.lengths.push_back(e.lengths.back() + nurbsArcLength(e, e.params.back(), u));
+			e.params.push_back(u);
+		}
+	}
+}
+
+// MFnNurbsCurve::length()
+inline double nurbsLength(const s_NurbsEvaluator& e)
+{
+	return e.lengths.empty() ? 0.0 : e.lengths.back();
+}
+
+// MFnNurbsCurve::findParamFromLength(), clamped to the curve
+inline double nurbsParamFromLength(const s_NurbsEvaluator& e, double length)
+{
+	if (e.lengths.empty() || length <= 0.0)
+		return e.start;
+	if (length >= e.lengths.back())
+		return e.end;
+
+	// the table sample, then Newton steps kept in the sample
+	size_t i = std::upper_bound(e.lengths.begin(), e.lengths.end(), length) - e.lengths.begin() - 1;
+	double a = e.params[i];
+	double b = e.params[i + 1];
+	double target = length - e.lengths[i];
+	double u = a + (b - a) * target / std::max(e.lengths[i + 1] - e.lengths[i], 1.0e-300);
+	for (int iteration = 0; iteration < 8; iteration++) {
+		double f = nurbsArcLength(e, a, u) - target;
+		double d[3];
+		nurbsDerivative(e, u, d);
+		double speed = std::sqrt(dot3(d, d));
+		if (std::fabs(f) < 1.0e-12 || speed <= 0.0)
+			break;
+		u = std::min(std::max(u - f / speed, a), b);
+	}
+	return u;
+}
+
+inline void s_NurbsEvaluator::point(double u, double out[3]) const
+{
+	nurbsPoint(*this, u, out);
+}
+
+inline void s_NurbsEvaluator::tangent(double u, double out[3]) const
+{
+	nurbsDerivative(*this, u, out);
+}
+
+inline double s_NurbsEvaluator::length() const
+{
+	return nurbsLength(*this);
+}
+
+inline double s_NurbsEvaluator::paramFromLength(double length) const
+{
+	return nurbsParamFromLength(*this, length);
+}
+
+/////////////////////////////////////////////////
+// SLIDECURVE2
+/////////////////////////////////////////////////
+
+// The attributes of mgear_slideCurve2, with their defaults. geometryMatrix
+// is the world matrix of the deformed curve (mat in deform()).
+struct s_SlideCurve2Inputs
+{
+	double masterMatrix[4][4];
+	double geometryMatrix[4][4];
+	double slaveLength;
+	double masterLength;
+	double position;
+	double maxstretch;
+	double maxsquash;
+	double softness;
+
+	s_SlideCurve2Inputs() : slaveLength(1.0), masterLength(1.0), position(0.0), maxstretch(1.5), maxsquash(.5), softness(0.5)
+	{
+		identityMatrix4(masterMatrix);
+		identityMatrix4(geometryMatrix);
+	}
+};
+
+// Where the points of mgear_slideCurve2 slide on the master curve
+struct s_SlideCurve2Slide
+{
+	double start;
+	double step;
+	double length;			// of the master curve
+	double toObject[4][4];	// mat.inverse() * master_mat, as one matrix
+};
+
+// The part of mgear_slideCurve2::deform() all the points share, pointCount
+// is the number of points of the deformed curve
+template <class Curve>
+inline void slideCurve2Slide(const Curve& crv, const s_SlideCurve2Inputs& in, int pointCount, s_SlideCurve2Slide& slide)
+{
+	double in_sl = in.slaveLength;
+	double in_ml = in.masterLength;
+	double mstCrvLength = crv.length();
+
+	// Stretch
+	double expo = 1;
+	if ((mstCrvLength > in_ml) && (in.maxstretch > 1)) {
+		if (in.softness != 0) {
+			double stretch = (mstCrvLength - in_ml) / (in_sl * in.maxstretch);
+			expo = 1 - std::exp(-(stretch) / in.softness);
+		}
+		double ext = std::min(in_sl * (in.maxstretch - 1) * expo, mstCrvLength - in_ml);
+		in_sl += ext;
+	}
+	else if ((mstCrvLength < in_ml) && (in.maxsquash < 1)) {
+		if (in.softness != 0) {
+			double squash = (in_ml - mstCrvLength) / (in_sl * in.maxsquash);
+			expo = 1 - std::exp(-(squash) / in.softness);
+		}
+		double ext = std::min(in_sl * (1 - in.maxsquash) * expo, in_ml - mstCrvLength);
+		in_sl -= ext;
+	}
+
+	// Position
+	double size = in_sl / mstCrvLength;
+	double sizeLeft = 1 - size;
+	slide.start = in.position * sizeLeft;
+	double end = slide.start + size;
+	slide.step = (end - slide.start) / (pointCount - 1.0);
+	slide.length = mstCrvLength;
+
+	if (!invertMatrix4(in.geometryMatrix, slide.toObject))
+		identityMatrix4(slide.toObject);
+	multiplyMatrix4(slide.toObject, in.masterMatrix, slide.toObject);
+}
+
+// The deformed position of the point index
+template <class Curve>
+inline void slideCurve2Point(const Curve& crv, const s_SlideCurve2Slide& slide, int index, double out[3])
+{
+	double perc = slide.start + (index * slide.step);
+	double pt[3];
+
+	if ((0 <= perc) && (perc <= 1))
+		crv.point(crv.paramFromLength(perc * slide.length), pt);
+	else if (perc < 0) {
+		// the start isn't extended, the points stack on it
+		crv.point(0.0, pt);
+	}
+	else {
+		double overPerc = perc - 1;
+		double tan[3];
+		double end = crv.cvCount() - 3.0;
+		crv.point(end, pt);
+		crv.tangent(end, tan);
+		normalize3(tan);
+		for (int i = 0; i < 3; i++)
+			pt[i] += tan[i] * slide.length * overPerc;
+	}
+
+	const double (*m)[4] = slide.toObject;
+	for (int i = 0; i < 3; i++)
+		out[i] = pt[0] * m[0][i] + pt[1] * m[1][i] + pt[2] * m[2][i] + m[3][i];
+}
+
+// mgear_slideCurve2::deform(): the pointCount positions of the deformed
+// curve, false when the master curve can't be evaluated
+template <class Curve>
+inline bool slideCurve2(const Curve& crv, const s_SlideCurve2Inputs& in, int pointCount, double (*out)[3])
+{
+	if (!crv.valid)
+		return false;
+
+	s_SlideCurve2Slide slide;
+	slideCurve2Slide(crv, in, pointCount, slide);
+	for (int index = 0; index < pointCount; index++)
+		slideCurve2Point(crv, slide, index, out[index]);
+	return true;
+}
+
+/////////////////////////////////////////////////
+// PERCENTAGETOU
+/////////////////////////////////////////////////
+
+// mgear_percentageToU::compute(), percentage from 0 to 100. Only points are
+// evaluated, the arc length table isn't needed.
+template <class Curve>
+inline double percentageToU(const Curve& crv, double percentage, bool normalizedU, int steps)
+{
+	if (!crv.valid || steps < 2)
+		return 0.0;
+
+	int cvCount = crv.cvCount();
+	double in_percentage = percentage * .01;
+
+	std::vector<double> buffer(steps * 3, 0.0);
+	double* u_list = &buffer[0];
+	double* dist = u_list + steps;
+	double* u_perc = dist + steps;
+	double previous[3], pt[3];
+	double t_length = 0;
+	for (int i = 0; i < steps; i++) {
+		u_list[i] = i / (steps - 1.0) * (cvCount - 3.0);
+		crv.point(u_list[i], pt);
+		if (i > 0) {
+			double v[3] = { pt[0] - previous[0], pt[1] - previous[1], pt[2] - previous[2] };
+			t_length += std::sqrt(dot3(v, v));
+			dist[i] = t_length;
+		}
+		for (int j = 0; j < 3; j++)
+			previous[j] = pt[j];
+	}
+	for (int i = 0; i < steps; i++)
+		u_perc[i] = dist[i] / t_length;
+
+	// closest index
+	double ref = 9999999999.999999;
+	int index = -1;
+	for (int i = 0; i < steps; i++) {
+		double diff = std::fabs(u_perc[i] - in_percentage);
+		if (diff < ref) {
+			ref = diff;
+			index = i;
+		}
+	}
+	if (index < 0)
+		return 0.0;
+
+	// the samples around the percentage, the first or last segment past the ends
+	int indexA, indexB;
+	if (in_percentage <= u_perc[index]) {
+		indexA = std::max(index - 1, 0);
+		indexB = std::max(index, 1);
+	}
+	else {
+		indexA = std::min(index, steps - 2);
+		indexB = indexA + 1;
+	}
+
+	double blend = (in_percentage - u_perc[indexA]) / (u_perc[indexB] - u_perc[indexA]);
+	double out_u = u_list[indexA] * (1 - blend) + u_list[indexB] * blend;
+
+	if (normalizedU)
+		out_u = out_u / (cvCount - 3.0);
+	return out_u;
+}
+
+#endif
@@ -0,0 +1,1224 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+#ifndef _mgearMath
+#define _mgearMath
+
+/////////////////////////////////////////////////
+// Maya free math kernels.
+// They only work on plain doubles so they can be shared by the nodes
+// (through MMatrix::matrix) and by code that runs without Maya.
+/////////////////////////////////////////////////
+
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// the array kernels are timed when built with MGEAR_TRACE, see mgear_trace.h
+#if defined(MGEAR_TRACE)
+#include "mgear_trace.h"
+#else
+#define MGEAR_TRACE_SCOPE(name, batch) ((void)0)
+#endif
+
+/////////////////////////////////////////////////
+// MATRIX
+/////////////////////////////////////////////////
+
+// out = a * b, out can be a or b.
+inline void multiplyMatrix4(const double a[4][4], const double b[4][4], double out[4][4])
+{
+	double r[4][4];
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+	}
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			out[i][j] = r[i][j];
+	}
+}
+
+// General 4x4 inverse by cofactors, out can be m.
+// Returns false and leaves out untouched when m is singular.
+inline bool invertMatrix4(const double m[4][4], double out[4][4])
+{
+	double s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	double s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	double s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	double s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	double s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	double s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+	double c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+	double c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	double c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	double c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	double c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	double c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+	double det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (std::fabs(det) <= 1.0e-300)
+		return false;
+	double inv = 1.0 / det;
+
+	double r[4][4];
+	r[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv;
+	r[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv;
+	r[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv;
+	r[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv;
+
+	r[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv;
+	r[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv;
+	r[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv;
+	r[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv;
+
+	r[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv;
+	r[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv;
+	r[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv;
+	r[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv;
+
+	r[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv;
+	r[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv;
+	r[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv;
+	r[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv;
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			out[i][j] = r[i][j];
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////
+// ARRAYS
+/////////////////////////////////////////////////
+
+// sum of values[i] * weights[i], weights can be NULL for a plain sum.
+// Eight partial sums (one AVX register) are reduced at the end, so the
+// result can differ from a sequential sum in the last bits.
+inline float weightedSum(const float* values, const float* weights, int count)
+{
+	MGEAR_TRACE_SCOPE("weightedSum", count);
+	int i = 0;
+	float sum = 0.0f;
+#if defined(__AVX2__)
+	__m256 acc = _mm256_setzero_ps();
+	for (; i + 8 <= count; i += 8) {
+		__m256 v = _mm256_loadu_ps(values + i);
+		if (weights)
+			v = _mm256_mul_ps(v, _mm256_loadu_ps(weights + i));
+		acc = _mm256_add_ps(acc, v);
+	}
+	float lanes[8];
+	_mm256_storeu_ps(lanes, acc);
+	for (int j = 0; j < 8; j++)
+		sum += lanes[j];
+#else
+	float acc[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (; i + 8 <= count; i += 8) {
+		for (int j = 0; j < 8; j++)
+			acc[j] += weights ? values[i + j] * weights[i + j] : values[i + j];
+	}
+	for (int j = 0; j < 8; j++)
+		sum += acc[j];
+#endif
+	for (; i < count; i++)
+		sum += weights ? values[i] * weights[i] : values[i];
+	return sum;
+}
+
+// Sine and cosine of count angles (radians) at once. s and c can't alias x.
+// Cody-Waite reduction to [-pi/4, pi/4] on a three part pi/2, then the
+// Cephes minimax polynomials. Against libm the error stays within 2 ulp,
+// 2.3e-16 absolute, for |x| < 1e5 (bench/trig_bench.cpp). The reduction stays
+// exact while q * dp1 does, up to |x| of about 8e8.
+// The rounding trick below needs IEEE arithmetic, don't build with fast-math.
+inline void sinCosArray(const double* x, int count, double* s, double* c)
+{
+	MGEAR_TRACE_SCOPE("sinCosArray", count);
+	const double twoOverPi = 0.63661977236758134308;
+	const double dp1 = 1.57079625129699707031;
+	const double dp2 = 7.54978941586159635336e-8;
+	const double dp3 = 5.39030285815811905290e-15;
+	const double s0 = 1.58962301576546568060e-10, s1 = -2.50507477628578072866e-8,
+		s2 = 2.75573136213857245213e-6, s3 = -1.98412698295895385996e-4,
+		s4 = 8.33333333332211858878e-3, s5 = -1.66666666666666307295e-1;
+	const double c0 = -1.13585365213876817300e-11, c1 = 2.08757008419747316778e-9,
+		c2 = -2.75573141792967388112e-7, c3 = 2.48015872888517045348e-5,
+		c4 = -1.38888888888730564116e-3, c5 = 4.16666666666665929218e-2;
+
+	int i = 0;
+#if defined(__AVX2__)
+	const __m256d signBit = _mm256_set1_pd(-0.0);
+	for (; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_loadu_pd(x + i);
+		__m256d q = _mm256_round_pd(_mm256_mul_pd(v, _mm256_set1_pd(twoOverPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256d r = _mm256_sub_pd(v, _mm256_mul_pd(q, _mm256_set1_pd(dp1)));
+		r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(dp2)));
+		r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(dp3)));
+		__m256d z = _mm256_mul_pd(r, r);
+
+		__m256d ps = _mm256_set1_pd(s0);
+		ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(s1));
+		ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(s2));
+		ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(s3));
+		ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(s4));
+		ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(s5));
+		__m256d sr = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), ps));
+
+		__m256d pc = _mm256_set1_pd(c0);
+		pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(c1));
+		pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(c2));
+		pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(c3));
+		pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(c4));
+		pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(c5));
+		__m256d cr = _mm256_add_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_set1_pd(0.5), z)), _mm256_mul_pd(_mm256_mul_pd(z, z), pc));
+
+		// quadrant, q mod 4 in 0..3
+		__m256d m = _mm256_sub_pd(q, _mm256_mul_pd(_mm256_set1_pd(4.0), _mm256_floor_pd(_mm256_mul_pd(q, _mm256_set1_pd(0.25)))));
+		__m256d odd = _mm256_cmp_pd(_mm256_sub_pd(m, _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_floor_pd(_mm256_mul_pd(m, _mm256_set1_pd(0.5))))), _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+		__m256d sinNeg = _mm256_cmp_pd(m, _mm256_set1_pd(2.0), _CMP_GE_OQ);
+		__m256d cosNeg = _mm256_and_pd(_mm256_cmp_pd(m, _mm256_set1_pd(1.0), _CMP_GE_OQ), _mm256_cmp_pd(m, _mm256_set1_pd(2.0), _CMP_LE_OQ));
+
+		__m256d vs = _mm256_blendv_pd(sr, cr, odd);
+		__m256d vc = _mm256_blendv_pd(cr, sr, odd);
+		vs = _mm256_xor_pd(vs, _mm256_and_pd(sinNeg, signBit));
+		vc = _mm256_xor_pd(vc, _mm256_and_pd(cosNeg, signBit));
+		_mm256_storeu_pd(s + i, vs);
+		_mm256_storeu_pd(c + i, vc);
+	}
+#endif
+	// adding then removing 1.5 * 2^52 rounds to the nearest integer without
+	// a call to floor, SSE2 has no rounding instruction
+	const double roundMagic = 6755399441055744.0;
+	for (; i < count; i++) {
+		double t = x[i] * twoOverPi + roundMagic;
+		double q = t - roundMagic;
+		double r = ((x[i] - q * dp1) - q * dp2) - q * dp3;
+		double z = r * r;
+		double sr = r + r * z * (((((s0 * z + s1) * z + s2) * z + s3) * z + s4) * z + s5);
+		double cr = 1.0 - 0.5 * z + z * z * (((((c0 * z + c1) * z + c2) * z + c3) * z + c4) * z + c5);
+
+		// quadrant m swaps and negates without branches, the angles are random
+		int m = (int)(long long)q & 3;
+		double v[2] = { sr, cr };
+		s[i] = (1.0 - (double)(m & 2)) * v[m & 1];
+		c[i] = (1.0 - (double)((m + 1) & 2)) * v[(m + 1) & 1];
+	}
+}
+
+// Squash and stretch of mgear_squashStretch2 for count amounts (driven
+// squash + stretch) at once: the two axes other than Axis (0, 1, 2 for x, y,
+// z) are scaled by 1 + amount, the result is blended from gscale and clamped
+// to 0.0001. The axis is a template parameter so its tests compile away,
+// squashStretchArray() picks the instance once per call.
+template <int Axis>
+inline void squashStretchArrayAxis(const double gscale[3], const double* amounts, int count, double blend, double (*out)[3])
+{
+	const double clampValue = 0.0001;
+	const double gx = gscale[0], gy = gscale[1], gz = gscale[2];
+	for (int i = 0; i < count; i++) {
+		double factor = 1.0 + amounts[i];
+		factor = (factor > 0.0) ? factor : 0.0;
+		double fx = (Axis == 0) ? 1.0 : factor;
+		double fy = (Axis == 1) ? 1.0 : factor;
+		double fz = (Axis == 2) ? 1.0 : factor;
+		double x = gx * (1.0 - blend) + gx * fx * blend;
+		double y = gy * (1.0 - blend) + gy * fy * blend;
+		double z = gz * (1.0 - blend) + gz * fz * blend;
+		out[i][0] = (x > clampValue) ? x : clampValue;
+		out[i][1] = (y > clampValue) ? y : clampValue;
+		out[i][2] = (z > clampValue) ? z : clampValue;
+	}
+}
+
+inline void squashStretchArray(int axis, const double gscale[3], const double* amounts, int count, double blend, double (*out)[3])
+{
+	MGEAR_TRACE_SCOPE("squashStretchArray", count);
+	switch (axis) {
+		case 0: squashStretchArrayAxis<0>(gscale, amounts, count, blend, out); break;
+		case 1: squashStretchArrayAxis<1>(gscale, amounts, count, blend, out); break;
+		default: squashStretchArrayAxis<2>(gscale, amounts, count, blend, out); break;
+	}
+}
+
+/////////////////////////////////////////////////
+// TRANSFORMATION
+/////////////////////////////////////////////////
+
+// Translation, rotation, scale and shear of a matrix.
+// Same model as MTransformationMatrix without pivots, with row vectors:
+//     m = S * Sh * R * T
+// with the shear matrix Sh = | 1   0   0 |
+//                            | xy  1   0 |
+//                            | xz  yz  1 |
+//
+// Tolerance: composeTRS(decomposeTRS(m)) gives back m within 1e-12 of the
+// largest coefficient for any matrix whose scales are above 1e-6. Translation,
+// scale and shear match MTransformationMatrix to the same precision, the
+// rotation matches up to the sign of the quaternion (q and -q are the same
+// rotation, we always return w >= 0). A negative determinant is stored as a
+// negative X scale, Maya may pick another axis and rotation for the same
+// matrix. Degenerated matrices (zero scale) get a valid rotation, but the
+// missing axis can't be recovered.
+struct s_TRS
+{
+	double t[3];
+	double q[4];	// x, y, z, w
+	double s[3];
+	double sh[3];	// xy, xz, yz
+};
+
+#define MGEAR_TRS_EPSILON 1.0e-12
+
+inline double dot3(const double a[3], const double b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline void cross3(const double a[3], const double b[3], double out[3])
+{
+	double x = a[1] * b[2] - a[2] * b[1];
+	double y = a[2] * b[0] - a[0] * b[2];
+	double z = a[0] * b[1] - a[1] * b[0];
+	out[0] = x;
+	out[1] = y;
+	out[2] = z;
+}
+
+// normalize in place, returns the original length
+inline double normalize3(double v[3])
+{
+	double length = std::sqrt(dot3(v, v));
+	if (length > MGEAR_TRS_EPSILON) {
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+	return length;
+}
+
+// any unit vector perpendicular to v (v being unit length)
+inline void perpendicular3(const double v[3], double out[3])
+{
+	double axis[3] = { 0.0, 0.0, 0.0 };
+	int i = (std::fabs(v[0]) < std::fabs(v[1])) ? 0 : 1;
+	if (std::fabs(v[2]) < std::fabs(v[i]))
+		i = 2;
+	axis[i] = 1.0;
+	cross3(v, axis, out);
+	normalize3(out);
+}
+
+// Quaternion (x, y, z, w) of the orthonormal rotation stored in the rows of m
+inline void quaternionFromRotation(const double m[4][4], double q[4])
+{
+	double trace = m[0][0] + m[1][1] + m[2][2];
+	if (trace > 0.0) {
+		double s = 0.5 / std::sqrt(trace + 1.0);
+		q[3] = 0.25 / s;
+		q[0] = (m[1][2] - m[2][1]) * s;
+		q[1] = (m[2][0] - m[0][2]) * s;
+		q[2] = (m[0][1] - m[1][0]) * s;
+	}
+	else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+		double s = 2.0 * std::sqrt(1.0 + m[0][0] - m[1][1] - m[2][2]);
+		q[3] = (m[1][2] - m[2][1]) / s;
+		q[0] = 0.25 * s;
+		q[1] = (m[0][1] + m[1][0]) / s;
+		q[2] = (m[0][2] + m[2][0]) / s;
+	}
+	else if (m[1][1] > m[2][2]) {
+		double s = 2.0 * std::sqrt(1.0 + m[1][1] - m[0][0] - m[2][2]);
+		q[3] = (m[2][0] - m[0][2]) / s;
+		q[0] = (m[0][1] + m[1][0]) / s;
+		q[1] = 0.25 * s;
+		q[2] = (m[1][2] + m[2][1]) / s;
+	}
+	else {
+		double s = 2.0 * std::sqrt(1.0 + m[2][2] - m[0][0] - m[1][1]);
+		q[3] = (m[0][1] - m[1][0]) / s;
+		q[0] = (m[0][2] + m[2][0]) / s;
+		q[1] = (m[1][2] + m[2][1]) / s;
+		q[2] = 0.25 * s;
+	}
+
+	if (q[3] < 0.0) {
+		q[0] = -q[0];
+		q[1] = -q[1];
+		q[2] = -q[2];
+		q[3] = -q[3];
+	}
+}
+
+// Rotation rows of the quaternion (x, y, z, w), normalized on the fly
+inline void rotationFromQuaternion(const double q[4], double r[3][3])
+{
+	double n = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+	double s = (n > MGEAR_TRS_EPSILON) ? 2.0 / n : 0.0;
+	double xx = q[0] * q[0] * s, yy = q[1] * q[1] * s, zz = q[2] * q[2] * s;
+	double xy = q[0] * q[1] * s, xz = q[0] * q[2] * s, yz = q[1] * q[2] * s;
+	double wx = q[3] * q[0] * s, wy = q[3] * q[1] * s, wz = q[3] * q[2] * s;
+
+	r[0][0] = 1.0 - (yy + zz);
+	r[0][1] = xy + wz;
+	r[0][2] = xz - wy;
+	r[1][0] = xy - wz;
+	r[1][1] = 1.0 - (xx + zz);
+	r[1][2] = yz + wx;
+	r[2][0] = xz + wy;
+	r[2][1] = yz - wx;
+	r[2][2] = 1.0 - (xx + yy);
+}
+
+// Split m in translation, rotation, scale and shear (Gram-Schmidt on the rows).
+// Returns false when the matrix is degenerated.
+inline bool decomposeTRS(const double m[4][4], s_TRS& trs)
+{
+	trs.t[0] = m[3][0];
+	trs.t[1] = m[3][1];
+	trs.t[2] = m[3][2];
+
+	double r[4][4];
+	double* r0 = r[0];
+	double* r1 = r[1];
+	double* r2 = r[2];
+	for (int i = 0; i < 3; i++) {
+		r0[i] = m[0][i];
+		r1[i] = m[1][i];
+		r2[i] = m[2][i];
+	}
+
+	// a mirrored matrix is brought back to a rotation by flipping X
+	double c[3];
+	cross3(r1, r2, c);
+	bool flip = dot3(r0, c) < 0.0;
+	if (flip) {
+		r0[0] = -r0[0];
+		r0[1] = -r0[1];
+		r0[2] = -r0[2];
+	}
+
+	bool valid = true;
+
+	// X
+	trs.s[0] = normalize3(r0);
+	if (trs.s[0] <= MGEAR_TRS_EPSILON) {
+		valid = false;
+		cross3(m[1], m[2], r0);
+		if (normalize3(r0) <= MGEAR_TRS_EPSILON) {
+			r0[0] = 1.0;
+			r0[1] = 0.0;
+			r0[2] = 0.0;
+		}
+	}
+
+	// Y
+	double d = dot3(r1, r0);
+	r1[0] -= d * r0[0];
+	r1[1] -= d * r0[1];
+	r1[2] -= d * r0[2];
+	trs.s[1] = normalize3(r1);
+	if (trs.s[1] <= MGEAR_TRS_EPSILON) {
+		valid = false;
+		perpendicular3(r0, r1);
+	}
+	trs.sh[0] = valid ? d / trs.s[1] : 0.0;
+
+	// Z, the remaining axis is known once X and Y are
+	double row2[3] = { m[2][0], m[2][1], m[2][2] };
+	cross3(r0, r1, r2);
+	trs.s[2] = dot3(row2, r2);
+	if (std::fabs(trs.s[2]) <= MGEAR_TRS_EPSILON) {
+		valid = false;
+		trs.sh[1] = 0.0;
+		trs.sh[2] = 0.0;
+	}
+	else {
+		trs.sh[1] = dot3(row2, r0) / trs.s[2];
+		trs.sh[2] = dot3(row2, r1) / trs.s[2];
+	}
+
+	if (flip)
+		trs.s[0] = -trs.s[0];
+
+	quaternionFromRotation(r, trs.q);
+
+	return valid;
+}
+
+// Build the matrix back from its components
+inline void composeTRS(const s_TRS& trs, double m[4][4])
+{
+	double r[3][3];
+	rotationFromQuaternion(trs.q, r);
+
+	for (int i = 0; i < 3; i++) {
+		m[0][i] = trs.s[0] * r[0][i];
+		m[1][i] = trs.s[1] * (trs.sh[0] * r[0][i] + r[1][i]);
+		m[2][i] = trs.s[2] * (trs.sh[1] * r[0][i] + trs.sh[2] * r[1][i] + r[2][i]);
+		m[3][i] = trs.t[i];
+	}
+	m[0][3] = 0.0;
+	m[1][3] = 0.0;
+	m[2][3] = 0.0;
+	m[3][3] = 1.0;
+}
+
+// Spherical interpolation, always along the shortest path
+inline void slerpQuaternion(const double a[4], const double b[4], double blend, double out[4])
+{
+	double cosHalf = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	double sign = 1.0;
+	if (cosHalf < 0.0) {
+		cosHalf = -cosHalf;
+		sign = -1.0;
+	}
+
+	double wa, wb;
+	if (cosHalf > 0.9999) {
+		// close enough for a linear blend
+		wa = 1.0 - blend;
+		wb = blend;
+	}
+	else {
+		double half = std::acos(cosHalf);
+		double sinHalf = std::sin(half);
+		wa = std::sin((1.0 - blend) * half) / sinHalf;
+		wb = std::sin(blend * half) / sinHalf;
+	}
+	wb *= sign;
+
+	double n = 0.0;
+	for (int i = 0; i < 4; i++) {
+		out[i] = wa * a[i] + wb * b[i];
+		n += out[i] * out[i];
+	}
+	n = std::sqrt(n);
+	for (int i = 0; i < 4; i++)
+		out[i] /= n;
+}
+
+// Same blend as interpolateTransform: linear translation and scale, slerp
+// rotation, the shear is dropped.
+inline void interpolateTRS(const s_TRS& a, const s_TRS& b, double blend, s_TRS& out)
+{
+	for (int i = 0; i < 3; i++) {
+		out.t[i] = a.t[i] + (b.t[i] - a.t[i]) * blend;
+		out.s[i] = a.s[i] + (b.s[i] - a.s[i]) * blend;
+		out.sh[i] = 0.0;
+	}
+	slerpQuaternion(a.q, b.q, blend, out.q);
+}
+
+// Hamilton product of two quaternions (x, y, z, w). Used with quatRotate,
+// rotating by a then b is quatMultiply(b, a).
+inline void quatMultiply(const double a[4], const double b[4], double out[4])
+{
+	double x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+	double y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+	double z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+	double w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+	out[0] = x;
+	out[1] = y;
+	out[2] = z;
+	out[3] = w;
+}
+
+// Rotate v by the unit quaternion q, same result as v * rotation matrix
+inline void quatRotate(const double q[4], const double v[3], double out[3])
+{
+	// v + 2w (u x v) + 2 u x (u x v)
+	double c[3], cc[3];
+	cross3(q, v, c);
+	c[0] *= 2.0;
+	c[1] *= 2.0;
+	c[2] *= 2.0;
+	cross3(q, c, cc);
+	out[0] = v[0] + q[3] * c[0] + cc[0];
+	out[1] = v[1] + q[3] * c[1] + cc[1];
+	out[2] = v[2] + q[3] * c[2] + cc[2];
+}
+
+// sine and cosine in one call where the compiler has it
+inline void sinCos(double a, double& s, double& c)
+{
+#if defined(__GNUC__) && !defined(__clang__)
+	__builtin_sincos(a, &s, &c);
+#else
+	s = std::sin(a);
+	c = std::cos(a);
+#endif
+}
+
+// Same conversion as e2q (angles in degrees, same rotation order), with three
+// sincos instead of six trig calls.
+inline void eulerToQuaternion(double x, double y, double z, double q[4])
+{
+	const double halfDegree = 3.14159265358979323846 / 360.0;
+	double s1, c1, s2, c2, s3, c3;
+	sinCos(y * halfDegree, s1, c1);
+	sinCos(z * halfDegree, s2, c2);
+	sinCos(x * halfDegree, s3, c3);
+
+	double c1c2 = c1 * c2;
+	double s1s2 = s1 * s2;
+	q[0] = c1c2 * s3 + s1s2 * c3;
+	q[1] = s1 * c2 * c3 + c1 * s2 * s3;
+	q[2] = c1 * s2 * c3 - s1 * c2 * s3;
+	q[3] = c1c2 * c3 - s1s2 * s3;
+}
+
+// Spherical interpolation that, like slerp2, doesn't take the shortest path:
+// a and b 360 degrees apart still give a full turn. When a and b are
+// (anti)parallel it returns a.
+inline void slerpQuaternionLong(const double a[4], const double b[4], double blend, double out[4])
+{
+	double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	d = std::max(-1.0, std::min(1.0, d));
+	double sinAngle = std::sqrt(1.0 - d * d);
+	if (sinAngle < 1.0e-6) {
+		for (int j = 0; j < 4; j++)
+			out[j] = a[j];
+		return;
+	}
+
+	double angle = std::atan2(sinAngle, d);
+	double wa = std::sin((1.0 - blend) * angle) / sinAngle;
+	double wb = std::sin(blend * angle) / sinAngle;
+	for (int j = 0; j < 4; j++)
+		out[j] = wa * a[j] + wb * b[j];
+}
+
+// Fast slerpQuaternionLong. When a and b are less than 180 degrees apart
+// (dot >= 0, the usual spine range) it's a normalized lerp whose blend is
+// corrected by a polynomial in the dot product (fit by A. Kapoulkine), no
+// trig at all. The error stays below 0.05 degrees over that range (see
+// bench/slerp_bench.cpp). Beyond that it falls back to the exact version.
+inline void slerpQuaternionFast(const double a[4], const double b[4], double blend, double out[4])
+{
+	double d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	if (d < 0.0) {
+		slerpQuaternionLong(a, b, blend, out);
+		return;
+	}
+
+	double ca = 1.0904 + d * (-3.2452 + d * (3.55645 - d * 1.43519));
+	double cb = 0.848013 + d * (-1.06021 + d * 0.215638);
+	double k = ca * (blend - 0.5) * (blend - 0.5) + cb;
+	double t = blend + blend * (blend - 0.5) * (blend - 1.0) * k;
+
+	double n = 0.0;
+	for (int j = 0; j < 4; j++) {
+		out[j] = a[j] + (b[j] - a[j]) * t;
+		n += out[j] * out[j];
+	}
+	n = 1.0 / std::sqrt(n);
+	for (int j = 0; j < 4; j++)
+		out[j] *= n;
+}
+
+// Axis of the rotation q (x, y, z, w), Axis being 0 to 5 for X, Y, Z, -X,
+// -Y, -Z. Same as rotating the unit vector by q, but only the matching row
+// of the rotation matrix is built: 9 multiplies instead of two cross
+// products. q doesn't need to be normalized.
+template <int Axis>
+inline void quaternionAxis(const double q[4], double out[3])
+{
+	const double sign = (Axis < 3) ? 1.0 : -1.0;
+	double n = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+	double s = (n > MGEAR_TRS_EPSILON) ? 2.0 * sign / n : 0.0;
+	if (Axis % 3 == 0) {
+		out[0] = sign - (q[1] * q[1] + q[2] * q[2]) * s;
+		out[1] = (q[0] * q[1] + q[3] * q[2]) * s;
+		out[2] = (q[0] * q[2] - q[3] * q[1]) * s;
+	}
+	else if (Axis % 3 == 1) {
+		out[0] = (q[0] * q[1] - q[3] * q[2]) * s;
+		out[1] = sign - (q[0] * q[0] + q[2] * q[2]) * s;
+		out[2] = (q[1] * q[2] + q[3] * q[0]) * s;
+	}
+	else {
+		out[0] = (q[0] * q[2] + q[3] * q[1]) * s;
+		out[1] = (q[1] * q[2] - q[3] * q[0]) * s;
+		out[2] = sign - (q[0] * q[0] + q[1] * q[1]) * s;
+	}
+}
+
+template <int Axis>
+inline void quaternionAxisArrayAxis(const double (*q)[4], int count, double (*out)[3])
+{
+	for (int i = 0; i < count; i++)
+		quaternionAxis<Axis>(q[i], out[i]);
+}
+
+// quaternionAxis over count rotations, the axis is resolved once
+inline void quaternionAxisArray(int axis, const double (*q)[4], int count, double (*out)[3])
+{
+	MGEAR_TRACE_SCOPE("quaternionAxisArray", count);
+	switch (axis) {
+		case 0: quaternionAxisArrayAxis<0>(q, count, out); break;
+		case 1: quaternionAxisArrayAxis<1>(q, count, out); break;
+		case 2: quaternionAxisArrayAxis<2>(q, count, out); break;
+		case 3: quaternionAxisArrayAxis<3>(q, count, out); break;
+		case 4: quaternionAxisArrayAxis<4>(q, count, out); break;
+		default: quaternionAxisArrayAxis<5>(q, count, out); break;
+	}
+}
+
+// Interpolation modes of interpolateTRSMode
+enum
+{
+	MGEAR_INTERPOLATE_SLERP = 0,
+	MGEAR_INTERPOLATE_DUAL_QUATERNION = 1,
+	MGEAR_INTERPOLATE_LOG = 2
+};
+
+// Shear is dropped and scale is blended linearly like interpolateTRS, only
+// the rigid part changes.
+// Dual quaternion linear blend (DLB): no trig, the translation follows the
+// rotation along an approximated screw motion.
+inline void interpolateTRSDualQuaternion(const s_TRS& a, const s_TRS& b, double blend, s_TRS& out)
+{
+	// dual parts, d = 0.5 * t * q
+	double ta[4] = { a.t[0], a.t[1], a.t[2], 0.0 };
+	double tb[4] = { b.t[0], b.t[1], b.t[2], 0.0 };
+	double da[4], db[4];
+	quatMultiply(ta, a.q, da);
+	quatMultiply(tb, b.q, db);
+
+	double wa = 1.0 - blend;
+	double wb = blend;
+	if (a.q[0] * b.q[0] + a.q[1] * b.q[1] + a.q[2] * b.q[2] + a.q[3] * b.q[3] < 0.0)
+		wb = -wb;
+
+	double real[4], dual[4];
+	double n = 0.0;
+	for (int j = 0; j < 4; j++) {
+		real[j] = wa * a.q[j] + wb * b.q[j];
+		dual[j] = 0.5 * (wa * da[j] + wb * db[j]);
+		n += real[j] * real[j];
+	}
+	n = 1.0 / std::sqrt(n);
+	for (int j = 0; j < 4; j++) {
+		real[j] *= n;
+		dual[j] *= n;
+	}
+
+	// t = 2 * d * conjugate(q)
+	double conj[4] = { -real[0], -real[1], -real[2], real[3] };
+	double t[4];
+	quatMultiply(dual, conj, t);
+
+	for (int j = 0; j < 3; j++) {
+		out.t[j] = 2.0 * t[j];
+		out.s[j] = a.s[j] + (b.s[j] - a.s[j]) * blend;
+		out.sh[j] = 0.0;
+	}
+	for (int j = 0; j < 4; j++)
+		out.q[j] = real[j];
+}
+
+// Log space interpolation: exact screw motion from a to b,
+// a * exp(blend * log(a^-1 * b)) on the rigid part, scale blended in log space.
+inline void interpolateTRSLog(const s_TRS& a, const s_TRS& b, double blend, s_TRS& out)
+{
+	// relative motion, in the space of a
+	double qaInv[4] = { -a.q[0], -a.q[1], -a.q[2], a.q[3] };
+	double dq[4];
+	quatMultiply(qaInv, b.q, dq);
+	if (dq[3] < 0.0) {
+		dq[0] = -dq[0];
+		dq[1] = -dq[1];
+		dq[2] = -dq[2];
+		dq[3] = -dq[3];
+	}
+	double dt[3] = { b.t[0] - a.t[0], b.t[1] - a.t[1], b.t[2] - a.t[2] };
+	quatRotate(qaInv, dt, dt);
+	// dt is now the translation of the relative motion, in the space of a
+
+	// log: rotation vector w and the screw translation v = V^-1 * dt
+	double sinHalf = std::sqrt(dq[0] * dq[0] + dq[1] * dq[1] + dq[2] * dq[2]);
+	double angle = 2.0 * std::atan2(sinHalf, dq[3]);
+	double w[3] = { 0.0, 0.0, 0.0 };
+	if (sinHalf > MGEAR_TRS_EPSILON) {
+		double f = angle / sinHalf;
+		w[0] = dq[0] * f;
+		w[1] = dq[1] * f;
+		w[2] = dq[2] * f;
+	}
+	double wdt[3], wwdt[3];
+	cross3(w, dt, wdt);
+	cross3(w, wdt, wwdt);
+	double cInv;
+	if (angle > 1.0e-4)
+		cInv = (1.0 - angle * std::sin(angle) / (2.0 * (1.0 - std::cos(angle)))) / (angle * angle);
+	else
+		cInv = 1.0 / 12.0;
+	double v[3];
+	for (int j = 0; j < 3; j++)
+		v[j] = dt[j] - 0.5 * wdt[j] + cInv * wwdt[j];
+
+	// exp of the scaled twist
+	double tw[3] = { w[0] * blend, w[1] * blend, w[2] * blend };
+	double tv[3] = { v[0] * blend, v[1] * blend, v[2] * blend };
+	double tAngle = angle * blend;
+	double halfAngle = 0.5 * tAngle;
+	// blend can be negative or past 1, so can tAngle
+	double rq[4];
+	if (std::fabs(tAngle) > MGEAR_TRS_EPSILON) {
+		double f = std::sin(halfAngle) / tAngle;
+		rq[0] = tw[0] * f;
+		rq[1] = tw[1] * f;
+		rq[2] = tw[2] * f;
+	}
+	else
+		rq[0] = rq[1] = rq[2] = 0.0;
+	rq[3] = std::cos(halfAngle);
+
+	double b1, b2;
+	if (std::fabs(tAngle) > 1.0e-4) {
+		b1 = (1.0 - std::cos(tAngle)) / (tAngle * tAngle);
+		b2 = (tAngle - std::sin(tAngle)) / (tAngle * tAngle * tAngle);
+	}
+	else {
+		b1 = 0.5;
+		b2 = 1.0 / 6.0;
+	}
+	double wtv[3], wwtv[3], rt[3];
+	cross3(tw, tv, wtv);
+	cross3(tw, wtv, wwtv);
+	for (int j = 0; j < 3; j++)
+		rt[j] = tv[j] + b1 * wtv[j] + b2 * wwtv[j];
+
+	// back to world: a followed by the partial motion
+	quatRotate(a.q, rt, rt);
+	quatMultiply(a.q, rq, out.q);
+	for (int j = 0; j < 3; j++) {
+		out.t[j] = a.t[j] + rt[j];
+		double s = a.s[j] + (b.s[j] - a.s[j]) * blend;
+		double logS = (1.0 - blend) * std::log(std::max(std::fabs(a.s[j]), MGEAR_TRS_EPSILON))
+			+ blend * std::log(std::max(std::fabs(b.s[j]), MGEAR_TRS_EPSILON));
+		out.s[j] = (s < 0.0) ? -std::exp(logS) : std::exp(logS);
+		out.sh[j] = 0.0;
+	}
+}
+
+// Dispatch on one of the MGEAR_INTERPOLATE modes
+inline void interpolateTRSMode(const s_TRS& a, const s_TRS& b, double blend, int mode, s_TRS& out)
+{
+	if (mode == MGEAR_INTERPOLATE_DUAL_QUATERNION)
+		interpolateTRSDualQuaternion(a, b, blend, out);
+	else if (mode == MGEAR_INTERPOLATE_LOG)
+		interpolateTRSLog(a, b, blend, out);
+	else
+		interpolateTRS(a, b, blend, out);
+}
+
+// interpolateTRS for many blends between the same two transforms.
+// The slerp angle is only computed once, the slerp weights of a chunk of
+// blends come from one sinCosArray call.
+inline void interpolateTRSArray(const s_TRS& a, const s_TRS& b, const double* blends, int count, s_TRS* out)
+{
+	MGEAR_TRACE_SCOPE("interpolateTRSArray", count);
+	double cosHalf = a.q[0] * b.q[0] + a.q[1] * b.q[1] + a.q[2] * b.q[2] + a.q[3] * b.q[3];
+	double sign = 1.0;
+	if (cosHalf < 0.0) {
+		cosHalf = -cosHalf;
+		sign = -1.0;
+	}
+	// close rotations use a normalized linear blend
+	bool linear = cosHalf > 0.9999;
+	double half = linear ? 0.0 : std::acos(cosHalf);
+	double invSin = linear ? 0.0 : 1.0 / std::sin(half);
+
+	// sin((1 - blend) * half) in the first n, sin(blend * half) after
+	const int chunk = 64;
+	double angles[2 * chunk], sines[2 * chunk], cosines[2 * chunk];
+	for (int begin = 0; begin < count; begin += chunk) {
+		int n = std::min(chunk, count - begin);
+		const double* blend = blends + begin;
+		if (!linear) {
+			for (int i = 0; i < n; i++) {
+				angles[i] = (1.0 - blend[i]) * half;
+				angles[n + i] = blend[i] * half;
+			}
+			sinCosArray(angles, 2 * n, sines, cosines);
+		}
+
+		for (int i = 0; i < n; i++) {
+			s_TRS& o = out[begin + i];
+			double wa = linear ? 1.0 - blend[i] : sines[i] * invSin;
+			double wb = (linear ? blend[i] : sines[n + i] * invSin) * sign;
+
+			double len = 0.0;
+			for (int j = 0; j < 4; j++) {
+				o.q[j] = wa * a.q[j] + wb * b.q[j];
+				len += o.q[j] * o.q[j];
+			}
+			len = 1.0 / std::sqrt(len);
+			for (int j = 0; j < 4; j++)
+				o.q[j] *= len;
+
+			for (int j = 0; j < 3; j++) {
+				o.t[j] = a.t[j] + (b.t[j] - a.t[j]) * blend[i];
+				o.s[j] = a.s[j] + (b.s[j] - a.s[j]) * blend[i];
+				o.sh[j] = 0.0;
+			}
+		}
+	}
+}
+
+// Weighted blend of several transforms: linear translation and shear,
+// weighted quaternion average (each quaternion brought in the hemisphere of
+// the first one, the sum is normalized) and scale blended in log space.
+// The weights are normalized, returns false when they sum to zero.
+inline bool blendTRS(const s_TRS* trs, const double* weights, int count, s_TRS& out)
+{
+	MGEAR_TRACE_SCOPE("blendTRS", count);
+	double total = 0.0;
+	for (int i = 0; i < count; i++)
+		total += weights[i];
+	if (std::fabs(total) <= MGEAR_TRS_EPSILON)
+		return false;
+
+	double logScale[3] = { 0.0, 0.0, 0.0 };
+	double signScale[3] = { 0.0, 0.0, 0.0 };
+	for (int j = 0; j < 3; j++) {
+		out.t[j] = 0.0;
+		out.sh[j] = 0.0;
+	}
+	for (int j = 0; j < 4; j++)
+		out.q[j] = 0.0;
+
+	for (int i = 0; i < count; i++) {
+		double w = weights[i] / total;
+		if (w == 0.0)
+			continue;
+
+		const s_TRS& x = trs[i];
+		double qw = (x.q[0] * trs[0].q[0] + x.q[1] * trs[0].q[1] + x.q[2] * trs[0].q[2] + x.q[3] * trs[0].q[3]) < 0.0 ? -w : w;
+		for (int j = 0; j < 4; j++)
+			out.q[j] += x.q[j] * qw;
+
+		for (int j = 0; j < 3; j++) {
+			out.t[j] += x.t[j] * w;
+			out.sh[j] += x.sh[j] * w;
+			logScale[j] += std::log(std::max(std::fabs(x.s[j]), MGEAR_TRS_EPSILON)) * w;
+			signScale[j] += (x.s[j] < 0.0) ? -w : w;
+		}
+	}
+
+	double n = std::sqrt(out.q[0] * out.q[0] + out.q[1] * out.q[1] + out.q[2] * out.q[2] + out.q[3] * out.q[3]);
+	if (n > MGEAR_TRS_EPSILON) {
+		for (int j = 0; j < 4; j++)
+			out.q[j] /= n;
+	}
+	else {
+		// opposite rotations cancelled out
+		out.q[0] = out.q[1] = out.q[2] = 0.0;
+		out.q[3] = 1.0;
+	}
+
+	for (int j = 0; j < 3; j++)
+		out.s[j] = (signScale[j] < 0.0) ? -std::exp(logScale[j]) : std::exp(logScale[j]);
+
+	return true;
+}
+
+/////////////////////////////////////////////////
+// SPRING
+/////////////////////////////////////////////////
+
+// Continuous spring constants derived from the per frame stiffness/damping sliders
+struct s_SpringCoefficients
+{
+	double stiffness;
+	double damping;
+};
+
+inline s_SpringCoefficients springCoefficients(double stiffness, double damping)
+{
+	// The original spring applied once per frame, on the offset from the goal:
+	//     y[n+1] = (1 - stiffness) * (y[n] + (1 - damping) * (y[n] - y[n-1]))
+	// We use the damped oscillator x'' = k * (goal - x) - c * x' whose response,
+	// sampled once per frame, has the same characteristic roots. That way the
+	// sliders keep their meaning but the spring can be integrated at any time step.
+	double a = (1.0 - stiffness) * (2.0 - damping);
+	double b = (1.0 - stiffness) * (1.0 - damping);
+	const double minRoot = 1.0e-9;
+
+	s_SpringCoefficients coef;
+	double disc = a * a - 4.0 * b;
+	if (disc >= 0.0) {
+		// overdamped, both roots are real and positive
+		double r1 = std::log(std::max((a + std::sqrt(disc)) * 0.5, minRoot));
+		double r2 = std::log(std::max((a - std::sqrt(disc)) * 0.5, minRoot));
+		coef.damping = -(r1 + r2);
+		coef.stiffness = r1 * r2;
+	}
+	else {
+		// oscillating, complex conjugate roots
+		double rho = std::max(std::sqrt(b), minRoot);
+		double theta = std::acos(std::min(std::max(a / (2.0 * rho), -1.0), 1.0));
+		coef.damping = -2.0 * std::log(rho);
+		coef.stiffness = std::log(rho) * std::log(rho) + theta * theta;
+	}
+
+	return coef;
+}
+
+// springVelocity of utils.cpp on plain doubles, out can be velocity
+inline void springVelocity3(const double velocity[3], const double offset[3], const s_SpringCoefficients& coef, double h, double out[3])
+{
+	double d = 1.0 + h * coef.damping + h * h * coef.stiffness;
+	for (int i = 0; i < 3; i++)
+		out[i] = (velocity[i] + offset[i] * (h * coef.stiffness)) / d;
+}
+
+// Springs reset instead of simulating across bigger time jumps
+#define SPRING_MAX_FRAME_GAP 100.0
+// Two evaluation times closer than this are the same cached frame
+#define SPRING_FRAME_TOLERANCE 1.0e-6
+
+// The settings a spring simulation depends on, iterations is for the
+// constraints of the chain
+struct s_SpringSettings
+{
+	double stiffness;
+	double damping;
+	int substeps;
+	int iterations;
+};
+
+inline bool operator!=(const s_SpringSettings& a, const s_SpringSettings& b)
+{
+	return a.stiffness != b.stiffness || a.damping != b.damping || a.substeps != b.substeps || a.iterations != b.iterations;
+}
+
+// Simulation state of a spring after evaluating a frame
+template <class Goal, class Velocity>
+struct s_SpringState
+{
+	double simFrame;	// last substep on the grid
+	Goal goal;
+	Goal position;
+	Velocity velocity;
+	Goal output;	// at the evaluated frame, before the intensity blend
+};
+
+// Keeps the simulation state of every evaluated frame, so going back to a
+// frame is a lookup and jumping ahead resumes from the closest earlier frame.
+// Simulating a frame drops the frames after it (eraseFrom).
+// Bounded: the frames furthest from the last stored one are dropped first.
+template <class T>
+class mgear_springCache
+{
+public:
+	const T* find(double frame) const
+	{
+		typename std::map<double, T>::const_iterator it = _frames.lower_bound(frame - SPRING_FRAME_TOLERANCE);
+		if (it == _frames.end() || it->first > frame + SPRING_FRAME_TOLERANCE)
+			return NULL;
+		return &it->second;
+	}
+
+	const T* findBefore(double frame, double& cachedFrame) const
+	{
+		typename std::map<double, T>::const_iterator it = _frames.lower_bound(frame - SPRING_FRAME_TOLERANCE);
+		if (it == _frames.begin())
+			return NULL;
+		--it;
+		cachedFrame = it->first;
+		return &it->second;
+	}
+
+	void store(double frame, const T& state, unsigned maxSize)
+	{
+		if (maxSize == 0){
+			_frames.clear();
+			return;
+		}
+		_frames[frame] = state;
+		while (_frames.size() > maxSize){
+			if (frame - _frames.begin()->first > _frames.rbegin()->first - frame)
+				_frames.erase(_frames.begin());
+			else
+				_frames.erase(--_frames.end());
+		}
+	}
+
+	void eraseFrom(double frame)
+	{
+		_frames.erase(_frames.lower_bound(frame - SPRING_FRAME_TOLERANCE), _frames.end());
+	}
+
+	void clear() { _frames.clear(); }
+
+private:
+	std::map<double, T> _frames;
+};
+
+// The per frame simulation of the spring nodes: the cache lookup, the reset
+// on time jumps, fixed size substeps on a grid since the last reset toward
+// a goal interpolated from the previous evaluation, and a partial step to
+// reach the evaluated time. Traits integrates its goal type:
+//     typedef ... Goal; typedef ... Velocity;
+//     static bool equivalent(const Goal& a, const Goal& b);
+//     static Velocity rest(const Goal& goal);
+//     static Velocity rigidVelocity(const Goal& from, const Goal& to, double frames);
+//     static void interpolate(const Goal& a, const Goal& b, double blend, Goal& out);
+//     void step(const Goal& goal, Goal& position, Velocity& velocity,
+//               const s_SpringCoefficients& coef, double h) const;
+// step moves position toward goal over h frames.
+template <class Traits>
+class mgear_springSimulation
+{
+public:
+	typedef typename Traits::Goal Goal;
+	typedef s_SpringState<Goal, typename Traits::Velocity> State;
+
+	mgear_springSimulation() : _initialized(false), _previousFrame(0.0)
+	{
+		_settings.stiffness = -1.0;
+		_settings.damping = -1.0;
+		_settings.substeps = 0;
+		_settings.iterations = 0;
+	}
+
+	// The simulated goal at currentFrame, cacheSize frames are kept
+	const Goal& evaluate(const Traits& traits, const Goal& goal, double currentFrame, const s_SpringSettings& settings, unsigned cacheSize)
+	{
+		// the cached states were simulated with other settings
+		if (settings != _settings || cacheSize == 0) {
+			_cache.clear();
+			_settings = settings;
+		}
+
+		// Revisiting a frame is a lookup, as long as the goal didn't change
+		// since. When it did the goal was edited upstream, and that edit can
+		// reach the frames before this one as well: none of the cache can be
+		// trusted.
+		const State* cached = _cache.find(currentFrame);
+		if (cached != NULL && !Traits::equivalent(cached->goal, goal)) {
+			reset();
+			cached = NULL;
+		}
+		if (cached != NULL) {
+			_state = *cached;
+			_previousFrame = currentFrame;
+			return _state.output;
+		}
+
+		// otherwise resume from the closest frame before this one
+		double cachedFrame;
+		const State* previous = _cache.findBefore(currentFrame, cachedFrame);
+		if (previous != NULL) {
+			_state = *previous;
+			_previousFrame = cachedFrame;
+			_initialized = true;
+		}
+		double timeDifference = currentFrame - _previousFrame;
+
+		// reset when going back in time or jumping too far ahead
+		if (!_initialized || timeDifference < 0.0 || timeDifference > SPRING_MAX_FRAME_GAP) {
+			_state.position = goal;
+			_state.velocity = Traits::rest(goal);
+			_state.goal = goal;
+			_state.simFrame = currentFrame;
+			_previousFrame = currentFrame;
+			_initialized = true;
+			timeDifference = 0.0;
+		}
+
+		if (settings.stiffness >= 1.0) {
+			// a rigid spring just sticks to the goal
+			if (timeDifference > 0.0)
+				_state.velocity = Traits::rigidVelocity(_state.goal, goal, timeDifference);
+			_state.position = goal;
+			_state.simFrame = currentFrame;
+			_state.output = goal;
+		}
+		else {
+			s_SpringCoefficients coef = springCoefficients(settings.stiffness, settings.damping);
+
+			double h = 1.0 / settings.substeps;
+			int steps = (int)std::floor((currentFrame - _state.simFrame) * settings.substeps + 1.0e-6);
+			Goal stepGoal = goal;
+			for (int i = 1; i <= steps; i++) {
+				double blend = std::min(std::max((_state.simFrame + i * h - _previousFrame) / std::max(timeDifference, 1.0e-9), 0.0), 1.0);
+				Traits::interpolate(_state.goal, goal, blend, stepGoal);
+				traits.step(stepGoal, _state.position, _state.velocity, coef, h);
+			}
+			_state.simFrame += steps * h;
+
+			// The evaluated time usually falls between two substeps (subframes,
+			// odd frame rates). Take a partial step to reach it, not stored.
+			_state.output = _state.position;
+			double remainder = currentFrame - _state.simFrame;
+			if (remainder > 1.0e-6) {
+				typename Traits::Velocity velocity = _state.velocity;
+				traits.step(goal, _state.output, velocity, coef, remainder);
+			}
+		}
+
+		// store the states for the next calculation. The cached frames after
+		// this one came from another history (a jump ahead resumed from an
+		// interpolated goal): they are simulated again when reached.
+		_state.goal = goal;
+		_cache.eraseFrom(currentFrame);
+		_cache.store(currentFrame, _state, cacheSize);
+		_previousFrame = currentFrame;
+		return _state.output;
+	}
+
+	// Forgets the cache, the next evaluation starts over from the goal
+	void reset()
+	{
+		_cache.clear();
+		_initialized = false;
+	}
+
+	const State& state() const { return _state; }
+
+private:
+	bool _initialized;
+	double _previousFrame;
+	State _state;
+	mgear_springCache<State> _cache;
+	s_SpringSettings _settings;
+};
+
+#endif
@@ -0,0 +1,372 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+#ifndef _mgearPoseStream
+#define _mgearPoseStream
+
+/////////////////////////////////////////////////
+// Pose stream: the binary file of the offline solver inputs and outputs
+// (tools/mgear_bake.cpp), made to be mapped in memory and read in place.
+//
+// Layout, little endian:
+//     s_PoseStreamHeader    64 bytes
+//     s_PoseStreamChannel   64 bytes per channel, the names
+//     frames                frameCount blocks of frameStride bytes, the
+//                           channelCount float64 of a frame then zero
+//                           padding
+// The channel table starts at channelOffset and the first frame at
+// dataOffset. Both offsets and the frame stride are multiples of 64 so
+// every frame starts on a cache line, the file can be read straight from
+// the mapping.
+//
+// The version changes with any layout change, readers refuse the versions
+// they don't know.
+/////////////////////////////////////////////////
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MGEAR_POSE_STREAM_VERSION 1
+#define MGEAR_POSE_STREAM_ALIGNMENT 64
+
+struct s_PoseStreamHeader
+{
+	char magic[8];			// "MGPOSE" and two zeros
+	uint32_t version;		// MGEAR_POSE_STREAM_VERSION
+	uint32_t headerSize;	// sizeof(s_PoseStreamHeader)
+	uint64_t channelCount;
+	uint64_t frameCount;
+	uint64_t channelOffset;	// bytes from the start of the file
+	uint64_t dataOffset;	// bytes from the start of the file
+	uint64_t frameStride;	// bytes from one frame to the next
+	uint64_t reserved;
+};
+
+// A channel name, zero terminated
+struct s_PoseStreamChannel
+{
+	char name[64];
+};
+
+inline uint64_t poseStreamAlign(uint64_t size)
+{
+	return (size + MGEAR_POSE_STREAM_ALIGNMENT - 1) / MGEAR_POSE_STREAM_ALIGNMENT * MGEAR_POSE_STREAM_ALIGNMENT;
+}
+
+// The header of a stream of channelCount channels and frameCount frames
+inline void poseStreamHeader(uint64_t channelCount, uint64_t frameCount, s_PoseStreamHeader& header)
+{
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, "MGPOSE", 6);
+	header.version = MGEAR_POSE_STREAM_VERSION;
+	header.headerSize = sizeof(s_PoseStreamHeader);
+	header.channelCount = channelCount;
+	header.frameCount = frameCount;
+	header.channelOffset = poseStreamAlign(sizeof(s_PoseStreamHeader));
+	header.dataOffset = poseStreamAlign(header.channelOffset + channelCount * sizeof(s_PoseStreamChannel));
+	header.frameStride = poseStreamAlign(channelCount * sizeof(double));
+}
+
+inline bool isPoseStream(const void* data, size_t size)
+{
+	return size >= 8 && std::memcmp(data, "MGPOSE\0\0", 8) == 0;
+}
+
+/////////////////////////////////////////////////
+// READER
+/////////////////////////////////////////////////
+
+// Maps a pose stream read only, frame() points in the mapping.
+// Where mmap isn't available the file is read in an aligned buffer.
+class mgear_PoseStreamReader
+{
+ public:
+	mgear_PoseStreamReader() : base(NULL), size(0), mapped(false), allocated(NULL) {}
+	~mgear_PoseStreamReader() { close(); }
+
+	bool open(const std::string& path, std::string& error)
+	{
+		close();
+#if defined(_WIN32)
+		FILE* file = std::fopen(path.c_str(), "rb");
+		if (!file) {
+			error = "can't open " + path;
+			return false;
+		}
+		std::fseek(file, 0, SEEK_END);
+		size = (size_t)std::ftell(file);
+		std::fseek(file, 0, SEEK_SET);
+		allocated = (unsigned char*)std::malloc(size + MGEAR_POSE_STREAM_ALIGNMENT);
+		base = allocated ? allocated + (MGEAR_POSE_STREAM_ALIGNMENT - (uintptr_t)allocated % MGEAR_POSE_STREAM_ALIGNMENT) % MGEAR_POSE_STREAM_ALIGNMENT : NULL;
+		bool ok = base && std::fread((void*)base, 1, size, file) == size;
+		std::fclose(file);
+		if (!ok) {
+			error = "can't read " + path;
+			close();
+			return false;
+		}
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			error = "can't open " + path;
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			::close(fd);
+			error = "can't read " + path;
+			return false;
+		}
+		size = (size_t)st.st_size;
+		void* p = (size > 0) ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+		::close(fd);
+		if (p == MAP_FAILED) {
+			error = "can't map " + path;
+			size = 0;
+			return false;
+		}
+		base = (const unsigned char*)p;
+		mapped = true;
+#endif
+		if (!validate(error)) {
+			error = path + ": " + error;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+#if !defined(_WIN32)
+		if (mapped)
+			munmap((void*)base, size);
+#endif
+		std::free(allocated);
+		base = NULL;
+		size = 0;
+		mapped = false;
+		allocated = NULL;
+	}
+
+	const s_PoseStreamHeader& header() const { return *(const s_PoseStreamHeader*)base; }
+	uint64_t channelCount() const { return header().channelCount; }
+	uint64_t frameCount() const { return header().frameCount; }
+
+	const char* channelName(uint64_t channel) const
+	{
+		return ((const s_PoseStreamChannel*)(base + header().channelOffset))[channel].name;
+	}
+
+	// index of the channel, -1 when missing
+	int64_t findChannel(const std::string& name) const
+	{
+		for (uint64_t i = 0; i < channelCount(); i++) {
+			if (name == channelName(i))
+				return (int64_t)i;
+		}
+		return -1;
+	}
+
+	// the channel values of a frame, 64 bytes aligned
+	const double* frame(uint64_t index) const
+	{
+		return (const double*)(base + header().dataOffset + index * header().frameStride);
+	}
+
+	// doubles from one frame to the next
+	size_t frameStride() const { return (size_t)(header().frameStride / sizeof(double)); }
+
+ private:
+	mgear_PoseStreamReader(const mgear_PoseStreamReader&);
+	mgear_PoseStreamReader& operator=(const mgear_PoseStreamReader&);
+
+	bool validate(std::string& error) const
+	{
+		if (size < sizeof(s_PoseStreamHeader) || !isPoseStream(base, size)) {
+			error = "not a pose stream";
+			return false;
+		}
+		const s_PoseStreamHeader& h = header();
+		if (h.version != MGEAR_POSE_STREAM_VERSION || h.headerSize != sizeof(s_PoseStreamHeader)) {
+			error = "unsupported pose stream version";
+			return false;
+		}
+		// the sizes are checked one at a time so nothing can overflow
+		bool aligned = h.channelOffset % MGEAR_POSE_STREAM_ALIGNMENT == 0 && h.dataOffset % MGEAR_POSE_STREAM_ALIGNMENT == 0
+			&& h.frameStride % MGEAR_POSE_STREAM_ALIGNMENT == 0;
+		bool fits = aligned && h.channelOffset >= sizeof(s_PoseStreamHeader) && h.channelOffset <= size
+			&& h.channelCount <= (size - h.channelOffset) / sizeof(s_PoseStreamChannel)
+			&& h.dataOffset >= h.channelOffset + h.channelCount * sizeof(s_PoseStreamChannel) && h.dataOffset <= size
+			&& h.frameStride >= h.channelCount * sizeof(double)
+			&& (h.frameStride == 0 ? h.frameCount == 0 || h.channelCount == 0 : h.frameCount <= (size - h.dataOffset) / h.frameStride);
+		if (!fits) {
+			error = "truncated or corrupted pose stream";
+			return false;
+		}
+		for (uint64_t i = 0; i < h.channelCount; i++) {
+			if (std::memchr(channelName(i), 0, sizeof(s_PoseStreamChannel)) == NULL) {
+				error = "corrupted channel name";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const unsigned char* base;
+	size_t size;
+	bool mapped;
+	unsigned char* allocated;
+};
+
+/////////////////////////////////////////////////
+// WRITER
+/////////////////////////////////////////////////
+
+// Creates a pose stream of known size and maps it, the frames are filled
+// in place (from any thread, one frame per writer) until close().
+// Where mmap isn't available they go to a buffer written by close().
+class mgear_PoseStreamWriter
+{
+ public:
+	mgear_PoseStreamWriter() : base(NULL), size(0), fd(-1), allocated(NULL) {}
+	~mgear_PoseStreamWriter()
+	{
+		std::string error;
+		close(error);
+	}
+
+	// Channel names are up to 63 characters
+	bool create(const std::string& path, const std::vector<std::string>& channels, uint64_t frameCount, std::string& error)
+	{
+		std::string closeError;
+		close(closeError);
+		for (size_t i = 0; i < channels.size(); i++) {
+			if (channels[i].size() >= sizeof(s_PoseStreamChannel)) {
+				error = "channel name too long: " + channels[i];
+				return false;
+			}
+		}
+
+		s_PoseStreamHeader header;
+		poseStreamHeader(channels.size(), frameCount, header);
+		size = (size_t)(header.dataOffset + frameCount * header.frameStride);
+
+#if defined(_WIN32)
+		this->path = path;
+		allocated = (unsigned char*)std::calloc(size + MGEAR_POSE_STREAM_ALIGNMENT, 1);
+		if (!allocated) {
+			error = "out of memory for " + path;
+			return false;
+		}
+		base = allocated + (MGEAR_POSE_STREAM_ALIGNMENT - (uintptr_t)allocated % MGEAR_POSE_STREAM_ALIGNMENT) % MGEAR_POSE_STREAM_ALIGNMENT;
+#else
+		fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			error = "can't create " + path;
+			return false;
+		}
+		// the new file reads as zeros, the padding included
+		void* p = (ftruncate(fd, (off_t)size) == 0) ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		if (p == MAP_FAILED) {
+			::close(fd);
+			fd = -1;
+			size = 0;
+			error = "can't map " + path;
+			return false;
+		}
+		base = (unsigned char*)p;
+#endif
+		std::memcpy(base, &header, sizeof(header));
+		s_PoseStreamChannel* table = (s_PoseStreamChannel*)(base + header.channelOffset);
+		for (size_t i = 0; i < channels.size(); i++)
+			std::memcpy(table[i].name, channels[i].c_str(), channels[i].size() + 1);
+		return true;
+	}
+
+	double* frame(uint64_t index)
+	{
+		const s_PoseStreamHeader& h = *(const s_PoseStreamHeader*)base;
+		return (double*)(base + h.dataOffset + index * h.frameStride);
+	}
+
+	size_t frameStride() const { return (size_t)(((const s_PoseStreamHeader*)base)->frameStride / sizeof(double)); }
+
+	// false when the file couldn't be completed
+	bool close(std::string& error)
+	{
+		bool ok = true;
+#if defined(_WIN32)
+		if (allocated) {
+			FILE* file = std::fopen(path.c_str(), "wb");
+			ok = file && std::fwrite(base, 1, size, file) == size;
+			ok = file && (std::fclose(file) == 0) && ok;
+			if (!ok)
+				error = "can't write " + path;
+		}
+		std::free(allocated);
+#else
+		if (fd >= 0) {
+			ok = munmap(base, size) == 0;
+			ok = (::close(fd) == 0) && ok;
+			if (!ok)
+				error = "can't write the pose stream";
+		}
+#endif
+		base = NULL;
+		size = 0;
+		fd = -1;
+		allocated = NULL;
+		return ok;
+	}
+
+ private:
+	mgear_PoseStreamWriter(const mgear_PoseStreamWriter&);
+	mgear_PoseStreamWriter& operator=(const mgear_PoseStreamWriter&);
+
+	unsigned char* base;
+	size_t size;
+	int fd;
+	unsigned char* allocated;
+	std::string path;
+};
+
+#endif
@@ -58,6 +58,9 @@ Date:       2016 / 10 / 10
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <map>
+#include <chrono>
+#include <vector>
 
 #include <maya/MGlobal.h>
 #include <maya/MPxNode.h>
@@ -68,6 +71,8 @@ Date:       2016 / 10 / 10
 #include <maya/MPlug.h>
 #include <maya/MDataBlock.h>
 #include <maya/MDataHandle.h>
+#include <maya/MArrayDataHandle.h>
+#include <maya/MArrayDataBuilder.h>
 
 #include <maya/MFnTypedAttribute.h>
 #include <maya/MFnNumericAttribute.h>
@@ -75,6 +80,7 @@ Date:       2016 / 10 / 10
 #include <maya/MFnEnumAttribute.h>
 #include <maya/MFnUnitAttribute.h>
 #include <maya/MFnCompoundAttribute.h>
+#include <maya/MRampAttribute.h>
 
 
 #include <maya/MQuaternion.h>
@@ -87,8 +93,11 @@ Date:       2016 / 10 / 10
 #include <maya/MFloatMatrix.h>
 #include <maya/MTransformationMatrix.h>
 #include <maya/MDoubleArray.h>
+#include <maya/MFnVectorArrayData.h>
+#include <maya/MFnDoubleArrayData.h>
 #include <maya/MEulerRotation.h>
 #include <maya/MTime.h>
+#include <maya/MObjectArray.h>
 
 
 #include <maya/MFnMesh.h>
@@ -109,45 +118,119 @@ Date:       2016 / 10 / 10
 
 
 #include <maya/MStatus.h>
+
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+#include <maya/MArgList.h>
+#include <maya/MArgDatabase.h>
+#include <maya/MProfiler.h>
+#include <maya/MObjectHandle.h>
+
+// cached playback support
+#if MAYA_API_VERSION >= 20200000
+#include <maya/MEvaluationNode.h>
+#include <maya/MNodeCacheDisablingInfo.h>
+#include <maya/MNodeCacheSetupInfo.h>
+#endif
 //#include <minmax.h>
 #include <cstdlib>
 
+#include "mgear_kernels.h"
+
 
 
 #define PI 3.14159265
 
 
+
 /////////////////////////////////////////////////
 // STRUCTS
 /////////////////////////////////////////////////
-struct s_GetFKTransform
+// Point and unit tangent on a bezier segment, see bezier4point
+struct s_BezierPoint
 {
-   double lengthA;
-   double lengthB;
-   bool negate;
-   MTransformationMatrix root;
-   MTransformationMatrix bone1;
-   MTransformationMatrix bone2;
-   MTransformationMatrix eff;
+   MVector position;
+   MVector tangent;
 };
 
-struct s_GetIKTransform
+// An MFnNurbsCurve for the curve kernels of mgear_kernels.h, the members
+// are the ones of s_NurbsEvaluator
+struct s_CurveFn
 {
-   double lengthA;
-   double lengthB;
-   bool negate;
-   double roll;
-   double scaleA;
-   double scaleB;
-   double maxstretch;
-   double softness;
-   double slide;
-   double reverse;
-   MTransformationMatrix root;
-   MTransformationMatrix eff;
-   MTransformationMatrix	 upv;
+   s_CurveFn(const MObject& curve);
+
+   int cvCount() const;
+   void point(double u, double out[3]) const;
+   void tangent(double u, double out[3]) const;
+   double length() const;
+   double paramFromLength(double length) const;
+
+   MFnNurbsCurve fn;
+   bool valid;
 };
 
+/////////////////////////////////////////////////
+// SPRINGS
+/////////////////////////////////////////////////
+// The integration of each spring node for mgear_springSimulation, see
+// mgear_math.h. The steps are in the node files, mgear_springNode's and
+// mgear_rotationalSpringNode's are s_SpringPoint3Traits and
+// s_SpringRotationTraits of mgear_kernels.h.
+
+// mgear_springChainNode: particles held at the goal segment lengths
+struct s_SpringChainTraits
+{
+	typedef MVectorArray Goal;
+	typedef MVectorArray Velocity;
+
+	int iterations;	// relaxation passes per step
+
+	static bool equivalent(const MVectorArray& a, const MVectorArray& b);
+	static MVectorArray rest(const MVectorArray& goal) { return MVectorArray(goal.length(), MVector(0.0, 0.0, 0.0)); }
+	static MVectorArray rigidVelocity(const MVectorArray& from, const MVectorArray& to, double frames);
+	static void interpolate(const MVectorArray& a, const MVectorArray& b, double blend, MVectorArray& out);
+	void step(const MVectorArray& goal, MVectorArray& position, MVectorArray& velocity, const s_SpringCoefficients& coef, double h) const;
+};
+
+/////////////////////////////////////////////////
+// PROFILING
+/////////////////////////////////////////////////
+// Opened in every compute/deform once the plug is known to be handled, the
+// kUnknownParameter calls aren't counted. Emits a "mgear_solvers" event when
+// that category is recorded by the Maya Profiler and, once turned on with
+// the mgear_profile command, counts the calls, their time and the triggering
+// plug per node. Both off, it's two flag tests.
+class mgear_ProfileScope
+{
+ public:
+   mgear_ProfileScope(const MPxNode* node, const char* typeName, const MPlug& plug);
+   mgear_ProfileScope(const MPxNode* node, const char* typeName, const char* what);
+   ~mgear_ProfileScope();
+
+ private:
+   void begin(const char* what);
+
+   const MPxNode* node;
+   const char* typeName;
+   MString plugName;
+   int eventId;
+   bool counting;
+   std::chrono::steady_clock::time_point start;
+};
+
+// mgear_profile -enable on|off, -reset, -dump [-file path]: -dump returns the
+// counters per node type and per instance as JSON
+class mgear_profileCmd : public MPxCommand
+{
+ public:
+   virtual MStatus doIt( const MArgList& args );
+   static void* creator();
+   static MSyntax newSyntax();
+};
+
+MStatus mgear_initializeProfiling();
+void mgear_uninitializeProfiling();
+
 /////////////////////////////////////////////////
 // CLASSES
 /////////////////////////////////////////////////
@@ -245,9 +328,20 @@ class mgear_squashStretch2 : public MPxNode
 	static MObject	 axis;
 	static MObject	 squash;
 	static MObject	 stretch;
+	static MObject	 count;
+	static MObject	 profile;
+	static MObject	 profile_position;
+	static MObject	 profile_value;
+	static MObject	 profile_interp;
 
 	// Output
 	static MObject	 output;
+	static MObject	 outputs;
+
+	// profile ramp entries (position, value, interpolation) and the ramp
+	// sampled from them at each joint, kept while neither changes
+	std::vector<float> _profileEntries;
+	std::vector<float> _profileLut;
 
 };
 
@@ -326,9 +420,12 @@ class mgear_spinePointAt : public MPxNode
 	static MObject	 rotBz;
 	static MObject	 axe;
 	static MObject	 blend;
+	static MObject	 interpolation;
+	static MObject	 blends;
 
 	// Output
 	static MObject	 pointAt;
+	static MObject	 pointAts;
 
 };
 
@@ -377,6 +474,35 @@ class mgear_mulMatrix : public MPxNode
 
 };
 
+class mgear_matrixChain : public MPxNode
+{
+ public:
+      mgear_matrixChain();
+   virtual	 ~mgear_matrixChain();
+
+   virtual MStatus compute( const MPlug& plug, MDataBlock& data );
+   virtual SchedulingType schedulingType() const;
+   static void* creator();
+   static MStatus initialize();
+
+ public:
+	static MTypeId id;
+
+	// Input
+	static MObject	 matrixIn;
+	static MObject	 matrix;
+	static MObject	 invert;
+
+	// Output
+	static MObject	 output;
+
+	// inverse of each element, kept while its matrix doesn't change
+	std::vector<MMatrix> _cacheInput;
+	std::vector<MMatrix> _cacheInverse;
+	std::vector<bool> _cacheValid;
+
+};
+
 class mgear_intMatrix : public MPxNode
 {
  public:
@@ -388,11 +514,16 @@ class mgear_intMatrix : public MPxNode
    static void* creator();
    static MStatus initialize();
 
+   MStatus computeArray( MDataBlock& data );
+
  public:
 	static MTypeId id;
 
 	// ATTRIBUTES
 	static MObject	 blend;
+	static MObject	 blends;
+	static MObject	 interpolation;
+	static MObject	 count;
 
 	// Input
 	static MObject	 matrixA;
@@ -400,6 +531,7 @@ class mgear_intMatrix : public MPxNode
 
 	// Output
 	static MObject	 output;
+	static MObject	 outputs;
 
 };
 
@@ -413,13 +545,12 @@ class mgear_ikfk2Bone : public MPxNode
    virtual SchedulingType schedulingType() const;
    static void* creator();
    static MStatus initialize();
-   MTransformationMatrix getIKTransform(s_GetIKTransform values, MString outportName);
-   MTransformationMatrix getFKTransform(s_GetFKTransform values, MString outportName);
 
  public:
 
 	// ATTRIBUTES
 	static MObject	 blend;
+	static MObject	 interpolation;
 
 	static MObject	 lengthA;
 	static MObject	 lengthB;
@@ -483,6 +614,24 @@ public:
 
 };
 
+class mgear_weightedSumNode : public MPxNode
+{
+public:
+	mgear_weightedSumNode();
+	virtual			~mgear_weightedSumNode();
+	virtual SchedulingType schedulingType() const;
+	static	void*	creator();
+
+	virtual MStatus		compute(const MPlug& plug, MDataBlock& data);
+	static MStatus		initialize();
+
+	static MTypeId id;
+	static MObject aOutValue;
+	static MObject aInValue;
+	static MObject aInWeight;
+
+};
+
 class mgear_linearInterpolate3DvectorNode : public MPxNode
 {
 public:
@@ -515,6 +664,28 @@ public:
 
 };
 
+class mgear_linearInterpolateVectorArrayNode : public MPxNode
+{
+public:
+	mgear_linearInterpolateVectorArrayNode();
+	virtual			~mgear_linearInterpolateVectorArrayNode();
+	virtual SchedulingType schedulingType() const;
+	static	void*	creator();
+
+	virtual MStatus		compute(const MPlug& plug, MDataBlock& data);
+	static MStatus		initialize();
+
+	static MTypeId id;
+
+	static MObject vecArrayA;
+	static MObject vecArrayB;
+	static MObject blend;
+	static MObject blendArray;
+
+	static MObject outVecArray;
+
+};
+
 class mgear_springNode : public MPxNode
 {
 public:
@@ -525,6 +696,9 @@ public:
 
 	virtual MStatus		compute(const MPlug& plug, MDataBlock& data);
 	static MStatus		initialize();
+#if MAYA_API_VERSION >= 20200000
+	virtual void		getCacheSetup(const MEvaluationNode& evalNode, MNodeCacheDisablingInfo& disablingInfo, MNodeCacheSetupInfo& cacheSetupInfo, MObjectArray& monitoredAttributes) const;
+#endif
 
 	static MTypeId id;
 	static MObject aOutput;
@@ -537,13 +711,73 @@ public:
 	static MObject aTime;
 	//static MObject aParentInverse;
 	static MObject aSpringIntensity;
+	static MObject aSubsteps;
+	static MObject aCacheSize;
+
+	////variables
+
+	mgear_springPointSimulation _simulation;
+
+};
+
+class mgear_rotationalSpringNode : public MPxNode
+{
+public:
+	mgear_rotationalSpringNode();
+	virtual			~mgear_rotationalSpringNode();
+	virtual SchedulingType schedulingType() const;
+	static	void*	creator();
+
+	virtual MStatus		compute(const MPlug& plug, MDataBlock& data);
+	static MStatus		initialize();
+#if MAYA_API_VERSION >= 20200000
+	virtual void		getCacheSetup(const MEvaluationNode& evalNode, MNodeCacheDisablingInfo& disablingInfo, MNodeCacheSetupInfo& cacheSetupInfo, MObjectArray& monitoredAttributes) const;
+#endif
+
+	static MTypeId id;
+	static MObject aOutput;
+	static MObject aGoal;
+	static MObject aDamping;
+	static MObject aStiffness;
+	static MObject aTime;
+	static MObject aSpringIntensity;
+	static MObject aSubsteps;
+	static MObject aCacheSize;
 
 	////variables
 
-	bool _initialized;
-	MTime _previousTime;
-	MFloatVector _currentPosition;
-	MFloatVector _previousPosition;
+	mgear_springRotationSimulation _simulation;
+
+};
+
+class mgear_springChainNode : public MPxNode
+{
+public:
+	mgear_springChainNode();
+	virtual			~mgear_springChainNode();
+	virtual SchedulingType schedulingType() const;
+	static	void*	creator();
+
+	virtual MStatus		compute(const MPlug& plug, MDataBlock& data);
+	static MStatus		initialize();
+#if MAYA_API_VERSION >= 20200000
+	virtual void		getCacheSetup(const MEvaluationNode& evalNode, MNodeCacheDisablingInfo& disablingInfo, MNodeCacheSetupInfo& cacheSetupInfo, MObjectArray& monitoredAttributes) const;
+#endif
+
+	static MTypeId id;
+	static MObject aOutput;
+	static MObject aGoal;
+	static MObject aDamping;
+	static MObject aStiffness;
+	static MObject aTime;
+	static MObject aSpringIntensity;
+	static MObject aSubsteps;
+	static MObject aIterations;
+	static MObject aCacheSize;
+
+	////variables
+
+	mgear_springSimulation<s_SpringChainTraits> _simulation;
 
 };
 
@@ -582,15 +816,24 @@ class mgear_trigonometryAngle : public MPxNode
    static void* creator();
    static MStatus initialize();
 
+   MStatus computeArray( MDataBlock& data );
+
  public:
 	static MTypeId id;
 
 	// Input
 	static MObject	 trigoOperation;
 	static MObject	 angle;
+	static MObject	 inputY;
+	static MObject	 inputX;
+	static MObject	 angleArray;
+	static MObject	 inputXArray;
 
 	// Output
 	static MObject	 output;
+	static MObject	 outputB;
+	static MObject	 outputArray;
+	static MObject	 outputArrayB;
 
 };
 
@@ -641,6 +884,11 @@ public:
 	// ---------------------------------------------------
 	static MObject aDriverMatrix;
 
+	// -- weighted drivers, they replace driverMatrix when connected
+	static MObject aDriverList;
+	static MObject aDriverListMatrix;
+	static MObject aDriverListWeight;
+
 	static MObject aDriverRotationOffset;
 	static MObject aDriverRotationOffsetX;
 	static MObject aDriverRotationOffsetY;
@@ -692,25 +940,29 @@ public:
 // METHODS
 /////////////////////////////////////////////////
 MQuaternion e2q(double x, double y, double z);
-MQuaternion slerp2(MQuaternion qA, MQuaternion qB, double blend);
+MQuaternion slerp2(const MQuaternion& qA, const MQuaternion& qB, double blend);
 double clamp(double d, double min_value, double max_value);
 int clamp(int d, int min_value, int max_value);
-double getDot(MQuaternion qA, MQuaternion qB);
+double getDot(const MQuaternion& qA, const MQuaternion& qB);
 double radians2degrees(double a);
 double degrees2radians(double a);
 double round(const double value, const int precision);
 double normalizedUToU(double u, int point_count);
 double uToNormalizedU(double u, int point_count);
-unsigned findClosestInArray(double value, MDoubleArray in_array);
+unsigned findClosestInArray(double value, const MDoubleArray& in_array);
 double set01range(double value, double first, double second);
 double linearInterpolate(double first, double second, double blend);
-MVector linearInterpolate(MVector v0, MVector v1, double blend);
-MVectorArray bezier4point( MVector a, MVector tan_a, MVector d, MVector tan_d, double u);
-MVector rotateVectorAlongAxis(MVector v, MVector axis, double a);
-MQuaternion getQuaternionFromAxes(MVector vx, MVector vy, MVector vz);
-MTransformationMatrix mapWorldPoseToObjectSpace(MTransformationMatrix objectSpace, MTransformationMatrix pose);
-MTransformationMatrix mapObjectPoseToWorldSpace(MTransformationMatrix objectSpace, MTransformationMatrix pose);
-MTransformationMatrix interpolateTransform(MTransformationMatrix xf1, MTransformationMatrix xf2, double blend);
+MVector linearInterpolate(const MVector& v0, const MVector& v1, double blend);
+s_BezierPoint bezier4point(const MVector& a, const MVector& tan_a, const MVector& d, const MVector& tan_d, double u);
+MVector rotateVectorAlongAxis(const MVector& v, const MVector& axis, double a);
+MQuaternion getQuaternionFromAxes(const MVector& vx, const MVector& vy, const MVector& vz);
+MTransformationMatrix mapWorldPoseToObjectSpace(const MTransformationMatrix& objectSpace, const MTransformationMatrix& pose);
+MTransformationMatrix mapObjectPoseToWorldSpace(const MTransformationMatrix& objectSpace, const MTransformationMatrix& pose);
+MTransformationMatrix interpolateTransform(const MTransformationMatrix& xf1, const MTransformationMatrix& xf2, double blend, int mode = MGEAR_INTERPOLATE_SLERP);
+MTransformationMatrix transformFromTRS(const s_TRS& trs);
+MVector springVelocity(const MVector& velocity, const MVector& offset, const s_SpringCoefficients& coef, double h);
+void removeElementsFrom(MArrayDataHandle& output, MArrayDataBuilder& builder, unsigned count);
+void removeElementsNotIn(MArrayDataHandle& output, MArrayDataBuilder& builder, MArrayDataHandle& input);
 
 
 #endif
\ No newline at end of file
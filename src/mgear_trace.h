@@ -0,0 +1,195 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+#ifndef _mgearTrace
+#define _mgearTrace
+
+/////////////////////////////////////////////////
+// Maya free scoped timers written as Chrome trace events, to look at
+// offline solver runs in chrome://tracing or Perfetto.
+//
+//     mgear_traceStart();
+//     { mgear_TraceScope scope("ikfk2Bone", frameCount); ... }
+//     mgear_traceStop("bake.json");
+//
+// Each thread appends complete ("X") events to its own buffer: name, begin,
+// duration, thread id and batch size. mgear_traceStop() gathers them, call
+// it once the worker threads are done. Not started, a scope costs one
+// atomic load.
+//
+// The kernels of mgear_math.h are traced when built with MGEAR_TRACE defined,
+// without it MGEAR_TRACE_SCOPE compiles to nothing.
+/////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct s_TraceEvent
+{
+	const char* name;
+	double begin;
+	double duration;
+	int batch;
+};
+
+struct s_TraceBuffer
+{
+	int tid;
+	std::mutex mutex;
+	std::vector<s_TraceEvent> events;
+};
+
+struct s_TraceState
+{
+	std::atomic<bool> enabled;
+	std::chrono::steady_clock::time_point origin;
+	std::mutex mutex;
+	std::vector<std::shared_ptr<s_TraceBuffer> > buffers;
+
+	s_TraceState() : enabled(false) {}
+};
+
+inline s_TraceState& mgear_traceState()
+{
+	static s_TraceState state;
+	return state;
+}
+
+// The buffer of the calling thread, registered on first use so its events
+// outlive the thread
+inline s_TraceBuffer& mgear_traceBuffer()
+{
+	static thread_local std::shared_ptr<s_TraceBuffer> buffer;
+	if (!buffer) {
+		buffer = std::make_shared<s_TraceBuffer>();
+		s_TraceState& state = mgear_traceState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		buffer->tid = (int)state.buffers.size() + 1;
+		state.buffers.push_back(buffer);
+	}
+	return *buffer;
+}
+
+// Microseconds since mgear_traceStart()
+inline double mgear_traceNow()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - mgear_traceState().origin).count();
+}
+
+// Drops the events recorded so far and starts recording
+inline void mgear_traceStart()
+{
+	s_TraceState& state = mgear_traceState();
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		for (size_t i = 0; i < state.buffers.size(); i++) {
+			std::lock_guard<std::mutex> bufferLock(state.buffers[i]->mutex);
+			state.buffers[i]->events.clear();
+		}
+		state.origin = std::chrono::steady_clock::now();
+	}
+	state.enabled = true;
+}
+
+inline bool mgear_traceEnabled()
+{
+	return mgear_traceState().enabled.load(std::memory_order_relaxed);
+}
+
+// Stops recording and writes the trace to path, false when it can't be
+// written. An empty path only stops.
+inline bool mgear_traceStop(const std::string& path)
+{
+	s_TraceState& state = mgear_traceState();
+	state.enabled = false;
+	if (path.empty())
+		return true;
+
+	FILE* file = std::fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	std::fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+	bool first = true;
+	std::lock_guard<std::mutex> lock(state.mutex);
+	for (size_t i = 0; i < state.buffers.size(); i++) {
+		s_TraceBuffer& buffer = *state.buffers[i];
+		std::lock_guard<std::mutex> bufferLock(buffer.mutex);
+		for (size_t j = 0; j < buffer.events.size(); j++) {
+			const s_TraceEvent& e = buffer.events[j];
+			std::fprintf(file, "%s\n{\"name\": \"%s\", \"cat\": \"mgear_solvers\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"batch\": %d}}",
+				first ? "" : ",", e.name, buffer.tid, e.begin, e.duration, e.batch);
+			first = false;
+		}
+	}
+	std::fprintf(file, "\n]}\n");
+	return std::fclose(file) == 0;
+}
+
+// Times its lifetime. name must be a string literal (it's kept as is and
+// written without escaping), batch is the number of items it processes.
+class mgear_TraceScope
+{
+ public:
+	mgear_TraceScope(const char* name, int batch) : name(name), batch(batch), begin(-1.0)
+	{
+		if (mgear_traceEnabled())
+			begin = mgear_traceNow();
+	}
+
+	~mgear_TraceScope()
+	{
+		if (begin < 0.0)
+			return;
+		s_TraceEvent e = { name, begin, mgear_traceNow() - begin, batch };
+		s_TraceBuffer& buffer = mgear_traceBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.events.push_back(e);
+	}
+
+ private:
+	const char* name;
+	int batch;
+	double begin;
+};
+
+#if !defined(MGEAR_TRACE_SCOPE)
+#if defined(MGEAR_TRACE)
+#define MGEAR_TRACE_SCOPE(name, batch) mgear_TraceScope _mgearTraceScope(name, batch)
+#else
+#define MGEAR_TRACE_SCOPE(name, batch) ((void)0)
+#endif
+#endif
+
+#endif
@@ -106,6 +106,8 @@ MStatus mgear_mulMatrix::compute(const MPlug& plug, MDataBlock& data)
 	if( plug != output )
 		return MS::kUnknownParameter;
 
+	mgear_ProfileScope profileScope(this, "mgear_mulMatrix", plug);
+
 	// Input
 	MMatrix mA = data.inputValue( matrixA ).asMatrix();
 	MMatrix mB = data.inputValue( matrixB ).asMatrix();
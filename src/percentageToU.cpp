@@ -124,72 +124,20 @@ MStatus mgear_percentageToU::compute(const MPlug& plug, MDataBlock& data)
     if (plug != percentage)
         return MS::kUnknownParameter;
 
-	// Curve
-   MObject crvObj = data.inputValue( curve ).asNurbsCurve();
+    mgear_ProfileScope profileScope(this, "mgear_percentageToU", plug);
 
-	MFnNurbsCurve crv(crvObj);
+	// Curve
+	s_CurveFn crv(data.inputValue( curve ).asNurbsCurve());
 
 	// Sliders
 	bool in_normU = data.inputValue( normalizedU ).asBool();
-	double in_percentage = (double)data.inputValue( percentage ).asFloat() * .01;
-	const unsigned in_steps = data.inputValue( steps ).asShort();
+	double in_percentage = (double)data.inputValue( percentage ).asFloat();
+	int in_steps = data.inputValue( steps ).asShort();
 
 	// Process
-	// Get length
-	MVectorArray u_subpos(in_steps);
-	MPoint pt;
-	MDoubleArray u_list(in_steps);
-	for(unsigned i = 0 ; i < in_steps ; i++ ){
-		u_list[i] = normalizedUToU(i /(in_steps - 1.0), crv.numCVs());
-
-		crv.getPointAtParam(u_list[i], pt, MSpace::kWorld);
-		u_subpos[i] = MVector(pt);
-	}
-
-
-	double t_length = 0;
-	MDoubleArray dist(in_steps);
-	MVector v;
-	for (unsigned i = 0; i < in_steps ; i++){
-		if (i>0){
-			v = u_subpos[i] - u_subpos[i-1];
-			t_length += v.length();
-			dist[i] = t_length;
-		}
-	}
-
-	MDoubleArray u_perc(in_steps);
-	for (unsigned i = 0; i < in_steps ; i++){
-		u_perc[i] = dist[i] / t_length;
-	}
-
-	double out_u = 0.0;
-
-	// Get closest indices
-	unsigned index = findClosestInArray(in_percentage, u_perc);
-	if (index != (unsigned)-1) {
-		unsigned indexA, indexB;
-		if (in_percentage <= u_perc[index]){
-			indexA = abs(int(index));
-			indexB = index;
-			if ( indexA > indexB){
-				indexA = indexB;
-				indexB = indexA+1;
-			}
-		}
-		else {
-			indexA = index;
-			indexB = index + 1;
-		}
-
-		// blend value
-		double blend = set01range(in_percentage, u_perc[indexA], u_perc[indexB]);
-
-		out_u = linearInterpolate(u_list[indexA], u_list[indexB], blend);
-
-		if (in_normU)
-			out_u = uToNormalizedU(out_u, crv.numCVs());
-	}
+	// the u between the samples around the percentage, past the ends the
+	// first or last segment is extended (see mgear_kernels.h)
+	double out_u = percentageToU(crv, in_percentage, in_normU, in_steps);
 
 	// Ouput
 	MDataHandle h = data.outputValue( u );
@@ -198,4 +146,3 @@ MStatus mgear_percentageToU::compute(const MPlug& plug, MDataBlock& data)
 
 	return MS::kSuccess;
 }
-
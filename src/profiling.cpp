@@ -0,0 +1,247 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+/////////////////////////////////////////////////
+// INCLUDE
+/////////////////////////////////////////////////
+#include "mgear_solvers.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+/////////////////////////////////////////////////
+// GLOBAL
+/////////////////////////////////////////////////
+// Counters of one node instance
+struct s_NodeProfile
+{
+	std::string typeName;
+	MObjectHandle handle;
+	unsigned long long calls;
+	double totalNs;
+	double maxNs;
+	std::map<std::string, unsigned long long> plugs;
+
+	s_NodeProfile() : calls(0), totalNs(0.0), maxNs(0.0) {}
+};
+
+static int g_profileCategory = -1;
+static std::atomic<bool> g_profileCounting(false);
+static std::mutex g_profileMutex;
+static std::map<const MPxNode*, s_NodeProfile> g_profiles;
+
+/////////////////////////////////////////////////
+// METHODS
+/////////////////////////////////////////////////
+MStatus mgear_initializeProfiling()
+{
+	g_profileCategory = MProfiler::addCategory("mgear_solvers", "mGear solver nodes");
+	return MS::kSuccess;
+}
+
+void mgear_uninitializeProfiling()
+{
+	g_profileCounting = false;
+	if (g_profileCategory >= 0)
+		MProfiler::removeCategory("mgear_solvers");
+	g_profileCategory = -1;
+
+	std::lock_guard<std::mutex> lock(g_profileMutex);
+	g_profiles.clear();
+}
+
+// SCOPE ========================================
+mgear_ProfileScope::mgear_ProfileScope(const MPxNode* node, const char* typeName, const MPlug& plug)
+	: node(node), typeName(typeName), eventId(-1), counting(false)
+{
+	bool recording = g_profileCategory >= 0 && MProfiler::isCategoryEnabled(g_profileCategory);
+	if (!recording && !g_profileCounting.load(std::memory_order_relaxed))
+		return;
+
+	// the name is only built when somebody looks at it
+	MString name = plug.partialName();
+	begin(name.asChar());
+}
+
+mgear_ProfileScope::mgear_ProfileScope(const MPxNode* node, const char* typeName, const char* what)
+	: node(node), typeName(typeName), eventId(-1), counting(false)
+{
+	begin(what);
+}
+
+void mgear_ProfileScope::begin(const char* what)
+{
+	if (g_profileCategory >= 0 && MProfiler::isCategoryEnabled(g_profileCategory))
+		eventId = MProfiler::eventBegin(g_profileCategory, MProfiler::kColorE_L3, typeName, what);
+
+	counting = g_profileCounting.load(std::memory_order_relaxed);
+	if (counting){
+		plugName = what;
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+mgear_ProfileScope::~mgear_ProfileScope()
+{
+	if (eventId >= 0)
+		MProfiler::eventEnd(eventId);
+
+	if (!counting)
+		return;
+
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(g_profileMutex);
+	s_NodeProfile& p = g_profiles[node];
+	// a new node allocated where a deleted one was starts over
+	if (p.calls && !p.handle.isAlive())
+		p = s_NodeProfile();
+	if (!p.calls){
+		p.typeName = typeName;
+		p.handle = MObjectHandle(node->thisMObject());
+	}
+	p.calls++;
+	p.totalNs += ns;
+	p.maxNs = std::max(p.maxNs, ns);
+	p.plugs[plugName.asChar()]++;
+}
+
+// JSON =========================================
+static std::string jsonString(const std::string& s)
+{
+	std::string out = "\"";
+	for (size_t i = 0; i < s.size(); i++){
+		char c = s[i];
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+static std::string jsonCounters(unsigned long long calls, double totalNs, double maxNs)
+{
+	char buffer[160];
+	snprintf(buffer, sizeof(buffer), "\"calls\": %llu, \"totalUs\": %.3f, \"avgUs\": %.3f, \"maxUs\": %.3f",
+		calls, totalNs * 1.0e-3, calls ? totalNs * 1.0e-3 / calls : 0.0, maxNs * 1.0e-3);
+	return buffer;
+}
+
+// {"enabled": bool, "types": {type: counters}, "instances": [{"name", "type", counters, "plugs": {plug: calls}}]}
+static std::string profileJson()
+{
+	std::lock_guard<std::mutex> lock(g_profileMutex);
+
+	std::map<std::string, s_NodeProfile> types;
+	std::string instances;
+	for (std::map<const MPxNode*, s_NodeProfile>::const_iterator it = g_profiles.begin(); it != g_profiles.end(); ++it){
+		const s_NodeProfile& p = it->second;
+		s_NodeProfile& t = types[p.typeName];
+		t.calls += p.calls;
+		t.totalNs += p.totalNs;
+		t.maxNs = std::max(t.maxNs, p.maxNs);
+
+		std::string name = p.handle.isValid() ? MFnDependencyNode(p.handle.object()).name().asChar() : "(deleted)";
+		std::string plugs;
+		for (std::map<std::string, unsigned long long>::const_iterator pl = p.plugs.begin(); pl != p.plugs.end(); ++pl){
+			char count[32];
+			snprintf(count, sizeof(count), ": %llu", pl->second);
+			plugs += (plugs.empty() ? "" : ", ") + jsonString(pl->first) + count;
+		}
+
+		instances += instances.empty() ? "\n    " : ",\n    ";
+		instances += "{\"name\": " + jsonString(name) + ", \"type\": " + jsonString(p.typeName) + ", "
+			+ jsonCounters(p.calls, p.totalNs, p.maxNs) + ", \"plugs\": {" + plugs + "}}";
+	}
+
+	std::string json = "{\n  \"enabled\": ";
+	json += g_profileCounting ? "true" : "false";
+	json += ",\n  \"types\": {";
+	for (std::map<std::string, s_NodeProfile>::const_iterator it = types.begin(); it != types.end(); ++it){
+		json += (it == types.begin()) ? "\n    " : ",\n    ";
+		json += jsonString(it->first) + ": {" + jsonCounters(it->second.calls, it->second.totalNs, it->second.maxNs) + "}";
+	}
+	json += types.empty() ? "},\n" : "\n  },\n";
+	json += "  \"instances\": [" + instances + (instances.empty() ? "]\n}" : "\n  ]\n}");
+	return json;
+}
+
+// COMMAND ======================================
+void* mgear_profileCmd::creator()
+{
+	return new mgear_profileCmd();
+}
+
+MSyntax mgear_profileCmd::newSyntax()
+{
+	MSyntax syntax;
+	syntax.addFlag("-e", "-enable", MSyntax::kBoolean);
+	syntax.addFlag("-r", "-reset");
+	syntax.addFlag("-d", "-dump");
+	syntax.addFlag("-f", "-file", MSyntax::kString);
+	return syntax;
+}
+
+MStatus mgear_profileCmd::doIt(const MArgList& args)
+{
+	MStatus stat;
+	MArgDatabase argData(syntax(), args, &stat);
+		if (!stat) {stat.perror("mgear_profile"); return stat;}
+
+	if (argData.isFlagSet("-reset")){
+		std::lock_guard<std::mutex> lock(g_profileMutex);
+		g_profiles.clear();
+	}
+
+	if (argData.isFlagSet("-enable")){
+		bool enable = false;
+		argData.getFlagArgument("-enable", 0, enable);
+		g_profileCounting = enable;
+	}
+
+	if (argData.isFlagSet("-dump")){
+		std::string json = profileJson();
+		if (argData.isFlagSet("-file")){
+			MString path;
+			argData.getFlagArgument("-file", 0, path);
+			std::ofstream file(path.asChar());
+			if (!file){
+				MGlobal::displayError(MString("mgear_profile: can't write ") + path);
+				return MS::kFailure;
+			}
+			file << json << "\n";
+		}
+		setResult(MString(json.c_str()));
+	}
+
+	return MS::kSuccess;
+}
@@ -120,6 +120,8 @@ MStatus mgear_rayCastPosition::compute(const MPlug& plug, MDataBlock& data)
 	if( plug != output )
 		return MS::kUnknownParameter;
 
+	mgear_ProfileScope profileScope(this, "mgear_rayCastPosition", plug);
+
 	// Input
 	MDataHandle hMeshInput = data.inputValue(meshInput, &status);
 	MObject oMesh = hMeshInput.asMesh();
@@ -127,11 +129,10 @@ MStatus mgear_rayCastPosition::compute(const MPlug& plug, MDataBlock& data)
 	MMatrix mRD = data.inputValue( rayDirection ).asMatrix();
 
 	MFnMesh fnMesh( oMesh, &status );
-	MTransformationMatrix mRSt= MTransformationMatrix(mRS);
-	MTransformationMatrix mRDt = MTransformationMatrix(mRD);
 
-	MFloatVector vRS = mRSt.getTranslation(MSpace::kWorld);
-	MFloatVector vRD = mRDt.getTranslation(MSpace::kWorld);
+	// only the positions are needed, read them from the matrices
+	MFloatVector vRS(mRS[3][0], mRS[3][1], mRS[3][2]);
+	MFloatVector vRD(mRD[3][0], mRD[3][1], mRD[3][2]);
 	double ax = vRD.x - vRS.x;
 	double ay = vRD.y - vRS.y;
 	double az = vRD.z - vRS.z;
@@ -167,7 +168,7 @@ MStatus mgear_rayCastPosition::compute(const MPlug& plug, MDataBlock& data)
                             tolerance
                             );
 
-	MTransformationMatrix result;
+	MMatrix mC;
 
 	if (hit)
 	{
@@ -186,21 +187,21 @@ MStatus mgear_rayCastPosition::compute(const MPlug& plug, MDataBlock& data)
 
 		if (newLength > oriLength)
 		{
-			result = mRDt;
+			mC = mRD;
 		}
 		else
 		{
-			result.setTranslation(hitPoint, MSpace::kWorld);
+			mC[3][0] = hitPoint.x;
+			mC[3][1] = hitPoint.y;
+			mC[3][2] = hitPoint.z;
 		}
 
 	}
 	else
 	{
-		result = mRDt;
+		mC = mRD;
 	}
 
-	MMatrix mC = result.asMatrix();
-
 	// Output
 	MDataHandle h;
 	h = data.outputValue( output );
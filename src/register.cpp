@@ -65,6 +65,9 @@ PLUGIN_EXPORT MStatus initializePlugin( MObject obj )
 	status = plugin.registerNode( "mgear_mulMatrix", mgear_mulMatrix::id, mgear_mulMatrix::creator, mgear_mulMatrix::initialize );
 		if (!status) {status.perror("registerNode() failed."); return status;}
 
+	status = plugin.registerNode( "mgear_matrixChain", mgear_matrixChain::id, mgear_matrixChain::creator, mgear_matrixChain::initialize );
+		if (!status) {status.perror("registerNode() failed."); return status;}
+
 	status = plugin.registerNode( "mgear_intMatrix", mgear_intMatrix::id, mgear_intMatrix::creator, mgear_intMatrix::initialize );
 		if (!status) {status.perror("registerNode() failed."); return status;}
 
@@ -80,12 +83,24 @@ PLUGIN_EXPORT MStatus initializePlugin( MObject obj )
 	status = plugin.registerNode("mgear_springNode", mgear_springNode::id, mgear_springNode::creator, mgear_springNode::initialize);
 		if (!status) { status.perror("registerNode() failed."); return status; }
 
+	status = plugin.registerNode("mgear_rotationalSpringNode", mgear_rotationalSpringNode::id, mgear_rotationalSpringNode::creator, mgear_rotationalSpringNode::initialize);
+		if (!status) { status.perror("registerNode() failed."); return status; }
+
+	status = plugin.registerNode("mgear_springChainNode", mgear_springChainNode::id, mgear_springChainNode::creator, mgear_springChainNode::initialize);
+		if (!status) { status.perror("registerNode() failed."); return status; }
+
 	status = plugin.registerNode("mgear_linearInterpolate3DvectorNode", mgear_linearInterpolate3DvectorNode::id, mgear_linearInterpolate3DvectorNode::creator, mgear_linearInterpolate3DvectorNode::initialize);
 		if (!status) { status.perror("registerNode() failed."); return status; }
 
+	status = plugin.registerNode("mgear_linearInterpolateVectorArrayNode", mgear_linearInterpolateVectorArrayNode::id, mgear_linearInterpolateVectorArrayNode::creator, mgear_linearInterpolateVectorArrayNode::initialize);
+		if (!status) { status.perror("registerNode() failed."); return status; }
+
 	status = plugin.registerNode("mgear_add10scalarNode", mgear_add10scalarNode::id, mgear_add10scalarNode::creator, mgear_add10scalarNode::initialize);
 		if (!status) { status.perror("registerNode() failed."); return status; }
 
+	status = plugin.registerNode("mgear_weightedSumNode", mgear_weightedSumNode::id, mgear_weightedSumNode::creator, mgear_weightedSumNode::initialize);
+		if (!status) { status.perror("registerNode() failed."); return status; }
+
 	status = plugin.registerNode("mgear_rayCastPosition", mgear_rayCastPosition::id, mgear_rayCastPosition::creator, mgear_rayCastPosition::initialize);
 		if (!status) { status.perror("registerNode() failed."); return status; }
 
@@ -98,6 +113,12 @@ PLUGIN_EXPORT MStatus initializePlugin( MObject obj )
 	status = plugin.registerNode("mgear_matrixConstraint", mgear_matrixConstraint::id, mgear_matrixConstraint::creator, mgear_matrixConstraint::initialize);
 		if (!status) { status.perror("registerNode() failed."); return status; }
 
+	status = mgear_initializeProfiling();
+		if (!status) { status.perror("mgear_initializeProfiling() failed."); return status; }
+
+	status = plugin.registerCommand("mgear_profile", mgear_profileCmd::creator, mgear_profileCmd::newSyntax);
+		if (!status) { status.perror("registerCommand() failed."); return status; }
+
 	return status;
 }
 
@@ -121,6 +142,8 @@ PLUGIN_EXPORT MStatus uninitializePlugin( MObject obj)
 		if (!status) {status.perror("deregisterNode() failed."); return status;}
 	status = plugin.deregisterNode( mgear_mulMatrix::id );
 		if (!status) {status.perror("deregisterNode() failed."); return status;}
+	status = plugin.deregisterNode( mgear_matrixChain::id );
+		if (!status) {status.perror("deregisterNode() failed."); return status;}
 	status = plugin.deregisterNode( mgear_intMatrix::id );
 		if (!status) {status.perror("deregisterNode() failed."); return status;}
 	status = plugin.deregisterNode( mgear_percentageToU::id );
@@ -131,10 +154,18 @@ PLUGIN_EXPORT MStatus uninitializePlugin( MObject obj)
 		if (!status) {status.perror("deregisterNode() failed."); return status;}
 	status = plugin.deregisterNode(mgear_springNode::id);
 		if (!status) { status.perror("deregisterNode() failed."); return status; }
+	status = plugin.deregisterNode(mgear_rotationalSpringNode::id);
+		if (!status) { status.perror("deregisterNode() failed."); return status; }
+	status = plugin.deregisterNode(mgear_springChainNode::id);
+		if (!status) { status.perror("deregisterNode() failed."); return status; }
 	status = plugin.deregisterNode(mgear_linearInterpolate3DvectorNode::id);
 		if (!status) { status.perror("deregisterNode() failed."); return status; }
+	status = plugin.deregisterNode(mgear_linearInterpolateVectorArrayNode::id);
+		if (!status) { status.perror("deregisterNode() failed."); return status; }
 	status = plugin.deregisterNode(mgear_add10scalarNode::id);
 		if (!status) { status.perror("deregisterNode() failed."); return status; }
+	status = plugin.deregisterNode(mgear_weightedSumNode::id);
+		if (!status) { status.perror("deregisterNode() failed."); return status; }
 	status = plugin.deregisterNode(mgear_rayCastPosition::id);
 		if (!status) { status.perror("deregisterNode() failed."); return status; }
 	status = plugin.deregisterNode(mgear_trigonometryAngle::id);
@@ -143,6 +174,10 @@ PLUGIN_EXPORT MStatus uninitializePlugin( MObject obj)
 		if (!status) { status.perror("deregisterNode() failed."); return status; }
 	status = plugin.deregisterNode(mgear_matrixConstraint::id);
 		if (!status) { status.perror("deregisterNode() failed."); return status; }
+	status = plugin.deregisterCommand("mgear_profile");
+		if (!status) { status.perror("deregisterCommand() failed."); return status; }
+
+	mgear_uninitializeProfiling();
 
 
 	return MS::kSuccess;
@@ -0,0 +1,178 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// INCLUDE
+/////////////////////////////////////////////////
+#include "mgear_solvers.h"
+
+/////////////////////////////////////////////////
+// GLOBAL
+/////////////////////////////////////////////////
+MTypeId		mgear_rotationalSpringNode::id(0x0011FED0);
+
+//Static variables
+
+MObject mgear_rotationalSpringNode::aOutput;
+MObject mgear_rotationalSpringNode::aGoal;
+
+MObject mgear_rotationalSpringNode::aDamping;
+MObject mgear_rotationalSpringNode::aStiffness;
+MObject mgear_rotationalSpringNode::aTime;
+MObject mgear_rotationalSpringNode::aSpringIntensity;
+MObject mgear_rotationalSpringNode::aSubsteps;
+MObject mgear_rotationalSpringNode::aCacheSize;
+
+
+mgear_rotationalSpringNode::mgear_rotationalSpringNode(){}
+mgear_rotationalSpringNode::~mgear_rotationalSpringNode(){}
+
+mgear_rotationalSpringNode::SchedulingType mgear_rotationalSpringNode::schedulingType() const
+{
+	return kParallel;
+}
+
+void* mgear_rotationalSpringNode::creator()
+{
+	return new mgear_rotationalSpringNode();
+}
+
+#if MAYA_API_VERSION >= 20200000
+// let the background evaluation cache the spring as a simulation
+void mgear_rotationalSpringNode::getCacheSetup(const MEvaluationNode& evalNode, MNodeCacheDisablingInfo& disablingInfo, MNodeCacheSetupInfo& cacheSetupInfo, MObjectArray& monitoredAttributes) const
+{
+	MPxNode::getCacheSetup(evalNode, disablingInfo, cacheSetupInfo, monitoredAttributes);
+	cacheSetupInfo.setPreference(MNodeCacheSetupInfo::kWantToCacheByDefault, true);
+	cacheSetupInfo.setRequirement(MNodeCacheSetupInfo::kSimulationSupport, true);
+}
+#endif
+
+//INIT
+MStatus mgear_rotationalSpringNode::initialize()
+{
+	MStatus status;
+	MFnNumericAttribute nAttr;
+	MFnUnitAttribute uAttr;
+	MFnMatrixAttribute mAttr;
+
+	aOutput = mAttr.create("output", "out");
+	mAttr.setWritable(false);
+	mAttr.setStorable(false);
+	mAttr.setReadable(true);
+	addAttribute(aOutput);
+
+	aGoal = mAttr.create("goal", "goal");
+	mAttr.setKeyable(true);
+	mAttr.setStorable(false);
+	addAttribute(aGoal);
+	attributeAffects(aGoal, aOutput);
+
+	aTime = uAttr.create("time", "time", MFnUnitAttribute::kTime, 0.0f);
+	addAttribute(aTime);
+	attributeAffects(aTime, aOutput);
+
+	aStiffness = nAttr.create("stiffness", "stiffness", MFnNumericData::kFloat, 1.0f);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0f);
+	nAttr.setMax(1.0f);
+	addAttribute(aStiffness);
+	attributeAffects(aStiffness, aOutput);
+
+	aDamping = nAttr.create("damping", "damping", MFnNumericData::kFloat, 1.0f);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0f);
+	nAttr.setMax(1.0f);
+	addAttribute(aDamping);
+	attributeAffects(aDamping, aOutput);
+
+	aSpringIntensity = nAttr.create("intensity", "intensity", MFnNumericData::kFloat, 1.0f);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0f);
+	nAttr.setMax(1.0f);
+	addAttribute(aSpringIntensity);
+	attributeAffects(aSpringIntensity, aOutput);
+
+	aSubsteps = nAttr.create("substeps", "substeps", MFnNumericData::kShort, 4);
+	nAttr.setKeyable(true);
+	nAttr.setMin(1);
+	nAttr.setSoftMax(16);
+	addAttribute(aSubsteps);
+	attributeAffects(aSubsteps, aOutput);
+
+	// number of evaluated frames kept in memory, 0 disables the cache, see
+	// springNode.cpp for when it is dropped
+	aCacheSize = nAttr.create("cacheSize", "cacheSize", MFnNumericData::kInt, 1000);
+	nAttr.setMin(0);
+	addAttribute(aCacheSize);
+
+	return MS::kSuccess;
+}
+
+// COMPUTE
+
+MStatus mgear_rotationalSpringNode::compute(const MPlug& plug, MDataBlock& data)
+{
+	MStatus status;
+
+	if (plug != aOutput)
+	{
+		return MS::kUnknownParameter;
+	}
+
+	mgear_ProfileScope profileScope(this, "mgear_rotationalSpringNode", plug);
+
+	// getting inputs attributes
+	float damping = data.inputValue(aDamping, &status).asFloat();
+	float stiffness = data.inputValue(aStiffness, &status).asFloat();
+
+	MDataHandle h = data.inputValue(aGoal, &status);
+	McheckStatusAndReturnIt(status);
+	MMatrix goal = h.asMatrix();
+
+	MTime currentTime = data.inputValue(aTime, &status).asTime();
+	float springIntensity = data.inputValue(aSpringIntensity, &status).asFloat();
+	int substeps = std::max(1, (int)data.inputValue(aSubsteps, &status).asShort());
+	unsigned cacheSize = (unsigned)std::max(0, data.inputValue(aCacheSize, &status).asInt());
+
+	// same time handling as mgear_springNode, see springNode.cpp
+	double currentFrame = currentTime.as(MTime::uiUnit());
+
+	MMatrix output;
+	rotationalSpringNode(_simulation, goal.matrix, currentFrame, stiffness, damping, springIntensity, substeps, cacheSize, output.matrix);
+
+	MDataHandle hOutput = data.outputValue(aOutput, &status);
+	McheckStatusAndReturnIt(status);
+	hOutput.setMMatrix(output);
+	hOutput.setClean();
+	data.setClean(plug);
+
+	return MS::kSuccess;
+
+}
@@ -32,6 +32,8 @@ Date:       2016 / 10 / 10
 /////////////////////////////////////////////////
 #include "mgear_solvers.h"
 
+#include <maya/MArrayDataBuilder.h>
+
 /////////////////////////////////////////////////
 // GLOBAL
 /////////////////////////////////////////////////
@@ -49,7 +51,10 @@ MObject mgear_spinePointAt::rotBy;
 MObject mgear_spinePointAt::rotBz;
 MObject mgear_spinePointAt::axe;
 MObject mgear_spinePointAt::blend;
+MObject mgear_spinePointAt::interpolation;
 MObject mgear_spinePointAt::pointAt;
+MObject mgear_spinePointAt::blends;
+MObject mgear_spinePointAt::pointAts;
 
 mgear_spinePointAt::mgear_spinePointAt() {} // constructor
 mgear_spinePointAt::~mgear_spinePointAt() {} // destructor
@@ -123,6 +128,19 @@ MStatus mgear_spinePointAt::initialize()
     stat = addAttribute( blend );
 		if (!stat) {stat.perror("addAttribute"); return stat;}
 
+    // exact: the slerp of the first versions, the default so the scenes
+    // saved before keep their pose
+    // fast: corrected nlerp below 180 degrees, see slerpQuaternionFast
+    interpolation = eAttr.create( "interpolation", "interp", 0 );
+    eAttr.addField("exact", 0);
+    eAttr.addField("fast", 1);
+    eAttr.setWritable(true);
+    eAttr.setStorable(true);
+    eAttr.setReadable(true);
+    eAttr.setKeyable(false);
+    stat = addAttribute( interpolation );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
     // Outputs
 	pointAt = nAttr.createPoint("pointAt", "pa" );
     nAttr.setWritable(false);
@@ -131,6 +149,27 @@ MStatus mgear_spinePointAt::initialize()
     stat = addAttribute( pointAt );
 		if (!stat) {stat.perror("addAttribute"); return stat;}
 
+    // Array form, one pointAts element per blends element
+    blends = nAttr.create( "blends", "bs", MFnNumericData::kFloat, 0.5 );
+    nAttr.setArray(true);
+    nAttr.setWritable(true);
+    nAttr.setStorable(true);
+    nAttr.setReadable(true);
+    nAttr.setKeyable(true);
+    nAttr.setMin(0);
+    nAttr.setMax(1);
+    stat = addAttribute( blends );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	pointAts = nAttr.createPoint("pointAts", "pas" );
+    nAttr.setArray(true);
+    nAttr.setUsesArrayDataBuilder(true);
+    nAttr.setWritable(false);
+    nAttr.setStorable(false);
+    nAttr.setReadable(true);
+    stat = addAttribute( pointAts );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
     // Connections
     stat = attributeAffects ( rotA, pointAt );
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
@@ -152,77 +191,139 @@ MStatus mgear_spinePointAt::initialize()
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
     stat = attributeAffects ( blend, pointAt );
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( interpolation, pointAt );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+
+    // Array form
+    stat = attributeAffects ( rotA, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotAx, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotAy, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotAz, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotB, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotBx, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotBy, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( rotBz, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( axe, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( blends, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
+    stat = attributeAffects ( interpolation, pointAts );
+		if (!stat) { stat.perror("attributeAffects"); return stat;}
 
    return MS::kSuccess;
 }
+// Pointing axis at each blend between the rotations A and B (degrees).
+// exact keeps the e2q and slerp2 of the first versions, fast runs the
+// kernels of mgear_math.h. Both write chunks of blended quaternions and
+// read the axis off them with quaternionAxisArray.
+static void spinePointAtAxes(const double rA[3], const double rB[3], int axe, bool fast, const double* blends, unsigned n, double (*out)[3])
+{
+    double q[64][4];
+    if (fast){
+        double qA[4], qB[4];
+        eulerToQuaternion(rA[0], rA[1], rA[2], qA);
+        eulerToQuaternion(rB[0], rB[1], rB[2], qB);
+        for (unsigned begin = 0; begin < n; begin += 64){
+            unsigned count = std::min(64u, n - begin);
+            for (unsigned i = 0; i < count; i++)
+                slerpQuaternionFast(qA, qB, blends[begin + i], q[i]);
+            quaternionAxisArray(axe, q, (int)count, out + begin);
+        }
+        return;
+    }
+
+    // There is no such thing as siTransformation in Maya,
+    // so what we really need to compute this +/-360 roll is the global rotation of the object
+    // We then need to convert this eulerRotation to Quaternion
+    // Maybe it would be faster to use the MEulerRotation class, but anyway, this code can do it
+    MQuaternion qA = e2q(rA[0], rA[1], rA[2]);
+    MQuaternion qB = e2q(rB[0], rB[1], rB[2]);
+
+    for (unsigned begin = 0; begin < n; begin += 64){
+        unsigned count = std::min(64u, n - begin);
+        for (unsigned i = 0; i < count; i++){
+            MQuaternion qC = slerp2(qA, qB, blends[begin + i]);
+            q[i][0] = qC.x;
+            q[i][1] = qC.y;
+            q[i][2] = qC.z;
+            q[i][3] = qC.w;
+        }
+        quaternionAxisArray(axe, q, (int)count, out + begin);
+    }
+}
+
 // COMPUTE ======================================
 MStatus mgear_spinePointAt::compute(const MPlug& plug, MDataBlock& data)
 {
 	MStatus returnStatus;
 
-	if( plug != pointAt )
+    bool arrayOutput = plug == pointAts || (plug.isElement() && plug.array() == pointAts);
+	if( plug != pointAt && !arrayOutput )
 		return MS::kUnknownParameter;
 
-	MString sx, sy, sz, sw;
+	mgear_ProfileScope profileScope(this, "mgear_spinePointAt", plug);
 
     // Get inputs
 	MDataHandle h;
 	MVector v;
     h = data.inputValue( rotA );
 	v = h.asFloatVector();
-    double rAx = v.x;
-    double rAy = v.y;
-    double rAz = v.z;
+    double rA[3] = { v.x, v.y, v.z };
 
     h = data.inputValue( rotB );
 	v = h.asFloatVector();
-    double rBx = v.x;
-    double rBy = v.y;
-    double rBz = v.z;
+    double rB[3] = { v.x, v.y, v.z };
 
 	h = data.inputValue( axe );
     int axe = h.asShort();
 
+	h = data.inputValue( interpolation );
+    bool fast = h.asShort() == 1;
+
+    // Process
+    if (arrayOutput){
+        MArrayDataHandle hBlends = data.inputArrayValue( blends );
+        MArrayDataHandle hOut = data.outputArrayValue( pointAts );
+        MArrayDataBuilder builder = hOut.builder();
+        unsigned n = hBlends.elementCount();
+        std::vector<double> in_blends(n), vOut(n * 3);
+        for (unsigned i = 0; i < n; i++){
+            hBlends.jumpToArrayElement(i);
+            in_blends[i] = (double)hBlends.inputValue().asFloat();
+        }
+        if (n)
+            spinePointAtAxes(rA, rB, axe, fast, &in_blends[0], n, (double(*)[3])&vOut[0]);
+
+        for (unsigned i = 0; i < n; i++){
+            // same index as the blend
+            hBlends.jumpToArrayElement(i);
+            h = builder.addElement( hBlends.elementIndex() );
+            h.set3Float( (float)vOut[i * 3], (float)vOut[i * 3 + 1], (float)vOut[i * 3 + 2] );
+        }
+        removeElementsNotIn( hOut, builder, hBlends );
+        hOut.set( builder );
+        hOut.setAllClean();
+        data.setClean( plug );
+
+        return MS::kSuccess;
+    }
+
 	h = data.inputValue( blend );
     double in_blend = (double)h.asFloat();
 
-    // Process
-    // There is no such thing as siTransformation in Maya,
-    // so what we really need to compute this +/-360 roll is the global rotation of the object
-    // We then need to convert this eulerRotation to Quaternion
-    // Maybe it would be faster to use the MEulerRotation class, but anyway, this code can do it
-    MQuaternion qA = e2q(rAx, rAy, rAz);
-    MQuaternion qB = e2q(rBx, rBy, rBz);
-
-    MQuaternion qC = slerp2(qA, qB, in_blend);
-
-	MVector vOut;
-	switch ( axe )
-	{
-		case 0:
-			vOut = MVector(1,0,0);
-			break;
-		case 1:
-			vOut = MVector(0,1,0);
-			break;
-		case 2:
-			vOut = MVector(0,0,1);
-			break;
-		case 3:
-			vOut = MVector(-1,0,0);
-			break;
-		case 4:
-			vOut = MVector(0,-1,0);
-			break;
-		case 5:
-			vOut = MVector(0,0,-1);
-			break;
-	}
-
-    vOut = vOut.rotateBy(qC);
-    float x = (float)vOut.x;
-    float y = (float)vOut.y;
-    float z = (float)vOut.z;
+    double vOut[1][3];
+    spinePointAtAxes(rA, rB, axe, fast, &in_blend, 1, vOut);
+    float x = (float)vOut[0][0];
+    float y = (float)vOut[0][1];
+    float z = (float)vOut[0][2];
 
     // Output
     h = data.outputValue( pointAt );
@@ -236,4 +337,3 @@ MStatus mgear_spinePointAt::compute(const MPlug& plug, MDataBlock& data)
 
 	return MS::kSuccess;
 }
-
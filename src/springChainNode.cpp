@@ -0,0 +1,318 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// INCLUDE
+/////////////////////////////////////////////////
+#include "mgear_solvers.h"
+
+#include <maya/MArrayDataHandle.h>
+#include <maya/MArrayDataBuilder.h>
+
+/////////////////////////////////////////////////
+// GLOBAL
+/////////////////////////////////////////////////
+MTypeId		mgear_springChainNode::id(0x0011FED1);
+
+//Static variables
+
+MObject mgear_springChainNode::aOutput;
+MObject mgear_springChainNode::aGoal;
+
+MObject mgear_springChainNode::aDamping;
+MObject mgear_springChainNode::aStiffness;
+MObject mgear_springChainNode::aTime;
+MObject mgear_springChainNode::aSpringIntensity;
+MObject mgear_springChainNode::aSubsteps;
+MObject mgear_springChainNode::aIterations;
+MObject mgear_springChainNode::aCacheSize;
+
+
+mgear_springChainNode::mgear_springChainNode(){}
+mgear_springChainNode::~mgear_springChainNode(){}
+
+mgear_springChainNode::SchedulingType mgear_springChainNode::schedulingType() const
+{
+	return kParallel;
+}
+
+void* mgear_springChainNode::creator()
+{
+	return new mgear_springChainNode();
+}
+
+#if MAYA_API_VERSION >= 20200000
+// let the background evaluation cache the chain as a simulation
+void mgear_springChainNode::getCacheSetup(const MEvaluationNode& evalNode, MNodeCacheDisablingInfo& disablingInfo, MNodeCacheSetupInfo& cacheSetupInfo, MObjectArray& monitoredAttributes) const
+{
+	MPxNode::getCacheSetup(evalNode, disablingInfo, cacheSetupInfo, monitoredAttributes);
+	cacheSetupInfo.setPreference(MNodeCacheSetupInfo::kWantToCacheByDefault, true);
+	cacheSetupInfo.setRequirement(MNodeCacheSetupInfo::kSimulationSupport, true);
+}
+#endif
+
+bool s_SpringChainTraits::equivalent(const MVectorArray& a, const MVectorArray& b)
+{
+	if (a.length() != b.length())
+		return false;
+	for (unsigned i = 0; i < a.length(); i++) {
+		if (!a[i].isEquivalent(b[i], 1.0e-9))
+			return false;
+	}
+	return true;
+}
+
+MVectorArray s_SpringChainTraits::rigidVelocity(const MVectorArray& from, const MVectorArray& to, double frames)
+{
+	MVectorArray velocity(to.length());
+	for (unsigned i = 0; i < to.length(); i++)
+		velocity[i] = (to[i] - from[i]) / frames;
+	return velocity;
+}
+
+void s_SpringChainTraits::interpolate(const MVectorArray& a, const MVectorArray& b, double blend, MVectorArray& out)
+{
+	for (unsigned i = 0; i < out.length(); i++)
+		out[i] = linearInterpolate(a[i], b[i], blend);
+}
+
+// One step of the chain: spring every particle but the root toward its goal,
+// then relax the segment lengths to the goal lengths.
+void s_SpringChainTraits::step(const MVectorArray& goal, MVectorArray& position, MVectorArray& velocity, const s_SpringCoefficients& coef, double h) const
+{
+	unsigned count = position.length();
+	if (count == 0)
+		return;
+	MVectorArray predicted(count);
+
+	// the root is pinned to its goal
+	predicted[0] = goal[0];
+	for (unsigned i = 1; i < count; i++) {
+		MVector v = springVelocity(velocity[i], goal[i] - position[i], coef, h);
+		predicted[i] = position[i] + v * h;
+	}
+
+	// Gauss-Seidel relaxation of the distance constraints
+	for (int it = 0; it < iterations; it++) {
+		for (unsigned i = 0; i + 1 < count; i++) {
+			double rest = (goal[i + 1] - goal[i]).length();
+			MVector d = predicted[i + 1] - predicted[i];
+			double length = d.length();
+			if (length < 1.0e-12)
+				continue;
+			MVector correction = d * ((length - rest) / length);
+			if (i == 0)
+				predicted[i + 1] -= correction;
+			else {
+				predicted[i] += correction * 0.5;
+				predicted[i + 1] -= correction * 0.5;
+			}
+		}
+	}
+
+	// verlet, the velocity is whatever the particle really travelled
+	for (unsigned i = 0; i < count; i++) {
+		velocity[i] = (predicted[i] - position[i]) / h;
+		position[i] = predicted[i];
+	}
+}
+
+//INIT
+MStatus mgear_springChainNode::initialize()
+{
+	MStatus status;
+	MFnNumericAttribute nAttr;
+	MFnUnitAttribute uAttr;
+	MFnMatrixAttribute mAttr;
+
+	aOutput = mAttr.create("output", "out");
+	mAttr.setArray(true);
+	mAttr.setUsesArrayDataBuilder(true);
+	mAttr.setWritable(false);
+	mAttr.setStorable(false);
+	mAttr.setReadable(true);
+	addAttribute(aOutput);
+
+	aGoal = mAttr.create("goal", "goal");
+	mAttr.setArray(true);
+	mAttr.setStorable(true);
+	mAttr.setReadable(false);
+	addAttribute(aGoal);
+	attributeAffects(aGoal, aOutput);
+
+	aTime = uAttr.create("time", "time", MFnUnitAttribute::kTime, 0.0f);
+	addAttribute(aTime);
+	attributeAffects(aTime, aOutput);
+
+	aStiffness = nAttr.create("stiffness", "stiffness", MFnNumericData::kFloat, 1.0f);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0f);
+	nAttr.setMax(1.0f);
+	addAttribute(aStiffness);
+	attributeAffects(aStiffness, aOutput);
+
+	aDamping = nAttr.create("damping", "damping", MFnNumericData::kFloat, 1.0f);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0f);
+	nAttr.setMax(1.0f);
+	addAttribute(aDamping);
+	attributeAffects(aDamping, aOutput);
+
+	aSpringIntensity = nAttr.create("intensity", "intensity", MFnNumericData::kFloat, 1.0f);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0.0f);
+	nAttr.setMax(1.0f);
+	addAttribute(aSpringIntensity);
+	attributeAffects(aSpringIntensity, aOutput);
+
+	aSubsteps = nAttr.create("substeps", "substeps", MFnNumericData::kShort, 4);
+	nAttr.setKeyable(true);
+	nAttr.setMin(1);
+	nAttr.setSoftMax(16);
+	addAttribute(aSubsteps);
+	attributeAffects(aSubsteps, aOutput);
+
+	// relaxation passes over the length constraints per substep
+	aIterations = nAttr.create("iterations", "iterations", MFnNumericData::kShort, 4);
+	nAttr.setKeyable(true);
+	nAttr.setMin(0);
+	nAttr.setSoftMax(20);
+	addAttribute(aIterations);
+	attributeAffects(aIterations, aOutput);
+
+	// number of evaluated frames kept in memory, 0 disables the cache, see
+	// springNode.cpp for when it is dropped
+	aCacheSize = nAttr.create("cacheSize", "cacheSize", MFnNumericData::kInt, 1000);
+	nAttr.setMin(0);
+	addAttribute(aCacheSize);
+
+	return MS::kSuccess;
+}
+
+// COMPUTE
+
+MStatus mgear_springChainNode::compute(const MPlug& plug, MDataBlock& data)
+{
+	MStatus status;
+
+	if (plug != aOutput && !(plug.isElement() && plug.array() == aOutput))
+	{
+		return MS::kUnknownParameter;
+	}
+
+	mgear_ProfileScope profileScope(this, "mgear_springChainNode", plug);
+
+	// getting inputs attributes
+	float damping = data.inputValue(aDamping, &status).asFloat();
+	float stiffness = data.inputValue(aStiffness, &status).asFloat();
+
+	MArrayDataHandle adh = data.inputArrayValue(aGoal, &status);
+	McheckStatusAndReturnIt(status);
+	unsigned count = adh.elementCount();
+	MMatrixArray goalMatrices(count);
+	MVectorArray goal(count);
+	// the goal array can be sparse, each output goes to the index of its goal
+	std::vector<unsigned> indices(count);
+	for (unsigned i = 0; i < count; i++) {
+		adh.jumpToArrayElement(i);
+		indices[i] = adh.elementIndex();
+		goalMatrices[i] = adh.inputValue().asMatrix();
+		goal[i] = MVector(goalMatrices[i][3][0], goalMatrices[i][3][1], goalMatrices[i][3][2]);
+	}
+
+	MTime currentTime = data.inputValue(aTime, &status).asTime();
+	float springIntensity = data.inputValue(aSpringIntensity, &status).asFloat();
+	int substeps = std::max(1, (int)data.inputValue(aSubsteps, &status).asShort());
+	int iterations = std::max(0, (int)data.inputValue(aIterations, &status).asShort());
+	unsigned cacheSize = (unsigned)std::max(0, data.inputValue(aCacheSize, &status).asInt());
+
+	// nothing to simulate, the next goals start over
+	if (count == 0) {
+		_simulation.reset();
+		MArrayDataHandle outputHandle = data.outputArrayValue(aOutput, &status);
+		McheckStatusAndReturnIt(status);
+		MArrayDataBuilder builder = outputHandle.builder(&status);
+		McheckStatusAndReturnIt(status);
+		removeElementsFrom(outputHandle, builder, 0);
+		outputHandle.set(builder);
+		outputHandle.setAllClean();
+		data.setClean(plug);
+		return MS::kSuccess;
+	}
+
+	// same time handling as mgear_springNode, see springNode.cpp
+	double currentFrame = currentTime.as(MTime::uiUnit());
+
+	// a different number of particles invalidates the whole simulation
+	if (_simulation.state().position.length() != count)
+		_simulation.reset();
+
+	s_SpringChainTraits traits;
+	traits.iterations = iterations;
+	s_SpringSettings settings = { stiffness, damping, substeps, iterations };
+	MVectorArray newPosition = _simulation.evaluate(traits, goal, currentFrame, settings, cacheSize);
+
+	// blend with the goals by the spring intensity, after storing the states
+	for (unsigned i = 0; i < count; i++)
+		newPosition[i] = goal[i] + ((newPosition[i] - goal[i]) * springIntensity);
+
+	// Output: each goal frame rotated so its segment aims at the simulated
+	// position of the next particle, the last one following its parent segment.
+	MArrayDataHandle outputHandle = data.outputArrayValue(aOutput, &status);
+	McheckStatusAndReturnIt(status);
+	MArrayDataBuilder builder = outputHandle.builder(&status);
+	McheckStatusAndReturnIt(status);
+	for (unsigned i = 0; i < count; i++) {
+		MMatrix result = goalMatrices[i];
+		result[3][0] = 0.0;
+		result[3][1] = 0.0;
+		result[3][2] = 0.0;
+		if (count > 1) {
+			unsigned a = (i + 1 < count) ? i : i - 1;
+			MVector goalAim = goal[a + 1] - goal[a];
+			MVector simAim = newPosition[a + 1] - newPosition[a];
+			if (goalAim.length() > 1.0e-12 && simAim.length() > 1.0e-12)
+				result *= goalAim.rotateTo(simAim).asMatrix();
+		}
+		result[3][0] = newPosition[i].x;
+		result[3][1] = newPosition[i].y;
+		result[3][2] = newPosition[i].z;
+
+		MDataHandle h = builder.addElement(indices[i]);
+		h.setMMatrix(result);
+	}
+	removeElementsNotIn(outputHandle, builder, adh);
+	outputHandle.set(builder);
+	outputHandle.setAllClean();
+	data.setClean(plug);
+
+	return MS::kSuccess;
+
+}
@@ -51,6 +51,8 @@ MObject mgear_springNode::aStiffness;
 MObject mgear_springNode::aTime;
 //MObject mgear_springNode::aParentInverse;
 MObject mgear_springNode::aSpringIntensity;
+MObject mgear_springNode::aSubsteps;
+MObject mgear_springNode::aCacheSize;
 
 
 mgear_springNode::mgear_springNode(){}
@@ -66,7 +68,15 @@ void* mgear_springNode::creator()
 	return new mgear_springNode();
 }
 
-
+#if MAYA_API_VERSION >= 20200000
+// let the background evaluation cache the spring as a simulation
+void mgear_springNode::getCacheSetup(const MEvaluationNode& evalNode, MNodeCacheDisablingInfo& disablingInfo, MNodeCacheSetupInfo& cacheSetupInfo, MObjectArray& monitoredAttributes) const
+{
+	MPxNode::getCacheSetup(evalNode, disablingInfo, cacheSetupInfo, monitoredAttributes);
+	cacheSetupInfo.setPreference(MNodeCacheSetupInfo::kWantToCacheByDefault, true);
+	cacheSetupInfo.setRequirement(MNodeCacheSetupInfo::kSimulationSupport, true);
+}
+#endif
 
 //INIT
 MStatus mgear_springNode::initialize()
@@ -116,6 +126,25 @@ MStatus mgear_springNode::initialize()
 	addAttribute(aSpringIntensity);
 	attributeAffects(aSpringIntensity, aOutput);
 
+	aSubsteps = nAttr.create("substeps", "substeps", MFnNumericData::kShort, 4);
+	nAttr.setKeyable(true);
+	nAttr.setMin(1);
+	nAttr.setSoftMax(16);
+	addAttribute(aSubsteps);
+	attributeAffects(aSubsteps, aOutput);
+
+	// Number of evaluated frames kept in memory, 0 disables the cache.
+	// Every cached frame depends on the goal at all the frames before it. A
+	// goal that changed at a visited frame, or a changed setting, drops the
+	// whole cache. Simulating a frame that wasn't cached, on the way back
+	// after a jump ahead, drops the cached frames after it. An upstream edit that only changes the goal at frames
+	// not visited since (a key moved before the current time) can't be
+	// seen: the later frames stay cached until one of them is revisited
+	// with another goal. Evaluating a frame with cacheSize at 0 flushes it.
+	aCacheSize = nAttr.create("cacheSize", "cacheSize", MFnNumericData::kInt, 1000);
+	nAttr.setMin(0);
+	addAttribute(aCacheSize);
+
 	/*aParentInverse = mAttr.create("parentInverse", "parentInverse");
 	mAttr.setStorable(true);
 	mAttr.setKeyable(true);
@@ -139,6 +168,8 @@ MStatus mgear_springNode::compute(const MPlug& plug, MDataBlock& data)
 		return MS::kUnknownParameter;
 	}
 
+	mgear_ProfileScope profileScope(this, "mgear_springNode", plug);
+
 
 
 	// getting inputs attributes
@@ -159,42 +190,17 @@ MStatus mgear_springNode::compute(const MPlug& plug, MDataBlock& data)
 	MTime currentTime = data.inputValue(aTime, &status).asTime();
 	//MMatrix parentInverse = data.inputValue(aParentInverse, &status).asMatrix();
 	float springIntensity = data.inputValue(aSpringIntensity, &status).asFloat();
+	int substeps = std::max(1, (int)data.inputValue(aSubsteps, &status).asShort());
+	unsigned cacheSize = (unsigned)std::max(0, data.inputValue(aCacheSize, &status).asInt());
 
-
-	if (_initialized == false) {
-		// Initialize the point states
-		//MGlobal::displayInfo( "mc_spring: Initialize the point states" );
-		_previousPosition = goal;
-		_currentPosition = goal;
-		_previousTime = currentTime;
-		_initialized = true;
-		//return MS::kSuccess;
-	}
-	// Check if the timestep is just 1 frame since we want a stable simulation
-	double timeDifference = currentTime.value() - _previousTime.value();
-	if (timeDifference > 1.0 || timeDifference < 0.0) {
-		_initialized = false;
-		_previousPosition = goal;
-		_currentPosition = goal;
-		_previousTime = currentTime;
-		//MGlobal::displayInfo( "mc_spring: time checker, reset position" );
-		//return MS::kSuccess;
-	}
-
-	// computation
-	MFloatVector velocity = (_currentPosition - _previousPosition) * (1.0 - damping);
-	MVector newPosition = _currentPosition + velocity;
-	MFloatVector goalForce = (goal - newPosition) * stiffness;
-	newPosition += goalForce;
-
-	// store the states for the next calculation
-	_previousPosition = _currentPosition;
-	_currentPosition = newPosition;
-	_previousTime = currentTime;
+	// we simulate in frames so the sliders behave the same whatever the playback step is
+	double currentFrame = currentTime.as(MTime::uiUnit());
 
 	//multipply the position by the spring intensity
 	//calculamos depues de los states, para no afectarlos
-	newPosition = goal + ((newPosition - goal) * springIntensity);
+	double g[3] = { goal.x, goal.y, goal.z };
+	double newPosition[3];
+	springNode(_simulation, g, currentFrame, stiffness, damping, springIntensity, substeps, cacheSize, newPosition);
 
 	//Setting the output in local space
 	// esto lo hacemos depues de hacer el store de los states
@@ -204,7 +210,7 @@ MStatus mgear_springNode::compute(const MPlug& plug, MDataBlock& data)
 
 	MDataHandle hOutput = data.outputValue(aOutput, &status);
 	McheckStatusAndReturnIt(status);
-	hOutput.set3Float(newPosition.x, newPosition.y, newPosition.z);
+	hOutput.set3Float((float)newPosition[0], (float)newPosition[1], (float)newPosition[2]);
 	hOutput.setClean();
 	data.setClean(plug);
 
@@ -32,6 +32,8 @@ Date:       2016 / 10 / 10
 /////////////////////////////////////////////////
 #include "mgear_solvers.h"
 
+#include <maya/MArrayDataBuilder.h>
+
 /////////////////////////////////////////////////
 // GLOBAL
 /////////////////////////////////////////////////
@@ -54,7 +56,14 @@ MObject mgear_squashStretch2::axis;
 MObject mgear_squashStretch2::squash;
 MObject mgear_squashStretch2::stretch;
 
+MObject mgear_squashStretch2::count;
+MObject mgear_squashStretch2::profile;
+MObject mgear_squashStretch2::profile_position;
+MObject mgear_squashStretch2::profile_value;
+MObject mgear_squashStretch2::profile_interp;
+
 MObject mgear_squashStretch2::output;
+MObject mgear_squashStretch2::outputs;
 
 mgear_squashStretch2::mgear_squashStretch2() {} // constructor
 mgear_squashStretch2::~mgear_squashStretch2() {} // destructor
@@ -149,6 +158,23 @@ MStatus mgear_squashStretch2::initialize()
     stat = addAttribute( stretch );
 		if (!stat) {stat.perror("addAttribute"); return stat;}
 
+	// Chain mode, count scales with the squash and stretch weighted by the
+	// profile ramp at i / (count - 1)
+	count = nAttr.create("count", "c", MFnNumericData::kInt, 0);
+	nAttr.setStorable(true);
+	nAttr.setKeyable(false);
+	nAttr.setMin(0);
+    stat = addAttribute( count );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	profile = MRampAttribute::createCurveRamp("profile", "prof");
+    stat = addAttribute( profile );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+	MFnCompoundAttribute profileAttr( profile );
+	profile_position = profileAttr.child(0);
+	profile_value = profileAttr.child(1);
+	profile_interp = profileAttr.child(2);
+
 	// Outputs
 	output = nAttr.createPoint("output", "out" );
     nAttr.setWritable(false);
@@ -156,6 +182,15 @@ MStatus mgear_squashStretch2::initialize()
     nAttr.setReadable(true);
     addAttribute( output );
 
+	outputs = nAttr.createPoint("outputs", "outs" );
+	nAttr.setArray(true);
+	nAttr.setUsesArrayDataBuilder(true);
+    nAttr.setWritable(false);
+    nAttr.setStorable(false);
+    nAttr.setReadable(true);
+    stat = addAttribute( outputs );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
 	// Connections
     stat = attributeAffects ( global_scale, output );
 		if (!stat) {stat.perror("attributeAffects"); return stat;}
@@ -176,6 +211,12 @@ MStatus mgear_squashStretch2::initialize()
     stat = attributeAffects ( stretch, output );
 		if (!stat) {stat.perror("attributeAffects"); return stat;}
 
+	MObject chainInputs[] = { global_scale, blend, driver, driver_min, driver_ctr, driver_max, axis, squash, stretch, count, profile };
+	for (unsigned i = 0; i < sizeof(chainInputs) / sizeof(chainInputs[0]); i++){
+		stat = attributeAffects ( chainInputs[i], outputs );
+			if (!stat) {stat.perror("attributeAffects"); return stat;}
+	}
+
 
    return MS::kSuccess;
 }
@@ -184,14 +225,14 @@ MStatus mgear_squashStretch2::compute(const MPlug& plug, MDataBlock& data)
 {
 	MStatus returnStatus;
 	// Error check
-    if (plug != output)
+    if (plug != output && plug != outputs)
         return MS::kUnknownParameter;
 
+    mgear_ProfileScope profileScope(this, "mgear_squashStretch2", plug);
+
 	// Inputs
     MVector gscale = data.inputValue( global_scale ).asFloatVector();
-	double sx = gscale.x;
-	double sy = gscale.y;
-	double sz = gscale.z;
+	double gs[3] = { gscale.x, gscale.y, gscale.z };
 
 	// Sliders
 	double in_blend = (double)data.inputValue( blend ).asFloat();
@@ -207,29 +248,66 @@ MStatus mgear_squashStretch2::compute(const MPlug& plug, MDataBlock& data)
     in_st *= clamp(std::max(in_driver - in_dctr, 0.0) / std::max(in_dmax - in_dctr, 0.0001), 0.0, 1.0);
     in_sq *= clamp(std::max(in_dctr - in_driver, 0.0) / std::max(in_dctr - in_dmin, 0.0001), 0.0, 1.0);
 
-    if (in_axis != 0)
-        sx *= std::max( 0.0, 1.0 + in_sq + in_st );
-
-    if (in_axis != 1)
-        sy *= std::max( 0.0, 1.0 + in_sq + in_st );
-
-    if (in_axis != 2)
-        sz *= std::max( 0.0, 1.0 + in_sq + in_st );
-
-    MVector scl = MVector(sx, sy, sz);
-    scl = linearInterpolate(gscale, scl, in_blend);
-
-	double clamp_value = 0.0001;
-
-	double scl_x = std::max(scl.x, clamp_value);
-	double scl_y = std::max(scl.y, clamp_value);
-	double scl_z = std::max(scl.z, clamp_value);
+	if (plug == outputs){
+		int in_count = data.inputValue( count ).asInt();
+
+		// The ramp entries are read through the data block, so a connected
+		// ramp is up to date, and compared with the ones the table was
+		// sampled from. The ramp is only sampled again, at the joints, when
+		// an entry or the count changed. An empty ramp weights every joint
+		// by 1.
+		MArrayDataHandle rampHandle = data.inputArrayValue( profile );
+		unsigned entryCount = rampHandle.elementCount();
+		bool changed = _profileLut.size() != (size_t)std::max(in_count, 0) || _profileEntries.size() != entryCount * 3;
+		_profileEntries.resize(entryCount * 3);
+		for (unsigned i = 0; i < entryCount; i++){
+			rampHandle.jumpToArrayElement(i);
+			MDataHandle h = rampHandle.inputValue();
+			float entry[3] = { h.child( profile_position ).asFloat(), h.child( profile_value ).asFloat(), (float)h.child( profile_interp ).asShort() };
+			for (unsigned j = 0; j < 3; j++){
+				if (_profileEntries[i * 3 + j] != entry[j]){
+					_profileEntries[i * 3 + j] = entry[j];
+					changed = true;
+				}
+			}
+		}
+		if (changed){
+			_profileLut.assign(std::max(in_count, 0), 1.0f);
+			if (entryCount > 0){
+				MRampAttribute ramp( thisMObject(), profile );
+				for (int i = 0; i < in_count; i++)
+					ramp.getValueAtPosition((in_count > 1) ? float(i) / float(in_count - 1) : 0.5f, _profileLut[i]);
+			}
+		}
+
+		std::vector<double> amounts(std::max(in_count, 0));
+		for (int i = 0; i < in_count; i++)
+			amounts[i] = (double)_profileLut[i] * (in_sq + in_st);
+		std::vector<double> scl(amounts.size() * 3);
+		if (in_count > 0)
+			squashStretchArray(in_axis, gs, &amounts[0], in_count, in_blend, (double(*)[3])&scl[0]);
+
+		MArrayDataHandle outHandle = data.outputArrayValue( outputs );
+		MArrayDataBuilder builder = outHandle.builder();
+		for (int i = 0; i < in_count; i++){
+			MDataHandle h = builder.addElement(i);
+			h.set3Float((float)scl[i * 3], (float)scl[i * 3 + 1], (float)scl[i * 3 + 2]);
+		}
+		removeElementsFrom(outHandle, builder, (unsigned)std::max(in_count, 0));
+		outHandle.set(builder);
+		outHandle.setAllClean();
+
+		return MS::kSuccess;
+	}
+
+	double amount = in_sq + in_st;
+	double scl[1][3];
+	squashStretchArray(in_axis, gs, &amount, 1, in_blend, scl);
 
 	// Output
 	MDataHandle h = data.outputValue(output);
-	h.set3Float((float)scl_x, (float)scl_y, (float)scl_z);
+	h.set3Float((float)scl[0][0], (float)scl[0][1], (float)scl[0][2]);
 	data.setClean(plug);
 
 	return MS::kSuccess;
 }
-
@@ -41,7 +41,14 @@ MTypeId mgear_trigonometryAngle::id(0x0011FEEC);
 
 MObject mgear_trigonometryAngle::trigoOperation;
 MObject mgear_trigonometryAngle::angle;
+MObject mgear_trigonometryAngle::inputY;
+MObject mgear_trigonometryAngle::inputX;
+MObject mgear_trigonometryAngle::angleArray;
+MObject mgear_trigonometryAngle::inputXArray;
 MObject mgear_trigonometryAngle::output;
+MObject mgear_trigonometryAngle::outputB;
+MObject mgear_trigonometryAngle::outputArray;
+MObject mgear_trigonometryAngle::outputArrayB;
 
 mgear_trigonometryAngle::mgear_trigonometryAngle() {} // constructor
 mgear_trigonometryAngle::~mgear_trigonometryAngle() {} // destructor
@@ -66,6 +73,8 @@ MStatus mgear_trigonometryAngle::initialize()
 {
    MFnNumericAttribute nAttr;
    MFnEnumAttribute eAttr;
+   MFnTypedAttribute tAttr;
+   MFnDoubleArrayData doubleArrayFn;
    MStatus stat;
    MFnUnitAttribute uAttr;
 
@@ -73,6 +82,9 @@ MStatus mgear_trigonometryAngle::initialize()
     trigoOperation = eAttr.create( "operation", "op", 0 );
     eAttr.addField("sine", 0);
     eAttr.addField("cosine", 1);
+    eAttr.addField("tangent", 2);
+    eAttr.addField("atan2", 3);
+    eAttr.addField("sincos", 4);
     eAttr.setWritable(true);
     eAttr.setStorable(true);
     eAttr.setReadable(true);
@@ -86,6 +98,30 @@ MStatus mgear_trigonometryAngle::initialize()
 	uAttr.setKeyable(true);
 	addAttribute(angle);
 
+	// atan2 operands
+	inputY = nAttr.create("inputY", "inputY", MFnNumericData::kDouble, 0.0);
+	nAttr.setStorable(true);
+	nAttr.setKeyable(true);
+	stat = addAttribute( inputY );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	inputX = nAttr.create("inputX", "inputX", MFnNumericData::kDouble, 1.0);
+	nAttr.setStorable(true);
+	nAttr.setKeyable(true);
+	stat = addAttribute( inputX );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	// array mode, angles in radians. With atan2 these are the y values
+	angleArray = tAttr.create("angleArray", "angleArray", MFnData::kDoubleArray, doubleArrayFn.create(MDoubleArray()));
+	tAttr.setStorable(true);
+	stat = addAttribute( angleArray );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	inputXArray = tAttr.create("inputXArray", "inputXArray", MFnData::kDoubleArray, doubleArrayFn.create(MDoubleArray()));
+	tAttr.setStorable(true);
+	stat = addAttribute( inputXArray );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
     // Outputs
 	// MAngle output( (double)0.0, MAngle::kDegrees );
 	// nAttr.create("output", "output", output);
@@ -97,11 +133,43 @@ MStatus mgear_trigonometryAngle::initialize()
 	stat = addAttribute( output );
 		if (!stat) {stat.perror("addAttribute"); return stat;}
 
+	// the cosine of the sincos operation
+	outputB = nAttr.create("outputB", "outputB", MFnNumericData::kDouble);
+	nAttr.setWritable(false);
+	nAttr.setReadable(true);
+	nAttr.setKeyable(false);
+	stat = addAttribute( outputB );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	outputArray = tAttr.create("outputArray", "outputArray", MFnData::kDoubleArray, doubleArrayFn.create(MDoubleArray()));
+	tAttr.setWritable(false);
+	tAttr.setStorable(false);
+	tAttr.setReadable(true);
+	stat = addAttribute( outputArray );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
+	outputArrayB = tAttr.create("outputArrayB", "outputArrayB", MFnData::kDoubleArray, doubleArrayFn.create(MDoubleArray()));
+	tAttr.setWritable(false);
+	tAttr.setStorable(false);
+	tAttr.setReadable(true);
+	stat = addAttribute( outputArrayB );
+		if (!stat) {stat.perror("addAttribute"); return stat;}
+
 
     // Connections
 	stat = attributeAffects( trigoOperation, output );
 		if (!stat) { stat.perror("attributeAffects"); return stat;}
 	attributeAffects(angle, output);
+	attributeAffects(inputY, output);
+	attributeAffects(inputX, output);
+	attributeAffects(trigoOperation, outputB);
+	attributeAffects(angle, outputB);
+
+	attributeAffects(trigoOperation, outputArray);
+	attributeAffects(angleArray, outputArray);
+	attributeAffects(inputXArray, outputArray);
+	attributeAffects(trigoOperation, outputArrayB);
+	attributeAffects(angleArray, outputArrayB);
 
    return MS::kSuccess;
 }
@@ -110,26 +178,105 @@ MStatus mgear_trigonometryAngle::compute(const MPlug& plug, MDataBlock& data)
 {
 	MStatus returnStatus;
 
-	if( plug != output )
+	bool arrayOutput = plug == outputArray || plug == outputArrayB;
+	if( plug != output && plug != outputB && !arrayOutput )
 		return MS::kUnknownParameter;
 
+	mgear_ProfileScope profileScope(this, "mgear_trigonometryAngle", plug);
+	if( arrayOutput )
+		return computeArray(data);
+
 	// Input
 	short   in_trigoOperation = data.inputValue( trigoOperation ).asShort();
 	MAngle in_angle = data.inputValue(angle, &returnStatus).asAngle();
 
 
 	double val;
+	double valB = 0.0;
 	if (in_trigoOperation == 0)
 
 		val = sin(in_angle.asRadians());
-	else
+	else if (in_trigoOperation == 1)
 		val = cos(in_angle.asRadians());
+	else if (in_trigoOperation == 2)
+		val = tan(in_angle.asRadians());
+	else if (in_trigoOperation == 3)
+		val = atan2(data.inputValue(inputY).asDouble(), data.inputValue(inputX).asDouble());
+	else
+	{
+		val = sin(in_angle.asRadians());
+		valB = cos(in_angle.asRadians());
+	}
 
 	// Output
 	MDataHandle h_output = data.outputValue( output );
 	h_output.setDouble(val);
-	data.setClean(plug);
+	data.outputValue( outputB ).setDouble(valB);
+	data.setClean(output);
+	data.setClean(outputB);
 
 	return MS::kSuccess;
 }
 
+// Array mode: one sin and cos pass of the polynomial kernel over all the
+// angles, tangent and sincos are derived from that pass.
+MStatus mgear_trigonometryAngle::computeArray(MDataBlock& data)
+{
+	MStatus status;
+
+	// Input
+	short in_trigoOperation = data.inputValue( trigoOperation ).asShort();
+	MDoubleArray in_angles = MFnDoubleArrayData(data.inputValue(angleArray).data()).array();
+
+	unsigned count = in_angles.length();
+	std::vector<double> a(count), s(count), c(count);
+	if (count)
+		in_angles.get(&a[0]);
+
+	MDoubleArray out, outB;
+	if (in_trigoOperation == 3)
+	{
+		// atan2 has no polynomial kernel, pairs past the shortest array are dropped
+		MDoubleArray in_x = MFnDoubleArrayData(data.inputValue(inputXArray).data()).array();
+		count = std::min(count, in_x.length());
+		for (unsigned i = 0; i < count; i++)
+			s[i] = atan2(a[i], in_x[i]);
+		if (count)
+			out = MDoubleArray(&s[0], count);
+	}
+	else if (count)
+	{
+		sinCosArray(&a[0], count, &s[0], &c[0]);
+		if (in_trigoOperation == 0)
+			out = MDoubleArray(&s[0], count);
+		else if (in_trigoOperation == 1)
+			out = MDoubleArray(&c[0], count);
+		else if (in_trigoOperation == 2)
+		{
+			for (unsigned i = 0; i < count; i++)
+				s[i] /= c[i];
+			out = MDoubleArray(&s[0], count);
+		}
+		else
+		{
+			out = MDoubleArray(&s[0], count);
+			outB = MDoubleArray(&c[0], count);
+		}
+	}
+
+	// Output
+	MFnDoubleArrayData outFn;
+	MObject outData = outFn.create(out, &status);
+	McheckStatusAndReturnIt(status);
+	data.outputValue(outputArray).set(outData);
+
+	MFnDoubleArrayData outFnB;
+	MObject outDataB = outFnB.create(outB, &status);
+	McheckStatusAndReturnIt(status);
+	data.outputValue(outputArrayB).set(outDataB);
+
+	data.setClean(outputArray);
+	data.setClean(outputArrayB);
+
+	return MS::kSuccess;
+}
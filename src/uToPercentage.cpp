@@ -126,6 +126,8 @@ MStatus mgear_uToPercentage::compute(const MPlug& plug, MDataBlock& data)
     if (plug != percentage)
         return MS::kUnknownParameter;
 
+    mgear_ProfileScope profileScope(this, "mgear_uToPercentage", plug);
+
 	// Curve
    MObject crvObj = data.inputValue( curve ).asNurbsCurve();
 
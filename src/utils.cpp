@@ -59,7 +59,7 @@ MQuaternion e2q(double x, double y, double z){
     return MQuaternion(qx,qy,qz,qw);
 }
 
-MQuaternion slerp2(MQuaternion qA, MQuaternion qB, double blend){
+MQuaternion slerp2(const MQuaternion& qA, const MQuaternion& qB, double blend){
     
 	double dot = getDot(qA, qB);
         
@@ -110,7 +110,7 @@ int clamp(int d, int min_value, int max_value){
         return d;
 }
 
-double getDot(MQuaternion qA, MQuaternion qB){
+double getDot(const MQuaternion& qA, const MQuaternion& qB){
 
     double dot = qA.w * qB.w +
 				qA.x * qB.x + 
@@ -162,14 +162,13 @@ double uToNormalizedU(double u, int point_count){
 	return u / (point_count-3.0);
 }
 
-unsigned findClosestInArray(double value, MDoubleArray in_array){
+unsigned findClosestInArray(double value, const MDoubleArray& in_array){
    
 	double ref = 9999999999.999999;
 	unsigned index = (unsigned)-1;
 	double diff;
-	unsigned count = sizeof(in_array) / sizeof(double);
-	for(unsigned i = 0; i < count; i++){
-		diff = abs(in_array[i] - value);
+	for(unsigned i = 0; i < in_array.length(); i++){
+		diff = std::fabs(in_array[i] - value);
 		if (diff < ref){
 			ref = diff;
 			index = i;
@@ -186,7 +185,7 @@ double set01range(double value, double first, double second){
 double linearInterpolate(double first, double second, double blend){
         return first * (1-blend) + second * blend;
 }
-MVector linearInterpolate(MVector v0, MVector v1, double blend){
+MVector linearInterpolate(const MVector& v0, const MVector& v1, double blend){
 	MVector v;
 	v.x = linearInterpolate(v0.x, v1.x, blend);
 	v.y = linearInterpolate(v0.y, v1.y, blend);
@@ -195,7 +194,7 @@ MVector linearInterpolate(MVector v0, MVector v1, double blend){
     return v;
 }
 
-MVectorArray bezier4point( MVector a, MVector tan_a, MVector d, MVector tan_d, double u){
+s_BezierPoint bezier4point(const MVector& a, const MVector& tan_a, const MVector& d, const MVector& tan_d, double u){
 
     MVector b = a + tan_a;
     MVector c = -tan_d + d;
@@ -207,17 +206,15 @@ MVectorArray bezier4point( MVector a, MVector tan_a, MVector d, MVector tan_d, d
     MVector bccd = linearInterpolate(bc,cd,u);
     MVector abbcbccd = linearInterpolate(abbc,bccd,u);
 
-	MVector tan = bccd - abbc;
-	tan.normalize();
-
-	MVectorArray output(2);
-	output[0] = abbcbccd;
-	output[1] = tan;
+	s_BezierPoint output;
+	output.position = abbcbccd;
+	output.tangent = bccd - abbc;
+	output.tangent.normalize();
 
     return output;
 }
 
-MVector rotateVectorAlongAxis(MVector v, MVector axis, double a){
+MVector rotateVectorAlongAxis(const MVector& v, const MVector& axis, double a){
 
     // Angle as to be in radians
 
@@ -233,7 +230,7 @@ MVector rotateVectorAlongAxis(MVector v, MVector axis, double a){
     return MVector(q.x, q.y, q.z);
 }
 
-MQuaternion getQuaternionFromAxes(MVector vx, MVector vy, MVector vz){
+MQuaternion getQuaternionFromAxes(const MVector& vx, const MVector& vy, const MVector& vz){
 	
 	MMatrix m;
 	m[0][0] = vx.x;
@@ -246,27 +243,49 @@ MQuaternion getQuaternionFromAxes(MVector vx, MVector vy, MVector vz){
 	m[2][1] = vz.y;
 	m[2][2] = vz.z;
 
-	MTransformationMatrix t(m);
+	s_TRS trs;
+	decomposeTRS(m.matrix, trs);
 
-	return t.rotation();
+	return MQuaternion(trs.q[0], trs.q[1], trs.q[2], trs.q[3]);
 }
 
 
-MTransformationMatrix mapWorldPoseToObjectSpace(MTransformationMatrix objectSpace, MTransformationMatrix pose){
+MTransformationMatrix mapWorldPoseToObjectSpace(const MTransformationMatrix& objectSpace, const MTransformationMatrix& pose){
         return MTransformationMatrix(pose.asMatrix() * objectSpace.asMatrixInverse());
 }
 
-MTransformationMatrix  mapObjectPoseToWorldSpace(MTransformationMatrix objectSpace, MTransformationMatrix pose){
+MTransformationMatrix mapObjectPoseToWorldSpace(const MTransformationMatrix& objectSpace, const MTransformationMatrix& pose){
         return MTransformationMatrix(pose.asMatrix() * objectSpace.asMatrix());
 }
 
-MTransformationMatrix interpolateTransform(MTransformationMatrix xf1, MTransformationMatrix xf2, double blend){
+MTransformationMatrix transformFromTRS(const s_TRS& trs){
+
+	// set the components directly, no decomposition involved
+	MTransformationMatrix result;
+	result.setTranslation(MVector(trs.t[0], trs.t[1], trs.t[2]), MSpace::kWorld);
+	result.setRotationQuaternion(trs.q[0], trs.q[1], trs.q[2], trs.q[3]);
+	result.setScale(trs.s, MSpace::kWorld);
+	result.setShear(trs.sh, MSpace::kWorld);
+
+	return result;
+}
+
+MTransformationMatrix interpolateTransform(const MTransformationMatrix& xf1, const MTransformationMatrix& xf2, double blend, int mode){
 
     if (blend == 1.0)
         return xf2;
     else if (blend == 0.0)
         return xf1;
 
+    // dual quaternion and log modes, see mgear_math.h
+    if (mode != MGEAR_INTERPOLATE_SLERP){
+        s_TRS a, b, c;
+        decomposeTRS(xf1.asMatrix().matrix, a);
+        decomposeTRS(xf2.asMatrix().matrix, b);
+        interpolateTRSMode(a, b, blend, mode, c);
+        return transformFromTRS(c);
+    }
+
     // translate
     MVector t = linearInterpolate(xf1.getTranslation(MSpace::kWorld), xf2.getTranslation(MSpace::kWorld), blend);
 
@@ -295,3 +314,76 @@ MTransformationMatrix interpolateTransform(MTransformationMatrix xf1, MTransform
 }
 
 
+
+MVector springVelocity(const MVector& velocity, const MVector& offset, const s_SpringCoefficients& coef, double h){
+
+	// Backward Euler step of x'' = k * offset - c * x' over h frames.
+	// Unconditionally stable, so stiff springs don't explode with big steps.
+	return (velocity + offset * (h * coef.stiffness)) / (1.0 + h * coef.damping + h * h * coef.stiffness);
+}
+
+// The elements of an output array left from an evaluation with more
+// outputs. Call them on the builder of output before set().
+void removeElementsFrom(MArrayDataHandle& output, MArrayDataBuilder& builder, unsigned count){
+
+	unsigned n = output.elementCount();
+	for (unsigned i = 0; i < n; i++){
+		output.jumpToArrayElement(i);
+		unsigned index = output.elementIndex();
+		if (index >= count)
+			builder.removeElement(index);
+	}
+}
+
+void removeElementsNotIn(MArrayDataHandle& output, MArrayDataBuilder& builder, MArrayDataHandle& input){
+
+	unsigned n = output.elementCount();
+	for (unsigned i = 0; i < n; i++){
+		output.jumpToArrayElement(i);
+		unsigned index = output.elementIndex();
+		if (!input.jumpToElement(index))
+			builder.removeElement(index);
+	}
+}
+
+/////////////////////////////////////////////////
+// CURVE
+/////////////////////////////////////////////////
+s_CurveFn::s_CurveFn(const MObject& curve) : fn(curve){
+
+	MStatus status;
+	int cvs = fn.numCVs(&status);
+	valid = status == MS::kSuccess && cvs > fn.degree();
+}
+
+int s_CurveFn::cvCount() const{
+
+	return fn.numCVs();
+}
+
+void s_CurveFn::point(double u, double out[3]) const{
+
+	MPoint pt;
+	fn.getPointAtParam(u, pt, MSpace::kWorld);
+	out[0] = pt.x;
+	out[1] = pt.y;
+	out[2] = pt.z;
+}
+
+void s_CurveFn::tangent(double u, double out[3]) const{
+
+	MVector tan = fn.tangent(u);
+	out[0] = tan.x;
+	out[1] = tan.y;
+	out[2] = tan.z;
+}
+
+double s_CurveFn::length() const{
+
+	return fn.length();
+}
+
+double s_CurveFn::paramFromLength(double length) const{
+
+	return fn.findParamFromLength(length);
+}
@@ -134,6 +134,8 @@ MStatus mgear_vertexPosition::compute( const MPlug& plug, MDataBlock& data )
     MStatus returnStatus;
     if( plug == output )
     {
+        mgear_ProfileScope profileScope(this, "mgear_vertexPosition", plug);
+
         MDataHandle inputData =	data.inputValue( inputShape, &returnStatus );
         MDataHandle outputHandle = data.outputValue( mgear_vertexPosition::output );
         MDataHandle vertHandle = data.inputValue( vertexIndex, &returnStatus );
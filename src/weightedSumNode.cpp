@@ -0,0 +1,140 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+*/
+
+
+/////////////////////////////////////////////////
+// INCLUDE
+/////////////////////////////////////////////////
+#include "mgear_solvers.h"
+
+/////////////////////////////////////////////////
+// GLOBAL
+/////////////////////////////////////////////////
+MTypeId		mgear_weightedSumNode::id(0x0011FED3);
+
+//Static variables
+
+MObject		mgear_weightedSumNode::aOutValue;
+MObject		mgear_weightedSumNode::aInValue;
+MObject		mgear_weightedSumNode::aInWeight;
+
+
+mgear_weightedSumNode::mgear_weightedSumNode()
+{
+}
+
+mgear_weightedSumNode::~mgear_weightedSumNode()
+{
+}
+
+mgear_weightedSumNode::SchedulingType mgear_weightedSumNode::schedulingType() const
+{
+	return kParallel;
+}
+
+void* mgear_weightedSumNode::creator()
+{
+	return new mgear_weightedSumNode();
+}
+
+
+/// INIT
+MStatus mgear_weightedSumNode::initialize()
+{
+	MStatus status;
+	MFnNumericAttribute nAttr;
+
+	aOutValue = nAttr.create("outValue", "outValue", MFnNumericData::kFloat);
+	nAttr.setWritable(false);
+	nAttr.setStorable(false);
+	addAttribute(aOutValue);
+
+	aInValue = nAttr.create("inValue", "inValue", MFnNumericData::kFloat);
+	nAttr.setArray(true);
+	nAttr.setKeyable(true);
+	addAttribute(aInValue);
+	attributeAffects(aInValue, aOutValue);
+
+	// optional, matched to inValue by index. A missing weight counts as 1
+	aInWeight = nAttr.create("inWeight", "inWeight", MFnNumericData::kFloat, 1.0);
+	nAttr.setArray(true);
+	nAttr.setKeyable(true);
+	addAttribute(aInWeight);
+	attributeAffects(aInWeight, aOutValue);
+
+	return MS::kSuccess;
+}
+
+// COMPUTE
+
+MStatus mgear_weightedSumNode::compute(const MPlug& plug, MDataBlock& data)
+{
+	MStatus status;
+
+	if (plug != aOutValue)
+	{
+		return MS::kUnknownParameter;
+	}
+
+	mgear_ProfileScope profileScope(this, "mgear_weightedSumNode", plug);
+
+	// gather the values, and their weights when there are any
+	MArrayDataHandle hValues = data.inputArrayValue(aInValue, &status);
+	McheckStatusAndReturnIt(status);
+	MArrayDataHandle hWeights = data.inputArrayValue(aInWeight, &status);
+	McheckStatusAndReturnIt(status);
+
+	unsigned count = hValues.elementCount();
+	bool weighted = hWeights.elementCount() > 0;
+	std::vector<float> values(count);
+	std::vector<float> weights(weighted ? count : 0);
+	for (unsigned i = 0; i < count; i++)
+	{
+		hValues.jumpToArrayElement(i);
+		values[i] = hValues.inputValue().asFloat();
+		if (weighted)
+		{
+			if (hWeights.jumpToElement(hValues.elementIndex()))
+				weights[i] = hWeights.inputValue().asFloat();
+			else
+				weights[i] = 1.0f;
+		}
+	}
+
+	// making the calculation
+	float output = count ? weightedSum(&values[0], weighted ? &weights[0] : NULL, count) : 0.0f;
+
+	MDataHandle hOutput = data.outputValue(aOutValue, &status);
+	McheckStatusAndReturnIt(status);
+	hOutput.setFloat(output);
+	hOutput.setClean();
+	data.setClean(plug);
+
+	return MS::kSuccess;
+}
@@ -0,0 +1 @@
+#include "../mayashim.h"
@@ -0,0 +1,2914 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+/////////////////////////////////////////////////
+// INCLUDE
+/////////////////////////////////////////////////
+
+#include "mayashim.h"
+
+#include "mgear_kernels.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/////////////////////////////////////////////////
+// SHIM DATA
+/////////////////////////////////////////////////
+
+namespace mshim
+{
+	// The value of an attribute on a node. An array attribute holds its
+	// elements, a compound one (numeric ones included) its children.
+	struct Data
+	{
+		MObject attributeObject;
+		const Attribute* attr;
+		bool isArray;
+		double v[3];
+		MMatrix m;
+		MObject object;
+		std::vector<std::shared_ptr<Data> > children;
+		std::map<unsigned, std::shared_ptr<Data> > elements;
+
+		// what the handles return references to
+		MVector vector;
+		MFloatVector floatVector;
+		double3 double3Value;
+		float float3Value[3];
+		MFloatMatrix floatMatrix;
+
+		Data() : attr(0), isArray(false) { v[0] = v[1] = v[2] = 0.0; }
+	};
+
+	struct NodeType
+	{
+		std::string name;
+		MTypeId id;
+		void* (*creator)();
+		MPxNode::Type type;
+		std::vector<MObject> attributes;	// top level, in the order they were added
+		std::vector<std::pair<MObject, MObject> > affects;
+	};
+
+	struct Block
+	{
+		std::map<const Attribute*, std::shared_ptr<Data> > values;
+		Data* value(const Attribute* attr);
+	};
+
+	// A node, what thisMObject() points to
+	struct NodeObject : Object
+	{
+		NodeType* type;
+		std::string name;
+		std::unique_ptr<MPxNode> node;
+		Block block;
+	};
+
+	struct CurveData : Object
+	{
+		s_NurbsCurve curve;
+		s_NurbsEvaluator evaluator;
+		bool arcLength;
+
+		CurveData() : arcLength(false) { nurbsPrepare(curve, evaluator, false); }
+
+		// the arc length table is only built once a length is asked for
+		const s_NurbsEvaluator& lengths()
+		{
+			if (!arcLength) {
+				nurbsPrepare(curve, evaluator, true);
+				arcLength = true;
+			}
+			return evaluator;
+		}
+	};
+
+	struct MeshData : Object
+	{
+		MPointArray points;
+		MIntArray counts;
+		MIntArray connects;
+	};
+
+	struct MatrixData : Object { MMatrix m; };
+	struct DoubleArrayData : Object { MDoubleArray values; };
+	struct VectorArrayData : Object { MVectorArray values; };
+
+	struct Command
+	{
+		void* (*creator)();
+		MSyntax (*createSyntax)();
+	};
+
+	struct Access
+	{
+		static void setSelf(MPxNode* node, const std::shared_ptr<Object>& self) { node->self = self; }
+		static void setSyntax(MPxCommand* command, const MSyntax& syntax) { command->syntaxValue = syntax; }
+	};
+
+	static std::vector<std::unique_ptr<NodeType> > g_types;
+	static std::map<std::string, Command> g_commands;
+	static NodeType* g_initializing = 0;
+	static std::map<std::string, int> g_nodeCount;
+	static MString g_result;
+	static MTime::Unit g_uiUnit = MTime::kFilm;
+
+	static NodeObject* nodeObject(const MObject& node) { return dynamic_cast<NodeObject*>(node.get()); }
+
+	static NodeType* findType(const std::string& name)
+	{
+		for (size_t i = 0; i < g_types.size(); i++) {
+			if (g_types[i]->name == name)
+				return g_types[i].get();
+		}
+		return 0;
+	}
+
+	// Keeps v to the precision of the attribute
+	static double precision(const Attribute* attr, double v)
+	{
+		if (!attr || attr->kind == kEnum)
+			return attr ? (double)(short)v : v;
+		if (attr->kind != kNumeric)
+			return v;
+		switch (attr->type) {
+			case MFnNumericData::kBoolean: return v != 0.0 ? 1.0 : 0.0;
+			case MFnNumericData::kByte: return (double)(unsigned char)v;
+			case MFnNumericData::kChar: return (double)(char)v;
+			case MFnNumericData::kShort: case MFnNumericData::k2Short: case MFnNumericData::k3Short: return (double)(short)v;
+			case MFnNumericData::kLong: case MFnNumericData::k2Long: case MFnNumericData::k3Long: return (double)(int)v;
+			case MFnNumericData::kFloat: case MFnNumericData::k2Float: case MFnNumericData::k3Float: return (double)(float)v;
+			default: return v;
+		}
+	}
+
+	static std::shared_ptr<Data> createData(const MObject& attributeObject, bool element)
+	{
+		std::shared_ptr<Data> d(new Data());
+		const Attribute* attr = attribute(attributeObject);
+		d->attributeObject = attributeObject;
+		d->attr = attr;
+		if (attr->array && !element) {
+			d->isArray = true;
+			return d;
+		}
+		for (int i = 0; i < 3; i++)
+			d->v[i] = precision(attr, attr->defaults[i]);
+		for (int i = 0; i < 16; i++)
+			d->m.matrix[i / 4][i % 4] = attr->kind == kMatrix && attr->type == MFnMatrixAttribute::kFloat
+				? (double)(float)attr->defaultMatrix[i / 4][i % 4] : attr->defaultMatrix[i / 4][i % 4];
+		d->object = attr->defaultData;
+		for (size_t i = 0; i < attr->children.size(); i++)
+			d->children.push_back(createData(attr->children[i], false));
+		return d;
+	}
+
+	static std::shared_ptr<Data> copyData(const Data& other)
+	{
+		std::shared_ptr<Data> d(new Data(other));
+		for (size_t i = 0; i < d->children.size(); i++)
+			d->children[i] = copyData(*other.children[i]);
+		for (std::map<unsigned, std::shared_ptr<Data> >::iterator it = d->elements.begin(); it != d->elements.end(); ++it)
+			it->second = copyData(*it->second);
+		return d;
+	}
+
+	static Data* element(Data* d, unsigned index)
+	{
+		std::shared_ptr<Data>& e = d->elements[index];
+		if (!e)
+			e = createData(d->attributeObject, true);
+		return e.get();
+	}
+
+	// What the value accessors work on, the first element of an array
+	static Data* leaf(Data* d)
+	{
+		if (d && d->isArray)
+			return d->elements.empty() ? element(d, 0) : d->elements.begin()->second.get();
+		return d;
+	}
+
+	static Data* child(Data* d, const Attribute* attr)
+	{
+		d = leaf(d);
+		if (!d)
+			return 0;
+		for (size_t i = 0; i < d->children.size(); i++) {
+			if (d->children[i]->attr == attr)
+				return d->children[i].get();
+		}
+		return 0;
+	}
+
+	Data* Block::value(const Attribute* attr)
+	{
+		if (attr->parent)
+			return child(value(attr->parent), attr);
+		std::map<const Attribute*, std::shared_ptr<Data> >::iterator it = values.find(attr);
+		if (it == values.end())
+			return 0;
+		return it->second.get();
+	}
+
+	static Data* value(Block* block, const MPlug& plug)
+	{
+		const Attribute* attr = attribute(plug.attribute());
+		if (!attr)
+			return 0;
+		Data* d;
+		if (plug.shimParent())
+			d = child(value(block, *plug.shimParent()), attr);
+		else
+			d = block->value(attr);
+		if (d && plug.shimIndex() >= 0 && d->isArray)
+			d = element(d, (unsigned)plug.shimIndex());
+		return d;
+	}
+
+	static Block* block(const MObject& node)
+	{
+		NodeObject* n = nodeObject(node);
+		return n ? &n->block : 0;
+	}
+
+	static void collect(const MObject& attribute, std::vector<MObject>& out)
+	{
+		out.push_back(attribute);
+		const Attribute* attr = mshim::attribute(attribute);
+		for (size_t i = 0; i < attr->children.size(); i++)
+			collect(attr->children[i], out);
+	}
+
+	static MObject createAttribute(const MString& name, const MString& shortName, AttributeKind kind, int type)
+	{
+		std::shared_ptr<Attribute> attr(new Attribute());
+		attr->name = name.asChar();
+		attr->shortName = shortName.asChar();
+		attr->kind = kind;
+		attr->type = type;
+		return MObject(attr);
+	}
+
+	static void addChild(const MObject& parent, const MObject& child)
+	{
+		attribute(parent)->children.push_back(child);
+		attribute(child)->parent = attribute(parent);
+	}
+
+	// Euler angles of the rotation rows m for an order of axes i, j, k
+	// (rotating about i first), Shoemake's decomposition of the transposed
+	// matrix
+	static void eulerFromRotation(const double m[3][3], int i, int j, int k, double out[3])
+	{
+		bool parity = j != (i + 1) % 3;
+		// column convention R = m^T, R[a][b] = m[b][a]
+		double cy = std::sqrt(m[i][i] * m[i][i] + m[i][j] * m[i][j]);
+		double ax, ay, az;
+		if (cy > 16.0 * 2.220446049250313e-16) {
+			ax = std::atan2(m[j][k], m[k][k]);
+			ay = std::atan2(-m[i][k], cy);
+			az = std::atan2(m[i][j], m[i][i]);
+		}
+		else {
+			ax = std::atan2(-m[k][j], m[j][j]);
+			ay = std::atan2(-m[i][k], cy);
+			az = 0.0;
+		}
+		if (parity) {
+			ax = -ax;
+			ay = -ay;
+			az = -az;
+		}
+		out[i] = ax;
+		out[j] = ay;
+		out[k] = az;
+	}
+
+	static const int g_eulerAxes[6][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 0, 2, 1 }, { 1, 0, 2 }, { 2, 1, 0 } };
+
+	static bool rayTriangle(const MPoint& o, const MVector& d, const MPoint& a, const MPoint& b, const MPoint& c, double tolerance,
+		double& t, double& u, double& v)
+	{
+		// Moller-Trumbore
+		MVector e1 = b - a;
+		MVector e2 = c - a;
+		MVector p = d ^ e2;
+		double det = e1 * p;
+		if (std::fabs(det) < 1.0e-12)
+			return false;
+		double inv = 1.0 / det;
+		MVector s = o - a;
+		u = (s * p) * inv;
+		if (u < -tolerance || u > 1.0 + tolerance)
+			return false;
+		MVector q = s ^ e1;
+		v = (d * q) * inv;
+		if (v < -tolerance || u + v > 1.0 + tolerance)
+			return false;
+		t = (e2 * q) * inv;
+		return true;
+	}
+}
+
+using namespace mshim;
+
+/////////////////////////////////////////////////
+// STATUS AND STRINGS
+/////////////////////////////////////////////////
+
+void MStatus::perror(const char* message) const
+{
+	static const char* names[] = { "kSuccess", "kFailure", "kInsufficientMemory", "kInvalidParameter", "kLicenseFailure", "kUnknownParameter",
+		"kNotImplemented", "kNotFound", "kEndOfFile" };
+	std::cerr << message << ": (" << names[code] << ")" << std::endl;
+}
+
+void MStatus::perror(const MString& message) const
+{
+	perror(message.asChar());
+}
+
+MString& MString::operator+=(double value)
+{
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+	s += buffer;
+	return *this;
+}
+
+MString& MString::operator+=(int value)
+{
+	s += std::to_string(value);
+	return *this;
+}
+
+MString& MString::operator+=(unsigned value)
+{
+	s += std::to_string(value);
+	return *this;
+}
+
+MStatus MString::split(char separator, MStringArray& out) const
+{
+	out.clear();
+	size_t start = 0;
+	while (start <= s.size()) {
+		size_t end = s.find(separator, start);
+		if (end == std::string::npos)
+			end = s.size();
+		if (end > start)
+			out.append(MString(s.substr(start, end - start)));
+		start = end + 1;
+	}
+	return MS::kSuccess;
+}
+
+MString& MString::set(double value, int precision)
+{
+	char buffer[64];
+	std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+	s = buffer;
+	return *this;
+}
+
+bool MString::isInt() const
+{
+	if (s.empty())
+		return false;
+	char* end;
+	std::strtol(s.c_str(), &end, 10);
+	return *end == 0;
+}
+
+int MString::asInt() const
+{
+	return std::atoi(s.c_str());
+}
+
+double MString::asDouble() const
+{
+	return std::atof(s.c_str());
+}
+
+MObject MObject::kNullObj;
+
+MStatus MDoubleArray::get(double* out) const
+{
+	std::copy(p->begin(), p->end(), out);
+	return MS::kSuccess;
+}
+
+/////////////////////////////////////////////////
+// VECTORS
+/////////////////////////////////////////////////
+
+const MVector MVector::zero(0, 0, 0);
+const MVector MVector::one(1, 1, 1);
+const MVector MVector::xAxis(1, 0, 0);
+const MVector MVector::yAxis(0, 1, 0);
+const MVector MVector::zAxis(0, 0, 1);
+const MVector MVector::xNegAxis(-1, 0, 0);
+const MVector MVector::yNegAxis(0, -1, 0);
+const MVector MVector::zNegAxis(0, 0, -1);
+const MPoint MPoint::origin(0, 0, 0);
+
+MFloatVector::MFloatVector(const MVector& v) : x((float)v.x), y((float)v.y), z((float)v.z) {}
+MFloatVector::MFloatVector(const MFloatPoint& p) : x(p.x), y(p.y), z(p.z) {}
+
+MStatus MFloatVector::normalize()
+{
+	float l = length();
+	if (l > 0.0f) {
+		x /= l;
+		y /= l;
+		z /= l;
+	}
+	return MS::kSuccess;
+}
+
+MVector::MVector(const MPoint& p) : x(p.x), y(p.y), z(p.z) {}
+
+MStatus MVector::normalize()
+{
+	double l = length();
+	if (l > 0.0) {
+		x /= l;
+		y /= l;
+		z /= l;
+	}
+	return MS::kSuccess;
+}
+
+MVector MVector::operator*(const MMatrix& m) const
+{
+	return MVector(x * m[0][0] + y * m[1][0] + z * m[2][0],
+		x * m[0][1] + y * m[1][1] + z * m[2][1],
+		x * m[0][2] + y * m[1][2] + z * m[2][2]);
+}
+
+MVector& MVector::operator*=(const MMatrix& m)
+{
+	return *this = *this * m;
+}
+
+MVector MVector::rotateBy(const MQuaternion& q) const
+{
+	return *this * q.asMatrix();
+}
+
+MQuaternion MVector::rotateTo(const MVector& v) const
+{
+	return MQuaternion(*this, v);
+}
+
+double MVector::angle(const MVector& v) const
+{
+	double l = length() * v.length();
+	if (l == 0.0)
+		return 0.0;
+	return std::acos(std::max(-1.0, std::min(1.0, (*this * v) / l)));
+}
+
+bool MVector::isEquivalent(const MVector& v, double tolerance) const
+{
+	return std::fabs(x - v.x) <= tolerance && std::fabs(y - v.y) <= tolerance && std::fabs(z - v.z) <= tolerance;
+}
+
+MPoint::MPoint(const MFloatPoint& p) : x(p.x), y(p.y), z(p.z), w(p.w) {}
+
+MPoint MPoint::operator*(const MMatrix& m) const
+{
+	return MPoint(x * m[0][0] + y * m[1][0] + z * m[2][0] + w * m[3][0],
+		x * m[0][1] + y * m[1][1] + z * m[2][1] + w * m[3][1],
+		x * m[0][2] + y * m[1][2] + z * m[2][2] + w * m[3][2],
+		x * m[0][3] + y * m[1][3] + z * m[2][3] + w * m[3][3]);
+}
+
+MPoint& MPoint::operator*=(const MMatrix& m)
+{
+	return *this = *this * m;
+}
+
+MStatus MPoint::cartesianize()
+{
+	if (w != 0.0 && w != 1.0) {
+		x /= w;
+		y /= w;
+		z /= w;
+		w = 1.0;
+	}
+	return MS::kSuccess;
+}
+
+MVectorArray::MVectorArray(const double values[][3], unsigned length)
+{
+	for (unsigned i = 0; i < length; i++)
+		p->push_back(MVector(values[i][0], values[i][1], values[i][2]));
+}
+
+MStatus MVectorArray::get(double out[][3]) const
+{
+	for (size_t i = 0; i < p->size(); i++) {
+		out[i][0] = (*p)[i].x;
+		out[i][1] = (*p)[i].y;
+		out[i][2] = (*p)[i].z;
+	}
+	return MS::kSuccess;
+}
+
+/////////////////////////////////////////////////
+// MATRICES
+/////////////////////////////////////////////////
+
+const MMatrix MMatrix::identity;
+
+MMatrix::MMatrix()
+{
+	identityMatrix4(matrix);
+}
+
+MMatrix::MMatrix(const double m[4][4])
+{
+	copyMatrix4(m, matrix);
+}
+
+MMatrix MMatrix::operator*(const MMatrix& m) const
+{
+	MMatrix out;
+	multiplyMatrix4(matrix, m.matrix, out.matrix);
+	return out;
+}
+
+MMatrix& MMatrix::operator*=(const MMatrix& m)
+{
+	multiplyMatrix4(matrix, m.matrix, matrix);
+	return *this;
+}
+
+MMatrix MMatrix::operator+(const MMatrix& m) const
+{
+	MMatrix out;
+	for (int i = 0; i < 16; i++)
+		out.matrix[i / 4][i % 4] = matrix[i / 4][i % 4] + m.matrix[i / 4][i % 4];
+	return out;
+}
+
+MMatrix MMatrix::operator-(const MMatrix& m) const
+{
+	MMatrix out;
+	for (int i = 0; i < 16; i++)
+		out.matrix[i / 4][i % 4] = matrix[i / 4][i % 4] - m.matrix[i / 4][i % 4];
+	return out;
+}
+
+MMatrix MMatrix::operator*(double s) const
+{
+	MMatrix out;
+	for (int i = 0; i < 16; i++)
+		out.matrix[i / 4][i % 4] = matrix[i / 4][i % 4] * s;
+	return out;
+}
+
+bool MMatrix::operator==(const MMatrix& m) const
+{
+	return std::memcmp(matrix, m.matrix, sizeof(matrix)) == 0;
+}
+
+MMatrix MMatrix::inverse() const
+{
+	MMatrix out;
+	if (!invertMatrix4(matrix, out.matrix))
+		return *this;
+	return out;
+}
+
+MMatrix MMatrix::transpose() const
+{
+	MMatrix out;
+	for (int i = 0; i < 16; i++)
+		out.matrix[i / 4][i % 4] = matrix[i % 4][i / 4];
+	return out;
+}
+
+MMatrix& MMatrix::setToIdentity()
+{
+	identityMatrix4(matrix);
+	return *this;
+}
+
+double MMatrix::det3x3() const
+{
+	const double (*m)[4] = matrix;
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+		- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+		+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+double MMatrix::det4x4() const
+{
+	double det = 0.0;
+	for (int c = 0; c < 4; c++) {
+		double minor[3][3];
+		for (int r = 1; r < 4; r++) {
+			for (int k = 0, n = 0; k < 4; k++) {
+				if (k != c)
+					minor[r - 1][n++] = matrix[r][k];
+			}
+		}
+		double d = minor[0][0] * (minor[1][1] * minor[2][2] - minor[1][2] * minor[2][1])
+			- minor[0][1] * (minor[1][0] * minor[2][2] - minor[1][2] * minor[2][0])
+			+ minor[0][2] * (minor[1][0] * minor[2][1] - minor[1][1] * minor[2][0]);
+		det += ((c % 2) ? -1.0 : 1.0) * matrix[0][c] * d;
+	}
+	return det;
+}
+
+bool MMatrix::isEquivalent(const MMatrix& m, double tolerance) const
+{
+	for (int i = 0; i < 16; i++) {
+		if (std::fabs(matrix[i / 4][i % 4] - m.matrix[i / 4][i % 4]) > tolerance)
+			return false;
+	}
+	return true;
+}
+
+MStatus MMatrix::get(double out[4][4]) const
+{
+	copyMatrix4(matrix, out);
+	return MS::kSuccess;
+}
+
+MFloatMatrix::MFloatMatrix()
+{
+	for (int i = 0; i < 16; i++)
+		matrix[i / 4][i % 4] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+MFloatMatrix::MFloatMatrix(const MMatrix& m)
+{
+	for (int i = 0; i < 16; i++)
+		matrix[i / 4][i % 4] = (float)m.matrix[i / 4][i % 4];
+}
+
+/////////////////////////////////////////////////
+// ROTATIONS
+/////////////////////////////////////////////////
+
+// The rotation and transformation math of the shim doesn't use
+// composeTRS()/decomposeTRS() of mgear_math.h, so running a node here checks
+// the kernels against a second implementation of the same model:
+//     m = S * Sh * R * T
+// with Sh lower triangular (xy, xz, yz). Scale and shear come from the
+// Cholesky factor of M * M.transpose() instead of Gram-Schmidt on the rows.
+
+// Rows of the rotation matrix of q: the axes rotated by q * v * q.conjugate()
+static void shimRotationRows(const double q[4], double r[3][3])
+{
+	double n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	double x = 0.0, y = 0.0, z = 0.0, w = 1.0;
+	if (n > 0.0) {
+		x = q[0] / n;
+		y = q[1] / n;
+		z = q[2] / n;
+		w = q[3] / n;
+	}
+	for (int i = 0; i < 3; i++) {
+		double v[3] = { 0.0, 0.0, 0.0 };
+		v[i] = 1.0;
+		// p = q * v
+		double px = w * v[0] + y * v[2] - z * v[1];
+		double py = w * v[1] + z * v[0] - x * v[2];
+		double pz = w * v[2] + x * v[1] - y * v[0];
+		double pw = -x * v[0] - y * v[1] - z * v[2];
+		// p * q.conjugate()
+		r[i][0] = -pw * x + px * w - py * z + pz * y;
+		r[i][1] = -pw * y + py * w - pz * x + px * z;
+		r[i][2] = -pw * z + pz * w - px * y + py * x;
+	}
+}
+
+// Quaternion of a rotation matrix, from its largest component (Shepperd).
+// w >= 0 like Maya.
+static void shimQuaternion(const double r[3][3], double q[4])
+{
+	double c[4] = {
+		1.0 + r[0][0] - r[1][1] - r[2][2],
+		1.0 - r[0][0] + r[1][1] - r[2][2],
+		1.0 - r[0][0] - r[1][1] + r[2][2],
+		1.0 + r[0][0] + r[1][1] + r[2][2] };
+	int k = 0;
+	for (int i = 1; i < 4; i++) {
+		if (c[i] > c[k])
+			k = i;
+	}
+	double h = 0.5 * std::sqrt(std::max(c[k], 0.0));
+	double f = (h > 0.0) ? 0.25 / h : 0.0;
+	double x, y, z, w;
+	switch (k) {
+		case 0:
+			x = h;
+			y = (r[0][1] + r[1][0]) * f;
+			z = (r[2][0] + r[0][2]) * f;
+			w = (r[1][2] - r[2][1]) * f;
+			break;
+		case 1:
+			x = (r[0][1] + r[1][0]) * f;
+			y = h;
+			z = (r[1][2] + r[2][1]) * f;
+			w = (r[2][0] - r[0][2]) * f;
+			break;
+		case 2:
+			x = (r[2][0] + r[0][2]) * f;
+			y = (r[1][2] + r[2][1]) * f;
+			z = h;
+			w = (r[0][1] - r[1][0]) * f;
+			break;
+		default:
+			x = (r[1][2] - r[2][1]) * f;
+			y = (r[2][0] - r[0][2]) * f;
+			z = (r[0][1] - r[1][0]) * f;
+			w = h;
+			break;
+	}
+	double n = std::sqrt(x * x + y * y + z * z + w * w);
+	if (w < 0.0)
+		n = -n;
+	q[0] = x / n;
+	q[1] = y / n;
+	q[2] = z / n;
+	q[3] = w / n;
+}
+
+// any unit vector perpendicular to the unit vector v
+static void shimPerpendicular(const double v[3], double out[3])
+{
+	int k = 0;
+	for (int i = 1; i < 3; i++) {
+		if (std::fabs(v[i]) < std::fabs(v[k]))
+			k = i;
+	}
+	double a[3] = { 0.0, 0.0, 0.0 };
+	a[k] = 1.0;
+	double d = v[0] * a[0] + v[1] * a[1] + v[2] * a[2];
+	double n = 0.0;
+	for (int i = 0; i < 3; i++) {
+		out[i] = a[i] - d * v[i];
+		n += out[i] * out[i];
+	}
+	n = std::sqrt(n);
+	for (int i = 0; i < 3; i++)
+		out[i] /= n;
+}
+
+static void shimCross(const double a[3], const double b[3], double out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Split m in translation, rotation, scale and shear. A mirrored matrix gets
+// a negative X scale, a missing axis a zero scale.
+static void shimDecompose(const double m[4][4], double t[3], double q[4], double s[3], double sh[3])
+{
+	const double eps = 1.0e-12;
+	double a[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			a[i][j] = m[i][j];
+		t[i] = m[3][i];
+	}
+
+	double c[3];
+	shimCross(a[1], a[2], c);
+	double sign = (a[0][0] * c[0] + a[0][1] * c[1] + a[0][2] * c[2] < 0.0) ? -1.0 : 1.0;
+	for (int j = 0; j < 3; j++)
+		a[0][j] *= sign;
+
+	// a * a.transpose() = l * l.transpose(), l = S * Sh
+	double b[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			b[i][j] = a[i][0] * a[j][0] + a[i][1] * a[j][1] + a[i][2] * a[j][2];
+	}
+	double l00 = std::sqrt(std::max(b[0][0], 0.0));
+	double l10 = (l00 > eps) ? b[1][0] / l00 : 0.0;
+	double l20 = (l00 > eps) ? b[2][0] / l00 : 0.0;
+	double l11 = std::sqrt(std::max(b[1][1] - l10 * l10, 0.0));
+	double l21 = (l11 > eps) ? (b[2][1] - l20 * l10) / l11 : 0.0;
+	double l22 = std::sqrt(std::max(b[2][2] - l20 * l20 - l21 * l21, 0.0));
+
+	// r = l.inverse() * a by forward substitution
+	double r[3][3];
+	if (l00 > eps) {
+		for (int j = 0; j < 3; j++)
+			r[0][j] = a[0][j] / l00;
+	}
+	else {
+		shimCross(a[1], a[2], r[0]);
+		double n = std::sqrt(r[0][0] * r[0][0] + r[0][1] * r[0][1] + r[0][2] * r[0][2]);
+		for (int j = 0; j < 3; j++)
+			r[0][j] = (n > eps) ? r[0][j] / n : (j == 0 ? 1.0 : 0.0);
+	}
+	if (l11 > eps) {
+		for (int j = 0; j < 3; j++)
+			r[1][j] = (a[1][j] - l10 * r[0][j]) / l11;
+		if (l22 > eps) {
+			for (int j = 0; j < 3; j++)
+				r[2][j] = (a[2][j] - l20 * r[0][j] - l21 * r[1][j]) / l22;
+		}
+		else
+			shimCross(r[0], r[1], r[2]);
+	}
+	else {
+		// no Y axis, Z is split along the one picked instead
+		shimPerpendicular(r[0], r[1]);
+		shimCross(r[0], r[1], r[2]);
+		l21 = a[2][0] * r[1][0] + a[2][1] * r[1][1] + a[2][2] * r[1][2];
+		l22 = a[2][0] * r[2][0] + a[2][1] * r[2][1] + a[2][2] * r[2][2];
+	}
+
+	s[0] = sign * l00;
+	s[1] = l11;
+	s[2] = l22;
+	sh[0] = (l11 > eps) ? l10 / l11 : 0.0;
+	sh[1] = (std::fabs(l22) > eps) ? l20 / l22 : 0.0;
+	sh[2] = (std::fabs(l22) > eps) ? l21 / l22 : 0.0;
+	shimQuaternion(r, q);
+}
+
+// The matrix of translation, rotation, scale and shear
+static void shimCompose(const double t[3], const double q[4], const double s[3], const double sh[3], double m[4][4])
+{
+	double r[3][3];
+	shimRotationRows(q, r);
+	const double l[3][3] = {
+		{ s[0], 0.0, 0.0 },
+		{ s[1] * sh[0], s[1], 0.0 },
+		{ s[2] * sh[1], s[2] * sh[2], s[2] } };
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			m[i][j] = l[i][0] * r[0][j] + l[i][1] * r[1][j] + l[i][2] * r[2][j];
+		m[i][3] = 0.0;
+		m[3][i] = t[i];
+	}
+	m[3][3] = 1.0;
+}
+
+const MQuaternion MQuaternion::identity;
+
+MQuaternion::MQuaternion(double angle, const MVector& axis)
+{
+	MVector n = axis.normal();
+	double s = std::sin(angle * 0.5);
+	x = n.x * s;
+	y = n.y * s;
+	z = n.z * s;
+	w = std::cos(angle * 0.5);
+}
+
+MQuaternion::MQuaternion(const MVector& a, const MVector& b, double factor)
+{
+	MVector na = a.normal();
+	MVector nb = b.normal();
+	double d = std::max(-1.0, std::min(1.0, na * nb));
+	MVector axis = na ^ nb;
+	if (axis.length() < 1.0e-10) {
+		if (d > 0.0) {
+			x = y = z = 0.0;
+			w = 1.0;
+			return;
+		}
+		// opposite vectors, any perpendicular axis will do
+		double v[3] = { na.x, na.y, na.z };
+		double p[3];
+		perpendicular3(v, p);
+		axis = MVector(p[0], p[1], p[2]);
+	}
+	*this = MQuaternion(std::acos(d) * factor, axis);
+}
+
+MQuaternion& MQuaternion::operator=(const MMatrix& m)
+{
+	double t[3], q[4], s[3], sh[3];
+	shimDecompose(m.matrix, t, q, s, sh);
+	x = q[0];
+	y = q[1];
+	z = q[2];
+	w = q[3];
+	return *this;
+}
+
+MQuaternion& MQuaternion::operator=(const MEulerRotation& e)
+{
+	return *this = e.asQuaternion();
+}
+
+MQuaternion MQuaternion::operator*(const MQuaternion& q) const
+{
+	double a[4] = { x, y, z, w };
+	double b[4] = { q.x, q.y, q.z, q.w };
+	double out[4];
+	quatMultiply(b, a, out);
+	return MQuaternion(out[0], out[1], out[2], out[3]);
+}
+
+MMatrix MQuaternion::asMatrix() const
+{
+	double q[4] = { x, y, z, w };
+	double r[3][3];
+	shimRotationRows(q, r);
+	MMatrix m;
+	for (int i = 0; i < 9; i++)
+		m.matrix[i / 3][i % 3] = r[i / 3][i % 3];
+	return m;
+}
+
+MEulerRotation MQuaternion::asEulerRotation() const
+{
+	return MEulerRotation::decompose(asMatrix(), MEulerRotation::kXYZ);
+}
+
+MQuaternion& MQuaternion::normalizeIt()
+{
+	double n = std::sqrt(x * x + y * y + z * z + w * w);
+	if (n > 0.0) {
+		x /= n;
+		y /= n;
+		z /= n;
+		w /= n;
+	}
+	return *this;
+}
+
+MQuaternion MQuaternion::inverse() const
+{
+	double n = x * x + y * y + z * z + w * w;
+	if (n == 0.0)
+		return *this;
+	return MQuaternion(-x / n, -y / n, -z / n, w / n);
+}
+
+MQuaternion MQuaternion::log() const
+{
+	double s = std::sqrt(x * x + y * y + z * z);
+	if (s < 1.0e-12)
+		return MQuaternion(0, 0, 0, 0);
+	double a = std::atan2(s, w) / s;
+	return MQuaternion(x * a, y * a, z * a, 0);
+}
+
+MQuaternion MQuaternion::exp() const
+{
+	double a = std::sqrt(x * x + y * y + z * z);
+	if (a < 1.0e-12)
+		return MQuaternion(0, 0, 0, 1);
+	double s = std::sin(a) / a;
+	return MQuaternion(x * s, y * s, z * s, std::cos(a));
+}
+
+bool MQuaternion::getAxisAngle(MVector& axis, double& angle) const
+{
+	MQuaternion q = normal();
+	double s = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+	angle = 2.0 * std::atan2(s, q.w);
+	if (s < 1.0e-12) {
+		axis = MVector(0, 0, 1);
+		return false;
+	}
+	axis = MVector(q.x / s, q.y / s, q.z / s);
+	return true;
+}
+
+bool MQuaternion::isEquivalent(const MQuaternion& q, double tolerance) const
+{
+	return std::fabs(x - q.x) <= tolerance && std::fabs(y - q.y) <= tolerance && std::fabs(z - q.z) <= tolerance && std::fabs(w - q.w) <= tolerance;
+}
+
+MQuaternion slerp(const MQuaternion& a, const MQuaternion& b, double t, short spin)
+{
+	double qa[4] = { a.x, a.y, a.z, a.w };
+	double qb[4] = { b.x, b.y, b.z, b.w };
+	double out[4];
+	if (spin == 0) {
+		slerpQuaternion(qa, qb, t, out);
+		return MQuaternion(out[0], out[1], out[2], out[3]);
+	}
+
+	double d = std::max(-1.0, std::min(1.0, qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3]));
+	double phi = std::acos(d) + spin * 3.14159265358979323846;
+	double s = std::sin(phi);
+	if (std::fabs(s) < 1.0e-12)
+		return a;
+	double sa = std::sin((1.0 - t) * phi) / s;
+	double sb = std::sin(t * phi) / s;
+	return MQuaternion(a.x * sa + b.x * sb, a.y * sa + b.y * sb, a.z * sa + b.z * sb, a.w * sa + b.w * sb);
+}
+
+MQuaternion MEulerRotation::asQuaternion() const
+{
+	const int* axes = g_eulerAxes[order];
+	MQuaternion q;
+	for (int i = 0; i < 3; i++) {
+		double a = (*this)[axes[i]] * 0.5;
+		MQuaternion r;
+		r[axes[i]] = std::sin(a);
+		r.w = std::cos(a);
+		q = q * r;
+	}
+	return q;
+}
+
+MMatrix MEulerRotation::asMatrix() const
+{
+	return asQuaternion().asMatrix();
+}
+
+MEulerRotation& MEulerRotation::setValue(double x, double y, double z, RotationOrder order)
+{
+	this->x = x;
+	this->y = y;
+	this->z = z;
+	this->order = order;
+	return *this;
+}
+
+MEulerRotation& MEulerRotation::reorderIt(RotationOrder order)
+{
+	return *this = decompose(asMatrix(), order);
+}
+
+MEulerRotation MEulerRotation::decompose(const MMatrix& m, RotationOrder order)
+{
+	double r[3][3];
+	for (int i = 0; i < 3; i++) {
+		double row[3] = { m.matrix[i][0], m.matrix[i][1], m.matrix[i][2] };
+		normalize3(row);
+		r[i][0] = row[0];
+		r[i][1] = row[1];
+		r[i][2] = row[2];
+	}
+	const int* axes = g_eulerAxes[order];
+	double e[3];
+	eulerFromRotation(r, axes[0], axes[1], axes[2], e);
+	return MEulerRotation(e[0], e[1], e[2], order);
+}
+
+/////////////////////////////////////////////////
+// TRANSFORMATION MATRIX
+/////////////////////////////////////////////////
+
+const MTransformationMatrix MTransformationMatrix::identity;
+
+MTransformationMatrix::MTransformationMatrix()
+{
+	for (int i = 0; i < 3; i++) {
+		t[i] = 0.0;
+		q[i] = 0.0;
+		s[i] = 1.0;
+		sh[i] = 0.0;
+	}
+	q[3] = 1.0;
+}
+
+MTransformationMatrix::MTransformationMatrix(const MMatrix& m)
+{
+	shimDecompose(m.matrix, t, q, s, sh);
+}
+
+MMatrix MTransformationMatrix::asMatrix() const
+{
+	return asMatrix(1.0);
+}
+
+MMatrix MTransformationMatrix::asMatrix(double percent) const
+{
+	// each component from the identity, like Maya
+	double pt[3], pq[4], ps[3], psh[3];
+	for (int i = 0; i < 3; i++) {
+		pt[i] = t[i] * percent;
+		ps[i] = 1.0 + (s[i] - 1.0) * percent;
+		psh[i] = sh[i] * percent;
+	}
+	if (percent == 1.0)
+		std::copy(q, q + 4, pq);
+	else {
+		MQuaternion r = slerp(MQuaternion::identity, rotation(), percent);
+		pq[0] = r.x;
+		pq[1] = r.y;
+		pq[2] = r.z;
+		pq[3] = r.w;
+	}
+
+	MMatrix m;
+	shimCompose(pt, pq, ps, psh, m.matrix);
+	return m;
+}
+
+MMatrix MTransformationMatrix::asMatrixInverse() const
+{
+	return asMatrix().inverse();
+}
+
+MMatrix MTransformationMatrix::asScaleMatrix() const
+{
+	const double zero[3] = { 0.0, 0.0, 0.0 };
+	const double id[4] = { 0.0, 0.0, 0.0, 1.0 };
+	MMatrix m;
+	shimCompose(zero, id, s, sh, m.matrix);
+	return m;
+}
+
+MMatrix MTransformationMatrix::asRotateMatrix() const
+{
+	return rotation().asMatrix();
+}
+
+bool MTransformationMatrix::isEquivalent(const MTransformationMatrix& other, double tolerance) const
+{
+	return asMatrix().isEquivalent(other.asMatrix(), tolerance);
+}
+
+MVector MTransformationMatrix::getTranslation(MSpace::Space /*space*/, MStatus* /*status*/) const
+{
+	return MVector(t[0], t[1], t[2]);
+}
+
+MStatus MTransformationMatrix::setTranslation(const MVector& v, MSpace::Space /*space*/)
+{
+	t[0] = v.x;
+	t[1] = v.y;
+	t[2] = v.z;
+	return MS::kSuccess;
+}
+
+MStatus MTransformationMatrix::addTranslation(const MVector& v, MSpace::Space /*space*/)
+{
+	t[0] += v.x;
+	t[1] += v.y;
+	t[2] += v.z;
+	return MS::kSuccess;
+}
+
+MQuaternion MTransformationMatrix::rotation(MStatus* /*status*/) const
+{
+	return MQuaternion(q[0], q[1], q[2], q[3]);
+}
+
+MEulerRotation MTransformationMatrix::eulerRotation(MStatus* /*status*/) const
+{
+	return rotation().asEulerRotation();
+}
+
+MTransformationMatrix& MTransformationMatrix::rotateTo(const MQuaternion& r, MStatus* /*status*/)
+{
+	MQuaternion n = r.normal();
+	q[0] = n.x;
+	q[1] = n.y;
+	q[2] = n.z;
+	q[3] = n.w;
+	return *this;
+}
+
+MTransformationMatrix& MTransformationMatrix::rotateTo(const MEulerRotation& e, MStatus* status)
+{
+	return rotateTo(e.asQuaternion(), status);
+}
+
+MTransformationMatrix& MTransformationMatrix::rotateBy(const MQuaternion& r, MSpace::Space space, MStatus* status)
+{
+	// in transform space the rotation comes after the current one
+	if (space == MSpace::kTransform)
+		return rotateTo(rotation() * r, status);
+	return rotateTo(r * rotation(), status);
+}
+
+MTransformationMatrix& MTransformationMatrix::rotateBy(const MEulerRotation& e, MSpace::Space space, MStatus* status)
+{
+	return rotateBy(e.asQuaternion(), space, status);
+}
+
+MStatus MTransformationMatrix::setRotationQuaternion(double x, double y, double z, double w, MSpace::Space /*space*/)
+{
+	rotateTo(MQuaternion(x, y, z, w));
+	return MS::kSuccess;
+}
+
+MStatus MTransformationMatrix::getRotationQuaternion(double& x, double& y, double& z, double& w, MSpace::Space /*space*/) const
+{
+	x = q[0];
+	y = q[1];
+	z = q[2];
+	w = q[3];
+	return MS::kSuccess;
+}
+
+MStatus MTransformationMatrix::getScale(double scale[3], MSpace::Space /*space*/) const
+{
+	std::copy(s, s + 3, scale);
+	return MS::kSuccess;
+}
+
+MStatus MTransformationMatrix::setScale(const double scale[3], MSpace::Space /*space*/)
+{
+	std::copy(scale, scale + 3, s);
+	return MS::kSuccess;
+}
+
+MStatus MTransformationMatrix::getShear(double shear[3], MSpace::Space /*space*/) const
+{
+	std::copy(sh, sh + 3, shear);
+	return MS::kSuccess;
+}
+
+MStatus MTransformationMatrix::setShear(const double shear[3], MSpace::Space /*space*/)
+{
+	std::copy(shear, shear + 3, sh);
+	return MS::kSuccess;
+}
+
+/////////////////////////////////////////////////
+// UNITS
+/////////////////////////////////////////////////
+
+static double secondsPer(MTime::Unit unit)
+{
+	switch (unit) {
+		case MTime::kHours: return 3600.0;
+		case MTime::kMinutes: return 60.0;
+		case MTime::kMilliseconds: return 0.001;
+		case MTime::kGames: return 1.0 / 15.0;
+		case MTime::kFilm: return 1.0 / 24.0;
+		case MTime::kPALFrame: return 1.0 / 25.0;
+		case MTime::kNTSCFrame: return 1.0 / 30.0;
+		case MTime::kShowScan: return 1.0 / 48.0;
+		case MTime::kPALField: return 1.0 / 50.0;
+		case MTime::kNTSCField: return 1.0 / 60.0;
+		default: return 1.0;
+	}
+}
+
+double MTime::as(Unit unit) const
+{
+	return unit == u ? v : v * secondsPer(u) / secondsPer(unit);
+}
+
+MTime::Unit MTime::uiUnit()
+{
+	return g_uiUnit;
+}
+
+MStatus MTime::setUIUnit(Unit unit)
+{
+	g_uiUnit = unit;
+	return MS::kSuccess;
+}
+
+static double radiansPer(MAngle::Unit unit)
+{
+	switch (unit) {
+		case MAngle::kDegrees: return 3.14159265358979323846 / 180.0;
+		case MAngle::kAngMinutes: return 3.14159265358979323846 / 10800.0;
+		case MAngle::kAngSeconds: return 3.14159265358979323846 / 648000.0;
+		default: return 1.0;
+	}
+}
+
+double MAngle::as(Unit unit) const
+{
+	return unit == u ? v : v * radiansPer(u) / radiansPer(unit);
+}
+
+/////////////////////////////////////////////////
+// PLUGS
+/////////////////////////////////////////////////
+
+MPlug::MPlug(const MObject& node, const MObject& attribute) : nodeObject(node), attributeObject(attribute), index(-1) {}
+
+bool MPlug::operator==(const MPlug& other) const
+{
+	if (nodeObject != other.nodeObject || attributeObject != other.attributeObject || index != other.index)
+		return false;
+	if (!parentPlug || !other.parentPlug)
+		return !parentPlug == !other.parentPlug;
+	return *parentPlug == *other.parentPlug;
+}
+
+MString MPlug::name(MStatus* /*status*/) const
+{
+	NodeObject* n = mshim::nodeObject(nodeObject);
+	return MString(n ? n->name : std::string()) + "." + partialName();
+}
+
+MString MPlug::partialName(bool includeNodeName, bool /*includeNonMandatoryIndices*/, bool /*includeInstancedIndices*/, bool /*useAlias*/,
+	bool useFullAttributePath, bool useLongNames, MStatus* /*status*/) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	if (!attr)
+		return MString();
+	std::string name = useLongNames ? attr->name : attr->shortName;
+	if (index >= 0)
+		name += "[" + std::to_string(index) + "]";
+	if (useFullAttributePath && parentPlug)
+		name = std::string(parentPlug->partialName(false, false, false, false, true, useLongNames).asChar()) + "." + name;
+	if (includeNodeName) {
+		NodeObject* n = mshim::nodeObject(nodeObject);
+		name = (n ? n->name : std::string()) + "." + name;
+	}
+	return MString(name);
+}
+
+bool MPlug::isArray(MStatus* /*status*/) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	return attr && attr->array && index < 0;
+}
+
+bool MPlug::isCompound(MStatus* /*status*/) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	return attr && !attr->children.empty();
+}
+
+bool MPlug::isChild(MStatus* /*status*/) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	return attr && attr->parent;
+}
+
+MPlug MPlug::array(MStatus* /*status*/) const
+{
+	MPlug plug(*this);
+	plug.index = -1;
+	return plug;
+}
+
+MPlug MPlug::parent(MStatus* status) const
+{
+	if (parentPlug)
+		return *parentPlug;
+	const Attribute* attr = mshim::attribute(attributeObject);
+	if (!attr || !attr->parent) {
+		if (status)
+			*status = MS::kFailure;
+		return MPlug();
+	}
+	// find the attribute object of the parent among the type's attributes
+	std::vector<MObject> all = mshim::attributes(nodeObject);
+	for (size_t i = 0; i < all.size(); i++) {
+		if (all[i].get() == attr->parent)
+			return MPlug(nodeObject, all[i]);
+	}
+	return MPlug();
+}
+
+unsigned MPlug::numElements(MStatus* /*status*/) const
+{
+	Data* d = value(block(nodeObject), array());
+	return d ? (unsigned)d->elements.size() : 0;
+}
+
+MPlug MPlug::elementByLogicalIndex(unsigned i, MStatus* /*status*/) const
+{
+	MPlug plug(*this);
+	plug.index = (int)i;
+	return plug;
+}
+
+MPlug MPlug::elementByPhysicalIndex(unsigned i, MStatus* status) const
+{
+	Data* d = value(block(nodeObject), array());
+	if (!d || i >= d->elements.size()) {
+		if (status)
+			*status = MS::kFailure;
+		return MPlug();
+	}
+	std::map<unsigned, std::shared_ptr<Data> >::const_iterator it = d->elements.begin();
+	std::advance(it, i);
+	return elementByLogicalIndex(it->first);
+}
+
+unsigned MPlug::numChildren(MStatus* /*status*/) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	return attr ? (unsigned)attr->children.size() : 0;
+}
+
+MPlug MPlug::child(unsigned i, MStatus* status) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	if (!attr || i >= attr->children.size()) {
+		if (status)
+			*status = MS::kFailure;
+		return MPlug();
+	}
+	MPlug plug(nodeObject, attr->children[i]);
+	plug.parentPlug.reset(new MPlug(*this));
+	return plug;
+}
+
+MPlug MPlug::child(const MObject& attribute, MStatus* status) const
+{
+	const Attribute* attr = mshim::attribute(attributeObject);
+	for (unsigned i = 0; attr && i < attr->children.size(); i++) {
+		if (attr->children[i] == attribute)
+			return child(i, status);
+	}
+	if (status)
+		*status = MS::kFailure;
+	return MPlug();
+}
+
+/////////////////////////////////////////////////
+// DATA HANDLES
+/////////////////////////////////////////////////
+
+MObject MDataHandle::attribute()
+{
+	return d ? d->attributeObject : MObject();
+}
+
+// the children of numeric compounds hold the values
+static double component(Data* d, int i)
+{
+	d = leaf(d);
+	if (!d)
+		return 0.0;
+	if (!d->children.empty())
+		return i < (int)d->children.size() ? leaf(d->children[i].get())->v[0] : 0.0;
+	return d->v[i];
+}
+
+static void setComponent(Data* d, int i, double value)
+{
+	d = leaf(d);
+	if (!d)
+		return;
+	if (!d->children.empty()) {
+		if (i < (int)d->children.size()) {
+			Data* c = leaf(d->children[i].get());
+			c->v[0] = precision(c->attr, value);
+		}
+		return;
+	}
+	d->v[i] = precision(d->attr, value);
+}
+
+bool MDataHandle::asBool() const { return component(d, 0) != 0.0; }
+char MDataHandle::asChar() const { return (char)component(d, 0); }
+short MDataHandle::asShort() const { return (short)component(d, 0); }
+int MDataHandle::asInt() const { return (int)component(d, 0); }
+float MDataHandle::asFloat() const { return (float)component(d, 0); }
+double MDataHandle::asDouble() const { return component(d, 0); }
+
+const MMatrix& MDataHandle::asMatrix() const
+{
+	Data* l = leaf(d);
+	if (!l)
+		return MMatrix::identity;
+	if (l->object.get()) {
+		MatrixData* m = dynamic_cast<MatrixData*>(l->object.get());
+		if (m)
+			return m->m;
+	}
+	return l->m;
+}
+
+const MFloatMatrix& MDataHandle::asFloatMatrix() const
+{
+	static MFloatMatrix identity;
+	Data* l = leaf(d);
+	if (!l)
+		return identity;
+	l->floatMatrix = MFloatMatrix(asMatrix());
+	return l->floatMatrix;
+}
+
+MVector& MDataHandle::asVector()
+{
+	static MVector none;
+	Data* l = leaf(d);
+	if (!l)
+		return none = MVector();
+	l->vector = MVector(component(l, 0), component(l, 1), component(l, 2));
+	return l->vector;
+}
+
+MFloatVector& MDataHandle::asFloatVector()
+{
+	static MFloatVector none;
+	Data* l = leaf(d);
+	if (!l)
+		return none = MFloatVector();
+	l->floatVector = MFloatVector((float)component(l, 0), (float)component(l, 1), (float)component(l, 2));
+	return l->floatVector;
+}
+
+double3& MDataHandle::asDouble3()
+{
+	static double3 none;
+	Data* l = leaf(d);
+	if (!l)
+		return none;
+	for (int i = 0; i < 3; i++)
+		l->double3Value[i] = component(l, i);
+	return l->double3Value;
+}
+
+float* MDataHandle::asFloat3()
+{
+	static float none[3];
+	Data* l = leaf(d);
+	if (!l)
+		return none;
+	for (int i = 0; i < 3; i++)
+		l->float3Value[i] = (float)component(l, i);
+	return l->float3Value;
+}
+
+MTime MDataHandle::asTime() const
+{
+	return MTime(component(d, 0), MTime::kSeconds);
+}
+
+MAngle MDataHandle::asAngle() const
+{
+	return MAngle(component(d, 0), MAngle::kRadians);
+}
+
+MObject MDataHandle::data() const
+{
+	Data* l = leaf(d);
+	return l ? l->object : MObject();
+}
+
+void MDataHandle::setBool(bool value) { setComponent(d, 0, value ? 1.0 : 0.0); }
+void MDataHandle::setChar(char value) { setComponent(d, 0, value); }
+void MDataHandle::setShort(short value) { setComponent(d, 0, value); }
+void MDataHandle::setInt(int value) { setComponent(d, 0, value); }
+void MDataHandle::setFloat(float value) { setComponent(d, 0, value); }
+void MDataHandle::setDouble(double value) { setComponent(d, 0, value); }
+
+void MDataHandle::setMMatrix(const MMatrix& m)
+{
+	Data* l = leaf(d);
+	if (!l)
+		return;
+	l->object = MObject();
+	l->m = m;
+	if (l->attr && l->attr->kind == kMatrix && l->attr->type == MFnMatrixAttribute::kFloat) {
+		for (int i = 0; i < 16; i++)
+			l->m.matrix[i / 4][i % 4] = (float)m.matrix[i / 4][i % 4];
+	}
+}
+
+void MDataHandle::setMFloatMatrix(const MFloatMatrix& m)
+{
+	MMatrix dm;
+	for (int i = 0; i < 16; i++)
+		dm.matrix[i / 4][i % 4] = m.matrix[i / 4][i % 4];
+	setMMatrix(dm);
+}
+
+void MDataHandle::setMVector(const MVector& v) { set3Double(v.x, v.y, v.z); }
+void MDataHandle::setMFloatVector(const MFloatVector& v) { set3Double(v.x, v.y, v.z); }
+void MDataHandle::setMTime(const MTime& t) { setComponent(d, 0, t.as(MTime::kSeconds)); }
+void MDataHandle::setMAngle(const MAngle& a) { setComponent(d, 0, a.asRadians()); }
+void MDataHandle::set3Float(float x, float y, float z) { set3Double(x, y, z); }
+
+void MDataHandle::set3Double(double x, double y, double z)
+{
+	setComponent(d, 0, x);
+	setComponent(d, 1, y);
+	setComponent(d, 2, z);
+}
+
+MStatus MDataHandle::set(const MObject& data)
+{
+	Data* l = leaf(d);
+	if (!l)
+		return MS::kFailure;
+	MatrixData* m = dynamic_cast<MatrixData*>(data.get());
+	if (m && l->attr && l->attr->kind == kMatrix) {
+		setMMatrix(m->m);
+		return MS::kSuccess;
+	}
+	l->object = data;
+	return MS::kSuccess;
+}
+
+MDataHandle MDataHandle::child(const MObject& attribute)
+{
+	return MDataHandle(mshim::child(d, mshim::attribute(attribute)));
+}
+
+MStatus MDataHandle::copy(const MDataHandle& other)
+{
+	if (!d || !other.d)
+		return MS::kFailure;
+	std::shared_ptr<Data> c = copyData(*other.d);
+	MObject attributeObject = d->attributeObject;
+	const Attribute* attr = d->attr;
+	*d = *c;
+	d->attributeObject = attributeObject;
+	d->attr = attr;
+	return MS::kSuccess;
+}
+
+/////////////////////////////////////////////////
+// ARRAY HANDLES
+/////////////////////////////////////////////////
+
+MArrayDataBuilder::MArrayDataBuilder(MDataBlock* /*block*/, const MObject& attribute, unsigned /*count*/, MStatus* /*status*/)
+{
+	d = createData(attribute, false);
+}
+
+MArrayDataBuilder::MArrayDataBuilder(const MObject& attribute, unsigned /*count*/, MStatus* /*status*/)
+{
+	d = createData(attribute, false);
+}
+
+MDataHandle MArrayDataBuilder::addElement(unsigned index, MStatus* /*status*/)
+{
+	if (!d)
+		return MDataHandle();
+	return MDataHandle(element(d.get(), index));
+}
+
+MDataHandle MArrayDataBuilder::addLast(MStatus* /*status*/)
+{
+	if (!d)
+		return MDataHandle();
+	unsigned index = d->elements.empty() ? 0 : d->elements.rbegin()->first + 1;
+	return MDataHandle(element(d.get(), index));
+}
+
+MStatus MArrayDataBuilder::removeElement(unsigned index)
+{
+	if (!d || !d->elements.erase(index))
+		return MS::kFailure;
+	return MS::kSuccess;
+}
+
+unsigned MArrayDataBuilder::elementCount(MStatus* /*status*/) const
+{
+	return d ? (unsigned)d->elements.size() : 0;
+}
+
+unsigned MArrayDataHandle::elementCount(MStatus* /*status*/)
+{
+	return d ? (unsigned)d->elements.size() : 0;
+}
+
+MStatus MArrayDataHandle::jumpToElement(unsigned logicalIndex)
+{
+	if (!d)
+		return MS::kFailure;
+	std::map<unsigned, std::shared_ptr<Data> >::const_iterator it = d->elements.find(logicalIndex);
+	if (it == d->elements.end())
+		return MS::kFailure;
+	position = (unsigned)std::distance(d->elements.cbegin(), it);
+	return MS::kSuccess;
+}
+
+MStatus MArrayDataHandle::jumpToArrayElement(unsigned physicalIndex)
+{
+	if (!d || physicalIndex >= d->elements.size())
+		return MS::kFailure;
+	position = physicalIndex;
+	return MS::kSuccess;
+}
+
+unsigned MArrayDataHandle::elementIndex(MStatus* status)
+{
+	if (!d || position >= d->elements.size()) {
+		if (status)
+			*status = MS::kFailure;
+		return (unsigned)-1;
+	}
+	std::map<unsigned, std::shared_ptr<Data> >::const_iterator it = d->elements.begin();
+	std::advance(it, position);
+	return it->first;
+}
+
+MDataHandle MArrayDataHandle::inputValue(MStatus* status)
+{
+	if (!d || position >= d->elements.size()) {
+		if (status)
+			*status = MS::kFailure;
+		return MDataHandle();
+	}
+	std::map<unsigned, std::shared_ptr<Data> >::const_iterator it = d->elements.begin();
+	std::advance(it, position);
+	return MDataHandle(it->second.get());
+}
+
+MDataHandle MArrayDataHandle::outputValue(MStatus* status)
+{
+	return inputValue(status);
+}
+
+MStatus MArrayDataHandle::next()
+{
+	if (!d || position + 1 >= d->elements.size()) {
+		position = d ? (unsigned)d->elements.size() : 0;
+		return MS::kFailure;
+	}
+	position++;
+	return MS::kSuccess;
+}
+
+MArrayDataBuilder MArrayDataHandle::builder(MStatus* /*status*/)
+{
+	MArrayDataBuilder b;
+	if (d) {
+		// shares the elements, the ones added are new
+		b.d.reset(new Data(*d));
+	}
+	return b;
+}
+
+MStatus MArrayDataHandle::set(const MArrayDataBuilder& builder)
+{
+	if (!d || !builder.d)
+		return MS::kFailure;
+	d->elements = builder.d->elements;
+	position = 0;
+	return MS::kSuccess;
+}
+
+MDataHandle MDataBlock::inputValue(const MObject& attribute, MStatus* status)
+{
+	const Attribute* attr = mshim::attribute(attribute);
+	Data* d = attr ? block->value(attr) : 0;
+	if (!d && status)
+		*status = MS::kInvalidParameter;
+	return MDataHandle(d);
+}
+
+MDataHandle MDataBlock::inputValue(const MPlug& plug, MStatus* status)
+{
+	Data* d = value(block, plug);
+	if (!d && status)
+		*status = MS::kInvalidParameter;
+	return MDataHandle(d);
+}
+
+MArrayDataHandle MDataBlock::inputArrayValue(const MObject& attribute, MStatus* status)
+{
+	const Attribute* attr = mshim::attribute(attribute);
+	Data* d = attr ? block->value(attr) : 0;
+	if (!d || !d->isArray) {
+		if (status)
+			*status = MS::kInvalidParameter;
+		return MArrayDataHandle(0);
+	}
+	return MArrayDataHandle(d);
+}
+
+MArrayDataHandle MDataBlock::inputArrayValue(const MPlug& plug, MStatus* status)
+{
+	Data* d = value(block, plug.array());
+	if (!d || !d->isArray) {
+		if (status)
+			*status = MS::kInvalidParameter;
+		return MArrayDataHandle(0);
+	}
+	return MArrayDataHandle(d);
+}
+
+/////////////////////////////////////////////////
+// NODES
+/////////////////////////////////////////////////
+
+MObject MPxDeformerNode::input;
+MObject MPxDeformerNode::inputGeom;
+MObject MPxDeformerNode::groupId;
+MObject MPxDeformerNode::outputGeom;
+MObject MPxDeformerNode::envelope;
+
+MString MPxNode::name() const
+{
+	NodeObject* n = dynamic_cast<NodeObject*>(self.lock().get());
+	return MString(n ? n->name : std::string());
+}
+
+MTypeId MPxNode::typeId() const
+{
+	NodeObject* n = dynamic_cast<NodeObject*>(self.lock().get());
+	return n ? n->type->id : MTypeId();
+}
+
+MString MPxNode::typeName() const
+{
+	NodeObject* n = dynamic_cast<NodeObject*>(self.lock().get());
+	return MString(n ? n->type->name : std::string());
+}
+
+MStatus MPxNode::addAttribute(const MObject& attribute)
+{
+	if (!g_initializing || !mshim::attribute(attribute))
+		return MS::kFailure;
+	std::vector<MObject>& attributes = g_initializing->attributes;
+	if (std::find(attributes.begin(), attributes.end(), attribute) != attributes.end())
+		return MS::kFailure;
+	// children come with their compound
+	if (mshim::attribute(attribute)->parent)
+		return MS::kSuccess;
+	attributes.push_back(attribute);
+	return MS::kSuccess;
+}
+
+MStatus MPxNode::attributeAffects(const MObject& whenChanges, const MObject& isAffected)
+{
+	if (!g_initializing || !mshim::attribute(whenChanges) || !mshim::attribute(isAffected))
+		return MS::kFailure;
+	g_initializing->affects.push_back(std::make_pair(whenChanges, isAffected));
+	return MS::kSuccess;
+}
+
+/////////////////////////////////////////////////
+// ATTRIBUTES
+/////////////////////////////////////////////////
+
+Attribute* MFnAttribute::attribute() const
+{
+	return mshim::attribute(attr);
+}
+
+MString MFnAttribute::name() const
+{
+	return attribute() ? MString(attribute()->name) : MString();
+}
+
+MString MFnAttribute::shortName() const
+{
+	return attribute() ? MString(attribute()->shortName) : MString();
+}
+
+bool MFnAttribute::isArray() const
+{
+	return attribute() && attribute()->array;
+}
+
+MObject MFnAttribute::parent() const
+{
+	if (!attribute() || !attribute()->parent)
+		return MObject();
+	const Attribute* p = attribute()->parent;
+	// the parent doesn't keep its own MObject, its children do refer to it
+	for (size_t i = 0; p->parent && i < p->parent->children.size(); i++) {
+		if (p->parent->children[i].get() == p)
+			return p->parent->children[i];
+	}
+	for (size_t t = 0; t < g_types.size(); t++) {
+		std::vector<MObject>& attributes = g_types[t]->attributes;
+		for (size_t i = 0; i < attributes.size(); i++) {
+			if (attributes[i].get() == p)
+				return attributes[i];
+		}
+	}
+	return MObject();
+}
+
+MStatus MFnAttribute::setArray(bool array)
+{
+	if (!attribute())
+		return MS::kFailure;
+	attribute()->array = array;
+	return MS::kSuccess;
+}
+
+MObject MFnNumericAttribute::create(const MString& name, const MString& shortName, MFnNumericData::Type type, double defaultValue, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kNumeric, type);
+	// numeric compounds get a child per component
+	int count = 0;
+	MFnNumericData::Type childType = type;
+	switch (type) {
+		case MFnNumericData::k2Short: count = 2; childType = MFnNumericData::kShort; break;
+		case MFnNumericData::k3Short: count = 3; childType = MFnNumericData::kShort; break;
+		case MFnNumericData::k2Long: count = 2; childType = MFnNumericData::kLong; break;
+		case MFnNumericData::k3Long: count = 3; childType = MFnNumericData::kLong; break;
+		case MFnNumericData::k2Float: count = 2; childType = MFnNumericData::kFloat; break;
+		case MFnNumericData::k3Float: count = 3; childType = MFnNumericData::kFloat; break;
+		case MFnNumericData::k2Double: count = 2; childType = MFnNumericData::kDouble; break;
+		case MFnNumericData::k3Double: count = 3; childType = MFnNumericData::kDouble; break;
+		case MFnNumericData::k4Double: count = 4; childType = MFnNumericData::kDouble; break;
+		default: break;
+	}
+	static const char* suffixes[] = { "X", "Y", "Z", "W" };
+	static const char* shortSuffixes[] = { "x", "y", "z", "w" };
+	for (int i = 0; i < count && i < 3; i++) {
+		MObject child = createAttribute(name + suffixes[i], shortName + shortSuffixes[i], kNumeric, childType);
+		addChild(attr, child);
+	}
+	setDefault(defaultValue);
+	return attr;
+}
+
+MObject MFnNumericAttribute::create(const MString& name, const MString& shortName, const MObject& child1, const MObject& child2, const MObject& child3, MStatus* /*status*/)
+{
+	const Attribute* c = mshim::attribute(child1);
+	int type = MFnNumericData::k3Double;
+	if (c && c->type == MFnNumericData::kFloat)
+		type = child3.isNull() ? MFnNumericData::k2Float : MFnNumericData::k3Float;
+	else if (child3.isNull())
+		type = MFnNumericData::k2Double;
+	attr = createAttribute(name, shortName, kNumeric, type);
+	addChild(attr, child1);
+	addChild(attr, child2);
+	if (!child3.isNull())
+		addChild(attr, child3);
+	return attr;
+}
+
+MObject MFnNumericAttribute::createPoint(const MString& name, const MString& shortName, MStatus* status)
+{
+	return create(name, shortName, MFnNumericData::k3Float, 0.0, status);
+}
+
+MObject MFnNumericAttribute::createColor(const MString& name, const MString& shortName, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kNumeric, MFnNumericData::k3Float);
+	static const char* suffixes[] = { "R", "G", "B" };
+	static const char* shortSuffixes[] = { "r", "g", "b" };
+	for (int i = 0; i < 3; i++)
+		addChild(attr, createAttribute(name + suffixes[i], shortName + shortSuffixes[i], kNumeric, MFnNumericData::kFloat));
+	return attr;
+}
+
+MObject MFnNumericAttribute::child(unsigned i, MStatus* /*status*/)
+{
+	if (!attribute() || i >= attribute()->children.size())
+		return MObject();
+	return attribute()->children[i];
+}
+
+MFnNumericData::Type MFnNumericAttribute::unitType() const
+{
+	return attribute() ? (MFnNumericData::Type)attribute()->type : MFnNumericData::kInvalid;
+}
+
+MStatus MFnNumericAttribute::setDefault(double value)
+{
+	return setDefault(value, value, value);
+}
+
+MStatus MFnNumericAttribute::setDefault(double x, double y, double z)
+{
+	Attribute* a = attribute();
+	if (!a)
+		return MS::kFailure;
+	double values[3] = { x, y, z };
+	for (int i = 0; i < 3; i++)
+		a->defaults[i] = values[i];
+	for (size_t i = 0; i < a->children.size() && i < 3; i++)
+		mshim::attribute(a->children[i])->defaults[0] = values[i];
+	return MS::kSuccess;
+}
+
+MObject MFnMatrixAttribute::create(const MString& name, const MString& shortName, Type type, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kMatrix, type);
+	return attr;
+}
+
+MStatus MFnMatrixAttribute::setDefault(const MMatrix& m)
+{
+	if (!attribute())
+		return MS::kFailure;
+	m.get(attribute()->defaultMatrix);
+	return MS::kSuccess;
+}
+
+MObject MFnUnitAttribute::create(const MString& name, const MString& shortName, Type type, double defaultValue, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kUnit, type);
+	setDefault(defaultValue);
+	return attr;
+}
+
+MObject MFnUnitAttribute::create(const MString& name, const MString& shortName, const MAngle& defaultValue, MStatus* status)
+{
+	return create(name, shortName, kAngle, defaultValue.asRadians(), status);
+}
+
+MObject MFnUnitAttribute::create(const MString& name, const MString& shortName, const MTime& defaultValue, MStatus* status)
+{
+	return create(name, shortName, kTime, defaultValue.as(MTime::kSeconds), status);
+}
+
+MFnUnitAttribute::Type MFnUnitAttribute::unitType() const
+{
+	return attribute() ? (Type)attribute()->type : kInvalid;
+}
+
+MStatus MFnUnitAttribute::setDefault(double value)
+{
+	if (!attribute())
+		return MS::kFailure;
+	attribute()->defaults[0] = value;
+	return MS::kSuccess;
+}
+
+MStatus MFnUnitAttribute::setDefault(const MTime& value)
+{
+	return setDefault(value.as(MTime::kSeconds));
+}
+
+MObject MFnEnumAttribute::create(const MString& name, const MString& shortName, short defaultValue, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kEnum, 0);
+	setDefault(defaultValue);
+	return attr;
+}
+
+MStatus MFnEnumAttribute::setDefault(short value)
+{
+	if (!attribute())
+		return MS::kFailure;
+	attribute()->defaults[0] = value;
+	return MS::kSuccess;
+}
+
+MObject MFnTypedAttribute::create(const MString& name, const MString& shortName, MFnData::Type type, const MObject& defaultData, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kTyped, type);
+	setDefault(defaultData);
+	return attr;
+}
+
+MStatus MFnTypedAttribute::setDefault(const MObject& data)
+{
+	if (!attribute())
+		return MS::kFailure;
+	attribute()->defaultData = data;
+	return MS::kSuccess;
+}
+
+MObject MFnCompoundAttribute::create(const MString& name, const MString& shortName, MStatus* /*status*/)
+{
+	attr = createAttribute(name, shortName, kCompound, 0);
+	return attr;
+}
+
+MStatus MFnCompoundAttribute::addChild(const MObject& child)
+{
+	if (!attribute() || !mshim::attribute(child))
+		return MS::kFailure;
+	mshim::addChild(attr, child);
+	return MS::kSuccess;
+}
+
+unsigned MFnCompoundAttribute::numChildren(MStatus* /*status*/) const
+{
+	return attribute() ? (unsigned)attribute()->children.size() : 0;
+}
+
+MObject MFnCompoundAttribute::child(unsigned i, MStatus* /*status*/) const
+{
+	if (!attribute() || i >= attribute()->children.size())
+		return MObject();
+	return attribute()->children[i];
+}
+
+/////////////////////////////////////////////////
+// RAMPS
+/////////////////////////////////////////////////
+
+MRampAttribute::MRampAttribute(const MObject& node, const MObject& attribute, MStatus* /*status*/) : node(node), attribute(attribute) {}
+
+MRampAttribute::MRampAttribute(const MPlug& plug, MStatus* /*status*/) : node(plug.node()), attribute(plug.attribute()) {}
+
+MObject MRampAttribute::createCurveRamp(const MString& name, const MString& shortName, MStatus* /*status*/)
+{
+	MObject ramp = createAttribute(name, shortName, kCompound, 0);
+	mshim::attribute(ramp)->array = true;
+	addChild(ramp, createAttribute(name + "_Position", shortName + "p", kNumeric, MFnNumericData::kFloat));
+	addChild(ramp, createAttribute(name + "_FloatValue", shortName + "fv", kNumeric, MFnNumericData::kFloat));
+	MObject interp = createAttribute(name + "_Interp", shortName + "i", kEnum, 0);
+	mshim::attribute(interp)->defaults[0] = kLinear;
+	addChild(ramp, interp);
+	return ramp;
+}
+
+MDataHandle MRampAttribute::entry(unsigned index, int child)
+{
+	Block* b = block(node);
+	Data* d = b ? b->value(mshim::attribute(attribute)) : 0;
+	if (!d || index >= d->elements.size())
+		return MDataHandle();
+	std::map<unsigned, std::shared_ptr<Data> >::iterator it = d->elements.begin();
+	std::advance(it, index);
+	return MDataHandle(it->second->children[child].get());
+}
+
+unsigned MRampAttribute::getNumEntries(MStatus* /*status*/)
+{
+	Block* b = block(node);
+	Data* d = b ? b->value(mshim::attribute(attribute)) : 0;
+	return d ? (unsigned)d->elements.size() : 0;
+}
+
+void MRampAttribute::getEntries(MIntArray& indices, MFloatArray& positions, MFloatArray& values, MIntArray& interps, MStatus* /*status*/)
+{
+	indices.clear();
+	positions.clear();
+	values.clear();
+	interps.clear();
+	Block* b = block(node);
+	Data* d = b ? b->value(mshim::attribute(attribute)) : 0;
+	if (!d)
+		return;
+	for (std::map<unsigned, std::shared_ptr<Data> >::iterator it = d->elements.begin(); it != d->elements.end(); ++it) {
+		indices.append((int)it->first);
+		positions.append(MDataHandle(it->second->children[0].get()).asFloat());
+		values.append(MDataHandle(it->second->children[1].get()).asFloat());
+		interps.append(MDataHandle(it->second->children[2].get()).asShort());
+	}
+}
+
+void MRampAttribute::getValueAtPosition(float position, float& value, MStatus* /*status*/)
+{
+	MIntArray indices, interps;
+	MFloatArray positions, values;
+	getEntries(indices, positions, values, interps);
+	unsigned n = positions.length();
+	if (n == 0) {
+		value = 0.0f;
+		return;
+	}
+
+	std::vector<unsigned> order(n);
+	for (unsigned i = 0; i < n; i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { return positions[a] < positions[b]; });
+
+	if (position <= positions[order[0]]) {
+		value = values[order[0]];
+		return;
+	}
+	if (position >= positions[order[n - 1]]) {
+		value = values[order[n - 1]];
+		return;
+	}
+
+	unsigned k = 0;
+	while (positions[order[k + 1]] <= position)
+		k++;
+	unsigned a = order[k], b = order[k + 1];
+	float t = (position - positions[a]) / (positions[b] - positions[a]);
+	switch (interps[a]) {
+		case kNone:
+			value = values[a];
+			break;
+		case kSmooth:
+			t = t * t * (3.0f - 2.0f * t);
+			value = values[a] + (values[b] - values[a]) * t;
+			break;
+		case kSpline: {
+			// Catmull-Rom through the neighbours, the ends repeated
+			float p0 = values[order[k > 0 ? k - 1 : k]];
+			float p3 = values[order[k + 2 < n ? k + 2 : k + 1]];
+			float p1 = values[a], p2 = values[b];
+			value = 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t * t
+				+ (3.0f * p1 - p0 - 3.0f * p2 + p3) * t * t * t);
+			break;
+		}
+		default:
+			value = values[a] + (values[b] - values[a]) * t;
+			break;
+	}
+}
+
+MStatus MRampAttribute::setValueAtIndex(float value, unsigned index)
+{
+	MDataHandle h = entry(index, 1);
+	if (h.isNull())
+		return MS::kFailure;
+	h.setFloat(value);
+	return MS::kSuccess;
+}
+
+MStatus MRampAttribute::setPositionAtIndex(float position, unsigned index)
+{
+	MDataHandle h = entry(index, 0);
+	if (h.isNull())
+		return MS::kFailure;
+	h.setFloat(position);
+	return MS::kSuccess;
+}
+
+MStatus MRampAttribute::setInterpolationAtIndex(MInterpolation interp, unsigned index)
+{
+	MDataHandle h = entry(index, 2);
+	if (h.isNull())
+		return MS::kFailure;
+	h.setShort((short)interp);
+	return MS::kSuccess;
+}
+
+/////////////////////////////////////////////////
+// FUNCTION SETS
+/////////////////////////////////////////////////
+
+MString MFnDependencyNode::name(MStatus* /*status*/) const
+{
+	NodeObject* n = nodeObject(node);
+	return MString(n ? n->name : std::string());
+}
+
+MString MFnDependencyNode::typeName(MStatus* /*status*/) const
+{
+	NodeObject* n = nodeObject(node);
+	return MString(n ? n->type->name : std::string());
+}
+
+MTypeId MFnDependencyNode::typeId(MStatus* /*status*/) const
+{
+	NodeObject* n = nodeObject(node);
+	return n ? n->type->id : MTypeId();
+}
+
+MPxNode* MFnDependencyNode::userNode(MStatus* /*status*/) const
+{
+	NodeObject* n = nodeObject(node);
+	return n ? n->node.get() : 0;
+}
+
+unsigned MFnDependencyNode::attributeCount(MStatus* /*status*/) const
+{
+	return (unsigned)mshim::attributes(node).size();
+}
+
+MObject MFnDependencyNode::attribute(unsigned index, MStatus* /*status*/) const
+{
+	std::vector<MObject> all = mshim::attributes(node);
+	return index < all.size() ? all[index] : MObject();
+}
+
+MObject MFnDependencyNode::attribute(const MString& name, MStatus* status) const
+{
+	std::vector<MObject> all = mshim::attributes(node);
+	for (size_t i = 0; i < all.size(); i++) {
+		const Attribute* attr = mshim::attribute(all[i]);
+		if (name == attr->name.c_str() || name == attr->shortName.c_str())
+			return all[i];
+	}
+	if (status)
+		*status = MS::kInvalidParameter;
+	return MObject();
+}
+
+MPlug MFnDependencyNode::findPlug(const MString& name, bool /*wantNetworkedPlug*/, MStatus* status) const
+{
+	MObject attr = attribute(name, status);
+	if (attr.isNull())
+		return MPlug();
+	return MPlug(node, attr);
+}
+
+const MMatrix& MFnMatrixData::matrix(MStatus* /*status*/) const
+{
+	MatrixData* d = dynamic_cast<MatrixData*>(object.get());
+	return d ? d->m : MMatrix::identity;
+}
+
+MObject MFnMatrixData::create(const MMatrix& m, MStatus* /*status*/)
+{
+	std::shared_ptr<MatrixData> d(new MatrixData());
+	d->m = m;
+	object = MObject(d);
+	return object;
+}
+
+MStatus MFnMatrixData::set(const MMatrix& m)
+{
+	MatrixData* d = dynamic_cast<MatrixData*>(object.get());
+	if (!d)
+		return MS::kFailure;
+	d->m = m;
+	return MS::kSuccess;
+}
+
+MDoubleArray MFnDoubleArrayData::array(MStatus* /*status*/) const
+{
+	DoubleArrayData* d = dynamic_cast<DoubleArrayData*>(object.get());
+	MDoubleArray values;
+	if (d)
+		values.mshim_share(d->values);
+	return values;
+}
+
+MObject MFnDoubleArrayData::create(const MDoubleArray& values, MStatus* /*status*/)
+{
+	std::shared_ptr<DoubleArrayData> d(new DoubleArrayData());
+	d->values = values;
+	object = MObject(d);
+	return object;
+}
+
+MStatus MFnDoubleArrayData::set(const MDoubleArray& values)
+{
+	DoubleArrayData* d = dynamic_cast<DoubleArrayData*>(object.get());
+	if (!d)
+		return MS::kFailure;
+	d->values = values;
+	return MS::kSuccess;
+}
+
+MVectorArray MFnVectorArrayData::array(MStatus* /*status*/) const
+{
+	VectorArrayData* d = dynamic_cast<VectorArrayData*>(object.get());
+	MVectorArray values;
+	if (d)
+		values.mshim_share(d->values);
+	return values;
+}
+
+MObject MFnVectorArrayData::create(const MVectorArray& values, MStatus* /*status*/)
+{
+	std::shared_ptr<VectorArrayData> d(new VectorArrayData());
+	d->values = values;
+	object = MObject(d);
+	return object;
+}
+
+MStatus MFnVectorArrayData::set(const MVectorArray& values)
+{
+	VectorArrayData* d = dynamic_cast<VectorArrayData*>(object.get());
+	if (!d)
+		return MS::kFailure;
+	d->values = values;
+	return MS::kSuccess;
+}
+
+MObject MFnMeshData::create(MStatus* /*status*/)
+{
+	return MObject(std::shared_ptr<Object>(new MeshData()));
+}
+
+MFnMesh::MFnMesh(const MObject& mesh, MStatus* status) : object(mesh)
+{
+	if (status)
+		*status = dynamic_cast<MeshData*>(mesh.get()) ? MS::kSuccess : MS::kInvalidParameter;
+}
+
+MObject MFnMesh::create(int numVertices, int numPolygons, const MPointArray& vertexArray, const MIntArray& polygonCounts, const MIntArray& polygonConnects,
+	MObject& parentOrOwner, MStatus* /*status*/)
+{
+	if (!dynamic_cast<MeshData*>(parentOrOwner.get()))
+		parentOrOwner = MFnMeshData().create();
+	MeshData* d = dynamic_cast<MeshData*>(parentOrOwner.get());
+	d->points = vertexArray;
+	d->points.setLength((unsigned)numVertices);
+	d->counts = polygonCounts;
+	d->counts.setLength((unsigned)numPolygons);
+	d->connects = polygonConnects;
+	object = parentOrOwner;
+	return object;
+}
+
+int MFnMesh::numVertices(MStatus* /*status*/) const
+{
+	MeshData* d = dynamic_cast<MeshData*>(object.get());
+	return d ? (int)d->points.length() : 0;
+}
+
+int MFnMesh::numPolygons(MStatus* /*status*/) const
+{
+	MeshData* d = dynamic_cast<MeshData*>(object.get());
+	return d ? (int)d->counts.length() : 0;
+}
+
+MStatus MFnMesh::getPoint(int index, MPoint& point, MSpace::Space /*space*/) const
+{
+	MeshData* d = dynamic_cast<MeshData*>(object.get());
+	if (!d || index < 0 || index >= (int)d->points.length())
+		return MS::kFailure;
+	point = d->points[(unsigned)index];
+	return MS::kSuccess;
+}
+
+MStatus MFnMesh::getPoints(MPointArray& points, MSpace::Space /*space*/) const
+{
+	MeshData* d = dynamic_cast<MeshData*>(object.get());
+	if (!d)
+		return MS::kFailure;
+	points = d->points;
+	return MS::kSuccess;
+}
+
+bool MFnMesh::closestIntersection(const MFloatPoint& raySource, const MFloatVector& rayDirection, const MIntArray* /*faceIds*/, const MIntArray* /*triIds*/,
+	bool /*idsSorted*/, MSpace::Space /*space*/, float maxParam, bool testBothDirections, MMeshIsectAccelParams* /*accelParams*/,
+	MFloatPoint& hitPoint, float* hitRayParam, int* hitFace, int* hitTriangle, float* hitBary1, float* hitBary2,
+	float tolerance, MStatus* status)
+{
+	MeshData* d = dynamic_cast<MeshData*>(object.get());
+	if (!d) {
+		if (status)
+			*status = MS::kFailure;
+		return false;
+	}
+
+	MPoint o(raySource);
+	MVector dir(rayDirection);
+	double best = -1.0;
+	unsigned offset = 0;
+	for (unsigned f = 0; f < d->counts.length(); f++) {
+		unsigned count = (unsigned)d->counts[f];
+		for (unsigned k = 1; k + 1 < count; k++) {
+			double t, u, v;
+			if (!rayTriangle(o, dir, d->points[d->connects[offset]], d->points[d->connects[offset + k]], d->points[d->connects[offset + k + 1]], tolerance, t, u, v))
+				continue;
+			if (t < 0.0 && !testBothDirections)
+				continue;
+			if (std::fabs(t) > maxParam || (best >= 0.0 && std::fabs(t) >= best))
+				continue;
+			best = std::fabs(t);
+			hitPoint = MFloatPoint(o + dir * t);
+			if (hitRayParam)
+				*hitRayParam = (float)t;
+			if (hitFace)
+				*hitFace = (int)f;
+			if (hitTriangle)
+				*hitTriangle = (int)k - 1;
+			if (hitBary1)
+				*hitBary1 = (float)u;
+			if (hitBary2)
+				*hitBary2 = (float)v;
+		}
+		offset += count;
+	}
+	return best >= 0.0;
+}
+
+MObject MFnNurbsCurveData::create(MStatus* /*status*/)
+{
+	return MObject(std::shared_ptr<Object>(new CurveData()));
+}
+
+MObject MFnNurbsCurve::create(const MPointArray& cvs, const MDoubleArray& knots, unsigned degree, Form /*form*/, bool /*create2D*/, bool /*createRational*/,
+	MObject& parentOrOwner, MStatus* status)
+{
+	if (!dynamic_cast<CurveData*>(parentOrOwner.get()))
+		parentOrOwner = MFnNurbsCurveData().create();
+	CurveData* d = dynamic_cast<CurveData*>(parentOrOwner.get());
+	d->curve.degree = (int)degree;
+	d->curve.cvs.resize(cvs.length() * 3);
+	for (unsigned i = 0; i < cvs.length(); i++) {
+		d->curve.cvs[i * 3] = cvs[i].x;
+		d->curve.cvs[i * 3 + 1] = cvs[i].y;
+		d->curve.cvs[i * 3 + 2] = cvs[i].z;
+	}
+	d->curve.knots.resize(knots.length());
+	for (unsigned i = 0; i < knots.length(); i++)
+		d->curve.knots[i] = knots[i];
+	nurbsPrepare(d->curve, d->evaluator, false);
+	d->arcLength = false;
+	if (status)
+		*status = d->evaluator.valid ? MS::kSuccess : MS::kInvalidParameter;
+	object = parentOrOwner;
+	return object;
+}
+
+static CurveData* curveData(const MObject& object, MStatus* status)
+{
+	CurveData* d = dynamic_cast<CurveData*>(object.get());
+	if (status)
+		*status = d && d->evaluator.valid ? MS::kSuccess : MS::kInvalidParameter;
+	return d && d->evaluator.valid ? d : 0;
+}
+
+int MFnNurbsCurve::numCVs(MStatus* status) const
+{
+	CurveData* d = curveData(object, status);
+	return d ? d->curve.cvCount() : 0;
+}
+
+int MFnNurbsCurve::numKnots(MStatus* status) const
+{
+	CurveData* d = curveData(object, status);
+	return d ? (int)d->evaluator.knots.size() - 2 : 0;
+}
+
+int MFnNurbsCurve::degree(MStatus* status) const
+{
+	CurveData* d = curveData(object, status);
+	return d ? d->curve.degree : 0;
+}
+
+MStatus MFnNurbsCurve::getCVs(MPointArray& cvs, MSpace::Space /*space*/) const
+{
+	MStatus status;
+	CurveData* d = curveData(object, &status);
+	cvs.clear();
+	for (int i = 0; d && i < d->curve.cvCount(); i++)
+		cvs.append(MPoint(d->curve.cvs[i * 3], d->curve.cvs[i * 3 + 1], d->curve.cvs[i * 3 + 2]));
+	return status;
+}
+
+MStatus MFnNurbsCurve::getKnots(MDoubleArray& knots) const
+{
+	MStatus status;
+	CurveData* d = curveData(object, &status);
+	knots.clear();
+	// Maya's knots leave out the first and last of the full vector
+	for (size_t i = 1; d && i + 1 < d->evaluator.knots.size(); i++)
+		knots.append(d->evaluator.knots[i]);
+	return status;
+}
+
+MStatus MFnNurbsCurve::getKnotDomain(double& start, double& end) const
+{
+	MStatus status;
+	CurveData* d = curveData(object, &status);
+	if (d) {
+		start = d->evaluator.start;
+		end = d->evaluator.end;
+	}
+	return status;
+}
+
+double MFnNurbsCurve::length(double /*tolerance*/, MStatus* status) const
+{
+	CurveData* d = curveData(object, status);
+	return d ? nurbsLength(d->lengths()) : 0.0;
+}
+
+double MFnNurbsCurve::findParamFromLength(double length, MStatus* status) const
+{
+	CurveData* d = curveData(object, status);
+	return d ? nurbsParamFromLength(d->lengths(), length) : 0.0;
+}
+
+MStatus MFnNurbsCurve::getPointAtParam(double param, MPoint& point, MSpace::Space /*space*/) const
+{
+	MStatus status;
+	CurveData* d = curveData(object, &status);
+	if (d) {
+		double p[3];
+		nurbsPoint(d->evaluator, param, p);
+		point = MPoint(p[0], p[1], p[2]);
+	}
+	return status;
+}
+
+MVector MFnNurbsCurve::tangent(double param, MSpace::Space /*space*/, MStatus* status) const
+{
+	CurveData* d = curveData(object, status);
+	if (!d)
+		return MVector();
+	double t[3];
+	nurbsDerivative(d->evaluator, param, t);
+	normalize3(t);
+	return MVector(t[0], t[1], t[2]);
+}
+
+/////////////////////////////////////////////////
+// PLUGIN, COMMANDS AND PROFILER
+/////////////////////////////////////////////////
+
+void MGlobal::displayInfo(const MString& message)
+{
+	std::cerr << message.asChar() << std::endl;
+}
+
+void MGlobal::displayWarning(const MString& message)
+{
+	std::cerr << "// Warning: " << message.asChar() << std::endl;
+}
+
+void MGlobal::displayError(const MString& message)
+{
+	std::cerr << "// Error: " << message.asChar() << std::endl;
+}
+
+MStatus MSyntax::addFlag(const char* shortName, const char* longName, MArgType type)
+{
+	Flag flag;
+	flag.shortName = shortName;
+	flag.longName = longName;
+	flag.type = type;
+	flags.push_back(flag);
+	return MS::kSuccess;
+}
+
+MArgDatabase::MArgDatabase(const MSyntax& syntax, const MArgList& args, MStatus* status)
+{
+	for (size_t i = 0; i < syntax.flags.size(); i++) {
+		names[syntax.flags[i].shortName] = syntax.flags[i].longName;
+		names[syntax.flags[i].longName] = syntax.flags[i].longName;
+	}
+	if (status)
+		*status = MS::kSuccess;
+	for (unsigned i = 0; i < args.length(); i++) {
+		std::string arg = args.asString(i).asChar();
+		const MSyntax::Flag* flag = 0;
+		for (size_t k = 0; k < syntax.flags.size(); k++) {
+			if (arg == syntax.flags[k].shortName || arg == syntax.flags[k].longName)
+				flag = &syntax.flags[k];
+		}
+		if (!flag) {
+			MGlobal::displayError(MString("Invalid flag: ") + arg.c_str());
+			if (status)
+				*status = MS::kInvalidParameter;
+			continue;
+		}
+		if (flag->type != MSyntax::kNoArg && i + 1 < args.length())
+			values[flag->longName] = args.asString(++i);
+		else
+			values[flag->longName] = MString();
+	}
+}
+
+const MString* MArgDatabase::argument(const char* flag) const
+{
+	std::map<std::string, std::string>::const_iterator name = names.find(flag);
+	if (name == names.end())
+		return 0;
+	std::map<std::string, MString>::const_iterator it = values.find(name->second);
+	return it == values.end() ? 0 : &it->second;
+}
+
+bool MArgDatabase::isFlagSet(const char* flag, MStatus* /*status*/) const
+{
+	return argument(flag) != 0;
+}
+
+MStatus MArgDatabase::getFlagArgument(const char* flag, unsigned /*index*/, MString& value) const
+{
+	const MString* arg = argument(flag);
+	if (!arg)
+		return MS::kFailure;
+	value = *arg;
+	return MS::kSuccess;
+}
+
+MStatus MArgDatabase::getFlagArgument(const char* flag, unsigned /*index*/, bool& value) const
+{
+	const MString* arg = argument(flag);
+	if (!arg)
+		return MS::kFailure;
+	value = *arg == "true" || *arg == "on" || *arg == "yes" || (arg->isInt() && arg->asInt() != 0);
+	return MS::kSuccess;
+}
+
+MStatus MArgDatabase::getFlagArgument(const char* flag, unsigned /*index*/, int& value) const
+{
+	const MString* arg = argument(flag);
+	if (!arg)
+		return MS::kFailure;
+	value = arg->asInt();
+	return MS::kSuccess;
+}
+
+MStatus MArgDatabase::getFlagArgument(const char* flag, unsigned /*index*/, double& value) const
+{
+	const MString* arg = argument(flag);
+	if (!arg)
+		return MS::kFailure;
+	value = arg->asDouble();
+	return MS::kSuccess;
+}
+
+void MPxCommand::setResult(const MString& result) { g_result = result; }
+void MPxCommand::setResult(int result) { g_result = MString(std::to_string(result)); }
+void MPxCommand::setResult(bool result) { g_result = result ? "1" : "0"; }
+void MPxCommand::setResult(double result) { g_result = MString(); g_result += result; }
+void MPxCommand::clearResult() { g_result = MString(); }
+
+void MPxCommand::appendToResult(const MString& result)
+{
+	if (g_result.length())
+		g_result += " ";
+	g_result += result;
+}
+
+MString MPxCommand::shimResult()
+{
+	return g_result;
+}
+
+MStatus MFnPlugin::registerNode(const MString& typeName, const MTypeId& typeId, void* (*creator)(), MStatus (*initialize)(), MPxNode::Type type,
+	const MString* /*classification*/)
+{
+	if (findType(typeName.asChar()))
+		return MS::kFailure;
+
+	std::unique_ptr<NodeType> nodeType(new NodeType());
+	nodeType->name = typeName.asChar();
+	nodeType->id = typeId;
+	nodeType->creator = creator;
+	nodeType->type = type;
+
+	if (type == MPxNode::kDeformerNode) {
+		// the attributes every deformer inherits
+		if (MPxDeformerNode::input.isNull()) {
+			MFnTypedAttribute tAttr;
+			MFnNumericAttribute nAttr;
+			MFnCompoundAttribute cAttr;
+			MPxDeformerNode::inputGeom = tAttr.create("inputGeometry", "ig", MFnData::kAny);
+			MPxDeformerNode::groupId = nAttr.create("groupId", "gi", MFnNumericData::kLong, 0);
+			MPxDeformerNode::input = cAttr.create("input", "ip");
+			cAttr.addChild(MPxDeformerNode::inputGeom);
+			cAttr.addChild(MPxDeformerNode::groupId);
+			cAttr.setArray(true);
+			MPxDeformerNode::outputGeom = tAttr.create("outputGeometry", "og", MFnData::kAny);
+			tAttr.setArray(true);
+			MPxDeformerNode::envelope = nAttr.create("envelope", "en", MFnNumericData::kFloat, 1.0);
+		}
+		nodeType->attributes.push_back(MPxDeformerNode::input);
+		nodeType->attributes.push_back(MPxDeformerNode::outputGeom);
+		nodeType->attributes.push_back(MPxDeformerNode::envelope);
+		nodeType->affects.push_back(std::make_pair(MPxDeformerNode::inputGeom, MPxDeformerNode::outputGeom));
+		nodeType->affects.push_back(std::make_pair(MPxDeformerNode::envelope, MPxDeformerNode::outputGeom));
+	}
+
+	g_initializing = nodeType.get();
+	MStatus status = initialize();
+	g_initializing = 0;
+	if (!status)
+		return status;
+
+	g_types.push_back(std::move(nodeType));
+	return MS::kSuccess;
+}
+
+MStatus MFnPlugin::deregisterNode(const MTypeId& typeId)
+{
+	for (size_t i = 0; i < g_types.size(); i++) {
+		if (g_types[i]->id == typeId) {
+			g_types.erase(g_types.begin() + i);
+			return MS::kSuccess;
+		}
+	}
+	return MS::kFailure;
+}
+
+MStatus MFnPlugin::registerCommand(const MString& name, void* (*creator)(), MSyntax (*createSyntax)())
+{
+	if (g_commands.count(name.asChar()))
+		return MS::kFailure;
+	Command command;
+	command.creator = creator;
+	command.createSyntax = createSyntax;
+	g_commands[name.asChar()] = command;
+	return MS::kSuccess;
+}
+
+MStatus MFnPlugin::deregisterCommand(const MString& name)
+{
+	return g_commands.erase(name.asChar()) ? MS::kSuccess : MS::kFailure;
+}
+
+/////////////////////////////////////////////////
+// SHIM
+/////////////////////////////////////////////////
+
+namespace mshim
+{
+	MStatus loadPlugin(MStatus (*initializePlugin)(MObject))
+	{
+		return initializePlugin(MObject());
+	}
+
+	MStatus unloadPlugin(MStatus (*uninitializePlugin)(MObject))
+	{
+		return uninitializePlugin(MObject());
+	}
+
+	MObject createNode(const MString& typeName, MStatus* status)
+	{
+		NodeType* type = findType(typeName.asChar());
+		if (!type) {
+			if (status)
+				*status = MS::kInvalidParameter;
+			return MObject();
+		}
+
+		std::shared_ptr<NodeObject> node(new NodeObject());
+		node->type = type;
+		node->name = type->name + std::to_string(++g_nodeCount[type->name]);
+		node->node.reset(static_cast<MPxNode*>(type->creator()));
+		for (size_t i = 0; i < type->attributes.size(); i++)
+			node->block.values[attribute(type->attributes[i])] = createData(type->attributes[i], false);
+		Access::setSelf(node->node.get(), node);
+		node->node->postConstructor();
+
+		if (status)
+			*status = MS::kSuccess;
+		return MObject(node);
+	}
+
+	std::vector<MObject> attributes(const MObject& node)
+	{
+		std::vector<MObject> out;
+		NodeObject* n = nodeObject(node);
+		for (size_t i = 0; n && i < n->type->attributes.size(); i++)
+			collect(n->type->attributes[i], out);
+		return out;
+	}
+
+	std::vector<MObject> affectedAttributes(const MObject& node)
+	{
+		std::vector<MObject> out;
+		NodeObject* n = nodeObject(node);
+		if (!n)
+			return out;
+		std::vector<MObject> all = attributes(node);
+		for (size_t i = 0; i < all.size(); i++) {
+			for (size_t k = 0; k < n->type->affects.size(); k++) {
+				if (n->type->affects[k].second == all[i]) {
+					out.push_back(all[i]);
+					break;
+				}
+			}
+		}
+		return out;
+	}
+
+	bool isDeformer(const MObject& node)
+	{
+		NodeObject* n = nodeObject(node);
+		return n && n->type->type == MPxNode::kDeformerNode;
+	}
+
+	MDataBlock dataBlock(const MObject& node)
+	{
+		return MDataBlock(block(node));
+	}
+
+	MStatus compute(const MPlug& plug)
+	{
+		NodeObject* n = nodeObject(plug.node());
+		if (!n)
+			return MS::kInvalidParameter;
+		MDataBlock data(&n->block);
+		return n->node->compute(plug, data);
+	}
+
+	MStatus dirty(const MPlug& plug)
+	{
+		NodeObject* n = nodeObject(plug.node());
+		if (!n)
+			return MS::kInvalidParameter;
+		MPlugArray affected;
+		return n->node->setDependentsDirty(plug, affected);
+	}
+
+	MStatus deform(const MObject& node, MPointArray& points, const MMatrix& mat, unsigned multiIndex)
+	{
+		NodeObject* n = nodeObject(node);
+		MPxDeformerNode* deformer = n ? dynamic_cast<MPxDeformerNode*>(n->node.get()) : 0;
+		if (!deformer)
+			return MS::kInvalidParameter;
+		MDataBlock data(&n->block);
+		MItGeometry iter(points);
+		return deformer->deform(data, iter, mat, multiIndex);
+	}
+
+	MStatus runCommand(const MString& name, const MArgList& args)
+	{
+		std::map<std::string, Command>::iterator it = g_commands.find(name.asChar());
+		if (it == g_commands.end())
+			return MS::kInvalidParameter;
+		std::unique_ptr<MPxCommand> command(static_cast<MPxCommand*>(it->second.creator()));
+		Access::setSyntax(command.get(), it->second.createSyntax ? it->second.createSyntax() : MSyntax());
+		MPxCommand::clearResult();
+		return command->doIt(args);
+	}
+}
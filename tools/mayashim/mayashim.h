@@ -0,0 +1,1458 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+#ifndef _mgearMayaShim
+#define _mgearMayaShim
+
+/////////////////////////////////////////////////
+// Stand-in for the part of the Maya API the nodes of src use, so that the
+// real compute() and deform() build and run on a plain Linux box, to drive
+// them from a harness (tools/mgear_node.cpp) under perf or valgrind.
+//
+// Every <maya/...> header of tools/mayashim/maya includes this file. Build
+// the plugin sources against it with -Itools/mayashim and link
+// tools/mayashim/mayashim.cpp.
+//
+// What behaves like Maya:
+//     math classes        MVector, MPoint, MMatrix, MQuaternion,
+//                         MEulerRotation (all orders), MTransformationMatrix
+//                         (no pivots, same model as mgear_math.h but its
+//                         own decomposition), float variants, MAngle, MTime
+//     attributes          numeric (values stored at the precision of their
+//                         type), matrix, enum, unit, compound, typed, arrays
+//     data block          inputValue, outputValue, array handles and builders
+//     geometry            MItGeometry over an MPointArray, MFnNurbsCurve
+//                         (non rational, evaluated like mgear_kernels.h),
+//                         MFnMesh points and ray intersections
+//     ramps               None, Linear and Smooth; Spline is a Catmull-Rom,
+//                         close to Maya's but not the same
+// What doesn't: no dependency graph (nothing is dirtied or pulled, plugs are
+// never connected), no undo, no MEL, commands only parse their flags, the
+// profiler and MGlobal only print.
+//
+// The mshim namespace at the end isn't Maya API: it loads a plugin, creates
+// nodes and reaches their data, for the harness.
+/////////////////////////////////////////////////
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define PLUGIN_EXPORT extern "C"
+#define MAYA_API_VERSION 20220000
+
+class MObject;
+class MPlug;
+class MVector;
+class MPoint;
+class MFloatPoint;
+class MMatrix;
+class MQuaternion;
+class MEulerRotation;
+class MDataBlock;
+class MStringArray;
+
+namespace mshim
+{
+	struct Object;
+	struct Attribute;
+	struct Data;
+	struct Block;
+	struct Access;
+}
+
+/////////////////////////////////////////////////
+// STATUS AND STRINGS
+/////////////////////////////////////////////////
+
+class MStatus
+{
+ public:
+	enum MStatusCode { kSuccess, kFailure, kInsufficientMemory, kInvalidParameter, kLicenseFailure, kUnknownParameter, kNotImplemented, kNotFound, kEndOfFile };
+
+	MStatus() : code(kSuccess) {}
+	MStatus(MStatusCode code) : code(code) {}
+
+	bool operator==(const MStatus& other) const { return code == other.code; }
+	bool operator!=(const MStatus& other) const { return code != other.code; }
+	bool operator==(MStatusCode other) const { return code == other; }
+	bool operator!=(MStatusCode other) const { return code != other; }
+	operator bool() const { return code == kSuccess; }
+
+	MStatusCode statusCode() const { return code; }
+	void perror(const char* message) const;
+	void perror(const class MString& message) const;
+
+ private:
+	MStatusCode code;
+};
+
+inline bool operator==(MStatus::MStatusCode code, const MStatus& status) { return status == code; }
+inline bool operator!=(MStatus::MStatusCode code, const MStatus& status) { return status != code; }
+
+namespace MS
+{
+	const MStatus::MStatusCode kSuccess = MStatus::kSuccess;
+	const MStatus::MStatusCode kFailure = MStatus::kFailure;
+	const MStatus::MStatusCode kInsufficientMemory = MStatus::kInsufficientMemory;
+	const MStatus::MStatusCode kInvalidParameter = MStatus::kInvalidParameter;
+	const MStatus::MStatusCode kUnknownParameter = MStatus::kUnknownParameter;
+	const MStatus::MStatusCode kNotImplemented = MStatus::kNotImplemented;
+	const MStatus::MStatusCode kNotFound = MStatus::kNotFound;
+}
+
+class MString
+{
+ public:
+	MString() {}
+	MString(const char* s) : s(s ? s : "") {}
+	MString(const std::string& s) : s(s) {}
+
+	bool operator==(const MString& other) const { return s == other.s; }
+	bool operator==(const char* other) const { return s == (other ? other : ""); }
+	bool operator!=(const MString& other) const { return s != other.s; }
+	bool operator!=(const char* other) const { return !(*this == other); }
+	MString& operator+=(const MString& other) { s += other.s; return *this; }
+	MString& operator+=(const char* other) { s += other ? other : ""; return *this; }
+	MString& operator+=(double value);
+	MString& operator+=(int value);
+	MString& operator+=(unsigned value);
+
+	const char* asChar() const { return s.c_str(); }
+	unsigned length() const { return (unsigned)s.size(); }
+	MStatus split(char separator, MStringArray& out) const;
+	MString& set(double value, int precision = 14);
+	MString& set(const char* value) { s = value ? value : ""; return *this; }
+	bool isInt() const;
+	int asInt() const;
+	double asDouble() const;
+
+ private:
+	std::string s;
+};
+
+inline MString operator+(const MString& a, const MString& b) { MString s(a); s += b; return s; }
+inline MString operator+(const MString& a, const char* b) { MString s(a); s += b; return s; }
+inline MString operator+(const char* a, const MString& b) { MString s(a); s += b; return s; }
+inline std::ostream& operator<<(std::ostream& os, const MString& s) { return os << s.asChar(); }
+
+class MStringArray
+{
+ public:
+	unsigned length() const { return (unsigned)v.size(); }
+	MString& operator[](unsigned i) { return v[i]; }
+	const MString& operator[](unsigned i) const { return v[i]; }
+	MStatus append(const MString& s) { v.push_back(s); return MS::kSuccess; }
+	MStatus clear() { v.clear(); return MS::kSuccess; }
+
+ private:
+	std::vector<MString> v;
+};
+
+class MTypeId
+{
+ public:
+	MTypeId(unsigned id = 0) : value(id) {}
+	unsigned id() const { return value; }
+	bool operator==(const MTypeId& other) const { return value == other.value; }
+	bool operator!=(const MTypeId& other) const { return value != other.value; }
+
+ private:
+	unsigned value;
+};
+
+/////////////////////////////////////////////////
+// OBJECTS
+/////////////////////////////////////////////////
+
+namespace mshim
+{
+	// What an MObject points to: an attribute, a node or some data
+	struct Object
+	{
+		virtual ~Object() {}
+	};
+}
+
+class MObject
+{
+ public:
+	MObject() {}
+	explicit MObject(const std::shared_ptr<mshim::Object>& object) : object(object) {}
+
+	bool isNull() const { return !object; }
+	bool operator==(const MObject& other) const { return object == other.object; }
+	bool operator!=(const MObject& other) const { return object != other.object; }
+
+	static MObject kNullObj;
+
+	// shim only
+	mshim::Object* get() const { return object.get(); }
+	const std::shared_ptr<mshim::Object>& shared() const { return object; }
+
+ private:
+	std::shared_ptr<mshim::Object> object;
+};
+
+class MObjectArray
+{
+ public:
+	unsigned length() const { return (unsigned)v.size(); }
+	MStatus append(const MObject& o) { v.push_back(o); return MS::kSuccess; }
+	MObject& operator[](unsigned i) { return v[i]; }
+	const MObject& operator[](unsigned i) const { return v[i]; }
+
+ private:
+	std::vector<MObject> v;
+};
+
+class MObjectHandle
+{
+ public:
+	MObjectHandle() {}
+	MObjectHandle(const MObject& o) : handle(o.shared()) {}
+
+	bool isValid() const { return !handle.expired(); }
+	bool isAlive() const { return !handle.expired(); }
+	MObject object() const { return MObject(handle.lock()); }
+	MObject objectRef() const { return object(); }
+
+ private:
+	std::weak_ptr<mshim::Object> handle;
+};
+
+/////////////////////////////////////////////////
+// ARRAYS
+/////////////////////////////////////////////////
+
+// Maya arrays are value types over a buffer, a vector here. Like in Maya,
+// the array MFn*ArrayData::array() returns edits the data object in place:
+// it points p at the vector of the data, a copy gets its own vector.
+template <typename T>
+class mshim_Array
+{
+ public:
+	mshim_Array() : p(&v) {}
+	mshim_Array(unsigned length, const T& value = T()) : v(length, value), p(&v) {}
+	mshim_Array(const mshim_Array& other) : v(*other.p), p(&v) {}
+	mshim_Array(mshim_Array&& other) : v(std::move(other.v)), p(other.p == &other.v ? &v : other.p) {}
+	mshim_Array& operator=(const mshim_Array& other) { if (p != other.p) *p = *other.p; return *this; }
+
+	T& operator[](unsigned i) { return (*p)[i]; }
+	const T& operator[](unsigned i) const { return (*p)[i]; }
+	unsigned length() const { return (unsigned)p->size(); }
+	MStatus setLength(unsigned length) { p->resize(length); return MS::kSuccess; }
+	MStatus append(const T& value) { p->push_back(value); return MS::kSuccess; }
+	MStatus insert(const T& value, unsigned i) { p->insert(p->begin() + i, value); return MS::kSuccess; }
+	MStatus remove(unsigned i) { p->erase(p->begin() + i); return MS::kSuccess; }
+	MStatus set(const T& value, unsigned i) { (*p)[i] = value; return MS::kSuccess; }
+	MStatus clear() { p->clear(); return MS::kSuccess; }
+
+	// shim only, for MFn*ArrayData::array()
+	void mshim_share(mshim_Array& data) { p = data.p; }
+
+ protected:
+	std::vector<T> v;
+	std::vector<T>* p;
+};
+
+class MDoubleArray : public mshim_Array<double>
+{
+ public:
+	MDoubleArray() {}
+	MDoubleArray(unsigned length, double value = 0.0) : mshim_Array<double>(length, value) {}
+	MDoubleArray(const double* values, unsigned length) { v.assign(values, values + length); }
+	MStatus get(double* out) const;
+};
+
+class MFloatArray : public mshim_Array<float>
+{
+ public:
+	MFloatArray() {}
+	MFloatArray(unsigned length, float value = 0.0f) : mshim_Array<float>(length, value) {}
+};
+
+class MIntArray : public mshim_Array<int>
+{
+ public:
+	MIntArray() {}
+	MIntArray(unsigned length, int value = 0) : mshim_Array<int>(length, value) {}
+};
+
+/////////////////////////////////////////////////
+// MATH
+/////////////////////////////////////////////////
+
+namespace MSpace
+{
+	enum Space { kInvalid, kTransform, kPreTransform, kPostTransform, kWorld, kObject = kPreTransform, kLast };
+}
+
+class MFloatVector
+{
+ public:
+	float x, y, z;
+
+	MFloatVector() : x(0), y(0), z(0) {}
+	MFloatVector(float x, float y, float z = 0) : x(x), y(y), z(z) {}
+	MFloatVector(const MVector& v);
+	MFloatVector(const MFloatPoint& p);
+
+	MFloatVector operator+(const MFloatVector& v) const { return MFloatVector(x + v.x, y + v.y, z + v.z); }
+	MFloatVector operator-(const MFloatVector& v) const { return MFloatVector(x - v.x, y - v.y, z - v.z); }
+	MFloatVector operator-() const { return MFloatVector(-x, -y, -z); }
+	MFloatVector operator*(float s) const { return MFloatVector(x * s, y * s, z * s); }
+	MFloatVector operator/(float s) const { return MFloatVector(x / s, y / s, z / s); }
+	float operator*(const MFloatVector& v) const { return x * v.x + y * v.y + z * v.z; }
+	MFloatVector operator^(const MFloatVector& v) const { return MFloatVector(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+	MFloatVector& operator+=(const MFloatVector& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	MFloatVector& operator-=(const MFloatVector& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	MFloatVector& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+	float operator[](unsigned i) const { return i == 0 ? x : (i == 1 ? y : z); }
+	float& operator[](unsigned i) { return i == 0 ? x : (i == 1 ? y : z); }
+
+	float length() const { return std::sqrt(x * x + y * y + z * z); }
+	MFloatVector normal() const { MFloatVector v(*this); v.normalize(); return v; }
+	MStatus normalize();
+};
+
+inline MFloatVector operator*(float s, const MFloatVector& v) { return v * s; }
+
+class MVector
+{
+ public:
+	double x, y, z;
+
+	MVector() : x(0), y(0), z(0) {}
+	MVector(double x, double y, double z = 0) : x(x), y(y), z(z) {}
+	MVector(const MFloatVector& v) : x(v.x), y(v.y), z(v.z) {}
+	MVector(const MPoint& p);
+	MVector(const double v[3]) : x(v[0]), y(v[1]), z(v[2]) {}
+
+	MVector operator+(const MVector& v) const { return MVector(x + v.x, y + v.y, z + v.z); }
+	MVector operator-(const MVector& v) const { return MVector(x - v.x, y - v.y, z - v.z); }
+	MVector operator-() const { return MVector(-x, -y, -z); }
+	MVector operator*(double s) const { return MVector(x * s, y * s, z * s); }
+	MVector operator/(double s) const { return MVector(x / s, y / s, z / s); }
+	double operator*(const MVector& v) const { return x * v.x + y * v.y + z * v.z; }
+	MVector operator^(const MVector& v) const { return MVector(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+	MVector operator*(const MMatrix& m) const;
+	MVector& operator*=(const MMatrix& m);
+	MVector& operator+=(const MVector& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	MVector& operator-=(const MVector& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	MVector& operator*=(double s) { x *= s; y *= s; z *= s; return *this; }
+	MVector& operator/=(double s) { x /= s; y /= s; z /= s; return *this; }
+	bool operator==(const MVector& v) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=(const MVector& v) const { return !(*this == v); }
+	double& operator[](unsigned i) { return i == 0 ? x : (i == 1 ? y : z); }
+	double operator[](unsigned i) const { return i == 0 ? x : (i == 1 ? y : z); }
+
+	double length() const { return std::sqrt(x * x + y * y + z * z); }
+	MVector normal() const { MVector v(*this); v.normalize(); return v; }
+	MStatus normalize();
+	MVector rotateBy(const MQuaternion& q) const;
+	MQuaternion rotateTo(const MVector& v) const;
+	double angle(const MVector& v) const;
+	bool isEquivalent(const MVector& v, double tolerance = 1.0e-10) const;
+
+	static const MVector zero, one, xAxis, yAxis, zAxis, xNegAxis, yNegAxis, zNegAxis;
+};
+
+inline MVector operator*(double s, const MVector& v) { return v * s; }
+
+class MPoint
+{
+ public:
+	double x, y, z, w;
+
+	MPoint() : x(0), y(0), z(0), w(1) {}
+	MPoint(double x, double y, double z = 0, double w = 1) : x(x), y(y), z(z), w(w) {}
+	MPoint(const MVector& v) : x(v.x), y(v.y), z(v.z), w(1) {}
+	MPoint(const MFloatPoint& p);
+
+	MPoint operator+(const MVector& v) const { return MPoint(x + v.x, y + v.y, z + v.z, w); }
+	MPoint operator-(const MVector& v) const { return MPoint(x - v.x, y - v.y, z - v.z, w); }
+	MVector operator-(const MPoint& p) const { return MVector(x - p.x, y - p.y, z - p.z); }
+	MPoint& operator+=(const MVector& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	MPoint& operator-=(const MVector& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	MPoint operator*(double s) const { return MPoint(x * s, y * s, z * s, w * s); }
+	MPoint operator*(const MMatrix& m) const;
+	MPoint& operator*=(const MMatrix& m);
+	bool operator==(const MPoint& p) const { return x == p.x && y == p.y && z == p.z && w == p.w; }
+	double& operator[](unsigned i) { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+	double operator[](unsigned i) const { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+
+	double distanceTo(const MPoint& p) const { return (*this - p).length(); }
+	MStatus cartesianize();
+
+	static const MPoint origin;
+};
+
+class MFloatPoint
+{
+ public:
+	float x, y, z, w;
+
+	MFloatPoint() : x(0), y(0), z(0), w(1) {}
+	MFloatPoint(float x, float y, float z = 0, float w = 1) : x(x), y(y), z(z), w(w) {}
+	MFloatPoint(const MFloatVector& v) : x(v.x), y(v.y), z(v.z), w(1) {}
+	MFloatPoint(const MPoint& p) : x((float)p.x), y((float)p.y), z((float)p.z), w((float)p.w) {}
+
+	MFloatPoint operator+(const MFloatVector& v) const { return MFloatPoint(x + v.x, y + v.y, z + v.z, w); }
+	MFloatVector operator-(const MFloatPoint& p) const { return MFloatVector(x - p.x, y - p.y, z - p.z); }
+};
+
+class MMatrix
+{
+ public:
+	double matrix[4][4];
+
+	MMatrix();
+	MMatrix(const double m[4][4]);
+
+	MMatrix operator*(const MMatrix& m) const;
+	MMatrix& operator*=(const MMatrix& m);
+	MMatrix operator+(const MMatrix& m) const;
+	MMatrix operator-(const MMatrix& m) const;
+	MMatrix operator*(double s) const;
+	double* operator[](unsigned row) { return matrix[row]; }
+	const double* operator[](unsigned row) const { return matrix[row]; }
+	double operator()(unsigned row, unsigned col) const { return matrix[row][col]; }
+	double& operator()(unsigned row, unsigned col) { return matrix[row][col]; }
+	bool operator==(const MMatrix& m) const;
+	bool operator!=(const MMatrix& m) const { return !(*this == m); }
+
+	MMatrix inverse() const;
+	MMatrix transpose() const;
+	MMatrix& setToIdentity();
+	double det3x3() const;
+	double det4x4() const;
+	bool isEquivalent(const MMatrix& m, double tolerance = 1.0e-10) const;
+	MStatus get(double out[4][4]) const;
+
+	static const MMatrix identity;
+};
+
+inline MMatrix operator*(double s, const MMatrix& m) { return m * s; }
+
+class MFloatMatrix
+{
+ public:
+	float matrix[4][4];
+
+	MFloatMatrix();
+	MFloatMatrix(const MMatrix& m);
+	float* operator[](unsigned row) { return matrix[row]; }
+	const float* operator[](unsigned row) const { return matrix[row]; }
+};
+
+class MQuaternion
+{
+ public:
+	double x, y, z, w;
+
+	MQuaternion() : x(0), y(0), z(0), w(1) {}
+	MQuaternion(double x, double y, double z, double w) : x(x), y(y), z(z), w(w) {}
+	MQuaternion(double angle, const MVector& axis);
+	MQuaternion(const MVector& a, const MVector& b, double factor = 1.0);
+	MQuaternion& operator=(const MMatrix& m);
+	MQuaternion& operator=(const MEulerRotation& e);
+
+	// a * b rotates by a then b, like the matrices
+	MQuaternion operator*(const MQuaternion& q) const;
+	MQuaternion& operator*=(const MQuaternion& q) { return *this = *this * q; }
+	MQuaternion operator+(const MQuaternion& q) const { return MQuaternion(x + q.x, y + q.y, z + q.z, w + q.w); }
+	MQuaternion operator-(const MQuaternion& q) const { return MQuaternion(x - q.x, y - q.y, z - q.z, w - q.w); }
+	MQuaternion operator-() const { return MQuaternion(-x, -y, -z, -w); }
+	bool operator==(const MQuaternion& q) const { return x == q.x && y == q.y && z == q.z && w == q.w; }
+	double& operator[](unsigned i) { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+	double operator[](unsigned i) const { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+
+	MMatrix asMatrix() const;
+	MEulerRotation asEulerRotation() const;
+	MQuaternion& normalizeIt();
+	MQuaternion normal() const { MQuaternion q(*this); return q.normalizeIt(); }
+	MQuaternion conjugate() const { return MQuaternion(-x, -y, -z, w); }
+	MQuaternion& conjugateIt() { return *this = conjugate(); }
+	MQuaternion inverse() const;
+	MQuaternion log() const;
+	MQuaternion exp() const;
+	bool getAxisAngle(MVector& axis, double& angle) const;
+	MQuaternion& setAxisAngle(const MVector& axis, double angle) { return *this = MQuaternion(angle, axis); }
+	bool isEquivalent(const MQuaternion& q, double tolerance = 1.0e-10) const;
+
+	static const MQuaternion identity;
+};
+
+inline MQuaternion operator*(double s, const MQuaternion& q) { return MQuaternion(q.x * s, q.y * s, q.z * s, q.w * s); }
+
+// Shortest path spherical interpolation, spin adds full turns
+MQuaternion slerp(const MQuaternion& a, const MQuaternion& b, double t, short spin = 0);
+
+class MEulerRotation
+{
+ public:
+	enum RotationOrder { kXYZ, kYZX, kZXY, kXZY, kYXZ, kZYX };
+
+	double x, y, z;
+	RotationOrder order;
+
+	MEulerRotation() : x(0), y(0), z(0), order(kXYZ) {}
+	MEulerRotation(double x, double y, double z, RotationOrder order = kXYZ) : x(x), y(y), z(z), order(order) {}
+	MEulerRotation(const MVector& v, RotationOrder order = kXYZ) : x(v.x), y(v.y), z(v.z), order(order) {}
+
+	MEulerRotation operator*(double s) const { return MEulerRotation(x * s, y * s, z * s, order); }
+	MEulerRotation& operator*=(double s) { x *= s; y *= s; z *= s; return *this; }
+	MEulerRotation operator+(const MEulerRotation& e) const { return MEulerRotation(x + e.x, y + e.y, z + e.z, order); }
+	double& operator[](unsigned i) { return i == 0 ? x : (i == 1 ? y : z); }
+	double operator[](unsigned i) const { return i == 0 ? x : (i == 1 ? y : z); }
+
+	MQuaternion asQuaternion() const;
+	MMatrix asMatrix() const;
+	MVector asVector() const { return MVector(x, y, z); }
+	MEulerRotation& setValue(double x, double y, double z, RotationOrder order = kXYZ);
+	MEulerRotation& reorderIt(RotationOrder order);
+	MEulerRotation reorder(RotationOrder order) const { MEulerRotation e(*this); return e.reorderIt(order); }
+
+	// the rotation part of m, rows normalized
+	static MEulerRotation decompose(const MMatrix& m, RotationOrder order);
+};
+
+class MTransformationMatrix
+{
+ public:
+	MTransformationMatrix();
+	MTransformationMatrix(const MMatrix& m);
+	MTransformationMatrix& operator=(const MMatrix& m) { return *this = MTransformationMatrix(m); }
+
+	MMatrix asMatrix() const;
+	MMatrix asMatrix(double percent) const;
+	MMatrix asMatrixInverse() const;
+	MMatrix asScaleMatrix() const;
+	MMatrix asRotateMatrix() const;
+	bool isEquivalent(const MTransformationMatrix& other, double tolerance = 1.0e-10) const;
+
+	MVector getTranslation(MSpace::Space space, MStatus* status = 0) const;
+	MStatus setTranslation(const MVector& t, MSpace::Space space);
+	MStatus addTranslation(const MVector& t, MSpace::Space space);
+
+	MQuaternion rotation(MStatus* status = 0) const;
+	MEulerRotation eulerRotation(MStatus* status = 0) const;
+	MTransformationMatrix& rotateTo(const MQuaternion& q, MStatus* status = 0);
+	MTransformationMatrix& rotateTo(const MEulerRotation& e, MStatus* status = 0);
+	MTransformationMatrix& rotateBy(const MQuaternion& q, MSpace::Space space, MStatus* status = 0);
+	MTransformationMatrix& rotateBy(const MEulerRotation& e, MSpace::Space space, MStatus* status = 0);
+	MStatus setRotationQuaternion(double x, double y, double z, double w, MSpace::Space space = MSpace::kTransform);
+	MStatus getRotationQuaternion(double& x, double& y, double& z, double& w, MSpace::Space space = MSpace::kTransform) const;
+
+	MStatus getScale(double scale[3], MSpace::Space space) const;
+	MStatus setScale(const double scale[3], MSpace::Space space);
+	MStatus getShear(double shear[3], MSpace::Space space) const;
+	MStatus setShear(const double shear[3], MSpace::Space space);
+
+	static const MTransformationMatrix identity;
+
+ private:
+	double t[3];
+	double q[4];
+	double s[3];
+	double sh[3];
+};
+
+class MTime
+{
+ public:
+	enum Unit { kInvalid, kHours, kMinutes, kSeconds, kMilliseconds, kGames, kFilm, kPALFrame, kNTSCFrame, kShowScan, kPALField, kNTSCField, kLast };
+
+	MTime() : v(0), u(kFilm) {}
+	MTime(double value, Unit unit = kFilm) : v(value), u(unit) {}
+
+	double value() const { return v; }
+	Unit unit() const { return u; }
+	double as(Unit unit) const;
+	MStatus setValue(double value) { v = value; return MS::kSuccess; }
+	MStatus setUnit(Unit unit) { v = as(unit); u = unit; return MS::kSuccess; }
+
+	bool operator==(const MTime& t) const { return as(kSeconds) == t.as(kSeconds); }
+	bool operator!=(const MTime& t) const { return !(*this == t); }
+	bool operator<(const MTime& t) const { return as(kSeconds) < t.as(kSeconds); }
+	MTime operator-(const MTime& t) const { return MTime(v - t.as(u), u); }
+	MTime operator+(const MTime& t) const { return MTime(v + t.as(u), u); }
+
+	// the unit of the time slider, film (24 fps) until set
+	static Unit uiUnit();
+	static MStatus setUIUnit(Unit unit);
+
+ private:
+	double v;
+	Unit u;
+};
+
+class MAngle
+{
+ public:
+	enum Unit { kInvalid, kRadians, kDegrees, kAngMinutes, kAngSeconds, kLast };
+
+	MAngle() : v(0), u(kRadians) {}
+	MAngle(double value, Unit unit = kRadians) : v(value), u(unit) {}
+
+	double value() const { return v; }
+	Unit unit() const { return u; }
+	double as(Unit unit) const;
+	double asRadians() const { return as(kRadians); }
+	double asDegrees() const { return as(kDegrees); }
+
+ private:
+	double v;
+	Unit u;
+};
+
+class MVectorArray : public mshim_Array<MVector>
+{
+ public:
+	MVectorArray() {}
+	MVectorArray(unsigned length, const MVector& value = MVector()) : mshim_Array<MVector>(length, value) {}
+	MVectorArray(const double values[][3], unsigned length);
+	MStatus get(double out[][3]) const;
+};
+
+class MPointArray : public mshim_Array<MPoint>
+{
+ public:
+	MPointArray() {}
+	MPointArray(unsigned length, const MPoint& value = MPoint()) : mshim_Array<MPoint>(length, value) {}
+};
+
+class MMatrixArray : public mshim_Array<MMatrix>
+{
+ public:
+	MMatrixArray() {}
+	MMatrixArray(unsigned length, const MMatrix& value = MMatrix()) : mshim_Array<MMatrix>(length, value) {}
+};
+
+typedef double double3[3];
+
+/////////////////////////////////////////////////
+// ATTRIBUTE TYPES
+/////////////////////////////////////////////////
+
+class MFnBase
+{
+ public:
+	virtual ~MFnBase() {}
+};
+
+class MFnData : public MFnBase
+{
+ public:
+	enum Type { kInvalid, kNumeric, kPlugin, kPluginGeometry, kString, kMatrix, kStringArray, kDoubleArray, kFloatArray, kIntArray, kPointArray, kVectorArray, kMatrixArray, kComponentList, kMesh, kLattice, kNurbsCurve, kNurbsSurface, kSphere, kDynArrayAttrs, kDynSweptGeometry, kSubdSurface, kNObject, kNId, kAny, kLast };
+};
+
+class MFnNumericData : public MFnData
+{
+ public:
+	enum Type { kInvalid, kBoolean, kByte, kChar, kShort, k2Short, k3Short, kLong, kInt = kLong, k2Long, k2Int = k2Long, k3Long, k3Int = k3Long, kInt64, kAddr, kFloat, k2Float, k3Float, kDouble, k2Double, k3Double, k4Double, kLast };
+};
+
+/////////////////////////////////////////////////
+// PLUGS AND DATA
+/////////////////////////////////////////////////
+
+class MPlug
+{
+ public:
+	MPlug() : index(-1) {}
+	MPlug(const MObject& node, const MObject& attribute);
+
+	// the attributes are compared, not the indices
+	bool operator==(const MObject& attribute) const { return attributeObject == attribute; }
+	bool operator!=(const MObject& attribute) const { return attributeObject != attribute; }
+	bool operator==(const MPlug& other) const;
+	bool operator!=(const MPlug& other) const { return !(*this == other); }
+
+	MObject node(MStatus* /*status*/ = 0) const { return nodeObject; }
+	MObject attribute(MStatus* /*status*/ = 0) const { return attributeObject; }
+	bool isNull(MStatus* /*status*/ = 0) const { return attributeObject.isNull(); }
+	MString name(MStatus* status = 0) const;
+	MString partialName(bool includeNodeName = false, bool includeNonMandatoryIndices = false, bool includeInstancedIndices = false,
+		bool useAlias = false, bool useFullAttributePath = false, bool useLongNames = false, MStatus* status = 0) const;
+
+	bool isArray(MStatus* status = 0) const;
+	bool isElement(MStatus* /*status*/ = 0) const { return index >= 0; }
+	bool isCompound(MStatus* status = 0) const;
+	bool isChild(MStatus* status = 0) const;
+	bool isConnected(MStatus* /*status*/ = 0) const { return false; }
+	bool isSource(MStatus* /*status*/ = 0) const { return false; }
+	bool isDestination(MStatus* /*status*/ = 0) const { return false; }
+
+	MPlug array(MStatus* status = 0) const;
+	MPlug parent(MStatus* status = 0) const;
+	unsigned logicalIndex(MStatus* /*status*/ = 0) const { return (unsigned)index; }
+	unsigned numElements(MStatus* status = 0) const;
+	unsigned numConnectedElements(MStatus* /*status*/ = 0) const { return 0; }
+	unsigned numConnectedChildren(MStatus* /*status*/ = 0) const { return 0; }
+	MPlug elementByLogicalIndex(unsigned i, MStatus* status = 0) const;
+	MPlug elementByPhysicalIndex(unsigned i, MStatus* status = 0) const;
+	unsigned numChildren(MStatus* status = 0) const;
+	MPlug child(unsigned i, MStatus* status = 0) const;
+	MPlug child(const MObject& attribute, MStatus* status = 0) const;
+
+	// shim only: the element index, -1 when not an element, and the plug of
+	// the compound above
+	int shimIndex() const { return index; }
+	const MPlug* shimParent() const { return parentPlug.get(); }
+
+ private:
+	MObject nodeObject;
+	MObject attributeObject;
+	int index;
+	std::shared_ptr<MPlug> parentPlug;
+};
+
+class MPlugArray : public mshim_Array<MPlug>
+{
+ public:
+	MPlugArray() {}
+};
+
+class MDataHandle
+{
+ public:
+	MDataHandle() : d(0) {}
+	explicit MDataHandle(mshim::Data* d) : d(d) {}
+
+	bool isNull() const { return !d; }
+	MObject attribute();
+
+	bool asBool() const;
+	char asChar() const;
+	short asShort() const;
+	int asInt() const;
+	int asLong() const { return asInt(); }
+	float asFloat() const;
+	double asDouble() const;
+	const MMatrix& asMatrix() const;
+	const MFloatMatrix& asFloatMatrix() const;
+	MVector& asVector();
+	MFloatVector& asFloatVector();
+	double3& asDouble3();
+	float* asFloat3();
+	MTime asTime() const;
+	MAngle asAngle() const;
+	MObject data() const;
+	MObject asMesh() const { return data(); }
+	MObject asNurbsCurve() const { return data(); }
+
+	void setBool(bool value);
+	void setChar(char value);
+	void setShort(short value);
+	void setInt(int value);
+	void setFloat(float value);
+	void setDouble(double value);
+	void setMMatrix(const MMatrix& m);
+	void setMFloatMatrix(const MFloatMatrix& m);
+	void setMVector(const MVector& v);
+	void setMFloatVector(const MFloatVector& v);
+	void setMTime(const MTime& t);
+	void setMAngle(const MAngle& a);
+	void set3Float(float x, float y, float z);
+	void set3Double(double x, double y, double z);
+	void set(bool value) { setBool(value); }
+	void set(short value) { setShort(value); }
+	void set(int value) { setInt(value); }
+	void set(float value) { setFloat(value); }
+	void set(double value) { setDouble(value); }
+	void set(const MMatrix& m) { setMMatrix(m); }
+	void set(const MVector& v) { setMVector(v); }
+	void set(const MTime& t) { setMTime(t); }
+	void set(const MAngle& a) { setMAngle(a); }
+	MStatus set(const MObject& data);
+	void setClean() {}
+
+	MDataHandle child(const MObject& attribute);
+	MDataHandle child(const MPlug& plug) { return child(plug.attribute()); }
+	MStatus copy(const MDataHandle& other);
+
+	// shim only
+	mshim::Data* shimData() const { return d; }
+
+ private:
+	mshim::Data* d;
+};
+
+class MArrayDataBuilder
+{
+ public:
+	MArrayDataBuilder() {}
+	MArrayDataBuilder(MDataBlock* block, const MObject& attribute, unsigned count, MStatus* status = 0);
+	MArrayDataBuilder(const MObject& attribute, unsigned count, MStatus* status = 0);
+
+	MDataHandle addElement(unsigned index, MStatus* status = 0);
+	MDataHandle addLast(MStatus* status = 0);
+	MStatus removeElement(unsigned index);
+	unsigned elementCount(MStatus* status = 0) const;
+	MStatus growArray(unsigned /*amount*/) { return MS::kSuccess; }
+	MStatus setGrowSize(unsigned /*size*/) { return MS::kSuccess; }
+
+ private:
+	friend class MArrayDataHandle;
+	std::shared_ptr<mshim::Data> d;
+};
+
+class MArrayDataHandle
+{
+ public:
+	explicit MArrayDataHandle(mshim::Data* d) : d(d), position(0) {}
+
+	unsigned elementCount(MStatus* status = 0);
+	MStatus jumpToElement(unsigned logicalIndex);
+	MStatus jumpToArrayElement(unsigned physicalIndex);
+	unsigned elementIndex(MStatus* status = 0);
+	MDataHandle inputValue(MStatus* status = 0);
+	MDataHandle outputValue(MStatus* status = 0);
+	MStatus next();
+	MArrayDataBuilder builder(MStatus* status = 0);
+	MStatus set(const MArrayDataBuilder& builder);
+	MStatus setAllClean() { return MS::kSuccess; }
+	MStatus setClean() { return MS::kSuccess; }
+
+ private:
+	mshim::Data* d;
+	unsigned position;
+};
+
+class MDataBlock
+{
+ public:
+	explicit MDataBlock(mshim::Block* block) : block(block) {}
+
+	MDataHandle inputValue(const MObject& attribute, MStatus* status = 0);
+	MDataHandle inputValue(const MPlug& plug, MStatus* status = 0);
+	MDataHandle outputValue(const MObject& attribute, MStatus* status = 0) { return inputValue(attribute, status); }
+	MDataHandle outputValue(const MPlug& plug, MStatus* status = 0) { return inputValue(plug, status); }
+	MArrayDataHandle inputArrayValue(const MObject& attribute, MStatus* status = 0);
+	MArrayDataHandle inputArrayValue(const MPlug& plug, MStatus* status = 0);
+	MArrayDataHandle outputArrayValue(const MObject& attribute, MStatus* status = 0) { return inputArrayValue(attribute, status); }
+	MArrayDataHandle outputArrayValue(const MPlug& plug, MStatus* status = 0) { return inputArrayValue(plug, status); }
+	MStatus setClean(const MPlug& /*plug*/) { return MS::kSuccess; }
+	MStatus setClean(const MObject& /*attribute*/) { return MS::kSuccess; }
+	bool isClean(const MObject& /*attribute*/, MStatus* /*status*/ = 0) { return false; }
+	bool isClean(const MPlug& /*plug*/, MStatus* /*status*/ = 0) { return false; }
+
+ private:
+	mshim::Block* block;
+};
+
+/////////////////////////////////////////////////
+// NODES
+/////////////////////////////////////////////////
+
+class MEvaluationNode {};
+
+class MNodeCacheDisablingInfo
+{
+ public:
+	void setCacheDisabled(bool /*disabled*/) {}
+	void setReason(const MString& /*reason*/) {}
+};
+
+class MNodeCacheSetupInfo
+{
+ public:
+	enum Preference { kWantToCacheByDefault, kLastPreference };
+	enum Requirement { kSimulationSupport, kLastRequirement };
+
+	MNodeCacheSetupInfo() : preference(false), requirement(false) {}
+	void setPreference(Preference /*p*/, bool value) { preference = value; }
+	bool getPreference(Preference /*p*/) const { return preference; }
+	void setRequirement(Requirement /*r*/, bool value) { requirement = value; }
+	bool getRequirement(Requirement /*r*/) const { return requirement; }
+
+ private:
+	bool preference;
+	bool requirement;
+};
+
+class MCacheSchema
+{
+ public:
+	void add(const MObject& /*attribute*/) {}
+};
+
+class MPxNode
+{
+ public:
+	enum SchedulingType { kParallel, kSerial, kGloballySerial, kUntrusted, kDefaultScheduling = kSerial };
+	enum Type { kDependNode, kLocatorNode, kDeformerNode, kManipContainer, kSurfaceShape, kFieldNode, kEmitterNode, kSpringNode, kIkSolverNode, kHardwareShader, kHwShaderNode, kTransformNode, kObjectSet, kFluidEmitterNode, kImagePlaneNode, kParticleAttributeMapperNode, kCameraSetNode, kConstraintNode, kManipulatorNode, kMotionPathNode, kClientDeviceNode, kThreadedDeviceNode, kAssembly, kSkinCluster, kGeometryFilter, kBlendShape, kLast };
+
+	MPxNode() {}
+	virtual ~MPxNode() {}
+
+	virtual MStatus compute(const MPlug& /*plug*/, MDataBlock& /*data*/) { return MS::kUnknownParameter; }
+	virtual SchedulingType schedulingType() const { return kDefaultScheduling; }
+	virtual void postConstructor() {}
+	virtual MStatus setDependentsDirty(const MPlug& /*plug*/, MPlugArray& /*affected*/) { return MS::kSuccess; }
+	virtual MStatus connectionMade(const MPlug& /*plug*/, const MPlug& /*other*/, bool /*asSrc*/) { return MS::kUnknownParameter; }
+	virtual MStatus connectionBroken(const MPlug& /*plug*/, const MPlug& /*other*/, bool /*asSrc*/) { return MS::kUnknownParameter; }
+	virtual void getCacheSetup(const MEvaluationNode& /*evalNode*/, MNodeCacheDisablingInfo& /*disablingInfo*/, MNodeCacheSetupInfo& /*cacheSetupInfo*/, MObjectArray& /*monitoredAttributes*/) const {}
+	virtual void configCache(const MEvaluationNode& /*evalNode*/, MCacheSchema& /*schema*/) const {}
+
+	MObject thisMObject() const { return MObject(self.lock()); }
+	MString name() const;
+	MTypeId typeId() const;
+	MString typeName() const;
+
+	static MStatus addAttribute(const MObject& attribute);
+	static MStatus attributeAffects(const MObject& whenChanges, const MObject& isAffected);
+
+ private:
+	friend struct mshim::Access;
+	std::weak_ptr<mshim::Object> self;
+};
+
+class MItGeometry
+{
+ public:
+	// shim only, Maya builds it from the geometry data
+	MItGeometry(MPointArray& points) : points(&points), i(0) {}
+
+	bool isDone(MStatus* /*status*/ = 0) const { return i >= points->length(); }
+	MStatus next() { i++; return MS::kSuccess; }
+	MStatus reset() { i = 0; return MS::kSuccess; }
+	int index(MStatus* /*status*/ = 0) const { return (int)i; }
+	int count(MStatus* /*status*/ = 0) const { return (int)points->length(); }
+	int exactCount(MStatus* /*status*/ = 0) const { return (int)points->length(); }
+	MPoint position(MSpace::Space /*space*/ = MSpace::kObject, MStatus* /*status*/ = 0) const { return (*points)[i]; }
+	MStatus setPosition(const MPoint& p, MSpace::Space /*space*/ = MSpace::kObject) { (*points)[i] = p; return MS::kSuccess; }
+	MStatus allPositions(MPointArray& out, MSpace::Space /*space*/ = MSpace::kObject) const { out = *points; return MS::kSuccess; }
+	MStatus setAllPositions(const MPointArray& in, MSpace::Space /*space*/ = MSpace::kObject) { *points = in; return MS::kSuccess; }
+
+ private:
+	MPointArray* points;
+	unsigned i;
+};
+
+class MPxDeformerNode : public MPxNode
+{
+ public:
+	MPxDeformerNode() {}
+	virtual MStatus deform(MDataBlock& /*block*/, MItGeometry& /*iter*/, const MMatrix& /*mat*/, unsigned int /*multiIndex*/) { return MS::kSuccess; }
+
+	static MObject input;
+	static MObject inputGeom;
+	static MObject groupId;
+	static MObject outputGeom;
+	static MObject envelope;
+};
+
+/////////////////////////////////////////////////
+// ATTRIBUTES
+/////////////////////////////////////////////////
+
+class MFnAttribute : public MFnBase
+{
+ public:
+	MFnAttribute() {}
+	MFnAttribute(const MObject& attribute, MStatus* /*status*/ = 0) : attr(attribute) {}
+
+	MObject object() const { return attr; }
+	MString name() const;
+	MString shortName() const;
+	bool isArray() const;
+	MObject parent() const;
+
+	MStatus setKeyable(bool) { return MS::kSuccess; }
+	MStatus setStorable(bool) { return MS::kSuccess; }
+	MStatus setWritable(bool) { return MS::kSuccess; }
+	MStatus setReadable(bool) { return MS::kSuccess; }
+	MStatus setConnectable(bool) { return MS::kSuccess; }
+	MStatus setHidden(bool) { return MS::kSuccess; }
+	MStatus setArray(bool array);
+	MStatus setIndexMatters(bool) { return MS::kSuccess; }
+	MStatus setUsesArrayDataBuilder(bool) { return MS::kSuccess; }
+	MStatus setCached(bool) { return MS::kSuccess; }
+	MStatus setInternal(bool) { return MS::kSuccess; }
+	MStatus setChannelBox(bool) { return MS::kSuccess; }
+	MStatus setAffectsAppearance(bool) { return MS::kSuccess; }
+	MStatus setAffectsWorldSpace(bool) { return MS::kSuccess; }
+	MStatus setNiceNameOverride(const MString&) { return MS::kSuccess; }
+	enum DisconnectBehavior { kDelete, kReset, kNothing };
+	MStatus setDisconnectBehavior(DisconnectBehavior) { return MS::kSuccess; }
+
+ protected:
+	mshim::Attribute* attribute() const;
+	MObject attr;
+};
+
+class MFnNumericAttribute : public MFnAttribute
+{
+ public:
+	MFnNumericAttribute() {}
+	MFnNumericAttribute(const MObject& attribute, MStatus* /*status*/ = 0) : MFnAttribute(attribute) {}
+
+	MObject create(const MString& name, const MString& shortName, MFnNumericData::Type type, double defaultValue = 0, MStatus* status = 0);
+	MObject create(const MString& name, const MString& shortName, const MObject& child1, const MObject& child2, const MObject& child3 = MObject::kNullObj, MStatus* status = 0);
+	MObject createPoint(const MString& name, const MString& shortName, MStatus* status = 0);
+	MObject createColor(const MString& name, const MString& shortName, MStatus* status = 0);
+	MObject child(unsigned i, MStatus* status = 0);
+	MFnNumericData::Type unitType() const;
+
+	MStatus setMin(double) { return MS::kSuccess; }
+	MStatus setMax(double) { return MS::kSuccess; }
+	MStatus setSoftMin(double) { return MS::kSuccess; }
+	MStatus setSoftMax(double) { return MS::kSuccess; }
+	MStatus setMin(double, double, double) { return MS::kSuccess; }
+	MStatus setMax(double, double, double) { return MS::kSuccess; }
+	MStatus setDefault(bool value) { return setDefault((double)value); }
+	MStatus setDefault(int value) { return setDefault((double)value); }
+	MStatus setDefault(float value) { return setDefault((double)value); }
+	MStatus setDefault(double value);
+	MStatus setDefault(double x, double y, double z);
+};
+
+class MFnMatrixAttribute : public MFnAttribute
+{
+ public:
+	enum Type { kFloat, kDouble };
+
+	MObject create(const MString& name, const MString& shortName, Type type = kDouble, MStatus* status = 0);
+	MStatus setDefault(const MMatrix& m);
+};
+
+class MFnUnitAttribute : public MFnAttribute
+{
+ public:
+	enum Type { kInvalid, kAngle, kDistance, kTime, kLast };
+
+	MFnUnitAttribute() {}
+	MFnUnitAttribute(const MObject& attribute, MStatus* /*status*/ = 0) : MFnAttribute(attribute) {}
+
+	MObject create(const MString& name, const MString& shortName, Type type, double defaultValue = 0, MStatus* status = 0);
+	MObject create(const MString& name, const MString& shortName, const MAngle& defaultValue, MStatus* status = 0);
+	MObject create(const MString& name, const MString& shortName, const MTime& defaultValue, MStatus* status = 0);
+	Type unitType() const;
+
+	MStatus setMin(double) { return MS::kSuccess; }
+	MStatus setMax(double) { return MS::kSuccess; }
+	MStatus setSoftMin(double) { return MS::kSuccess; }
+	MStatus setSoftMax(double) { return MS::kSuccess; }
+	MStatus setDefault(double value);
+	MStatus setDefault(const MAngle& value) { return setDefault(value.asRadians()); }
+	MStatus setDefault(const MTime& value);
+};
+
+class MFnEnumAttribute : public MFnAttribute
+{
+ public:
+	MObject create(const MString& name, const MString& shortName, short defaultValue = 0, MStatus* status = 0);
+	MStatus addField(const MString& /*name*/, short /*value*/) { return MS::kSuccess; }
+	MStatus setDefault(short value);
+};
+
+class MFnTypedAttribute : public MFnAttribute
+{
+ public:
+	MObject create(const MString& name, const MString& shortName, MFnData::Type type, const MObject& defaultData = MObject::kNullObj, MStatus* status = 0);
+	MObject create(const MString& name, const MString& shortName, MFnData::Type type, MStatus* status) { return create(name, shortName, type, MObject::kNullObj, status); }
+	MStatus setDefault(const MObject& data);
+};
+
+class MFnCompoundAttribute : public MFnAttribute
+{
+ public:
+	MFnCompoundAttribute() {}
+	MFnCompoundAttribute(const MObject& attribute, MStatus* /*status*/ = 0) : MFnAttribute(attribute) {}
+
+	MObject create(const MString& name, const MString& shortName, MStatus* status = 0);
+	MStatus addChild(const MObject& child);
+	unsigned numChildren(MStatus* status = 0) const;
+	MObject child(unsigned i, MStatus* status = 0) const;
+};
+
+class MRampAttribute
+{
+ public:
+	enum MInterpolation { kNone, kLinear, kSmooth, kSpline };
+
+	MRampAttribute() {}
+	MRampAttribute(const MObject& node, const MObject& attribute, MStatus* status = 0);
+	MRampAttribute(const MPlug& plug, MStatus* status = 0);
+
+	unsigned getNumEntries(MStatus* status = 0);
+	void getEntries(MIntArray& indices, MFloatArray& positions, MFloatArray& values, MIntArray& interps, MStatus* status = 0);
+	void getValueAtPosition(float position, float& value, MStatus* status = 0);
+	MStatus setValueAtIndex(float value, unsigned index);
+	MStatus setPositionAtIndex(float position, unsigned index);
+	MStatus setInterpolationAtIndex(MInterpolation interp, unsigned index);
+	bool isCurveRamp(MStatus* /*status*/ = 0) const { return true; }
+
+	static MObject createCurveRamp(const MString& name, const MString& shortName, MStatus* status = 0);
+
+ private:
+	MDataHandle entry(unsigned index, int child);
+	MObject node;
+	MObject attribute;
+};
+
+/////////////////////////////////////////////////
+// FUNCTION SETS
+/////////////////////////////////////////////////
+
+class MFnDependencyNode : public MFnBase
+{
+ public:
+	MFnDependencyNode() {}
+	MFnDependencyNode(const MObject& node, MStatus* /*status*/ = 0) : node(node) {}
+
+	MStatus setObject(const MObject& o) { node = o; return MS::kSuccess; }
+	MString name(MStatus* status = 0) const;
+	MString typeName(MStatus* status = 0) const;
+	MTypeId typeId(MStatus* status = 0) const;
+	MPxNode* userNode(MStatus* status = 0) const;
+	unsigned attributeCount(MStatus* status = 0) const;
+	MObject attribute(unsigned index, MStatus* status = 0) const;
+	MObject attribute(const MString& name, MStatus* status = 0) const;
+	MPlug findPlug(const MString& name, bool wantNetworkedPlug, MStatus* status = 0) const;
+	MPlug findPlug(const MObject& attribute, bool /*wantNetworkedPlug*/, MStatus* /*status*/ = 0) const { return MPlug(node, attribute); }
+
+ private:
+	MObject node;
+};
+
+class MFnMatrixData : public MFnData
+{
+ public:
+	MFnMatrixData() {}
+	MFnMatrixData(const MObject& data, MStatus* /*status*/ = 0) : object(data) {}
+
+	const MMatrix& matrix(MStatus* status = 0) const;
+	MObject create(const MMatrix& m, MStatus* status = 0);
+	MStatus set(const MMatrix& m);
+
+ private:
+	MObject object;
+};
+
+class MFnDoubleArrayData : public MFnData
+{
+ public:
+	MFnDoubleArrayData() {}
+	MFnDoubleArrayData(const MObject& data, MStatus* /*status*/ = 0) : object(data) {}
+
+	MDoubleArray array(MStatus* status = 0) const;
+	MObject create(const MDoubleArray& values, MStatus* status = 0);
+	MObject create(MStatus* status = 0) { return create(MDoubleArray(), status); }
+	MStatus set(const MDoubleArray& values);
+	unsigned length(MStatus* /*status*/ = 0) const { return array().length(); }
+	double operator[](unsigned i) const { return array()[i]; }
+
+ private:
+	MObject object;
+};
+
+class MFnVectorArrayData : public MFnData
+{
+ public:
+	MFnVectorArrayData() {}
+	MFnVectorArrayData(const MObject& data, MStatus* /*status*/ = 0) : object(data) {}
+
+	MVectorArray array(MStatus* status = 0) const;
+	MObject create(const MVectorArray& values, MStatus* status = 0);
+	MObject create(MStatus* status = 0) { return create(MVectorArray(), status); }
+	MStatus set(const MVectorArray& values);
+	unsigned length(MStatus* /*status*/ = 0) const { return array().length(); }
+	MVector operator[](unsigned i) const { return array()[i]; }
+
+ private:
+	MObject object;
+};
+
+class MFnMeshData : public MFnData
+{
+ public:
+	MObject create(MStatus* status = 0);
+};
+
+class MMeshIsectAccelParams {};
+
+class MFnMesh : public MFnBase
+{
+ public:
+	MFnMesh() {}
+	MFnMesh(const MObject& mesh, MStatus* status = 0);
+
+	// polygonCounts vertices per face, polygonConnects their indices;
+	// parentOrOwner is the data created by MFnMeshData::create()
+	MObject create(int numVertices, int numPolygons, const MPointArray& vertexArray, const MIntArray& polygonCounts, const MIntArray& polygonConnects,
+		MObject& parentOrOwner, MStatus* status = 0);
+	int numVertices(MStatus* status = 0) const;
+	int numPolygons(MStatus* status = 0) const;
+	MStatus getPoint(int index, MPoint& point, MSpace::Space space = MSpace::kObject) const;
+	MStatus getPoints(MPointArray& points, MSpace::Space space = MSpace::kObject) const;
+
+	// Brute force over the triangle fans of the faces, accelParams is
+	// ignored and so are the face and triangle ids filters
+	bool closestIntersection(const MFloatPoint& raySource, const MFloatVector& rayDirection, const MIntArray* faceIds, const MIntArray* triIds,
+		bool idsSorted, MSpace::Space space, float maxParam, bool testBothDirections, MMeshIsectAccelParams* accelParams,
+		MFloatPoint& hitPoint, float* hitRayParam, int* hitFace, int* hitTriangle, float* hitBary1, float* hitBary2,
+		float tolerance = 1e-6, MStatus* status = 0);
+
+ private:
+	MObject object;
+};
+
+class MFnNurbsCurveData : public MFnData
+{
+ public:
+	MObject create(MStatus* status = 0);
+};
+
+class MFnNurbsCurve : public MFnBase
+{
+ public:
+	enum Form { kInvalid, kOpen, kClosed, kPeriodic, kLast };
+
+	MFnNurbsCurve() {}
+	MFnNurbsCurve(const MObject& curve, MStatus* /*status*/ = 0) : object(curve) {}
+
+	// knots in Maya's convention, cvs + degree - 1 of them; parentOrOwner is
+	// the data created by MFnNurbsCurveData::create()
+	MObject create(const MPointArray& cvs, const MDoubleArray& knots, unsigned degree, Form form, bool create2D, bool createRational,
+		MObject& parentOrOwner, MStatus* status = 0);
+
+	int numCVs(MStatus* status = 0) const;
+	int numKnots(MStatus* status = 0) const;
+	int degree(MStatus* status = 0) const;
+	Form form(MStatus* /*status*/ = 0) const { return kOpen; }
+	MStatus getCVs(MPointArray& cvs, MSpace::Space space = MSpace::kObject) const;
+	MStatus getKnots(MDoubleArray& knots) const;
+	MStatus getKnotDomain(double& start, double& end) const;
+	double length(double tolerance = 1.0e-3, MStatus* status = 0) const;
+	double findParamFromLength(double length, MStatus* status = 0) const;
+	MStatus getPointAtParam(double param, MPoint& point, MSpace::Space space = MSpace::kObject) const;
+	MVector tangent(double param, MSpace::Space space = MSpace::kObject, MStatus* status = 0) const;
+
+ private:
+	MObject object;
+};
+
+class MDagModifier {};
+
+/////////////////////////////////////////////////
+// PLUGIN, COMMANDS AND PROFILER
+/////////////////////////////////////////////////
+
+class MGlobal
+{
+ public:
+	static void displayInfo(const MString& message);
+	static void displayWarning(const MString& message);
+	static void displayError(const MString& message);
+	static MStatus executeCommand(const MString& /*command*/, bool /*displayEnabled*/ = false, bool /*undoEnabled*/ = false) { return MS::kFailure; }
+};
+
+class MSyntax
+{
+ public:
+	enum MArgType { kInvalidArgType, kNoArg, kBoolean, kLong, kUnsigned, kDouble, kString, kUnsigned64, kDistance, kAngle, kTime, kSelectionItem, kLastArgType };
+
+	MStatus addFlag(const char* shortName, const char* longName, MArgType type = kNoArg);
+	MStatus addFlag(const char* shortName, const char* longName, MArgType type1, MArgType /*type2*/) { return addFlag(shortName, longName, type1); }
+	void useSelectionAsDefault(bool) {}
+	MStatus enableQuery(bool = true) { return MS::kSuccess; }
+	MStatus enableEdit(bool = true) { return MS::kSuccess; }
+
+ private:
+	friend class MArgDatabase;
+	struct Flag
+	{
+		std::string shortName;
+		std::string longName;
+		MArgType type;
+	};
+	std::vector<Flag> flags;
+};
+
+class MArgList
+{
+ public:
+	unsigned length(MStatus* /*status*/ = 0) const { return args.length(); }
+	MString asString(unsigned i, MStatus* /*status*/ = 0) const { return args[i]; }
+	MStatus addArg(const MString& arg) { return args.append(arg); }
+	MStatus addArg(const char* arg) { return args.append(arg); }
+
+ private:
+	MStringArray args;
+};
+
+class MArgDatabase
+{
+ public:
+	MArgDatabase(const MSyntax& syntax, const MArgList& args, MStatus* status = 0);
+
+	bool isFlagSet(const char* flag, MStatus* status = 0) const;
+	MStatus getFlagArgument(const char* flag, unsigned index, MString& value) const;
+	MStatus getFlagArgument(const char* flag, unsigned index, bool& value) const;
+	MStatus getFlagArgument(const char* flag, unsigned index, int& value) const;
+	MStatus getFlagArgument(const char* flag, unsigned index, double& value) const;
+
+ private:
+	const MString* argument(const char* flag) const;
+	std::map<std::string, MString> values;	// long flag name to argument
+	std::map<std::string, std::string> names;	// short or long name to long name
+};
+
+class MPxCommand
+{
+ public:
+	MPxCommand() {}
+	virtual ~MPxCommand() {}
+
+	virtual MStatus doIt(const MArgList& /*args*/) { return MS::kSuccess; }
+	virtual MStatus undoIt() { return MS::kSuccess; }
+	virtual MStatus redoIt() { return MS::kSuccess; }
+	virtual bool isUndoable() const { return false; }
+	MSyntax syntax() const { return syntaxValue; }
+
+	static void setResult(const MString& result);
+	static void setResult(int result);
+	static void setResult(bool result);
+	static void setResult(double result);
+	static void clearResult();
+	static void appendToResult(const MString& result);
+
+	// shim only: the result of the last command
+	static MString shimResult();
+
+ private:
+	friend struct mshim::Access;
+	MSyntax syntaxValue;
+};
+
+// Recording isn't implemented, categories are never enabled
+class MProfiler
+{
+ public:
+	enum ProfilingColor { kColorA_L1, kColorA_L2, kColorA_L3, kColorB_L1, kColorB_L2, kColorB_L3, kColorC_L1, kColorC_L2, kColorC_L3, kColorD_L1, kColorD_L2, kColorD_L3, kColorE_L1, kColorE_L2, kColorE_L3, kColorG_L1, kColorG_L2, kColorG_L3 };
+
+	static int addCategory(const char* /*name*/, const char* /*description*/ = 0) { return 0; }
+	static int removeCategory(const char* /*name*/) { return 0; }
+	static bool isCategoryEnabled(int /*category*/) { return false; }
+	static int eventBegin(int /*category*/, ProfilingColor /*color*/, const char* /*name*/, const char* /*description*/ = 0, const MObject* /*object*/ = 0) { return -1; }
+	static void eventEnd(int /*eventId*/) {}
+};
+
+class MProfilingScope
+{
+ public:
+	MProfilingScope(int /*category*/, MProfiler::ProfilingColor /*color*/, const char* /*name*/, const char* /*description*/ = 0, const MObject* /*object*/ = 0, MStatus* /*status*/ = 0) {}
+};
+
+class MFnPlugin : public MFnBase
+{
+ public:
+	MFnPlugin(MObject& /*object*/, const char* /*vendor*/ = "Unknown", const char* /*version*/ = "Unknown", const char* /*requiredApiVersion*/ = "Any", MStatus* /*status*/ = 0) {}
+
+	MStatus registerNode(const MString& typeName, const MTypeId& typeId, void* (*creator)(), MStatus (*initialize)(), MPxNode::Type type = MPxNode::kDependNode,
+		const MString* classification = 0);
+	MStatus deregisterNode(const MTypeId& typeId);
+	MStatus registerCommand(const MString& name, void* (*creator)(), MSyntax (*createSyntax)() = 0);
+	MStatus deregisterCommand(const MString& name);
+};
+
+/////////////////////////////////////////////////
+// SHIM
+/////////////////////////////////////////////////
+
+namespace mshim
+{
+	enum AttributeKind { kNumeric, kMatrix, kEnum, kUnit, kTyped, kCompound };
+
+	// An attribute of a node type, what the MObject of an MFn*Attribute::create
+	// points to
+	struct Attribute : Object
+	{
+		std::string name;
+		std::string shortName;
+		AttributeKind kind;
+		int type;	// MFnNumericData::Type, MFnData::Type or MFnUnitAttribute::Type
+		double defaults[3];
+		double defaultMatrix[4][4];
+		MObject defaultData;
+		bool array;
+		std::vector<MObject> children;
+		Attribute* parent;
+
+		Attribute() : kind(kNumeric), type(0), array(false), parent(0)
+		{
+			defaults[0] = defaults[1] = defaults[2] = 0.0;
+			for (int i = 0; i < 16; i++)
+				defaultMatrix[i / 4][i % 4] = (i % 5 == 0) ? 1.0 : 0.0;
+		}
+
+		const Attribute* child(unsigned i) const { return static_cast<const Attribute*>(children[i].get()); }
+	};
+
+	inline Attribute* attribute(const MObject& o) { return dynamic_cast<Attribute*>(o.get()); }
+
+	// Runs initializePlugin() of a plugin, the node types and commands it
+	// registers can then be created
+	MStatus loadPlugin(MStatus (*initializePlugin)(MObject));
+	MStatus unloadPlugin(MStatus (*uninitializePlugin)(MObject));
+
+	// A new node of a registered type, named like Maya does (type + number).
+	// It lives as long as an MObject refers to it.
+	MObject createNode(const MString& typeName, MStatus* status = 0);
+
+	// Every attribute of the type of a node, children included, in the order
+	// they were added, and the ones affected by another
+	std::vector<MObject> attributes(const MObject& node);
+	std::vector<MObject> affectedAttributes(const MObject& node);
+	bool isDeformer(const MObject& node);
+
+	// The data of a node, given to compute() and deform()
+	MDataBlock dataBlock(const MObject& node);
+
+	// compute() of the plug, through setDependentsDirty() for inputs
+	MStatus compute(const MPlug& plug);
+	MStatus dirty(const MPlug& plug);
+
+	// deform() over points, mat being the world matrix of the geometry
+	MStatus deform(const MObject& node, MPointArray& points, const MMatrix& mat, unsigned multiIndex = 0);
+
+	// Creates and runs a registered command
+	MStatus runCommand(const MString& name, const MArgList& args);
+}
+
+
+#endif
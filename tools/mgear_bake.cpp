@@ -0,0 +1,1348 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+
+/////////////////////////////////////////////////
+// Bakes solver outputs over animation data, without Maya.
+//
+// Build from the repository root:
+//     g++ -O2 -std=c++11 -pthread -Isrc tools/mgear_bake.cpp -o mgear_bake
+// and run:
+//     mgear_bake <solver> <input> <output.pose> [-threads n] [-trace trace.json]
+//     mgear_bake convert <input.csv> <output.pose>
+//     mgear_bake check <solver> <input> <golden> [-tolerance t]
+//         [-baseline file] [-threshold r] [-update]
+//     mgear_bake diff <output> <golden> [-tolerance t] [-update]
+//
+// Solvers: ikfk2Bone, rollSplineKine, matrixConstraint, intMatrix,
+// slideCurve2, percentageToU, springNode and rotationalSpringNode, evaluated
+// by the kernels of mgear_kernels.h.
+//
+// Input: a pose stream (mgear_poseStream.h), read in place, or a CSV file.
+// One frame (CSV row) per evaluation, the channels (CSV columns of the
+// first line) are named after the node plugs:
+//     scalar         blend, u, stiffness
+//     compound       rotationMultX, goalX
+//     matrix         root[0] .. root[15] (row major)
+//     array element  inputsRoll[2], inputs[2][0] .. inputs[2][15],
+//                    driverList[1].driverListWeight
+//     nurbsCurve     curve.cv[3][0] .. curve.cv[3][2], curve.knot[5] and
+//                    curve.degree (uniform cubic when missing)
+// Missing plugs keep the node default, unknown channels are reported.
+// Two optional channels: frame (the row number when missing) and instance
+// (0 when missing), to bake several nodes from one file. convert turns a
+// CSV file into a pose stream once, to skip the parsing on the next runs.
+//
+// Stateless solvers split the rows between the threads. The springs depend
+// on the previous frames: the rows of an instance are evaluated in order,
+// one thread per instance.
+//
+// Output: a pose stream with a frame per input row, the threads write in
+// the mapped file. The channels are instance, frame, then the outputs named
+// like the inputs (outA[0] .. outA[15], outputX). slideCurve2 also needs a
+// pointCount channel, the cvs of the deformed curve, for its
+// outputGeometry[i][0] .. outputGeometry[i][2].
+//
+// check replays the input through a solver and fails (exit 1) when an
+// output is further than tolerance (relative, 1e-9) from the golden file,
+// or, with a baseline file, when the single thread cost of a row is over
+// the entry of the solver by more than threshold (0.25). The cost is
+// relative to a fixed reference workload timed by the same run, not a time.
+// -update writes the golden file and the baseline entry instead. diff does
+// the same comparison for an output baked elsewhere, mgear_node's. See
+// tools/regression.
+/////////////////////////////////////////////////
+
+#include "mgear_kernels.h"
+#include "mgear_poseStream.h"
+#include "mgear_trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/////////////////////////////////////////////////
+// INPUT
+/////////////////////////////////////////////////
+
+// The input values, one row per evaluation. They are parsed in storage for
+// a CSV file, a pose stream is used in place.
+struct s_Table
+{
+	std::vector<std::string> names;
+	std::map<std::string, int> columns;
+	std::vector<bool> used;
+	const double* data;
+	size_t stride;	// doubles from one row to the next
+	int rows;
+	std::vector<double> storage;
+
+	s_Table() : data(NULL), stride(0), rows(0) {}
+
+	bool addColumn(const std::string& name, std::string& error)
+	{
+		if (columns.count(name)) {
+			error = "duplicated channel " + name;
+			return false;
+		}
+		columns[name] = (int)names.size();
+		names.push_back(name);
+		used.push_back(false);
+		return true;
+	}
+
+	// column of a plug, -1 when missing
+	int column(const std::string& name)
+	{
+		std::map<std::string, int>::const_iterator it = columns.find(name);
+		if (it == columns.end())
+			return -1;
+		used[it->second] = true;
+		return it->second;
+	}
+
+	bool has(const std::string& name) const
+	{
+		return columns.find(name) != columns.end();
+	}
+
+	double value(int row, int column, double defaultValue) const
+	{
+		return (column < 0) ? defaultValue : data[(size_t)row * stride + column];
+	}
+};
+
+static bool readCSV(const char* path, s_Table& table, std::string& error)
+{
+	FILE* file = std::fopen(path, "rb");
+	if (!file) {
+		error = std::string("can't open ") + path;
+		return false;
+	}
+	std::string text;
+	char buffer[1 << 16];
+	size_t n;
+	while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, n);
+	std::fclose(file);
+
+	size_t start = 0;
+	int line = 0;
+	while (start < text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string row = text.substr(start, end - start);
+		start = end + 1;
+		line++;
+		if (!row.empty() && row[row.size() - 1] == '\r')
+			row.erase(row.size() - 1);
+		if (row.empty())
+			continue;
+
+		if (table.names.empty()) {
+			std::stringstream ss(row);
+			std::string name;
+			while (std::getline(ss, name, ',')) {
+				size_t first = name.find_first_not_of(" \t");
+				size_t last = name.find_last_not_of(" \t");
+				name = (first == std::string::npos) ? "" : name.substr(first, last - first + 1);
+				if (!table.addColumn(name, error))
+					return false;
+			}
+			continue;
+		}
+
+		const char* p = row.c_str();
+		for (size_t i = 0; i < table.names.size(); i++) {
+			char* next;
+			double v = std::strtod(p, &next);
+			if (next == p || (*next != ',' && *next != '\0') || (*next == '\0') != (i + 1 == table.names.size())) {
+				std::ostringstream ss;
+				ss << path << ":" << line << ": expected " << table.names.size() << " numbers";
+				error = ss.str();
+				return false;
+			}
+			table.storage.push_back(v);
+			p = next + 1;
+		}
+		table.rows++;
+	}
+
+	if (table.names.empty()) {
+		error = std::string(path) + " is empty";
+		return false;
+	}
+	table.data = table.storage.empty() ? NULL : &table.storage[0];
+	table.stride = table.names.size();
+	return true;
+}
+
+static bool readPoseStream(const mgear_PoseStreamReader& stream, s_Table& table, std::string& error)
+{
+	if (stream.frameCount() > (uint64_t)INT32_MAX) {
+		error = "too many frames";
+		return false;
+	}
+	for (uint64_t i = 0; i < stream.channelCount(); i++) {
+		if (!table.addColumn(stream.channelName(i), error))
+			return false;
+	}
+	table.data = stream.frame(0);
+	table.stride = stream.frameStride();
+	table.rows = (int)stream.frameCount();
+	return true;
+}
+
+// A pose stream or a CSV file, from the first bytes
+static bool readInput(const char* path, mgear_PoseStreamReader& stream, s_Table& table, std::string& error)
+{
+	char magic[8] = { 0 };
+	FILE* file = std::fopen(path, "rb");
+	if (!file) {
+		error = std::string("can't open ") + path;
+		return false;
+	}
+	size_t n = std::fread(magic, 1, sizeof(magic), file);
+	std::fclose(file);
+
+	if (!isPoseStream(magic, n))
+		return readCSV(path, table, error);
+	return stream.open(path, error) && readPoseStream(stream, table, error);
+}
+
+// Columns of a matrix plug, identity where they are missing
+struct s_MatrixColumns
+{
+	int c[16];
+
+	void bind(s_Table& table, const std::string& name)
+	{
+		for (int i = 0; i < 16; i++) {
+			std::ostringstream ss;
+			ss << name << "[" << i << "]";
+			c[i] = table.column(ss.str());
+		}
+	}
+
+	void read(const s_Table& table, int row, double m[4][4]) const
+	{
+		for (int i = 0; i < 16; i++)
+			m[i / 4][i % 4] = table.value(row, c[i], (i % 5 == 0) ? 1.0 : 0.0);
+	}
+};
+
+static std::string element(const std::string& name, int index, const std::string& child = "")
+{
+	std::ostringstream ss;
+	ss << name << "[" << index << "]" << child;
+	return ss.str();
+}
+
+static void matrixChannels(const std::string& name, std::vector<std::string>& channels)
+{
+	for (int i = 0; i < 16; i++)
+		channels.push_back(element(name, i));
+}
+
+static void writeMatrix(const double m[4][4], double* out)
+{
+	for (int i = 0; i < 16; i++)
+		out[i] = m[i / 4][i % 4];
+}
+
+/////////////////////////////////////////////////
+// SOLVERS
+/////////////////////////////////////////////////
+
+// A node type: binds the columns it reads and evaluates rows
+class Solver
+{
+ public:
+	virtual ~Solver() {}
+
+	// Resolves the input columns and names the outputs. False with an error
+	// when the table can't be evaluated.
+	virtual bool bind(s_Table& table, std::vector<std::string>& outputs, std::string& error) = 0;
+
+	// Evaluates the rows, in that order for the stateful solvers. The outputs
+	// of row r are written at out + r * stride.
+	virtual void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const = 0;
+
+	virtual bool stateful() const { return false; }
+};
+
+class IkFk2BoneSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string&)
+	{
+		const char* matrices[6] = { "root", "ikref", "upv", "fk0", "fk1", "fk2" };
+		for (int i = 0; i < 6; i++)
+			m[i].bind(table, matrices[i]);
+		const char* parents[4] = { "inAparent", "inBparent", "inCenterparent", "inEffparent" };
+		for (int i = 0; i < 4; i++)
+			parent[i].bind(table, parents[i]);
+
+		blend = table.column("blend");
+		interpolation = table.column("interpolation");
+		lengthA = table.column("lengthA");
+		lengthB = table.column("lengthB");
+		negate = table.column("negate");
+		roll = table.column("roll");
+		scaleA = table.column("scaleA");
+		scaleB = table.column("scaleB");
+		maxstretch = table.column("maxstretch");
+		softness = table.column("softness");
+		slide = table.column("slide");
+		reverse = table.column("reverse");
+
+		const char* names[4] = { "outA", "outB", "outCenter", "outEff" };
+		for (int i = 0; i < 4; i++)
+			matrixChannels(names[i], outputs);
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake ikfk2Bone", count);
+		s_IkFk2BoneInputs in;
+		const s_IkFk2BoneInputs defaults;
+		double result[4][4][4];
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			m[0].read(table, r, in.root);
+			m[1].read(table, r, in.ikref);
+			m[2].read(table, r, in.upv);
+			m[3].read(table, r, in.fk0);
+			m[4].read(table, r, in.fk1);
+			m[5].read(table, r, in.fk2);
+			for (int j = 0; j < 4; j++)
+				parent[j].read(table, r, in.parent[j]);
+
+			// the node reads the sliders as floats
+			in.blend = (float)table.value(r, blend, defaults.blend);
+			in.interpolation = (int)table.value(r, interpolation, defaults.interpolation);
+			in.lengthA = (float)table.value(r, lengthA, defaults.lengthA);
+			in.lengthB = (float)table.value(r, lengthB, defaults.lengthB);
+			in.negate = table.value(r, negate, defaults.negate) != 0.0;
+			in.roll = (float)table.value(r, roll, defaults.roll);
+			in.scaleA = (float)table.value(r, scaleA, defaults.scaleA);
+			in.scaleB = (float)table.value(r, scaleB, defaults.scaleB);
+			in.maxstretch = (float)table.value(r, maxstretch, defaults.maxstretch);
+			in.softness = (float)table.value(r, softness, defaults.softness);
+			in.slide = (float)table.value(r, slide, defaults.slide);
+			in.reverse = (float)table.value(r, reverse, defaults.reverse);
+
+			ikfk2Bone(in, result);
+			for (int j = 0; j < 4; j++)
+				writeMatrix(result[j], out + (size_t)r * stride + j * 16);
+		}
+	}
+
+ private:
+	s_MatrixColumns m[6];
+	s_MatrixColumns parent[4];
+	int blend, interpolation, lengthA, lengthB, negate, roll, scaleA, scaleB, maxstretch, softness, slide, reverse;
+};
+
+class RollSplineKineSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string& error)
+	{
+		// the elements of inputs, ctlParent and inputsRoll go together
+		count = 0;
+		while (table.has(element(element("inputs", count), 0)) || table.has(element(element("ctlParent", count), 0)) || table.has(element("inputsRoll", count)))
+			count++;
+		if (count < 2) {
+			error = "rollSplineKine needs at least two inputs (inputs[0][0] .. inputs[1][15])";
+			return false;
+		}
+		ctlParent.resize(count);
+		inputs.resize(count);
+		inputsRoll.resize(count);
+		for (int i = 0; i < count; i++) {
+			ctlParent[i].bind(table, element("ctlParent", i));
+			inputs[i].bind(table, element("inputs", i));
+			inputsRoll[i] = table.column(element("inputsRoll", i));
+		}
+		outputParent.bind(table, "outputParent");
+		u = table.column("u");
+		resample = table.column("resample");
+		subdiv = table.column("subdiv");
+		absolute = table.column("absolute");
+
+		matrixChannels("output", outputs);
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int n, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake rollSplineKine", n);
+		std::vector<double> parents(count * 16), matrices(count * 16), roll(count);
+		s_RollSplineKineInputs in;
+		const s_RollSplineKineInputs defaults;
+		in.ctlParent = (const double(*)[4][4])&parents[0];
+		in.inputs = (const double(*)[4][4])&matrices[0];
+		in.inputsRoll = &roll[0];
+		in.count = count;
+		double result[4][4];
+		for (int i = 0; i < n; i++) {
+			int r = rows[i];
+			for (int j = 0; j < count; j++) {
+				ctlParent[j].read(table, r, (double(*)[4])&parents[j * 16]);
+				inputs[j].read(table, r, (double(*)[4])&matrices[j * 16]);
+				roll[j] = (float)table.value(r, inputsRoll[j], 0.0);
+			}
+			outputParent.read(table, r, in.outputParent);
+			in.u = (float)table.value(r, u, defaults.u);
+			in.resample = table.value(r, resample, defaults.resample) != 0.0;
+			in.subdiv = (int)table.value(r, subdiv, defaults.subdiv);
+			in.absolute = table.value(r, absolute, defaults.absolute) != 0.0;
+
+			rollSplineKine(in, result);
+			writeMatrix(result, out + (size_t)r * stride);
+		}
+	}
+
+ private:
+	int count;
+	std::vector<s_MatrixColumns> ctlParent, inputs;
+	std::vector<int> inputsRoll;
+	s_MatrixColumns outputParent;
+	int u, resample, subdiv, absolute;
+};
+
+class MatrixConstraintSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string&)
+	{
+		driverMatrix.bind(table, "driverMatrix");
+		driverCount = 0;
+		while (table.has(element("driverList", driverCount, ".driverListMatrix[0]")) || table.has(element("driverList", driverCount, ".driverListWeight")))
+			driverCount++;
+		driverList.resize(driverCount);
+		driverWeight.resize(driverCount);
+		for (int i = 0; i < driverCount; i++) {
+			driverList[i].bind(table, element("driverList", i, ".driverListMatrix"));
+			driverWeight[i] = table.column(element("driverList", i, ".driverListWeight"));
+		}
+		drivenParentInverseMatrix.bind(table, "drivenParentInverseMatrix");
+		drivenRestMatrix.bind(table, "drivenRestMatrix");
+		const char* axes = "XYZ";
+		for (int i = 0; i < 3; i++) {
+			rotationOffset[i] = table.column(std::string("driverRotationOffset") + axes[i]);
+			rotationMult[i] = table.column(std::string("rotationMult") + axes[i]);
+			scaleMult[i] = table.column(std::string("scaleMult") + axes[i]);
+		}
+
+		matrixChannels("outputMatrix", outputs);
+		matrixChannels("outputDriverOffsetMatrix", outputs);
+		const char* vectors[4] = { "translate", "rotate", "scale", "shear" };
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 3; j++)
+				outputs.push_back(std::string(vectors[i]) + axes[j]);
+		}
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake matrixConstraint", count);
+		std::vector<double> drivers(driverCount * 16 + 1), weights(driverCount + 1);
+		s_MatrixConstraintInputs in;
+		in.driverList = (const double(*)[4][4])&drivers[0];
+		in.driverWeights = &weights[0];
+		in.driverCount = driverCount;
+		s_MatrixConstraintOutputs result;
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			driverMatrix.read(table, r, in.driverMatrix);
+			for (int j = 0; j < driverCount; j++) {
+				driverList[j].read(table, r, (double(*)[4])&drivers[j * 16]);
+				weights[j] = table.value(r, driverWeight[j], 1.0);
+			}
+			drivenParentInverseMatrix.read(table, r, in.drivenParentInverseMatrix);
+			drivenRestMatrix.read(table, r, in.drivenRestMatrix);
+			for (int j = 0; j < 3; j++) {
+				in.driverRotationOffset[j] = table.value(r, rotationOffset[j], 0.0);
+				in.rotationMultiplier[j] = table.value(r, rotationMult[j], 1.0);
+				in.scaleMultiplier[j] = table.value(r, scaleMult[j], 1.0);
+			}
+
+			matrixConstraint(in, result);
+			double* o = out + (size_t)r * stride;
+			writeMatrix(result.outputMatrix, o);
+			writeMatrix(result.driverOffsetOutputMatrix, o + 16);
+			for (int j = 0; j < 3; j++) {
+				o[32 + j] = result.translate[j];
+				o[35 + j] = result.rotate[j];
+				o[38 + j] = result.scale[j];
+				o[41 + j] = result.shear[j];
+			}
+		}
+	}
+
+ private:
+	s_MatrixColumns driverMatrix, drivenParentInverseMatrix, drivenRestMatrix;
+	int driverCount;
+	std::vector<s_MatrixColumns> driverList;
+	std::vector<int> driverWeight;
+	int rotationOffset[3], rotationMult[3], scaleMult[3];
+};
+
+class IntMatrixSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string&)
+	{
+		matrixA.bind(table, "matrixA");
+		matrixB.bind(table, "matrixB");
+		blend = table.column("blend");
+		interpolation = table.column("interpolation");
+		matrixChannels("output", outputs);
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake intMatrix", count);
+		double a[4][4], b[4][4], result[4][4];
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			matrixA.read(table, r, a);
+			matrixB.read(table, r, b);
+			interpolateMatrix(a, b, (float)table.value(r, blend, 0.5), (int)table.value(r, interpolation, MGEAR_INTERPOLATE_SLERP), result);
+			writeMatrix(result, out + (size_t)r * stride);
+		}
+	}
+
+ private:
+	s_MatrixColumns matrixA, matrixB;
+	int blend, interpolation;
+};
+
+// Columns of a nurbsCurve plug: <name>.cv[i][0..2], the optional Maya knots
+// <name>.knot[k] (uniform when missing) and <name>.degree (3 when missing)
+struct s_CurveColumns
+{
+	std::vector<int> cv;
+	std::vector<int> knot;
+	int degree;
+
+	bool bind(s_Table& table, const std::string& name, std::string& error)
+	{
+		int count = 0;
+		while (table.has(element(name + ".cv", count, "[0]")))
+			count++;
+		for (int i = 0; i < count; i++) {
+			for (int j = 0; j < 3; j++)
+				cv.push_back(table.column(element(element(name + ".cv", i), j)));
+		}
+		for (int k = 0; table.has(element(name + ".knot", k)); k++)
+			knot.push_back(table.column(element(name + ".knot", k)));
+		degree = table.column(name + ".degree");
+		if (count < 2) {
+			error = "the curve " + name + " needs at least two cvs (" + name + ".cv[0][0] ..)";
+			return false;
+		}
+		return true;
+	}
+
+	void read(const s_Table& table, int row, s_NurbsCurve& curve) const
+	{
+		curve.degree = (int)table.value(row, degree, 3.0);
+		curve.cvs.resize(cv.size());
+		for (size_t i = 0; i < cv.size(); i++)
+			curve.cvs[i] = table.value(row, cv[i], 0.0);
+		curve.knots.resize(knot.size());
+		for (size_t i = 0; i < knot.size(); i++)
+			curve.knots[i] = table.value(row, knot[i], 0.0);
+	}
+};
+
+class SlideCurve2Solver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string& error)
+	{
+		if (!crv.bind(table, "master_crv", error))
+			return false;
+		masterMatrix.bind(table, "master_mat");
+		geometryMatrix.bind(table, "geometryMatrix");
+		slaveLength = table.column("slave_length");
+		masterLength = table.column("master_length");
+		position = table.column("position");
+		maxstretch = table.column("maxstretch");
+		maxsquash = table.column("maxsquash");
+		softness = table.column("softness");
+
+		// the cv count of the deformed curve, the same on every row
+		int column = table.column("pointCount");
+		pointCount = table.rows ? (int)table.value(0, column, 0.0) : 0;
+		for (int r = 0; r < table.rows; r++) {
+			if ((int)table.value(r, column, 0.0) != pointCount) {
+				error = "slideCurve2 needs the same pointCount on every row";
+				return false;
+			}
+		}
+		if (pointCount < 2) {
+			error = "slideCurve2 needs a pointCount channel of 2 or more";
+			return false;
+		}
+		for (int i = 0; i < pointCount; i++) {
+			for (int j = 0; j < 3; j++)
+				outputs.push_back(element(element("outputGeometry", i), j));
+		}
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake slideCurve2", count);
+		s_NurbsCurve curve;
+		s_NurbsEvaluator e;
+		s_SlideCurve2Inputs in;
+		const s_SlideCurve2Inputs defaults;
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			crv.read(table, r, curve);
+			nurbsPrepare(curve, e);
+			masterMatrix.read(table, r, in.masterMatrix);
+			geometryMatrix.read(table, r, in.geometryMatrix);
+			in.slaveLength = (float)table.value(r, slaveLength, defaults.slaveLength);
+			in.masterLength = (float)table.value(r, masterLength, defaults.masterLength);
+			in.position = (float)table.value(r, position, defaults.position);
+			in.maxstretch = (float)table.value(r, maxstretch, defaults.maxstretch);
+			in.maxsquash = (float)table.value(r, maxsquash, defaults.maxsquash);
+			in.softness = (float)table.value(r, softness, defaults.softness);
+
+			double* o = out + (size_t)r * stride;
+			if (!slideCurve2(e, in, pointCount, (double(*)[3])o)) {
+				for (int j = 0; j < pointCount * 3; j++)
+					o[j] = 0.0;
+			}
+		}
+	}
+
+ private:
+	s_CurveColumns crv;
+	s_MatrixColumns masterMatrix, geometryMatrix;
+	int slaveLength, masterLength, position, maxstretch, maxsquash, softness;
+	int pointCount;
+};
+
+class PercentageToUSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string& error)
+	{
+		if (!crv.bind(table, "curve", error))
+			return false;
+		percentage = table.column("percentage");
+		normalizedU = table.column("normalizedU");
+		steps = table.column("steps");
+		outputs.push_back("u");
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake percentageToU", count);
+		s_NurbsCurve curve;
+		s_NurbsEvaluator e;
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			crv.read(table, r, curve);
+			nurbsPrepare(curve, e, false);
+			// percentage and u are floats on the node
+			double u = percentageToU(e, (float)table.value(r, percentage, 0.0), table.value(r, normalizedU, 0.0) != 0.0,
+				(int)table.value(r, steps, 40.0));
+			out[(size_t)r * stride] = (float)u;
+		}
+	}
+
+ private:
+	s_CurveColumns crv;
+	int percentage, normalizedU, steps;
+};
+
+class SpringNodeSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string&)
+	{
+		const char* axes = "XYZ";
+		for (int i = 0; i < 3; i++) {
+			goal[i] = table.column(std::string("goal") + axes[i]);
+			outputs.push_back(std::string("output") + axes[i]);
+		}
+		// the time plug, in frames, or the frame column
+		time = table.has("time") ? table.column("time") : table.column("frame");
+		stiffness = table.column("stiffness");
+		damping = table.column("damping");
+		intensity = table.column("intensity");
+		substeps = table.column("substeps");
+		cacheSize = table.column("cacheSize");
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake springNode", count);
+		// rows in order, the node cache only applies to the rows with a
+		// cacheSize, the ones going back or jumping ahead
+		mgear_springPointSimulation simulation;
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			// goal and output are float points on the node
+			double g[3];
+			for (int j = 0; j < 3; j++)
+				g[j] = (float)table.value(r, goal[j], 0.0);
+			double frame = table.value(r, time, (double)r);
+
+			double result[3];
+			springNode(simulation, g, frame, (float)table.value(r, stiffness, 1.0), (float)table.value(r, damping, 1.0),
+				(float)table.value(r, intensity, 1.0), (int)table.value(r, substeps, 4),
+				(unsigned)std::max(0.0, table.value(r, cacheSize, 0.0)), result);
+			double* o = out + (size_t)r * stride;
+			for (int j = 0; j < 3; j++)
+				o[j] = (float)result[j];
+		}
+	}
+
+	bool stateful() const { return true; }
+
+ private:
+	int goal[3];
+	int time, stiffness, damping, intensity, substeps, cacheSize;
+};
+
+class RotationalSpringNodeSolver : public Solver
+{
+ public:
+	bool bind(s_Table& table, std::vector<std::string>& outputs, std::string&)
+	{
+		goal.bind(table, "goal");
+		matrixChannels("output", outputs);
+		// the time plug, in frames, or the frame column
+		time = table.has("time") ? table.column("time") : table.column("frame");
+		stiffness = table.column("stiffness");
+		damping = table.column("damping");
+		intensity = table.column("intensity");
+		substeps = table.column("substeps");
+		cacheSize = table.column("cacheSize");
+		return true;
+	}
+
+	void evaluate(const s_Table& table, const int* rows, int count, double* out, int stride) const
+	{
+		mgear_TraceScope scope("bake rotationalSpringNode", count);
+		// same rows in order and cacheSize as springNode
+		mgear_springRotationSimulation simulation;
+		double g[4][4], result[4][4];
+		for (int i = 0; i < count; i++) {
+			int r = rows[i];
+			goal.read(table, r, g);
+			double frame = table.value(r, time, (double)r);
+			rotationalSpringNode(simulation, g, frame, (float)table.value(r, stiffness, 1.0), (float)table.value(r, damping, 1.0),
+				(float)table.value(r, intensity, 1.0), (int)table.value(r, substeps, 4),
+				(unsigned)std::max(0.0, table.value(r, cacheSize, 0.0)), result);
+			writeMatrix(result, out + (size_t)r * stride);
+		}
+	}
+
+	bool stateful() const { return true; }
+
+ private:
+	s_MatrixColumns goal;
+	int time, stiffness, damping, intensity, substeps, cacheSize;
+};
+
+static Solver* createSolver(const std::string& name)
+{
+	if (name == "ikfk2Bone")
+		return new IkFk2BoneSolver();
+	if (name == "rollSplineKine")
+		return new RollSplineKineSolver();
+	if (name == "matrixConstraint")
+		return new MatrixConstraintSolver();
+	if (name == "intMatrix")
+		return new IntMatrixSolver();
+	if (name == "slideCurve2")
+		return new SlideCurve2Solver();
+	if (name == "percentageToU")
+		return new PercentageToUSolver();
+	if (name == "springNode")
+		return new SpringNodeSolver();
+	if (name == "rotationalSpringNode")
+		return new RotationalSpringNodeSolver();
+	return NULL;
+}
+
+/////////////////////////////////////////////////
+// BAKE
+/////////////////////////////////////////////////
+
+static int fail(const std::string& error)
+{
+	std::fprintf(stderr, "mgear_bake: %s\n", error.c_str());
+	return 1;
+}
+
+// A solver bound to its input
+struct s_Bake
+{
+	std::unique_ptr<Solver> solver;
+	mgear_PoseStreamReader input;	// stays mapped until the end
+	s_Table table;
+	std::vector<std::string> channels;	// instance, frame, then the solver outputs
+	int instanceColumn;
+	int frameColumn;
+
+	bool open(const char* solverName, const char* path, std::string& error)
+	{
+		solver.reset(createSolver(solverName));
+		if (!solver) {
+			error = std::string("unknown solver ") + solverName;
+			return false;
+		}
+		{
+			mgear_TraceScope scope("read input", 0);
+			if (!readInput(path, input, table, error))
+				return false;
+		}
+		channels.push_back("instance");
+		channels.push_back("frame");
+		instanceColumn = table.column("instance");
+		frameColumn = table.column("frame");
+		if (!solver->bind(table, channels, error))
+			return false;
+		for (size_t i = 0; i < table.names.size(); i++) {
+			if (!table.used[i])
+				std::fprintf(stderr, "mgear_bake: warning, channel %s is not a %s input\n", table.names[i].c_str(), solverName);
+		}
+		return true;
+	}
+
+	// Fills the rows of out, frame by frame. Returns the threads used.
+	int run(int threadCount, double* out, int stride) const
+	{
+		for (int r = 0; r < table.rows; r++) {
+			out[(size_t)r * stride] = table.value(r, instanceColumn, 0.0);
+			out[(size_t)r * stride + 1] = table.value(r, frameColumn, (double)r);
+		}
+
+		// the work items: row ranges for the stateless solvers, the rows of
+		// each instance for the springs
+		std::vector<std::vector<int> > items;
+		if (solver->stateful()) {
+			std::map<double, size_t> instances;
+			for (int r = 0; r < table.rows; r++) {
+				double instance = table.value(r, instanceColumn, 0.0);
+				std::map<double, size_t>::iterator it = instances.find(instance);
+				if (it == instances.end()) {
+					it = instances.insert(std::make_pair(instance, items.size())).first;
+					items.push_back(std::vector<int>());
+				}
+				items[it->second].push_back(r);
+			}
+		}
+		else {
+			// a few chunks per thread so they end together
+			int chunk = std::max(1, table.rows / (threadCount * 8));
+			for (int begin = 0; begin < table.rows; begin += chunk) {
+				items.push_back(std::vector<int>());
+				for (int r = begin; r < std::min(table.rows, begin + chunk); r++)
+					items.back().push_back(r);
+			}
+		}
+
+		std::atomic<size_t> next(0);
+		const Solver& s = *solver;
+		const s_Table& t = table;
+		std::vector<std::thread> threads;
+		for (int n = 0; n < std::min(threadCount, (int)items.size()); n++) {
+			threads.push_back(std::thread([&]() {
+				for (size_t i = next++; i < items.size(); i = next++)
+					s.evaluate(t, &items[i][0], (int)items[i].size(), out + 2, stride);
+			}));
+		}
+		for (size_t n = 0; n < threads.size(); n++)
+			threads[n].join();
+		return (int)threads.size();
+	}
+};
+
+/////////////////////////////////////////////////
+// CHECK
+/////////////////////////////////////////////////
+
+// Best single thread cost of a row over a few batches of at least 50 ms,
+// the solvers are evaluated again until then
+static double nsPerRow(const s_Bake& bake, double* out, int stride)
+{
+	if (!bake.table.rows)
+		return 0.0;
+	double best = 1.0e30;
+	for (int batch = 0; batch < 5; batch++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double elapsed = 0.0;
+		int runs = 0;
+		do {
+			bake.run(1, out, stride);
+			runs++;
+			elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		} while (elapsed < 5.0e7);
+		best = std::min(best, elapsed / ((double)runs * bake.table.rows));
+	}
+	return best;
+}
+
+// Best cost of a fixed reference workload, timed like nsPerRow: two
+// decompositions, a blend and a composition, the bulk of most solvers. The
+// baselines are costs in units of this one, measured by the same process,
+// so they carry over from the machine that recorded them and a busy or
+// throttled machine slows both down.
+static double referenceNs()
+{
+	const int count = 64;
+	std::vector<s_TRS> trs(count);
+	for (int i = 0; i < count; i++) {
+		double a = 0.1 * i;
+		double q[4] = { std::sin(a) * 0.6, std::cos(a) * 0.3, 0.2, 1.0 };
+		s_TRS& t = trs[i];
+		for (int k = 0; k < 3; k++) {
+			t.t[k] = a * (k + 1);
+			t.s[k] = 1.0 + 0.1 * k;
+			t.sh[k] = 0.05 * k;
+		}
+		double n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		for (int k = 0; k < 4; k++)
+			t.q[k] = q[k] / n;
+	}
+	std::vector<double> matrices(count * 16);
+	for (int i = 0; i < count; i++)
+		composeTRS(trs[i], (double(*)[4])&matrices[i * 16]);
+
+	volatile double sink = 0.0;
+	double best = 1.0e30;
+	for (int batch = 0; batch < 5; batch++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double elapsed = 0.0;
+		int runs = 0;
+		do {
+			for (int i = 0; i < count; i++) {
+				s_TRS a, b, c;
+				double m[4][4];
+				decomposeTRS((const double(*)[4])&matrices[i * 16], a);
+				decomposeTRS((const double(*)[4])&matrices[((i + 1) % count) * 16], b);
+				interpolateTRS(a, b, 0.3, c);
+				composeTRS(c, m);
+				sink = sink + m[3][0];
+			}
+			runs++;
+			elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		} while (elapsed < 5.0e7);
+		best = std::min(best, elapsed / ((double)runs * count));
+	}
+	return best;
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix)
+{
+	return s.size() >= suffix.size() && !s.compare(s.size() - suffix.size(), suffix.size(), suffix);
+}
+
+// The golden file: CSV at full precision when the path ends with .csv, so it
+// diffs in review, a pose stream otherwise
+static bool writeGolden(const std::string& path, const std::vector<std::string>& channels, const std::vector<double>& values, int rows, std::string& error)
+{
+	size_t width = channels.size();
+	if (!endsWith(path, ".csv")) {
+		mgear_PoseStreamWriter stream;
+		if (!stream.create(path, channels, (uint64_t)rows, error))
+			return false;
+		for (int r = 0; r < rows; r++)
+			std::memcpy(stream.frame(r), &values[r * width], width * sizeof(double));
+		return stream.close(error);
+	}
+
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (!file) {
+		error = "can't write " + path;
+		return false;
+	}
+	for (size_t i = 0; i < width; i++)
+		std::fprintf(file, i ? ",%s" : "%s", channels[i].c_str());
+	std::fprintf(file, "\n");
+	for (int r = 0; r < rows; r++) {
+		for (size_t i = 0; i < width; i++)
+			std::fprintf(file, i ? ",%.17g" : "%.17g", values[r * width + i]);
+		std::fprintf(file, "\n");
+	}
+	if (std::fclose(file) != 0) {
+		error = "can't write " + path;
+		return false;
+	}
+	return true;
+}
+
+// The lines of a baseline file, "<solver> <cost of a row>", the cost in
+// units of referenceNs(), # for comments
+static bool readBaseline(const std::string& path, std::vector<std::string>& lines)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+	char line[1024];
+	while (std::fgets(line, sizeof(line), file)) {
+		std::string l(line);
+		while (!l.empty() && (l[l.size() - 1] == '\n' || l[l.size() - 1] == '\r'))
+			l.erase(l.size() - 1);
+		lines.push_back(l);
+	}
+	std::fclose(file);
+	return true;
+}
+
+// index of the line of the solver, -1 when missing
+static int baselineLine(const std::vector<std::string>& lines, const std::string& solver, double& cost)
+{
+	for (size_t i = 0; i < lines.size(); i++) {
+		std::istringstream ss(lines[i]);
+		std::string name;
+		if (ss >> name && name == solver && ss >> cost)
+			return (int)i;
+	}
+	return -1;
+}
+
+static bool sameValue(double value, double golden, double tolerance)
+{
+	if (value != value || golden != golden)
+		return value != value && golden != golden;
+	if (value == golden)
+		return true;
+	return std::fabs(value - golden) <= tolerance * (1.0 + std::fabs(golden));
+}
+
+// Compares the outputs with the golden file, prints the mismatches.
+// Returns false when they differ.
+static bool compareGolden(const std::string& name, const std::vector<std::string>& channels, const std::vector<double>& values, int rows,
+	const std::string& goldenPath, double tolerance)
+{
+	mgear_PoseStreamReader goldenStream;
+	s_Table golden;
+	std::string error;
+	if (!readInput(goldenPath.c_str(), goldenStream, golden, error)) {
+		std::printf("%s: FAIL %s\n", name.c_str(), error.c_str());
+		return false;
+	}
+	if (golden.rows != rows) {
+		std::printf("%s: FAIL %d rows, the golden file has %d\n", name.c_str(), rows, golden.rows);
+		return false;
+	}
+
+	bool same = true;
+	int width = (int)channels.size();
+	int mismatches = 0;
+	double worst = 0.0;
+	int worstRow = -1, worstChannel = -1;
+	for (int c = 0; c < width; c++) {
+		int g = golden.column(channels[c]);
+		if (g < 0) {
+			std::printf("%s: FAIL %s is not in the golden file\n", name.c_str(), channels[c].c_str());
+			same = false;
+			continue;
+		}
+		for (int r = 0; r < rows; r++) {
+			double value = values[(size_t)r * width + c];
+			double expected = golden.value(r, g, 0.0);
+			if (sameValue(value, expected, tolerance))
+				continue;
+			mismatches++;
+			double e = (value == value && expected == expected) ? std::fabs(value - expected) / (1.0 + std::fabs(expected)) : 1.0e30;
+			if (worstRow < 0 || e > worst) {
+				worst = e;
+				worstRow = r;
+				worstChannel = c;
+			}
+		}
+	}
+	if (mismatches) {
+		std::printf("%s: FAIL %d values off, the worst is %s on frame %d: %.17g, expected %.17g\n", name.c_str(), mismatches,
+			channels[worstChannel].c_str(), worstRow, values[(size_t)worstRow * width + worstChannel],
+			golden.value(worstRow, golden.column(channels[worstChannel]), 0.0));
+		same = false;
+	}
+	return same;
+}
+
+// Replays the input through the solver and compares the outputs with the
+// golden file, then the cost of a row with the baseline
+static int check(int argc, char** argv)
+{
+	if (argc < 5)
+		return -1;
+	const char* solverName = argv[2];
+	std::string goldenPath = argv[4];
+	std::string baselinePath;
+	double tolerance = 1.0e-9;
+	double threshold = 0.25;
+	bool update = false;
+	for (int i = 5; i < argc; i++) {
+		if (!std::strcmp(argv[i], "-tolerance") && i + 1 < argc)
+			tolerance = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "-baseline") && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (!std::strcmp(argv[i], "-threshold") && i + 1 < argc)
+			threshold = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "-update"))
+			update = true;
+		else
+			return -1;
+	}
+
+	s_Bake bake;
+	std::string error;
+	if (!bake.open(solverName, argv[3], error))
+		return fail(error);
+	int rows = bake.table.rows;
+	int width = (int)bake.channels.size();
+	std::vector<double> values((size_t)rows * width + 1);
+	bake.run(1, &values[0], width);
+
+	// cost of a row in units of the reference workload
+	double ns = 0.0, cost = 0.0;
+	if (!baselinePath.empty()) {
+		std::vector<double> scratch(values.size());
+		ns = nsPerRow(bake, &scratch[0], width);
+		cost = ns / referenceNs();
+	}
+
+	if (update) {
+		if (!writeGolden(goldenPath, bake.channels, values, rows, error))
+			return fail(error);
+		if (!baselinePath.empty()) {
+			std::vector<std::string> lines;
+			readBaseline(baselinePath, lines);
+			double previous;
+			int line = baselineLine(lines, solverName, previous);
+			std::ostringstream ss;
+			ss.setf(std::ios::fixed);
+			ss.precision(2);
+			ss << solverName << " " << cost;
+			if (line < 0)
+				lines.push_back(ss.str());
+			else
+				lines[line] = ss.str();
+			FILE* file = std::fopen(baselinePath.c_str(), "wb");
+			if (!file)
+				return fail("can't write " + baselinePath);
+			for (size_t i = 0; i < lines.size(); i++)
+				std::fprintf(file, "%s\n", lines[i].c_str());
+			std::fclose(file);
+			std::printf("%s: updated %s and %s, %d rows, %.2f (%.1f ns/row)\n", solverName, goldenPath.c_str(), baselinePath.c_str(), rows, cost, ns);
+		}
+		else
+			std::printf("%s: updated %s, %d rows\n", solverName, goldenPath.c_str(), rows);
+		return 0;
+	}
+
+	bool failed = !compareGolden(solverName, bake.channels, values, rows, goldenPath, tolerance);
+
+	// cost
+	if (!baselinePath.empty()) {
+		std::vector<std::string> lines;
+		double expected;
+		if (!readBaseline(baselinePath, lines) || baselineLine(lines, solverName, expected) < 0)
+			std::printf("%s: no baseline in %s, %.2f (%.1f ns/row)\n", solverName, baselinePath.c_str(), cost, ns);
+		else if (cost > expected * (1.0 + threshold)) {
+			std::printf("%s: FAIL %.2f (%.1f ns/row), the baseline is %.2f (+%.0f%%)\n", solverName, cost, ns, expected, threshold * 100.0);
+			failed = true;
+		}
+		else
+			std::printf("%s: %.2f (%.1f ns/row), the baseline is %.2f\n", solverName, cost, ns, expected);
+	}
+
+	if (!failed)
+		std::printf("%s: ok, %d rows, %d outputs\n", solverName, rows, width - 2);
+	return failed ? 1 : 0;
+}
+
+// Compares an output, of mgear_node for instance, with its golden file
+static int diff(int argc, char** argv)
+{
+	if (argc < 4)
+		return -1;
+	std::string goldenPath = argv[3];
+	double tolerance = 1.0e-9;
+	bool update = false;
+	for (int i = 4; i < argc; i++) {
+		if (!std::strcmp(argv[i], "-tolerance") && i + 1 < argc)
+			tolerance = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "-update"))
+			update = true;
+		else
+			return -1;
+	}
+
+	// named after the golden file, without its directory and .golden.csv
+	std::string name = goldenPath.substr(goldenPath.find_last_of('/') + 1);
+	name = name.substr(0, name.rfind(".golden"));
+
+	mgear_PoseStreamReader stream;
+	s_Table table;
+	std::string error;
+	if (!readInput(argv[2], stream, table, error))
+		return fail(error);
+	int rows = table.rows;
+	int width = (int)table.names.size();
+	std::vector<double> values((size_t)rows * width + 1);
+	for (int r = 0; r < rows; r++) {
+		for (int c = 0; c < width; c++)
+			values[(size_t)r * width + c] = table.value(r, c, 0.0);
+	}
+
+	if (update) {
+		if (!writeGolden(goldenPath, table.names, values, rows, error))
+			return fail(error);
+		std::printf("%s: updated %s, %d rows\n", name.c_str(), goldenPath.c_str(), rows);
+		return 0;
+	}
+	if (!compareGolden(name, table.names, values, rows, goldenPath, tolerance))
+		return 1;
+	std::printf("%s: ok, %d rows, %d outputs\n", name.c_str(), rows, width - 2);
+	return 0;
+}
+
+/////////////////////////////////////////////////
+// MAIN
+/////////////////////////////////////////////////
+
+static int usage()
+{
+	std::fprintf(stderr, "usage: mgear_bake <solver> <input> <output.pose> [-threads n] [-trace trace.json]\n"
+		"       mgear_bake convert <input.csv> <output.pose>\n"
+		"       mgear_bake check <solver> <input> <golden> [-tolerance t] [-baseline file] [-threshold r] [-update]\n"
+		"       mgear_bake diff <output> <golden> [-tolerance t] [-update]\n"
+		"solvers: ikfk2Bone, rollSplineKine, matrixConstraint, intMatrix, slideCurve2, percentageToU, springNode,\n"
+		"    rotationalSpringNode\n");
+	return 2;
+}
+
+// CSV to pose stream, same channels
+static int convert(const char* input, const char* output)
+{
+	s_Table table;
+	std::string error;
+	if (!readCSV(input, table, error))
+		return fail(error);
+
+	mgear_PoseStreamWriter stream;
+	if (!stream.create(output, table.names, (uint64_t)table.rows, error))
+		return fail(error);
+	for (int r = 0; r < table.rows; r++)
+		std::memcpy(stream.frame(r), table.data + (size_t)r * table.stride, table.names.size() * sizeof(double));
+	if (!stream.close(error))
+		return fail(error);
+
+	std::printf("convert: %d rows, %d channels\n", table.rows, (int)table.names.size());
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+		return usage();
+	if (!std::strcmp(argv[1], "convert"))
+		return (argc == 4) ? convert(argv[2], argv[3]) : usage();
+	if (!std::strcmp(argv[1], "check")) {
+		int status = check(argc, argv);
+		return (status < 0) ? usage() : status;
+	}
+	if (!std::strcmp(argv[1], "diff")) {
+		int status = diff(argc, argv);
+		return (status < 0) ? usage() : status;
+	}
+
+	int threadCount = (int)std::thread::hardware_concurrency();
+	std::string tracePath;
+	for (int i = 4; i < argc; i++) {
+		if (!std::strcmp(argv[i], "-threads") && i + 1 < argc)
+			threadCount = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "-trace") && i + 1 < argc)
+			tracePath = argv[++i];
+		else
+			return usage();
+	}
+	threadCount = std::max(1, threadCount);
+
+	if (!tracePath.empty())
+		mgear_traceStart();
+
+	s_Bake bake;
+	std::string error;
+	if (!bake.open(argv[1], argv[2], error))
+		return fail(error);
+
+	mgear_PoseStreamWriter output;
+	if (!output.create(argv[3], bake.channels, (uint64_t)bake.table.rows, error))
+		return fail(error);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int threads = bake.run(threadCount, output.frame(0), (int)output.frameStride());
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	{
+		mgear_TraceScope scope("write output", bake.table.rows);
+		if (!output.close(error))
+			return fail(error);
+	}
+
+	if (!tracePath.empty() && !mgear_traceStop(tracePath))
+		std::fprintf(stderr, "mgear_bake: can't write %s\n", tracePath.c_str());
+
+	int rows = bake.table.rows;
+	std::printf("%s: %d rows, %d outputs, %d threads, %.3f s (%.1f ns/row)\n", argv[1], rows, (int)bake.channels.size() - 2,
+		threads, seconds, rows ? seconds * 1.0e9 / rows : 0.0);
+	return 0;
+}
@@ -0,0 +1,671 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+/////////////////////////////////////////////////
+// Runs the real compute() and deform() of the plugin nodes over animation
+// data, without Maya, on the API stand-in of tools/mayashim. For profiling
+// the nodes themselves under perf or valgrind, and to check what they read
+// from and write to their plugs against mgear_bake, which calls the kernels
+// of mgear_kernels.h directly.
+//
+// Build from the repository root:
+//     g++ -O2 -g -std=c++11 -pthread -Itools/mayashim -Isrc src/*.cpp
+//         tools/mayashim/mayashim.cpp tools/mgear_node.cpp -o mgear_node
+// and run:
+//     mgear_node <nodeType> <input.pose> <output.pose> [-repeat n]
+//
+// Input: a pose stream, mgear_bake convert makes one from a CSV file. The
+// channels are named after the plugs like for mgear_bake, any attribute of
+// the node can be set:
+//     scalar         blend, rotationMultX (a child, by its own name)
+//     matrix         root[0] .. root[15] (row major)
+//     array element  inputsRoll[2], inputs[2][0] .. inputs[2][15],
+//                    driverList[1].driverListWeight
+//     nurbsCurve     curve.cv[3][0] .. curve.cv[3][2], curve.knot[5] and
+//                    curve.degree (uniform cubic when missing)
+//     double array   values[4], vector arrays values[4][0] .. values[4][2]
+// Unit attributes take Maya's internal units, radians for angles, but time
+// is in frames of MTime::uiUnit(). The frame channel (the row number when
+// missing) drives the time attributes without a channel of their own.
+// Every instance value gets its own node, its rows are evaluated in order.
+//
+// Each plug set goes through setDependentsDirty(), then every attribute
+// affected by another is computed on its own. Deformers are run on
+// pointCount points with the world matrix geometryMatrix[0..15] (identity
+// when missing) instead.
+//
+// Output: a pose stream like mgear_bake's, instance, frame, then the output
+// values named after their plugs (outA[0] .. outA[15], translateX,
+// outputGeometry[i][0] .. outputGeometry[i][2]). The outputs of the first
+// row give the channels. So
+//     mgear_bake check <solver> <input> <output.pose> -tolerance 1e-6
+// compares a node with its kernel. mgear_percentageToU only computes when
+// asked for its percentage plug, not for u: u keeps its default there.
+//
+// -repeat evaluates all the rows n times, for a longer profile. The springs
+// carry on from the previous pass, the output is the first one.
+/////////////////////////////////////////////////
+
+#include "mgear_poseStream.h"
+
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNurbsCurve.h>
+#include <maya/MFnNurbsCurveData.h>
+#include <maya/MFnDoubleArrayData.h>
+#include <maya/MFnVectorArrayData.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+PLUGIN_EXPORT MStatus initializePlugin(MObject obj);
+
+/////////////////////////////////////////////////
+// INPUT
+/////////////////////////////////////////////////
+
+// What a group of channels sets on a node
+enum TargetKind { kTargetValue, kTargetTime, kTargetMatrix, kTargetCurve, kTargetDoubleArray, kTargetVectorArray };
+
+// One step down to a plug: an attribute, and its element for arrays
+struct s_Step
+{
+	MObject attribute;
+	int index;
+};
+
+// A plug of the node and the channels that set it
+struct s_Target
+{
+	std::string name;
+	TargetKind kind;
+	std::vector<s_Step> path;
+	std::vector<int> columns;	// per channel
+	std::vector<std::vector<int> > slots;	// per channel, where the value goes
+
+	MPlug plug(const MObject& node) const
+	{
+		MPlug p(node, path[0].attribute);
+		if (path[0].index >= 0)
+			p = p.elementByLogicalIndex((unsigned)path[0].index);
+		for (size_t i = 1; i < path.size(); i++) {
+			p = p.child(path[i].attribute);
+			if (path[i].index >= 0)
+				p = p.elementByLogicalIndex((unsigned)path[i].index);
+		}
+		return p;
+	}
+};
+
+static int fail(const std::string& error)
+{
+	std::fprintf(stderr, "mgear_node: %s\n", error.c_str());
+	return 1;
+}
+
+static const mshim::Attribute* attributeOf(const MObject& attribute)
+{
+	return mshim::attribute(attribute);
+}
+
+// name[1][2] to name and {1, 2}, false when malformed
+static bool parseSegment(const std::string& segment, std::string& name, std::vector<int>& indices)
+{
+	size_t bracket = segment.find('[');
+	name = segment.substr(0, bracket);
+	indices.clear();
+	while (bracket != std::string::npos) {
+		size_t close = segment.find(']', bracket);
+		if (close == std::string::npos)
+			return false;
+		char* end;
+		std::string number = segment.substr(bracket + 1, close - bracket - 1);
+		long index = std::strtol(number.c_str(), &end, 10);
+		if (number.empty() || *end || index < 0)
+			return false;
+		indices.push_back((int)index);
+		bracket = (close + 1 < segment.size()) ? close + 1 : std::string::npos;
+		if (bracket != std::string::npos && segment[bracket] != '[')
+			return false;
+	}
+	return !name.empty();
+}
+
+static MObject findAttribute(const std::vector<MObject>& attributes, const std::string& name)
+{
+	for (size_t i = 0; i < attributes.size(); i++) {
+		const mshim::Attribute* attr = attributeOf(attributes[i]);
+		if (attr->name == name || attr->shortName == name)
+			return attributes[i];
+	}
+	return MObject();
+}
+
+static MObject findChild(const MObject& parent, const std::string& name)
+{
+	const mshim::Attribute* attr = attributeOf(parent);
+	for (size_t i = 0; i < attr->children.size(); i++) {
+		const mshim::Attribute* child = attr->child((unsigned)i);
+		if (child->name == name || child->shortName == name)
+			return attr->children[i];
+	}
+	return MObject();
+}
+
+// Resolves a channel to a plug, its kind and the slot of the value in it.
+// False when the channel isn't a plug of the node.
+static bool resolveChannel(const MObject& node, const std::string& channel, std::vector<s_Step>& path, TargetKind& kind, std::vector<int>& slot)
+{
+	std::vector<std::string> segments;
+	std::stringstream ss(channel);
+	std::string segment;
+	while (std::getline(ss, segment, '.'))
+		segments.push_back(segment);
+	if (segments.empty())
+		return false;
+
+	std::vector<MObject> attributes = mshim::attributes(node);
+	path.clear();
+	slot.clear();
+	for (size_t s = 0; s < segments.size(); s++) {
+		std::string name;
+		std::vector<int> indices;
+		if (!parseSegment(segments[s], name, indices))
+			return false;
+
+		// curve components
+		if (!path.empty() && attributeOf(path.back().attribute)->kind == mshim::kTyped
+			&& attributeOf(path.back().attribute)->type == MFnData::kNurbsCurve) {
+			if (s + 1 != segments.size())
+				return false;
+			kind = kTargetCurve;
+			if (name == "cv" && indices.size() == 2 && indices[1] < 3)
+				slot.push_back(0);
+			else if (name == "knot" && indices.size() == 1)
+				slot.push_back(1);
+			else if (name == "degree" && indices.empty())
+				slot.push_back(2);
+			else
+				return false;
+			slot.insert(slot.end(), indices.begin(), indices.end());
+			return true;
+		}
+
+		MObject attribute;
+		if (path.empty()) {
+			attribute = findAttribute(attributes, name);
+			if (attribute.isNull())
+				return false;
+			// a child named on its own, under its parents
+			std::vector<MObject> parents;
+			for (const mshim::Attribute* p = attributeOf(attribute)->parent; p; p = p->parent) {
+				for (size_t i = 0; i < attributes.size(); i++) {
+					if (attributes[i].get() == p)
+						parents.insert(parents.begin(), attributes[i]);
+				}
+			}
+			for (size_t i = 0; i < parents.size(); i++) {
+				s_Step step = { parents[i], attributeOf(parents[i])->array ? 0 : -1 };
+				path.push_back(step);
+			}
+		}
+		else {
+			attribute = findChild(path.back().attribute, name);
+			if (attribute.isNull())
+				return false;
+		}
+
+		const mshim::Attribute* attr = attributeOf(attribute);
+		s_Step step = { attribute, -1 };
+		size_t used = 0;
+		if (attr->array) {
+			if (indices.empty())
+				return false;
+			step.index = indices[used++];
+		}
+		path.push_back(step);
+		if (s + 1 < segments.size()) {
+			if (used != indices.size())
+				return false;
+			continue;
+		}
+
+		// the value slot in the plug
+		std::vector<int> rest(indices.begin() + used, indices.end());
+		if (attr->kind == mshim::kMatrix) {
+			if (rest.size() != 1 || rest[0] > 15)
+				return false;
+			kind = kTargetMatrix;
+		}
+		else if (attr->kind == mshim::kTyped && attr->type == MFnData::kDoubleArray) {
+			if (rest.size() != 1)
+				return false;
+			kind = kTargetDoubleArray;
+		}
+		else if (attr->kind == mshim::kTyped && attr->type == MFnData::kVectorArray) {
+			if (rest.size() != 2 || rest[1] > 2)
+				return false;
+			kind = kTargetVectorArray;
+		}
+		else if (attr->kind == mshim::kNumeric || attr->kind == mshim::kEnum || attr->kind == mshim::kUnit) {
+			if (!rest.empty() || !attr->children.empty())
+				return false;
+			kind = (attr->kind == mshim::kUnit && attr->type == MFnUnitAttribute::kTime) ? kTargetTime : kTargetValue;
+		}
+		else
+			return false;
+		slot = rest;
+		return true;
+	}
+	return false;
+}
+
+// Per node values of the targets for a row, then set on the node
+struct s_Staging
+{
+	std::vector<double> values;
+	MMatrix matrix;
+	MPointArray cvs;
+	MDoubleArray knots;
+	int degree;
+	MDoubleArray doubles;
+	MVectorArray vectors;
+};
+
+static void applyTarget(const MObject& node, const MPlug& plug, const s_Target& target, const double* row)
+{
+	MDataBlock data = mshim::dataBlock(node);
+	MDataHandle h = data.inputValue(plug);
+	s_Staging s;
+	s.degree = 3;
+	if (target.kind == kTargetMatrix)
+		s.matrix = h.asMatrix();
+
+	for (size_t c = 0; c < target.columns.size(); c++) {
+		double v = row[target.columns[c]];
+		const std::vector<int>& slot = target.slots[c];
+		switch (target.kind) {
+			case kTargetMatrix:
+				s.matrix.matrix[slot[0] / 4][slot[0] % 4] = v;
+				break;
+			case kTargetCurve:
+				if (slot[0] == 0) {
+					if ((unsigned)slot[1] >= s.cvs.length())
+						s.cvs.setLength((unsigned)slot[1] + 1);
+					s.cvs[(unsigned)slot[1]][(unsigned)slot[2]] = v;
+				}
+				else if (slot[0] == 1) {
+					if ((unsigned)slot[1] >= s.knots.length())
+						s.knots.setLength((unsigned)slot[1] + 1);
+					s.knots[(unsigned)slot[1]] = v;
+				}
+				else
+					s.degree = (int)v;
+				break;
+			case kTargetDoubleArray:
+				if ((unsigned)slot[0] >= s.doubles.length())
+					s.doubles.setLength((unsigned)slot[0] + 1);
+				s.doubles[(unsigned)slot[0]] = v;
+				break;
+			case kTargetVectorArray:
+				if ((unsigned)slot[0] >= s.vectors.length())
+					s.vectors.setLength((unsigned)slot[0] + 1);
+				s.vectors[(unsigned)slot[0]][(unsigned)slot[1]] = v;
+				break;
+			default:
+				s.values.push_back(v);
+				break;
+		}
+	}
+
+	switch (target.kind) {
+		case kTargetValue:
+			h.setDouble(s.values[0]);
+			break;
+		case kTargetTime:
+			h.setMTime(MTime(s.values[0], MTime::uiUnit()));
+			break;
+		case kTargetMatrix:
+			h.setMMatrix(s.matrix);
+			break;
+		case kTargetCurve: {
+			MObject owner = MFnNurbsCurveData().create();
+			MFnNurbsCurve().create(s.cvs, s.knots, (unsigned)s.degree, MFnNurbsCurve::kOpen, false, false, owner);
+			h.set(owner);
+			break;
+		}
+		case kTargetDoubleArray:
+			h.set(MFnDoubleArrayData().create(s.doubles));
+			break;
+		case kTargetVectorArray:
+			h.set(MFnVectorArrayData().create(s.vectors));
+			break;
+	}
+	mshim::dirty(plug);
+}
+
+/////////////////////////////////////////////////
+// OUTPUT
+/////////////////////////////////////////////////
+
+// Appends the values of an output plug, and their names when asked
+static void collectValues(MDataHandle h, const mshim::Attribute* attr, const std::string& name, std::vector<double>& values, std::vector<std::string>* names)
+{
+	std::ostringstream ss;
+	if (attr->kind == mshim::kMatrix) {
+		const MMatrix& m = h.asMatrix();
+		for (int i = 0; i < 16; i++) {
+			values.push_back(m.matrix[i / 4][i % 4]);
+			if (names) {
+				ss.str("");
+				ss << name << "[" << i << "]";
+				names->push_back(ss.str());
+			}
+		}
+	}
+	else if (!attr->children.empty()) {
+		for (size_t i = 0; i < attr->children.size(); i++) {
+			const mshim::Attribute* child = attr->child((unsigned)i);
+			// children of elements keep their path, the others go by their name
+			std::string childName = (name.find('[') != std::string::npos) ? name + "." + child->name : child->name;
+			if (child->array) {
+				MArrayDataHandle ah(h.child(attr->children[i]).shimData());
+				for (unsigned k = 0; k < ah.elementCount(); k++, ah.next()) {
+					ss.str("");
+					ss << childName << "[" << ah.elementIndex() << "]";
+					collectValues(ah.inputValue(), child, ss.str(), values, names);
+				}
+			}
+			else
+				collectValues(h.child(attr->children[i]), child, childName, values, names);
+		}
+	}
+	else if (attr->kind == mshim::kTyped) {
+		MObject data = h.data();
+		if (attr->type == MFnData::kDoubleArray && !data.isNull()) {
+			MDoubleArray a = MFnDoubleArrayData(data).array();
+			for (unsigned i = 0; i < a.length(); i++) {
+				values.push_back(a[i]);
+				if (names) {
+					ss.str("");
+					ss << name << "[" << i << "]";
+					names->push_back(ss.str());
+				}
+			}
+		}
+		else if (attr->type == MFnData::kVectorArray && !data.isNull()) {
+			MVectorArray a = MFnVectorArrayData(data).array();
+			for (unsigned i = 0; i < a.length(); i++) {
+				for (int j = 0; j < 3; j++) {
+					values.push_back(a[i][j]);
+					if (names) {
+						ss.str("");
+						ss << name << "[" << i << "][" << j << "]";
+						names->push_back(ss.str());
+					}
+				}
+			}
+		}
+	}
+	else {
+		values.push_back((attr->kind == mshim::kUnit && attr->type == MFnUnitAttribute::kTime) ? h.asTime().as(MTime::uiUnit()) : h.asDouble());
+		if (names)
+			names->push_back(name);
+	}
+}
+
+// An output plug: computed, then read
+struct s_Output
+{
+	MObject attribute;
+	const mshim::Attribute* attr;
+};
+
+static void collectOutput(const MObject& node, const s_Output& output, std::vector<double>& values, std::vector<std::string>* names)
+{
+	MDataBlock data = mshim::dataBlock(node);
+	if (output.attr->array) {
+		MArrayDataHandle ah = data.outputArrayValue(output.attribute);
+		std::ostringstream ss;
+		for (unsigned k = 0; k < ah.elementCount(); k++, ah.next()) {
+			ss.str("");
+			ss << output.attr->name << "[" << ah.elementIndex() << "]";
+			collectValues(ah.outputValue(), output.attr, ss.str(), values, names);
+		}
+	}
+	else
+		collectValues(data.outputValue(output.attribute), output.attr, output.attr->name, values, names);
+}
+
+/////////////////////////////////////////////////
+// MAIN
+/////////////////////////////////////////////////
+
+static int usage()
+{
+	std::fprintf(stderr, "usage: mgear_node <nodeType> <input.pose> <output.pose> [-repeat n]\n");
+	return 2;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+		return usage();
+	const char* typeName = argv[1];
+	int repeat = 1;
+	for (int i = 4; i < argc; i++) {
+		if (!std::strcmp(argv[i], "-repeat") && i + 1 < argc)
+			repeat = std::max(1, std::atoi(argv[++i]));
+		else
+			return usage();
+	}
+
+	std::string error;
+	mgear_PoseStreamReader input;
+	if (!input.open(argv[2], error))
+		return fail(error);
+	if (!mshim::loadPlugin(initializePlugin))
+		return fail("initializePlugin() failed");
+
+	MStatus status;
+	MObject prototype = mshim::createNode(typeName, &status);
+	if (!status)
+		return fail(std::string("unknown node type ") + typeName);
+	bool deformer = mshim::isDeformer(prototype);
+
+	// the channels, grouped by plug
+	int instanceColumn = (int)input.findChannel("instance");
+	int frameColumn = (int)input.findChannel("frame");
+	int pointCountColumn = deformer ? (int)input.findChannel("pointCount") : -1;
+	int geometryMatrixColumns[16];
+	for (int i = 0; i < 16; i++) {
+		std::ostringstream ss;
+		ss << "geometryMatrix[" << i << "]";
+		geometryMatrixColumns[i] = deformer ? (int)input.findChannel(ss.str()) : -1;
+	}
+
+	std::vector<s_Target> targets;
+	std::map<std::string, size_t> targetIndex;
+	for (uint64_t c = 0; c < input.channelCount(); c++) {
+		std::string channel = input.channelName(c);
+		if (channel == "instance" || channel == "frame" || (deformer && (channel == "pointCount" || channel.compare(0, 15, "geometryMatrix[") == 0)))
+			continue;
+
+		std::vector<s_Step> path;
+		TargetKind kind;
+		std::vector<int> slot;
+		if (!resolveChannel(prototype, channel, path, kind, slot)) {
+			std::fprintf(stderr, "mgear_node: warning, channel %s is not a %s plug\n", channel.c_str(), typeName);
+			continue;
+		}
+		s_Target probe;
+		probe.path = path;
+		std::string name = probe.plug(prototype).partialName(false, false, false, false, true, true).asChar();
+		std::map<std::string, size_t>::iterator it = targetIndex.find(name);
+		if (it == targetIndex.end()) {
+			it = targetIndex.insert(std::make_pair(name, targets.size())).first;
+			targets.push_back(s_Target());
+			targets.back().name = name;
+			targets.back().kind = kind;
+			targets.back().path = path;
+		}
+		targets[it->second].columns.push_back((int)c);
+		targets[it->second].slots.push_back(slot);
+	}
+
+	// time attributes without a channel follow the frame
+	std::vector<MObject> attributes = mshim::attributes(prototype);
+	std::vector<MObject> timeAttributes;
+	for (size_t i = 0; i < attributes.size(); i++) {
+		const mshim::Attribute* attr = attributeOf(attributes[i]);
+		if (attr->kind != mshim::kUnit || attr->type != MFnUnitAttribute::kTime || attr->parent || attr->array)
+			continue;
+		bool set = false;
+		for (size_t t = 0; t < targets.size(); t++)
+			set = set || (targets[t].path.size() == 1 && targets[t].path[0].attribute == attributes[i]);
+		if (!set)
+			timeAttributes.push_back(attributes[i]);
+	}
+
+	// the outputs: affected attributes under no affected parent
+	std::vector<s_Output> outputs;
+	std::vector<MObject> affected = mshim::affectedAttributes(prototype);
+	for (size_t i = 0; i < affected.size() && !deformer; i++) {
+		const mshim::Attribute* attr = attributeOf(affected[i]);
+		bool underAffected = false;
+		for (const mshim::Attribute* p = attr->parent; p; p = p->parent) {
+			for (size_t k = 0; k < affected.size(); k++)
+				underAffected = underAffected || affected[k].get() == p;
+		}
+		if (!underAffected) {
+			s_Output output = { affected[i], attr };
+			outputs.push_back(output);
+		}
+	}
+
+	// evaluation
+	int rows = (int)input.frameCount();
+	std::map<double, MObject> nodes;
+	std::map<double, std::vector<MPlug> > nodePlugs;
+	std::vector<std::string> channels;
+	channels.push_back("instance");
+	channels.push_back("frame");
+	std::vector<double> values;
+	std::vector<double> rowValues;
+	int width = 0;
+	MPointArray points;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < repeat; pass++) {
+		for (int r = 0; r < rows; r++) {
+			const double* row = input.frame((uint64_t)r);
+			double instance = instanceColumn >= 0 ? row[instanceColumn] : 0.0;
+			double frame = frameColumn >= 0 ? row[frameColumn] : (double)r;
+
+			std::map<double, MObject>::iterator it = nodes.find(instance);
+			if (it == nodes.end()) {
+				it = nodes.insert(std::make_pair(instance, nodes.empty() ? prototype : mshim::createNode(typeName))).first;
+				std::vector<MPlug>& plugs = nodePlugs[instance];
+				for (size_t t = 0; t < targets.size(); t++)
+					plugs.push_back(targets[t].plug(it->second));
+			}
+			const MObject& node = it->second;
+			const std::vector<MPlug>& plugs = nodePlugs[instance];
+
+			for (size_t t = 0; t < targets.size(); t++)
+				applyTarget(node, plugs[t], targets[t], row);
+			MDataBlock data = mshim::dataBlock(node);
+			for (size_t t = 0; t < timeAttributes.size(); t++) {
+				data.inputValue(timeAttributes[t]).setMTime(MTime(frame, MTime::uiUnit()));
+				mshim::dirty(MPlug(node, timeAttributes[t]));
+			}
+
+			rowValues.clear();
+			rowValues.push_back(instance);
+			rowValues.push_back(frame);
+			bool first = pass == 0 && r == 0;
+			if (deformer) {
+				int count = pointCountColumn >= 0 ? (int)row[pointCountColumn] : 0;
+				MMatrix mat;
+				for (int i = 0; i < 16; i++) {
+					if (geometryMatrixColumns[i] >= 0)
+						mat.matrix[i / 4][i % 4] = row[geometryMatrixColumns[i]];
+				}
+				points.setLength(0);
+				points.setLength((unsigned)std::max(0, count));
+				mshim::deform(node, points, mat);
+				for (unsigned i = 0; i < points.length(); i++) {
+					for (int j = 0; j < 3; j++) {
+						rowValues.push_back(points[i][j]);
+						if (first) {
+							std::ostringstream ss;
+							ss << "outputGeometry[" << i << "][" << j << "]";
+							channels.push_back(ss.str());
+						}
+					}
+				}
+			}
+			else {
+				for (size_t o = 0; o < outputs.size(); o++) {
+					mshim::compute(MPlug(node, outputs[o].attribute));
+					collectOutput(node, outputs[o], rowValues, first ? &channels : 0);
+				}
+			}
+
+			if (first)
+				width = (int)channels.size();
+			if ((int)rowValues.size() != width) {
+				std::ostringstream ss;
+				ss << "frame " << r << " has " << (int)rowValues.size() - 2 << " outputs, the first one " << width - 2;
+				return fail(ss.str());
+			}
+			if (pass == 0)
+				values.insert(values.end(), rowValues.begin(), rowValues.end());
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	mgear_PoseStreamWriter output;
+	if (!output.create(argv[3], channels, (uint64_t)rows, error))
+		return fail(error);
+	for (int r = 0; r < rows; r++)
+		std::memcpy(output.frame((uint64_t)r), &values[(size_t)r * width], (size_t)width * sizeof(double));
+	if (!output.close(error))
+		return fail(error);
+
+	double evaluated = (double)rows * repeat;
+	std::printf("%s: %d rows, %d nodes, %d outputs, %.3f s (%.1f ns/row)\n", typeName, rows, (int)nodes.size(), width - 2,
+		seconds, evaluated > 0 ? seconds * 1.0e9 / evaluated : 0.0);
+	return 0;
+}
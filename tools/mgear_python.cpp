@@ -0,0 +1,488 @@
+/*
+
+MGEAR is under the terms of the MIT License
+
+Copyright (c) 2016 Jeremie Passerin, Miquel Campos
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Author:     Jeremie Passerin      geerem@hotmail.com  www.jeremiepasserin.com
+Author:     Miquel Campos         hello@miquel-campos.com  www.miquel-campos.com
+Date:       2016 / 10 / 10
+
+*/
+/////////////////////////////////////////////////
+// Python module mgear_kernels: the ikfk2Bone and rollSplineKine kernels of
+// mgear_kernels.h over NumPy arrays, for pipeline tools that need the node
+// results outside of the dependency graph (retargeting, IK/FK matching,
+// game export), in mayapy or any Python 3.
+//
+// Build from the repository root:
+//     g++ -O2 -std=c++11 -pthread -shared -fPIC -Isrc $(python3-config --includes)
+//         tools/mgear_python.cpp -o mgear_kernels$(python3-config --extension-suffix)
+// Windows and macOS link against the Python library of mayapy the usual
+// way. The arrays are read through the buffer protocol, NumPy is only
+// imported at run time: one build works with any NumPy version.
+// tools/regression/check_python.py runs its smoke checks.
+//
+//     import numpy as np, mgear_kernels
+//     out = mgear_kernels.ikfk2Bone(root=roots, ikref=iks, blend=1.0)
+//     out.shape  # (frames, 4, 4, 4): outA, outB, outCenter, outEff
+//
+// Matrices are 4x4 in the Maya layout, translation in the last row, as
+// np.array(MMatrix).reshape(4, 4) or cmds.getAttr on a matrix plug. Every
+// argument takes either one value for all the rows, or an array with a
+// leading row axis: the rows are the frames (or rigs) to evaluate, they
+// must agree between the arguments. The result has the row axis when any
+// argument has it. Missing arguments keep the node defaults, the sliders
+// are rounded to float like the node attributes.
+//
+// The rows are split between threads (all the cores when threads=0), the
+// GIL is released while they run. out= writes in place into a C contiguous
+// float64 array of the result shape.
+/////////////////////////////////////////////////
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "mgear_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static PyObject* numpyModule = NULL;
+
+/////////////////////////////////////////////////
+// ARGUMENTS
+/////////////////////////////////////////////////
+
+// An array argument, as a C contiguous float64 buffer: one item per row,
+// or a single item shared by every row. data is NULL when missing.
+struct s_Argument
+{
+	PyObject* array;
+	Py_buffer view;
+	bool hasView;
+	const double* data;
+	Py_ssize_t size;	// doubles per item
+	Py_ssize_t rows;	// -1 when shared
+
+	s_Argument() : array(NULL), hasView(false), data(NULL), size(1), rows(-1) {}
+	~s_Argument()
+	{
+		if (hasView)
+			PyBuffer_Release(&view);
+		Py_XDECREF(array);
+	}
+
+	const double* row(Py_ssize_t r) const { return rows < 0 ? data : data + r * size; }
+	double value(Py_ssize_t r, double defaultValue) const { return data ? *row(r) : defaultValue; }
+
+	void matrix(Py_ssize_t r, double m[4][4]) const
+	{
+		if (data)
+			std::memcpy(m, row(r), 16 * sizeof(double));
+	}
+
+ private:
+	s_Argument(const s_Argument&);
+	s_Argument& operator=(const s_Argument&);
+};
+
+static std::string shapeString(const Py_ssize_t* shape, int ndim)
+{
+	std::string s = "(";
+	for (int i = 0; i < ndim; i++) {
+		if (i)
+			s += ", ";
+		s += shape[i] < 0 ? std::string("n") : std::to_string((long long)shape[i]);
+	}
+	return s + (ndim == 1 ? ",)" : ")");
+}
+
+// Reads obj as an item of the given shape, or an array of them. -1 in shape
+// takes the size of the array and is filled in.
+static bool readArgument(PyObject* obj, const char* name, Py_ssize_t* shape, int ndim, s_Argument& arg)
+{
+	if (obj == NULL || obj == Py_None)
+		return true;
+
+	arg.array = PyObject_CallMethod(numpyModule, "asarray", "Oss", obj, "float64", "C");
+	if (arg.array == NULL)
+		return false;
+	if (PyObject_GetBuffer(arg.array, &arg.view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0)
+		return false;
+	arg.hasView = true;
+
+	const Py_buffer& v = arg.view;
+	int offset = v.ndim - ndim;
+	bool valid = offset == 0 || offset == 1;
+	for (int i = 0; valid && i < ndim; i++)
+		valid = shape[i] < 0 || shape[i] == v.shape[offset + i];
+	if (!valid) {
+		std::string expected = shapeString(shape, ndim);
+		std::vector<Py_ssize_t> rowShape(1, -1);
+		rowShape.insert(rowShape.end(), shape, shape + ndim);
+		PyErr_Format(PyExc_ValueError, "%s: expected shape %s or %s, got %s", name, expected.c_str(),
+			shapeString(&rowShape[0], ndim + 1).c_str(), shapeString(v.shape, v.ndim).c_str());
+		return false;
+	}
+
+	arg.size = 1;
+	for (int i = 0; i < ndim; i++) {
+		shape[i] = v.shape[offset + i];
+		arg.size *= shape[i];
+	}
+	arg.rows = offset ? v.shape[0] : -1;
+	arg.data = (const double*)v.buf;
+	return true;
+}
+
+// The rows shared by the arguments, -1 when none has a row axis
+static bool rowCount(const s_Argument* const* args, int count, Py_ssize_t& rows)
+{
+	rows = -1;
+	for (int i = 0; i < count; i++) {
+		if (args[i]->rows < 0)
+			continue;
+		if (rows >= 0 && args[i]->rows != rows) {
+			PyErr_Format(PyExc_ValueError, "the arguments have %zd and %zd rows", rows, args[i]->rows);
+			return false;
+		}
+		rows = args[i]->rows;
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////
+// RESULT
+/////////////////////////////////////////////////
+
+// The result array, out when given (checked against the shape), a new one
+// otherwise. rows < 0 leaves the row axis out.
+struct s_Result
+{
+	PyObject* array;
+	Py_buffer view;
+	bool hasView;
+
+	s_Result() : array(NULL), hasView(false) {}
+	~s_Result()
+	{
+		if (hasView)
+			PyBuffer_Release(&view);
+		Py_XDECREF(array);
+	}
+
+	bool create(PyObject* out, Py_ssize_t rows, const Py_ssize_t* shape, int ndim)
+	{
+		std::vector<Py_ssize_t> full;
+		if (rows >= 0)
+			full.push_back(rows);
+		full.insert(full.end(), shape, shape + ndim);
+
+		if (out != NULL && out != Py_None) {
+			Py_INCREF(out);
+			array = out;
+		}
+		else {
+			PyObject* dims = PyTuple_New((Py_ssize_t)full.size());
+			if (dims == NULL)
+				return false;
+			for (size_t i = 0; i < full.size(); i++)
+				PyTuple_SET_ITEM(dims, i, PyLong_FromSsize_t(full[i]));
+			array = PyObject_CallMethod(numpyModule, "empty", "Os", dims, "float64");
+			Py_DECREF(dims);
+			if (array == NULL)
+				return false;
+		}
+
+		if (PyObject_GetBuffer(array, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE) < 0)
+			return false;
+		hasView = true;
+
+		// "d", or with a byte order prefix
+		size_t n = view.format ? std::strlen(view.format) : 0;
+		bool valid = view.itemsize == sizeof(double) && n > 0 && view.format[n - 1] == 'd' && view.ndim == (int)full.size();
+		for (int i = 0; valid && i < view.ndim; i++)
+			valid = view.shape[i] == full[i];
+		if (!valid) {
+			PyErr_Format(PyExc_ValueError, "out: expected a C contiguous float64 array of shape %s",
+				shapeString(&full[0], (int)full.size()).c_str());
+			return false;
+		}
+		return true;
+	}
+
+	double* data() const { return (double*)view.buf; }
+
+	PyObject* release()
+	{
+		PyBuffer_Release(&view);
+		hasView = false;
+		PyObject* result = array;
+		array = NULL;
+		return result;
+	}
+};
+
+/////////////////////////////////////////////////
+// THREADS
+/////////////////////////////////////////////////
+
+// Runs evaluate(begin, end) over the rows, split in a few chunks per thread
+// so they end together, without the GIL. rows < 0 (no row axis) is one row.
+template <class F>
+static void evaluateRows(Py_ssize_t rows, int threadCount, const F& evaluate)
+{
+	if (rows < 0)
+		rows = 1;
+	if (rows == 0)
+		return;
+	if (threadCount <= 0)
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	Py_ssize_t chunk = std::max((Py_ssize_t)1, rows / (threadCount * 8));
+	Py_ssize_t chunks = (rows + chunk - 1) / chunk;
+
+	Py_BEGIN_ALLOW_THREADS
+	if (threadCount == 1 || chunks <= 1)
+		evaluate((Py_ssize_t)0, rows);
+	else {
+		std::atomic<Py_ssize_t> next(0);
+		std::vector<std::thread> threads;
+		for (int n = 0; n < std::min((Py_ssize_t)threadCount, chunks); n++) {
+			threads.push_back(std::thread([&]() {
+				for (Py_ssize_t i = next++; i < chunks; i = next++)
+					evaluate(i * chunk, std::min(rows, (i + 1) * chunk));
+			}));
+		}
+		for (size_t n = 0; n < threads.size(); n++)
+			threads[n].join();
+	}
+	Py_END_ALLOW_THREADS
+}
+
+/////////////////////////////////////////////////
+// IKFK2BONE
+/////////////////////////////////////////////////
+
+PyDoc_STRVAR(ikfk2BoneDoc,
+"ikfk2Bone(root=None, ikref=None, upv=None, fk0=None, fk1=None, fk2=None, parent=None,\n"
+"          blend=0.0, interpolation=0, lengthA=0.0, lengthB=0.0, negate=False, roll=0.0,\n"
+"          scaleA=1.0, scaleB=1.0, maxstretch=1.5, softness=0.0, slide=0.5, reverse=0.0,\n"
+"          *, threads=0, out=None)\n"
+"\n"
+"mgear_ikfk2Bone over rows of inputs. The matrices are (4, 4) or (n, 4, 4),\n"
+"parent (4, 4, 4) or (n, 4, 4, 4) holds inAparent, inBparent, inCenterparent\n"
+"and inEffparent, the sliders are scalars or (n,). roll is in degrees.\n"
+"Returns outA, outB, outCenter and outEff: (4, 4, 4) or (n, 4, 4, 4).");
+
+static PyObject* pyIkfk2Bone(PyObject*, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = { "root", "ikref", "upv", "fk0", "fk1", "fk2", "parent",
+		"blend", "interpolation", "lengthA", "lengthB", "negate", "roll", "scaleA", "scaleB",
+		"maxstretch", "softness", "slide", "reverse", "threads", "out", NULL };
+	PyObject* objects[19] = { NULL };
+	int threadCount = 0;
+	PyObject* out = NULL;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOOOOOOOOOOOOOOOOOO$iO:ikfk2Bone", (char**)keywords,
+			&objects[0], &objects[1], &objects[2], &objects[3], &objects[4], &objects[5], &objects[6],
+			&objects[7], &objects[8], &objects[9], &objects[10], &objects[11], &objects[12], &objects[13],
+			&objects[14], &objects[15], &objects[16], &objects[17], &objects[18], &threadCount, &out))
+		return NULL;
+
+	s_Argument a[19];
+	const s_Argument* all[19];
+	for (int i = 0; i < 19; i++) {
+		Py_ssize_t matrix[2] = { 4, 4 };
+		Py_ssize_t parent[3] = { 4, 4, 4 };
+		bool read = i < 6 ? readArgument(objects[i], keywords[i], matrix, 2, a[i])
+			: i == 6 ? readArgument(objects[i], keywords[i], parent, 3, a[i])
+			: readArgument(objects[i], keywords[i], NULL, 0, a[i]);
+		if (!read)
+			return NULL;
+		all[i] = &a[i];
+	}
+	Py_ssize_t rows;
+	if (!rowCount(all, 19, rows))
+		return NULL;
+
+	s_Result result;
+	const Py_ssize_t shape[3] = { 4, 4, 4 };
+	if (!result.create(out, rows, shape, 3))
+		return NULL;
+	double* data = result.data();
+
+	evaluateRows(rows, threadCount, [&](Py_ssize_t begin, Py_ssize_t end) {
+		s_IkFk2BoneInputs in;
+		const s_IkFk2BoneInputs defaults;
+		for (Py_ssize_t r = begin; r < end; r++) {
+			a[0].matrix(r, in.root);
+			a[1].matrix(r, in.ikref);
+			a[2].matrix(r, in.upv);
+			a[3].matrix(r, in.fk0);
+			a[4].matrix(r, in.fk1);
+			a[5].matrix(r, in.fk2);
+			if (a[6].data)
+				std::memcpy(in.parent, a[6].row(r), 64 * sizeof(double));
+
+			// the node reads the sliders as floats
+			in.blend = (float)a[7].value(r, defaults.blend);
+			in.interpolation = (int)a[8].value(r, defaults.interpolation);
+			in.lengthA = (float)a[9].value(r, defaults.lengthA);
+			in.lengthB = (float)a[10].value(r, defaults.lengthB);
+			in.negate = a[11].value(r, defaults.negate) != 0.0;
+			in.roll = (float)a[12].value(r, defaults.roll);
+			in.scaleA = (float)a[13].value(r, defaults.scaleA);
+			in.scaleB = (float)a[14].value(r, defaults.scaleB);
+			in.maxstretch = (float)a[15].value(r, defaults.maxstretch);
+			in.softness = (float)a[16].value(r, defaults.softness);
+			in.slide = (float)a[17].value(r, defaults.slide);
+			in.reverse = (float)a[18].value(r, defaults.reverse);
+
+			ikfk2Bone(in, (double(*)[4][4])(data + r * 64));
+		}
+	});
+
+	return result.release();
+}
+
+/////////////////////////////////////////////////
+// ROLLSPLINEKINE
+/////////////////////////////////////////////////
+
+PyDoc_STRVAR(rollSplineKineDoc,
+"rollSplineKine(inputs, ctlParent=None, inputsRoll=None, outputParent=None, u=0.0,\n"
+"               resample=False, subdiv=10, absolute=False, *, threads=0, out=None)\n"
+"\n"
+"mgear_rollSplineKine over rows of inputs. inputs and ctlParent are\n"
+"(count, 4, 4) or (n, count, 4, 4) with at least two controlers, inputsRoll\n"
+"(count,) or (n, count) in degrees, outputParent (4, 4) or (n, 4, 4), the\n"
+"other sliders scalars or (n,). ctlParent defaults to identity matrices.\n"
+"Returns output: (4, 4) or (n, 4, 4).");
+
+static PyObject* pyRollSplineKine(PyObject*, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = { "inputs", "ctlParent", "inputsRoll", "outputParent",
+		"u", "resample", "subdiv", "absolute", "threads", "out", NULL };
+	PyObject* objects[8] = { NULL };
+	int threadCount = 0;
+	PyObject* out = NULL;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOOOOOO$iO:rollSplineKine", (char**)keywords,
+			&objects[0], &objects[1], &objects[2], &objects[3], &objects[4], &objects[5], &objects[6],
+			&objects[7], &threadCount, &out))
+		return NULL;
+
+	// inputs sets the controler count of the others
+	s_Argument a[8];
+	const s_Argument* all[8];
+	Py_ssize_t matrices[3] = { -1, 4, 4 };
+	if (!readArgument(objects[0], keywords[0], matrices, 3, a[0]))
+		return NULL;
+	Py_ssize_t count = matrices[0];
+	if (count < 2) {
+		PyErr_SetString(PyExc_ValueError, "inputs: rollSplineKine needs at least two controlers");
+		return NULL;
+	}
+	for (int i = 0; i < 8; i++) {
+		Py_ssize_t parents[3] = { count, 4, 4 };
+		Py_ssize_t matrix[2] = { 4, 4 };
+		bool read = i == 0 ? true
+			: i == 1 ? readArgument(objects[i], keywords[i], parents, 3, a[i])
+			: i == 2 ? readArgument(objects[i], keywords[i], &count, 1, a[i])
+			: i == 3 ? readArgument(objects[i], keywords[i], matrix, 2, a[i])
+			: readArgument(objects[i], keywords[i], NULL, 0, a[i]);
+		if (!read)
+			return NULL;
+		all[i] = &a[i];
+	}
+	Py_ssize_t rows;
+	if (!rowCount(all, 8, rows))
+		return NULL;
+
+	s_Result result;
+	const Py_ssize_t shape[2] = { 4, 4 };
+	if (!result.create(out, rows, shape, 2))
+		return NULL;
+	double* data = result.data();
+
+	// identity controler parents when missing
+	std::vector<double> identities(count * 16);
+	for (Py_ssize_t i = 0; i < count; i++)
+		identityMatrix4((double(*)[4])&identities[i * 16]);
+
+	evaluateRows(rows, threadCount, [&](Py_ssize_t begin, Py_ssize_t end) {
+		std::vector<double> roll(count, 0.0);
+		s_RollSplineKineInputs in;
+		const s_RollSplineKineInputs defaults;
+		in.inputsRoll = &roll[0];
+		in.count = (int)count;
+		for (Py_ssize_t r = begin; r < end; r++) {
+			in.inputs = (const double(*)[4][4])a[0].row(r);
+			in.ctlParent = (const double(*)[4][4])(a[1].data ? a[1].row(r) : &identities[0]);
+			if (a[2].data) {
+				const double* values = a[2].row(r);
+				for (Py_ssize_t j = 0; j < count; j++)
+					roll[j] = (float)values[j];
+			}
+			a[3].matrix(r, in.outputParent);
+			in.u = (float)a[4].value(r, defaults.u);
+			in.resample = a[5].value(r, defaults.resample) != 0.0;
+			in.subdiv = (int)a[6].value(r, defaults.subdiv);
+			in.absolute = a[7].value(r, defaults.absolute) != 0.0;
+
+			rollSplineKine(in, (double(*)[4])(data + r * 16));
+		}
+	});
+
+	return result.release();
+}
+
+/////////////////////////////////////////////////
+// MODULE
+/////////////////////////////////////////////////
+
+static PyMethodDef methods[] = {
+	{ "ikfk2Bone", (PyCFunction)(void(*)(void))pyIkfk2Bone, METH_VARARGS | METH_KEYWORDS, ikfk2BoneDoc },
+	{ "rollSplineKine", (PyCFunction)(void(*)(void))pyRollSplineKine, METH_VARARGS | METH_KEYWORDS, rollSplineKineDoc },
+	{ NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef moduleDef = {
+	PyModuleDef_HEAD_INIT,
+	"mgear_kernels",
+	"mGear solver kernels over NumPy arrays, evaluated in parallel without the GIL.",
+	-1,
+	methods,
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+PyMODINIT_FUNC PyInit_mgear_kernels(void)
+{
+	numpyModule = PyImport_ImportModule("numpy");
+	if (numpyModule == NULL)
+		return NULL;
+	return PyModule_Create(&moduleDef);
+}
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Replays the recorded poses of tools/regression through each solver kernel
+# and compares the outputs with the golden files. The nodes without a kernel
+# (mgear_<nodeType>[.case].csv) are run by mgear_node, their outputs are
+# compared the same way. Build mgear_bake and mgear_node first (see
+# tools/mgear_bake.cpp and tools/mgear_node.cpp), then from the repository
+# root:
+#     tools/regression/check.sh [path/to/mgear_bake] [-node path/to/mgear_node]
+#         [-update] [-perf]
+# mgear_node is looked for next to mgear_bake, the node checks are skipped
+# without it.
+# -update records new golden files, after an intended change.
+# -perf also compares the cost of a row of each kernel with baseline.txt
+# (records it with -update). The costs are relative to a reference workload
+# timed in the same run, but the ratio still moves a little from one CPU to
+# another: it's opt-in, for a quiet machine, not for every build.
+
+BAKE=./mgear_bake
+case "$1" in
+	-*|"") ;;
+	*) BAKE=$1; shift ;;
+esac
+NODE=$(dirname "$BAKE")/mgear_node
+UPDATE=
+BASELINE=
+DIR=$(dirname "$0")
+while [ $# -gt 0 ]; do
+	case "$1" in
+		-node) NODE=$2; shift ;;
+		-update) UPDATE=-update ;;
+		-perf) BASELINE="-baseline $DIR/baseline.txt" ;;
+		*) echo "usage: check.sh [mgear_bake] [-node mgear_node] [-update] [-perf]" >&2; exit 2 ;;
+	esac
+	shift
+done
+
+status=0
+for solver in ikfk2Bone rollSplineKine matrixConstraint intMatrix slideCurve2 percentageToU springNode rotationalSpringNode; do
+	"$BAKE" check "$solver" "$DIR/$solver.csv" "$DIR/$solver.golden.csv" $BASELINE $UPDATE || status=1
+done
+
+if [ ! -x "$NODE" ]; then
+	echo "no $NODE, the node checks are skipped"
+	exit $status
+fi
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+for input in "$DIR"/mgear_*.csv; do
+	case "$input" in
+		*.golden.csv) continue ;;
+	esac
+	name=$(basename "$input" .csv)
+	nodeType=${name%%.*}
+	"$BAKE" convert "$input" "$TMP/$name.pose" > /dev/null &&
+		"$NODE" "$nodeType" "$TMP/$name.pose" "$TMP/$name.out.pose" > /dev/null &&
+		"$BAKE" diff "$TMP/$name.out.pose" "$DIR/$name.golden.csv" $UPDATE || status=1
+done
+exit $status
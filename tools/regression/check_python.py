@@ -0,0 +1,110 @@
+"""Smoke checks of the mgear_kernels Python module (tools/mgear_python.cpp).
+
+Replays the ikfk2Bone and rollSplineKine recordings of tools/regression
+through the module and compares with the golden files, then checks the
+argument handling: broadcasting, out=, threads, empty rows and errors.
+Build the module first, then from the repository root:
+    python3 tools/regression/check_python.py [module directory]
+Exits 1 on the first failure.
+"""
+import os
+import sys
+
+import numpy as np
+
+DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, sys.argv[1] if len(sys.argv) > 1 else os.getcwd())
+import mgear_kernels  # noqa: E402
+
+
+def load(name):
+    with open(os.path.join(DIR, name)) as f:
+        lines = [line for line in f.read().split("\n") if line.strip()]
+    names = lines[0].split(",")
+    rows = np.array([[float(x) for x in line.split(",")] for line in lines[1:]])
+    return dict((n, rows[:, i]) for i, n in enumerate(names)), len(rows)
+
+
+def matrices(channels, name, rows):
+    if name + "[0]" not in channels:
+        return None
+    return np.stack([channels["%s[%d]" % (name, i)] for i in range(16)], 1).reshape(rows, 4, 4)
+
+
+def expect(condition, message):
+    if not condition:
+        print("FAIL " + message)
+        sys.exit(1)
+    print("ok   " + message)
+
+
+def expectError(call, message):
+    try:
+        call()
+    except ValueError:
+        print("ok   " + message)
+        return
+    print("FAIL " + message)
+    sys.exit(1)
+
+
+def ikfk2BoneArguments():
+    channels, rows = load("ikfk2Bone.csv")
+    kwargs = {}
+    for name in ("root", "ikref", "upv", "fk0", "fk1", "fk2"):
+        kwargs[name] = matrices(channels, name, rows)
+    parents = [matrices(channels, name, rows) for name in ("inAparent", "inBparent", "inCenterparent", "inEffparent")]
+    if any(p is not None for p in parents):
+        identity = np.broadcast_to(np.eye(4), (rows, 4, 4))
+        kwargs["parent"] = np.stack([identity if p is None else p for p in parents], 1)
+    for name in ("blend", "interpolation", "lengthA", "lengthB", "negate", "roll", "scaleA", "scaleB",
+                 "maxstretch", "softness", "slide", "reverse"):
+        if name in channels:
+            kwargs[name] = channels[name]
+    golden, _ = load("ikfk2Bone.golden.csv")
+    expected = np.stack([matrices(golden, name, rows) for name in ("outA", "outB", "outCenter", "outEff")], 1)
+    return kwargs, expected
+
+
+def rollSplineKineArguments():
+    channels, rows = load("rollSplineKine.csv")
+    count = 0
+    while "inputs[%d][0]" % count in channels:
+        count += 1
+    kwargs = {"inputs": np.stack([matrices(channels, "inputs[%d]" % i, rows) for i in range(count)], 1)}
+    if "inputsRoll[0]" in channels:
+        kwargs["inputsRoll"] = np.stack([channels["inputsRoll[%d]" % i] for i in range(count)], 1)
+    if "outputParent[0]" in channels:
+        kwargs["outputParent"] = matrices(channels, "outputParent", rows)
+    for name in ("u", "resample", "subdiv", "absolute"):
+        if name in channels:
+            kwargs[name] = channels[name]
+    golden, _ = load("rollSplineKine.golden.csv")
+    return kwargs, matrices(golden, "output", rows)
+
+
+def main():
+    kwargs, expected = ikfk2BoneArguments()
+    result = mgear_kernels.ikfk2Bone(**kwargs)
+    expect(np.allclose(result, expected, rtol=1e-9, atol=1e-9), "ikfk2Bone matches the golden file")
+    expect(np.array_equal(mgear_kernels.ikfk2Bone(threads=1, **kwargs), result), "ikfk2Bone on one thread")
+
+    kwargs, expected = rollSplineKineArguments()
+    result = mgear_kernels.rollSplineKine(**kwargs)
+    expect(np.allclose(result, expected, rtol=1e-9, atol=1e-9), "rollSplineKine matches the golden file")
+    out = np.empty_like(result)
+    expect(mgear_kernels.rollSplineKine(out=out, **kwargs) is out and np.array_equal(out, result), "out= is written in place")
+
+    expect(mgear_kernels.ikfk2Bone(blend=1.0).shape == (4, 4, 4), "no row axis without row arguments")
+    expect(mgear_kernels.ikfk2Bone(blend=[0.0, 1.0]).shape == (2, 4, 4, 4), "a row axis from a slider")
+    expect(mgear_kernels.ikfk2Bone(root=np.zeros((0, 4, 4))).shape == (0, 4, 4, 4), "ikfk2Bone over zero rows")
+    expect(mgear_kernels.rollSplineKine(np.zeros((0, 3, 4, 4))).shape == (0, 4, 4), "rollSplineKine over zero rows")
+
+    expectError(lambda: mgear_kernels.ikfk2Bone(root=np.zeros((3, 3))), "a wrong matrix shape is rejected")
+    expectError(lambda: mgear_kernels.ikfk2Bone(blend=[0.0, 1.0], roll=[0.0, 1.0, 2.0]), "row counts must agree")
+    expectError(lambda: mgear_kernels.rollSplineKine(np.zeros((1, 4, 4))), "rollSplineKine needs two controlers")
+    expectError(lambda: mgear_kernels.ikfk2Bone(out=np.zeros((4, 4, 4), np.float32)), "out must be float64")
+
+
+if __name__ == "__main__":
+    main()